@@ -0,0 +1,42 @@
+#version 330 core
+
+// source level, the caller restricts the base and max level of the texture to it,
+// so that the level that is currently rendered to is never sampled
+uniform sampler2D source;
+
+out float depth;
+
+void main()
+{
+    ivec2 sourceSize = textureSize(source, 0);
+    ivec2 sourcePosition = ivec2(gl_FragCoord.xy) * 2;
+
+    // keep the furthest depth of the 2x2 texels this texel covers
+    float result = max(max(texelFetch(source, sourcePosition, 0).r,
+                           texelFetch(source, sourcePosition + ivec2(1, 0), 0).r),
+                       max(texelFetch(source, sourcePosition + ivec2(0, 1), 0).r,
+                           texelFetch(source, sourcePosition + ivec2(1, 1), 0).r));
+
+    // odd sizes are rounded down, so the extra row and column need to be folded in to stay conservative
+    bool oddWidth = (sourceSize.x & 1) != 0;
+    bool oddHeight = (sourceSize.y & 1) != 0;
+
+    if (oddWidth)
+    {
+        result = max(result, max(texelFetch(source, sourcePosition + ivec2(2, 0), 0).r,
+                                 texelFetch(source, sourcePosition + ivec2(2, 1), 0).r));
+    }
+
+    if (oddHeight)
+    {
+        result = max(result, max(texelFetch(source, sourcePosition + ivec2(0, 2), 0).r,
+                                 texelFetch(source, sourcePosition + ivec2(1, 2), 0).r));
+    }
+
+    if (oddWidth && oddHeight)
+    {
+        result = max(result, texelFetch(source, sourcePosition + ivec2(2, 2), 0).r);
+    }
+
+    depth = result;
+}
\ No newline at end of file
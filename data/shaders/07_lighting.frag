@@ -0,0 +1,62 @@
+#version 330 core
+
+// lighting shader of the per mesh path, the renderer compiles one variant per combination of material features
+// (HAS_DIFFUSE_MAP, HAS_SPECULAR_MAP, HAS_EMISSIVE_MAP), see ShaderVariants
+// VIRTUAL_TEXTURE takes the diffuse color from the virtual texture instead of the diffuse map
+
+#include "include/material.glsl"
+#include "include/lights.glsl"
+
+#ifdef VIRTUAL_TEXTURE
+#include "include/virtualTexture.glsl"
+#endif
+
+struct Material {
+    sampler2D textureDiffuse0;
+    sampler2D textureSpecular0;
+    sampler2D textureEmissive0;
+};
+
+uniform Material material;
+
+// see MaterialTable, the block of the material of every draw is bound by the render queue
+layout (std140) uniform MaterialBlock {
+    vec4 diffuseColor;
+    vec4 specularColor;
+    vec4 emissiveColor;
+    uint features;
+    float shininess;
+} materialBlock;
+
+in vec3 normal;
+in vec3 fragmentViewPosition;
+in vec2 textureCoordinates;
+
+out vec4 color;
+
+MaterialParameters loadMaterialParameters()
+{
+    return MaterialParameters(materialBlock.diffuseColor, materialBlock.specularColor, materialBlock.emissiveColor,
+                              materialBlock.features, materialBlock.shininess);
+}
+
+vec3 sampleDiffuseMap()
+{
+#ifdef VIRTUAL_TEXTURE
+    return sampleVirtualTexture(textureCoordinates);
+#else
+    return vec3(texture(material.textureDiffuse0, textureCoordinates));
+#endif
+}
+
+vec3 sampleSpecularMap()
+{
+    return vec3(texture(material.textureSpecular0, textureCoordinates));
+}
+
+vec3 sampleEmissiveMap()
+{
+    return vec3(texture(material.textureEmissive0, textureCoordinates));
+}
+
+#include "include/lightingMain.glsl"
\ No newline at end of file
@@ -0,0 +1,84 @@
+#version 430 core
+#ifdef BINDLESS_TEXTURES
+#extension GL_ARB_bindless_texture : require
+#endif
+
+// lighting shader of the multi draw indirect path, takes the material of every draw from the material buffers,
+// with its textures either as layers of texture arrays (TEXTURE_ARRAYS) or as bindless handles (BINDLESS_TEXTURES)
+// variants are compiled per combination of material features like for 07_lighting.frag
+
+#include "include/material.glsl"
+#include "include/lights.glsl"
+
+// see MaterialTextures
+struct MaterialTextures {
+    uvec2 diffuseHandle;
+    uvec2 specularHandle;
+    uint diffuseLayer;
+    uint specularLayer;
+};
+
+in vec3 normal;
+in vec3 fragmentViewPosition;
+in vec2 textureCoordinates;
+flat in uint materialIndex;
+
+out vec4 color;
+
+layout (std430, binding = 1) readonly buffer MaterialBuffer {
+    MaterialTextures materials[];
+};
+
+// parameter blocks of all materials, materialStride vec4 apart (see MaterialTable)
+layout (std430, binding = 2) readonly buffer MaterialParameterBuffer {
+    vec4 materialBlocks[];
+};
+uniform int materialStride;
+
+#ifdef TEXTURE_ARRAYS
+// bound once per batch, the draws of a batch only differ in their layers
+uniform sampler2DArray diffuseArray;
+uniform sampler2DArray specularArray;
+#endif
+
+MaterialParameters loadMaterialParameters()
+{
+    int base = int(materialIndex) * materialStride;
+
+    MaterialParameters parameters;
+    parameters.diffuseColor = materialBlocks[base];
+    parameters.specularColor = materialBlocks[base + 1];
+    parameters.emissiveColor = materialBlocks[base + 2];
+    parameters.features = floatBitsToUint(materialBlocks[base + 3].x);
+    parameters.shininess = materialBlocks[base + 3].y;
+    return parameters;
+}
+
+vec3 sampleDiffuseMap()
+{
+    MaterialTextures textures = materials[materialIndex];
+#ifdef BINDLESS_TEXTURES
+    // the material index is the same for a whole draw, so the handles are dynamically uniform
+    return vec3(texture(sampler2D(textures.diffuseHandle), textureCoordinates));
+#else
+    return vec3(texture(diffuseArray, vec3(textureCoordinates, textures.diffuseLayer)));
+#endif
+}
+
+vec3 sampleSpecularMap()
+{
+    MaterialTextures textures = materials[materialIndex];
+#ifdef BINDLESS_TEXTURES
+    return vec3(texture(sampler2D(textures.specularHandle), textureCoordinates));
+#else
+    return vec3(texture(specularArray, vec3(textureCoordinates, textures.specularLayer)));
+#endif
+}
+
+// emissive maps aren't part of the material buffer, materials with one only get their emissive color
+vec3 sampleEmissiveMap()
+{
+    return vec3(1.0);
+}
+
+#include "include/lightingMain.glsl"
\ No newline at end of file
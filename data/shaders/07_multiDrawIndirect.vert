@@ -0,0 +1,38 @@
+#version 430 core
+layout (location = 0) in vec3 pos;
+layout (location = 1) in vec3 iNormal;
+layout (location = 2) in vec2 iTextureCoordinates;
+layout (location = 3) in uint drawId; // per instance attribute, offset by the base instance of the indirect command
+
+out vec3 normal;
+out vec3 fragmentViewPosition;
+out vec2 textureCoordinates;
+
+struct DrawData {
+    mat4 model;
+    uint materialIndex;
+};
+
+// written by the render queue every frame, one entry per draw (and instance)
+layout (std430, binding = 0) readonly buffer DrawDataBuffer {
+    DrawData draws[];
+};
+
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+    mat4 model = draws[drawId].model;
+
+    vec4 viewSpace = view * model * vec4(pos, 1.0);
+    fragmentViewPosition = vec3(viewSpace);
+
+    // the normal matrix is the transpose of the inverse of the upper-left 3x3 of the model * view matrix
+    // (model * view because we are doing lighting in view space)
+    normal = mat3(transpose(inverse(view * model))) * iNormal;
+
+    textureCoordinates = iTextureCoordinates;
+
+    gl_Position = projection * viewSpace;
+}
\ No newline at end of file
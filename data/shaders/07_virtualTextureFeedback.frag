@@ -0,0 +1,34 @@
+#version 330 core
+
+// records which page of a virtual texture every pixel needs, must pick pages the same way as
+// sampleVirtualTexture in include/virtualTexture.glsl
+struct VirtualTexture {
+    vec2 pageCount;     // pages of level 0
+    float levelCount;
+    float tileSize;     // texels of a page without its border
+    int index;
+};
+
+in vec2 textureCoordinates;
+
+out vec4 color;
+
+uniform VirtualTexture virtualTexture;
+
+// the feedback framebuffer is smaller than the screen, which makes the derivatives larger
+uniform float feedbackLodBias;
+
+void main()
+{
+    vec2 texels = textureCoordinates * virtualTexture.pageCount * virtualTexture.tileSize;
+    vec2 dx = dFdx(texels);
+    vec2 dy = dFdy(texels);
+    float level = clamp(floor(0.5 * log2(max(dot(dx, dx), dot(dy, dy))) + feedbackLodBias),
+                        0.0, virtualTexture.levelCount - 1.0);
+
+    vec2 levelPages = max(floor(virtualTexture.pageCount / exp2(level)), vec2(1.0));
+    vec2 page = floor(fract(textureCoordinates) * levelPages);
+
+    // stored as bytes, alpha is the texture index plus one so that the cleared background is no request
+    color = vec4(page, level, float(virtualTexture.index + 1)) / 255.0;
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+// main of the lighting shaders, the including shader declares the inputs normal, fragmentViewPosition,
+// textureCoordinates and the output color, and provides the material of the fragment:
+//   MaterialParameters loadMaterialParameters();
+//   vec3 sampleDiffuseMap();  (HAS_DIFFUSE_MAP)
+//   vec3 sampleSpecularMap(); (HAS_SPECULAR_MAP)
+//   vec3 sampleEmissiveMap(); (HAS_EMISSIVE_MAP)
+// features the material doesn't have are compiled out, so they cost neither texture fetches nor maths
+
+void main()
+{
+    materialParameters = loadMaterialParameters();
+
+#ifdef HAS_DIFFUSE_MAP
+    diffuseTexel = sampleDiffuseMap();
+#else
+    diffuseTexel = materialParameters.diffuseColor.rgb;
+#endif
+
+#ifdef HAS_SPECULAR_MAP
+    vec3 specularTexel = sampleSpecularMap();
+#else
+    vec3 specularTexel = materialParameters.specularColor.rgb;
+#endif
+
+    vec3 normalizedNormal = normalize(normal);
+    vec3 viewDirection = normalize(-fragmentViewPosition);
+
+    vec3 result = vec3(0.0);
+
+    result += calculateDirectionalLight(directionalLight, normalizedNormal, viewDirection, specularTexel);
+
+#if NUM_POINT_LIGHTS > 0
+    for (int i = 0; i < NUM_POINT_LIGHTS; i++) {
+        result += calculatePointLight(pointLights[i], normalizedNormal, fragmentViewPosition, viewDirection, specularTexel);
+    }
+#endif
+
+    result += calculateSpotLight(spotLight, normalizedNormal, fragmentViewPosition, specularTexel);
+
+    // add light that the object itself emits
+#ifdef HAS_EMISSIVE_MAP
+    result += materialParameters.emissiveColor.rgb * sampleEmissiveMap();
+#else
+    result += materialParameters.emissiveColor.rgb;
+#endif
+
+    color = vec4(result, 1.0);
+}
\ No newline at end of file
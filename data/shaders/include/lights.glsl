@@ -0,0 +1,129 @@
+// light sources of the scene and their contribution to a fragment
+// needs include/material.glsl, NUM_POINT_LIGHTS is defined by the renderer
+
+struct DirectionalLight {
+    vec3 direction;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+struct PointLight {
+    vec3 position;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+
+    float constant;
+    float linear;
+    float quadratic;
+};
+
+struct SpotLight {
+    vec3 position;
+    vec3 direction;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+
+    float constant;
+    float linear;
+    float quadratic;
+    float cutOff;       // cos value of the light cut-off angle
+    float outerCutOff;  // cos value of the cut-off angle of the outer, smoothed ring
+};
+
+uniform DirectionalLight directionalLight;
+#if NUM_POINT_LIGHTS > 0
+uniform PointLight pointLights[NUM_POINT_LIGHTS];
+#endif
+uniform SpotLight spotLight;
+
+vec3 calculateDirectionalLight(DirectionalLight light, vec3 normal, vec3 viewDirection, vec3 specularTexel) {
+    // ambient
+    vec3 ambient = light.ambient * diffuseTexel;
+
+    // diffuse
+    vec3 lightDirection = normalize(-light.direction);
+    float lightAngle = max(dot(normal, lightDirection), 0.0); // take max, because value becomes negative if angle is over 90 degrees
+    vec3 diffuse = light.diffuse * lightAngle * diffuseTexel;
+
+    // specular
+    // reflect needs the light direction to be from the light to the fragment, not the other way around so we negate it
+    // reflect returns the direction the light reflects, based on the normal and the light direction
+    vec3 reflectDirection = reflect(-lightDirection, normal);
+
+    // calculate specularity by calculating the angle between the reflection and the camera direction
+    // the power decides how 'shiny' the reflection will look like
+    float specularity = pow(max(dot(viewDirection, reflectDirection), 0.0), materialParameters.shininess);
+    vec3 specular = light.specular * specularity * specularTexel;
+
+    return ambient + diffuse + specular;
+}
+
+vec3 calculatePointLight(PointLight light, vec3 normal, vec3 fragmentViewPosition, vec3 viewDirection, vec3 specularTexel) {
+    float distance = length(light.position - fragmentViewPosition);
+    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+
+    // ambient
+    vec3 ambient = light.ambient * attenuation * diffuseTexel;
+
+    // diffuse
+    vec3 lightDirection = normalize(light.position - fragmentViewPosition);
+    float lightAngle = max(dot(normal, lightDirection), 0.0); // take max, because value becomes negative if angle is over 90 degrees
+    vec3 diffuse = light.diffuse * attenuation * lightAngle * diffuseTexel;
+
+    // specular
+    // reflect needs the light direction to be from the light to the fragment, not the other way around so we negate it
+    // reflect returns the direction the light reflects, based on the normal and the light direction
+    vec3 reflectDirection = reflect(-lightDirection, normal);
+
+    // calculate specularity by calculating the angle between the reflection and the camera direction
+    // the power decides how 'shiny' the reflection will look like
+    float specularity = pow(max(dot(viewDirection, reflectDirection), 0.0), materialParameters.shininess);
+    vec3 specular = light.specular * attenuation * specularity * specularTexel;
+
+    return ambient + diffuse + specular;
+}
+
+vec3 calculateSpotLight(SpotLight light, vec3 normal, vec3 fragmentViewPosition, vec3 specularTexel)
+{
+    // vector pointing from light to fragment
+    vec3 lightDirection = normalize(light.position - fragmentViewPosition);
+
+    // angle between light direction and direction of the fragment
+    float lightFragmentAngle = dot(lightDirection, normalize(-light.direction));
+
+    // difference in angle between the cut-off and the outer cut-off
+    float lightInterpolationRange = light.cutOff - light.outerCutOff;
+
+    // ((theta - gamma) / epsilon)
+    float intensity = clamp((lightFragmentAngle - light.outerCutOff) / lightInterpolationRange, 0.0, 1.0);
+
+    float distance = length(light.position - fragmentViewPosition);
+    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+
+    // ambient
+    vec3 ambient = light.ambient * diffuseTexel;
+
+    // diffuse
+    float lightAngle = max(dot(normal, lightDirection), 0.0); // take max, because value becomes negative if angle is over 90 degrees
+    vec3 diffuse = light.diffuse * attenuation * intensity * lightAngle * diffuseTexel;
+
+    // specular
+    vec3 viewDirection = normalize(-fragmentViewPosition);
+
+    // reflect needs the light direction to be from the light to the fragment, not the other way around so we negate it
+    // reflect returns the direction the light reflects, based on the normal and the light direction
+    vec3 reflectDirection = reflect(-lightDirection, normal);
+
+    // calculate specularity by calculating the angle between the reflection and the camera direction
+    // the power decides how 'shiny' the reflection will look like
+    float specularity = pow(max(dot(viewDirection, reflectDirection), 0.0), materialParameters.shininess);
+    vec3 specular = light.specular * attenuation * intensity * specularity * specularTexel;
+
+    return ambient + diffuse + specular;
+}
\ No newline at end of file
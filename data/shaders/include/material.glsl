@@ -0,0 +1,12 @@
+// parameters of the material of the current draw, see MaterialParameters
+struct MaterialParameters {
+    vec4 diffuseColor;
+    vec4 specularColor;
+    vec4 emissiveColor;
+    uint features;
+    float shininess;
+};
+
+// filled in by main before any lighting is calculated
+MaterialParameters materialParameters;
+vec3 diffuseTexel;
\ No newline at end of file
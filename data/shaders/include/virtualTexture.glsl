@@ -0,0 +1,36 @@
+// sampling of a virtual texture, see VirtualTextureSystem
+// must pick pages the same way as 07_virtualTextureFeedback.frag
+
+struct VirtualTexture {
+    sampler2D pageTable;
+    sampler2D cache;
+    vec2 pageCount;         // pages of level 0
+    float levelCount;
+    float tileSize;         // texels of a page without its border
+    float borderSize;
+    float cachePagesPerRow;
+};
+
+uniform VirtualTexture virtualTexture;
+
+vec3 sampleVirtualTexture(vec2 coordinates)
+{
+    // level of detail from the screen space derivatives in texels of level 0, the same as the feedback pass
+    vec2 texels = coordinates * virtualTexture.pageCount * virtualTexture.tileSize;
+    vec2 dx = dFdx(texels);
+    vec2 dy = dFdy(texels);
+    float level = clamp(floor(0.5 * log2(max(dot(dx, dx), dot(dy, dy)))), 0.0, virtualTexture.levelCount - 1.0);
+
+    // the page table points to the cached page, or to the closest coarser page if it's missing
+    vec2 wrapped = fract(coordinates);
+    vec2 levelPages = max(floor(virtualTexture.pageCount / exp2(level)), vec2(1.0));
+    vec4 entry = floor(texelFetch(virtualTexture.pageTable, ivec2(wrapped * levelPages), int(level)) * 255.0 + 0.5);
+
+    // position inside the page that's actually cached, which can be on a coarser level
+    vec2 residentPages = max(floor(virtualTexture.pageCount / exp2(entry.z)), vec2(1.0));
+    vec2 pageCoordinates = fract(wrapped * residentPages);
+
+    float pageSize = virtualTexture.tileSize + 2.0 * virtualTexture.borderSize;
+    vec2 cacheTexel = entry.xy * pageSize + virtualTexture.borderSize + pageCoordinates * virtualTexture.tileSize;
+    return vec3(textureLod(virtualTexture.cache, cacheTexel / (virtualTexture.cachePagesPerRow * pageSize), 0.0));
+}
\ No newline at end of file
@@ -0,0 +1,120 @@
+#include "AllocationTracker.h"
+
+#include <cstdlib>
+#include <new>
+
+#include "config.h"
+
+// only linked into the renderer, the tools built with the asset library keep the allocators of the C library
+
+#ifdef ALLOCATION_TRACKING
+
+// the replacements take the memory from the C library without going through the hooked malloc, so every
+// allocation is counted once
+#ifdef __GLIBC__
+extern "C"
+{
+    void *__libc_malloc(std::size_t size);
+    void *__libc_calloc(std::size_t count, std::size_t size);
+    void *__libc_realloc(void *pointer, std::size_t size);
+    void __libc_free(void *pointer);
+
+    void *malloc(std::size_t size) noexcept
+    {
+        AllocationTracker::countAllocation(size);
+        return __libc_malloc(size);
+    }
+
+    void *calloc(std::size_t count, std::size_t size) noexcept
+    {
+        AllocationTracker::countAllocation(count * size);
+        return __libc_calloc(count, size);
+    }
+
+    void *realloc(void *pointer, std::size_t size) noexcept
+    {
+        AllocationTracker::countAllocation(size);
+        return __libc_realloc(pointer, size);
+    }
+
+    void free(void *pointer) noexcept
+    {
+        __libc_free(pointer);
+    }
+}
+
+namespace
+{
+    void *allocateUncounted(std::size_t size)
+    {
+        return __libc_malloc(size);
+    }
+
+    void freeUncounted(void *pointer)
+    {
+        __libc_free(pointer);
+    }
+} // namespace
+#else
+namespace
+{
+    void *allocateUncounted(std::size_t size)
+    {
+        return std::malloc(size);
+    }
+
+    void freeUncounted(void *pointer)
+    {
+        std::free(pointer);
+    }
+} // namespace
+#endif
+
+void *operator new(std::size_t size)
+{
+    AllocationTracker::countAllocation(size);
+    void *pointer = allocateUncounted(size > 0 ? size : 1);
+    if (!pointer)
+    {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    AllocationTracker::countAllocation(size);
+    return allocateUncounted(size > 0 ? size : 1);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+    return operator new(size, std::nothrow);
+}
+
+void operator delete(void *pointer) noexcept
+{
+    freeUncounted(pointer);
+}
+
+void operator delete[](void *pointer) noexcept
+{
+    freeUncounted(pointer);
+}
+
+void operator delete(void *pointer, std::size_t) noexcept
+{
+    freeUncounted(pointer);
+}
+
+void operator delete[](void *pointer, std::size_t) noexcept
+{
+    freeUncounted(pointer);
+}
+
+#endif
\ No newline at end of file
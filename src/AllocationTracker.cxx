@@ -0,0 +1,236 @@
+#include "AllocationTracker.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+#include "config.h"
+
+#if defined(ALLOCATION_TRACKING) && defined(__GLIBC__)
+#include <execinfo.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    const std::size_t SUBSYSTEM_COUNT{static_cast<std::size_t>(AllocationSubsystem::count)};
+
+    // frames until the caches, pools and arenas reached their size
+    const std::size_t WARM_UP_FRAMES{120};
+
+    // stacks sampled per frame and frames reported in detail, the count of allocating frames goes on
+    const std::size_t MAX_SAMPLES{4};
+    const int MAX_SAMPLE_DEPTH{24};
+    const std::size_t MAX_REPORTED_FRAMES{10};
+
+    struct Sample
+    {
+        void *frames[MAX_SAMPLE_DEPTH];
+        int depth;
+        std::size_t bytes;
+        AllocationSubsystem subsystem;
+        std::atomic<bool> ready;
+    };
+
+    // the hooks (AllocationHooks.cxx) run before main and on every thread, so everything here is constant initialized
+    thread_local AllocationSubsystem currentSubsystem{AllocationSubsystem::other};
+    thread_local bool frameThread{false};
+    thread_local bool insideTracker{false};
+
+    std::atomic<std::size_t> totalAllocations{0};
+    std::atomic<std::size_t> frameAllocations{0};
+    std::atomic<std::size_t> frameBytes{0};
+    std::atomic<std::size_t> subsystemAllocations[SUBSYSTEM_COUNT];
+
+    std::atomic<bool> sampling{false};
+    std::atomic<std::size_t> sampleCount{0};
+    Sample samples[MAX_SAMPLES];
+
+    std::size_t frameNumber{0};
+    std::size_t allocatingFrameCount{0};
+    AllocationTracker::FrameCounts lastFrame;
+
+    void reportFrame(const AllocationTracker::FrameCounts &counts)
+    {
+        std::cerr << "Frame " << frameNumber << " allocated " << counts.allocations << " times (" << counts.bytes
+                  << " bytes) after the warm-up:";
+        for (std::size_t i = 0; i < SUBSYSTEM_COUNT; i++)
+        {
+            if (counts.perSubsystem[i] > 0)
+            {
+                std::cerr << " " << AllocationTracker::getSubsystemName(static_cast<AllocationSubsystem>(i)) << " "
+                          << counts.perSubsystem[i];
+            }
+        }
+        std::cerr << std::endl;
+
+        for (Sample &sample : samples)
+        {
+            if (!sample.ready.load(std::memory_order_acquire))
+            {
+                continue;
+            }
+
+            std::cerr << "  " << sample.bytes << " bytes in " << AllocationTracker::getSubsystemName(sample.subsystem)
+                      << ":" << std::endl;
+#if defined(ALLOCATION_TRACKING) && defined(__GLIBC__)
+            // writes straight to the file descriptor, backtrace_symbols would allocate
+            backtrace_symbols_fd(sample.frames, sample.depth, STDERR_FILENO);
+#endif
+        }
+    }
+} // namespace
+
+AllocationTracker::Scope::Scope(AllocationSubsystem subsystem)
+    : previous(currentSubsystem)
+{
+    currentSubsystem = subsystem;
+}
+
+AllocationTracker::Scope::~Scope()
+{
+    currentSubsystem = previous;
+}
+
+#ifdef ALLOCATION_TRACKING
+void AllocationTracker::countAllocation(std::size_t bytes)
+{
+    totalAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (!frameThread || insideTracker)
+    {
+        return;
+    }
+
+    frameAllocations.fetch_add(1, std::memory_order_relaxed);
+    frameBytes.fetch_add(bytes, std::memory_order_relaxed);
+    subsystemAllocations[static_cast<std::size_t>(currentSubsystem)].fetch_add(1, std::memory_order_relaxed);
+
+    if (!sampling.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+
+    std::size_t index = sampleCount.fetch_add(1, std::memory_order_relaxed);
+    if (index < MAX_SAMPLES && !samples[index].ready.load(std::memory_order_acquire))
+    {
+        Sample &sample = samples[index];
+#ifdef __GLIBC__
+        insideTracker = true;
+        sample.depth = backtrace(sample.frames, MAX_SAMPLE_DEPTH);
+        insideTracker = false;
+#else
+        sample.depth = 0;
+#endif
+        sample.bytes = bytes;
+        sample.subsystem = currentSubsystem;
+        sample.ready.store(true, std::memory_order_release);
+    }
+}
+#endif
+
+bool AllocationTracker::isEnabled()
+{
+#ifdef ALLOCATION_TRACKING
+    return true;
+#else
+    return false;
+#endif
+}
+
+void AllocationTracker::setFrameThread(bool enabled)
+{
+    frameThread = enabled;
+}
+
+void AllocationTracker::beginFrame()
+{
+#if defined(ALLOCATION_TRACKING) && defined(__GLIBC__)
+    if (frameNumber == 0)
+    {
+        // the first backtrace loads the unwinder, which allocates
+        void *frames[1];
+        insideTracker = true;
+        backtrace(frames, 1);
+        insideTracker = false;
+    }
+#endif
+}
+
+void AllocationTracker::endFrame()
+{
+    if (!isEnabled())
+    {
+        return;
+    }
+
+    // the report itself isn't counted
+    insideTracker = true;
+
+    lastFrame.allocations = frameAllocations.exchange(0);
+    lastFrame.bytes = frameBytes.exchange(0);
+    for (std::size_t i = 0; i < SUBSYSTEM_COUNT; i++)
+    {
+        lastFrame.perSubsystem[i] = subsystemAllocations[i].exchange(0);
+    }
+    frameNumber++;
+
+    if (frameNumber > WARM_UP_FRAMES && lastFrame.allocations > 0)
+    {
+        allocatingFrameCount++;
+        if (allocatingFrameCount <= MAX_REPORTED_FRAMES)
+        {
+            reportFrame(lastFrame);
+        }
+
+#ifdef ALLOCATION_TRACKING_FAIL
+        std::cerr << "The frame loop allocated after the warm-up, aborting" << std::endl;
+        std::abort();
+#endif
+    }
+
+    // samples are only taken once the warm-up is over, they are collected again for the next frame
+    for (Sample &sample : samples)
+    {
+        sample.ready.store(false, std::memory_order_release);
+    }
+    sampleCount = 0;
+    sampling = frameNumber >= WARM_UP_FRAMES;
+
+    insideTracker = false;
+}
+
+const AllocationTracker::FrameCounts &AllocationTracker::getLastFrame()
+{
+    return lastFrame;
+}
+
+std::size_t AllocationTracker::getTotalAllocations()
+{
+    return totalAllocations;
+}
+
+std::size_t AllocationTracker::getAllocatingFrameCount()
+{
+    return allocatingFrameCount;
+}
+
+const char *AllocationTracker::getSubsystemName(AllocationSubsystem subsystem)
+{
+    switch (subsystem)
+    {
+    case AllocationSubsystem::other:
+        return "other";
+    case AllocationSubsystem::hotReload:
+        return "hot reload";
+    case AllocationSubsystem::framePipeline:
+        return "frame pipeline";
+    case AllocationSubsystem::renderQueue:
+        return "render queue";
+    case AllocationSubsystem::imgui:
+        return "imgui";
+    default:
+        return "unknown";
+    }
+}
\ No newline at end of file
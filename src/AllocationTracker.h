@@ -0,0 +1,90 @@
+#ifndef ALLOCATIONTRACKER_H
+#define ALLOCATIONTRACKER_H
+
+#include <cstddef>
+
+/**
+ * Parts of the frame that allocations are attributed to, see AllocationTracker::Scope.
+ */
+enum class AllocationSubsystem
+{
+    other,
+    hotReload,
+    framePipeline,
+    renderQueue,
+    imgui,
+    count
+};
+
+/**
+ * Counts heap allocations per frame and per subsystem, when the build has the allocation_tracking option enabled.
+ * The global operator new and delete are replaced and, with glibc, malloc, calloc and realloc as well, so C
+ * libraries like ImGui are counted too. Only the threads taking part in the frame are counted per frame: the render
+ * thread and the workers of the job system (see setFrameThread), background threads only add to the total.
+ * The replacements are in AllocationHooks.cxx, which only the renderer links, so the tools built with the asset
+ * library don't count anything.
+ * After a warm-up, every frame that still allocates is reported on stderr with a few sampled call stacks.
+ * With allocation_tracking=fail the process aborts on the first such frame, so a steady state frame loop that
+ * allocates can't go unnoticed.
+ * Without the option all functions do nothing.
+ */
+namespace AllocationTracker
+{
+    struct FrameCounts
+    {
+        std::size_t allocations{0};
+        std::size_t bytes{0};
+        std::size_t perSubsystem[static_cast<std::size_t>(AllocationSubsystem::count)]{};
+    };
+
+    /**
+     * Attributes the allocations of the calling thread to a subsystem while it exists.
+     */
+    class Scope
+    {
+    public:
+        explicit Scope(AllocationSubsystem subsystem);
+        virtual ~Scope();
+
+        // remove copy functions
+        Scope(Scope const &) = delete;
+        void operator=(Scope const &) = delete;
+
+    private:
+        AllocationSubsystem previous;
+    };
+
+    bool isEnabled();
+
+    /**
+     * Count the allocations of the calling thread in the frame statistics.
+     */
+    void setFrameThread(bool enabled);
+
+    void beginFrame();
+
+    /**
+     * Finish the counts of the frame and check them once the warm-up is over.
+     */
+    void endFrame();
+
+    /**
+     * Counts of the last finished frame, and the allocations of all threads since the start.
+     */
+    const FrameCounts &getLastFrame();
+    std::size_t getTotalAllocations();
+
+    /**
+     * Frames after the warm-up that allocated.
+     */
+    std::size_t getAllocatingFrameCount();
+
+    const char *getSubsystemName(AllocationSubsystem subsystem);
+
+    /**
+     * Count an allocation of the calling thread, called by the hooks. Only exists with the option.
+     */
+    void countAllocation(std::size_t bytes);
+} // namespace AllocationTracker
+
+#endif
\ No newline at end of file
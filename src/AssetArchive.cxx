@@ -0,0 +1,247 @@
+#include "AssetArchive.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <boost/filesystem.hpp>
+
+constexpr char AssetArchive::MAGIC[];
+constexpr std::size_t AssetArchive::ALIGNMENT;
+
+namespace
+{
+    const char PATH_PREFIX[]{"archive:"};
+    const std::size_t PATH_PREFIX_SIZE{sizeof(PATH_PREFIX) - 1};
+
+    std::uint64_t alignUp(std::uint64_t offset, std::uint64_t alignment)
+    {
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+} // namespace
+
+AssetArchive &AssetArchive::getInstance()
+{
+    static AssetArchive instance;
+    return instance;
+}
+
+const char *AssetArchive::getFileName()
+{
+    return "assets.pack";
+}
+
+bool AssetArchive::open(const std::string &path)
+{
+    header = nullptr;
+    slots = nullptr;
+    names = nullptr;
+    if (!file.open(path))
+    {
+        return false;
+    }
+
+    // only the header is checked here, entries are checked when they're looked up, so opening stays cheap
+    const unsigned char *data = file.getData();
+    std::uint64_t size = file.getSize();
+    const Header *candidate = reinterpret_cast<const Header *>(data);
+    if (size < sizeof(Header) || std::memcmp(candidate->magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        candidate->version != VERSION || candidate->slotCount == 0 ||
+        (candidate->slotCount & (candidate->slotCount - 1)) != 0 || candidate->slotsOffset % alignof(Slot) != 0 ||
+        candidate->slotsOffset > size || candidate->slotCount > (size - candidate->slotsOffset) / sizeof(Slot) ||
+        candidate->namesOffset > size || candidate->namesSize > size - candidate->namesOffset)
+    {
+        std::cerr << "'" << path << "' isn't an asset archive of version " << VERSION << std::endl;
+        file.close();
+        return false;
+    }
+
+    header = candidate;
+    slots = reinterpret_cast<const Slot *>(data + header->slotsOffset);
+    names = reinterpret_cast<const char *>(data + header->namesOffset);
+    return true;
+}
+
+bool AssetArchive::isOpen() const
+{
+    return header != nullptr;
+}
+
+bool AssetArchive::find(const std::string &name, const unsigned char *&data, std::size_t &size) const
+{
+    if (!header)
+    {
+        return false;
+    }
+
+    // open addressing with linear probing, the table is at most half full so the runs are short
+    std::uint64_t hash = hashName(name);
+    std::uint64_t mask = header->slotCount - 1;
+    for (std::uint64_t probe = 0; probe < header->slotCount; probe++)
+    {
+        const Slot &slot = slots[(hash + probe) & mask];
+        if (slot.nameSize == 0)
+        {
+            return false;
+        }
+
+        if (slot.hash != hash || slot.nameSize != name.size() || slot.nameOffset > header->namesSize ||
+            slot.nameSize > header->namesSize - slot.nameOffset ||
+            std::memcmp(names + slot.nameOffset, name.data(), name.size()) != 0)
+        {
+            continue;
+        }
+
+        if (slot.offset > file.getSize() || slot.size > file.getSize() - slot.offset)
+        {
+            std::cerr << "Entry '" << name << "' of the asset archive is truncated" << std::endl;
+            return false;
+        }
+
+        data = file.getData() + slot.offset;
+        size = static_cast<std::size_t>(slot.size);
+        return true;
+    }
+
+    return false;
+}
+
+bool AssetArchive::contains(const std::string &name) const
+{
+    const unsigned char *data;
+    std::size_t size;
+    return find(name, data, size);
+}
+
+std::size_t AssetArchive::getEntryCount() const
+{
+    return header ? static_cast<std::size_t>(header->entryCount) : 0;
+}
+
+std::string AssetArchive::makePath(const std::string &name)
+{
+    return PATH_PREFIX + name;
+}
+
+bool AssetArchive::isArchivePath(const std::string &path)
+{
+    return path.compare(0, PATH_PREFIX_SIZE, PATH_PREFIX) == 0;
+}
+
+std::string AssetArchive::getName(const std::string &path)
+{
+    // paths built from archive paths (e.g. the texture next to a model) can contain .. and .
+    std::string name = isArchivePath(path) ? path.substr(PATH_PREFIX_SIZE) : path;
+    std::replace(name.begin(), name.end(), '\\', '/');
+    return boost::filesystem::path(name).lexically_normal().generic_string();
+}
+
+std::uint64_t AssetArchive::hashName(const std::string &name)
+{
+    // FNV-1a
+    std::uint64_t hash = 14695981039346656037ull;
+    for (char character : name)
+    {
+        hash ^= static_cast<unsigned char>(character);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+void AssetArchiveWriter::add(const std::string &name, std::vector<unsigned char> data)
+{
+    for (Entry &entry : entries)
+    {
+        if (entry.name == name)
+        {
+            entry.data = std::move(data);
+            return;
+        }
+    }
+    entries.push_back({name, std::move(data)});
+}
+
+std::size_t AssetArchiveWriter::getEntryCount() const
+{
+    return entries.size();
+}
+
+bool AssetArchiveWriter::write(const std::string &path) const
+{
+    using Header = AssetArchive::Header;
+    using Slot = AssetArchive::Slot;
+
+    // at most half of the slots are used
+    std::uint64_t slotCount = 1;
+    while (slotCount < entries.size() * 2)
+    {
+        slotCount *= 2;
+    }
+
+    Header header;
+    std::memcpy(header.magic, AssetArchive::MAGIC, sizeof(AssetArchive::MAGIC));
+    header.version = AssetArchive::VERSION;
+    header.entryCount = entries.size();
+    header.slotCount = slotCount;
+    header.slotsOffset = sizeof(Header);
+    header.namesOffset = header.slotsOffset + slotCount * sizeof(Slot);
+    header.namesSize = 0;
+    for (const Entry &entry : entries)
+    {
+        header.namesSize += entry.name.size();
+    }
+
+    std::vector<Slot> slots(slotCount, Slot{0, 0, 0, 0, 0});
+    std::string names;
+    names.reserve(header.namesSize);
+    std::vector<std::uint64_t> offsets;
+    offsets.reserve(entries.size());
+    std::uint64_t offset = alignUp(header.namesOffset + header.namesSize, AssetArchive::ALIGNMENT);
+    for (const Entry &entry : entries)
+    {
+        std::uint64_t hash = AssetArchive::hashName(entry.name);
+        std::uint64_t index = hash & (slotCount - 1);
+        while (slots[index].nameSize != 0)
+        {
+            index = (index + 1) & (slotCount - 1);
+        }
+        slots[index] = {hash, offset, entry.data.size(), names.size(), entry.name.size()};
+
+        names += entry.name;
+        offsets.push_back(offset);
+        offset = alignUp(offset + entry.data.size(), AssetArchive::ALIGNMENT);
+    }
+
+    std::string temporaryPath = path + ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char *>(slots.data()), slots.size() * sizeof(Slot));
+        file.write(names.data(), names.size());
+
+        // the gaps in front of the entries are filled with zeros
+        std::uint64_t position = header.namesOffset + header.namesSize;
+        std::vector<char> padding(AssetArchive::ALIGNMENT, 0);
+        for (std::size_t i = 0; i < entries.size(); i++)
+        {
+            file.write(padding.data(), offsets[i] - position);
+            file.write(reinterpret_cast<const char *>(entries[i].data.data()), entries[i].data.size());
+            position = offsets[i] + entries[i].data.size();
+        }
+
+        if (!file)
+        {
+            std::cerr << "Failed writing asset archive '" << temporaryPath << "'" << std::endl;
+            return false;
+        }
+    }
+
+    boost::system::error_code error;
+    boost::filesystem::rename(temporaryPath, path, error);
+    if (error)
+    {
+        std::cerr << "Failed moving asset archive to '" << path << "': " << error.message() << std::endl;
+        return false;
+    }
+    return true;
+}
\ No newline at end of file
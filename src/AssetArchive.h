@@ -0,0 +1,137 @@
+#ifndef ASSETARCHIVE_H
+#define ASSETARCHIVE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+
+/**
+ * Read only archive of the application data, baked by the oglr-pack tool (see pack.cxx).
+ * The archive is mapped once, its table of contents is a hash table of the entry names stored in the file,
+ * so entries are found in constant time without reading or building anything when it's opened.
+ * Every entry starts on a 4 KiB boundary, which keeps it page aligned in memory.
+ * Entries are data files under their path relative to the data directory (e.g. "shaders/04_color.frag"),
+ * processed variants of a file add a suffix to its name (e.g. "objects/sphere/sphere.obj|model").
+ * DirectoryHelper::locateData returns archive paths (see makePath) for files in the archive,
+ * MappedFile opens them as views into the archive.
+ */
+class AssetArchive
+{
+public:
+    static AssetArchive &getInstance();
+
+    /**
+     * Name of the archive in the data directories.
+     */
+    static const char *getFileName();
+
+    /**
+     * Map an archive, one that was opened before is closed first, which invalidates all views into it.
+     * @return False if the file can't be mapped or isn't an archive of this version.
+     */
+    bool open(const std::string &path);
+
+    bool isOpen() const;
+
+    /**
+     * Look up an entry, the data stays valid as long as the archive is open.
+     * @return False if the archive has no entry with that name.
+     */
+    bool find(const std::string &name, const unsigned char *&data, std::size_t &size) const;
+
+    bool contains(const std::string &name) const;
+
+    std::size_t getEntryCount() const;
+
+    /**
+     * Paths of entries start with a prefix that can't be a file name on disk, so they aren't probed for.
+     */
+    static std::string makePath(const std::string &name);
+    static bool isArchivePath(const std::string &path);
+
+    /**
+     * Name of the entry an archive path refers to, normalized like the names stored in the archive.
+     */
+    static std::string getName(const std::string &path);
+
+    /**
+     * Hash of the entry names, FNV-1a.
+     */
+    static std::uint64_t hashName(const std::string &name);
+
+    // remove some functions for the singleton
+    AssetArchive(AssetArchive const &) = delete;
+    void operator=(AssetArchive const &) = delete;
+
+private:
+    friend class AssetArchiveWriter;
+
+    static constexpr char MAGIC[4]{'O', 'G', 'P', 'K'};
+
+    // needs to be increased whenever the layout changes, older archives are ignored then
+    static constexpr std::uint32_t VERSION{1};
+
+    static constexpr std::size_t ALIGNMENT{4096};
+
+    struct Header
+    {
+        char magic[4];
+        std::uint32_t version;
+        std::uint64_t entryCount;
+        std::uint64_t slotCount; // a power of two
+        std::uint64_t slotsOffset;
+        std::uint64_t namesOffset;
+        std::uint64_t namesSize;
+    };
+
+    // slot of the hash table, empty slots have no name
+    struct Slot
+    {
+        std::uint64_t hash;
+        std::uint64_t offset;
+        std::uint64_t size;
+        std::uint64_t nameOffset; // into the names
+        std::uint64_t nameSize;
+    };
+
+    MappedFile file;
+    const Header *header{nullptr};
+    const Slot *slots{nullptr};
+    const char *names{nullptr};
+
+    AssetArchive() = default;
+};
+
+/**
+ * Collects the entries of an archive and writes it, for the oglr-pack tool.
+ */
+class AssetArchiveWriter
+{
+public:
+    /**
+     * Add an entry, a later entry with the same name replaces the earlier one.
+     */
+    void add(const std::string &name, std::vector<unsigned char> data);
+
+    std::size_t getEntryCount() const;
+
+    /**
+     * Write the archive through a temporary file, so a failed write never leaves a broken archive behind.
+     * @return False if the file couldn't be written.
+     */
+    bool write(const std::string &path) const;
+
+private:
+    struct Entry
+    {
+        std::string name;
+        std::vector<unsigned char> data;
+    };
+
+    std::vector<Entry> entries;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,107 @@
+#include "Culling.h"
+
+#include <limits>
+
+BoundingBox BoundingBox::transform(const glm::mat4 &matrix) const
+{
+    // transform center and extent instead of all eight corners (Arvo)
+    glm::vec3 center = (min + max) * 0.5f;
+    glm::vec3 extent = (max - min) * 0.5f;
+
+    glm::vec3 newCenter = glm::vec3(matrix * glm::vec4(center, 1.0f));
+    glm::vec3 newExtent;
+    for (int i = 0; i < 3; i++)
+    {
+        newExtent[i] = glm::abs(matrix[0][i]) * extent.x +
+                       glm::abs(matrix[1][i]) * extent.y +
+                       glm::abs(matrix[2][i]) * extent.z;
+    }
+
+    BoundingBox result;
+    result.min = newCenter - newExtent;
+    result.max = newCenter + newExtent;
+    return result;
+}
+
+BoundingBox BoundingBox::fromPositions(const glm::vec3 *positions, std::size_t count, std::size_t stride)
+{
+    BoundingBox box;
+    if (count == 0)
+    {
+        return box;
+    }
+
+    box.min = glm::vec3(std::numeric_limits<float>::max());
+    box.max = glm::vec3(std::numeric_limits<float>::lowest());
+
+    const char *data = reinterpret_cast<const char *>(positions);
+    for (std::size_t i = 0; i < count; i++)
+    {
+        const glm::vec3 &position = *reinterpret_cast<const glm::vec3 *>(data + i * stride);
+        box.min = glm::min(box.min, position);
+        box.max = glm::max(box.max, position);
+    }
+
+    return box;
+}
+
+Frustum::Frustum()
+{
+    // without a matrix everything is visible
+    planes.fill(glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+}
+
+Frustum::Frustum(const glm::mat4 &viewProjection)
+{
+    // glm matrices are column major, so rows need to be assembled manually
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; i++)
+    {
+        rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+    }
+
+    planes[0] = rows[3] + rows[0]; // left
+    planes[1] = rows[3] - rows[0]; // right
+    planes[2] = rows[3] + rows[1]; // bottom
+    planes[3] = rows[3] - rows[1]; // top
+    planes[4] = rows[3] + rows[2]; // near
+    planes[5] = rows[3] - rows[2]; // far
+
+    for (glm::vec4 &plane : planes)
+    {
+        plane = plane / glm::length(glm::vec3(plane));
+    }
+}
+
+bool Frustum::isVisible(const BoundingBox &box) const
+{
+    for (const glm::vec4 &plane : planes)
+    {
+        // the corner that lies furthest along the plane normal
+        glm::vec3 positive(plane.x > 0.0f ? box.max.x : box.min.x,
+                           plane.y > 0.0f ? box.max.y : box.min.y,
+                           plane.z > 0.0f ? box.max.z : box.min.z);
+
+        if (glm::dot(glm::vec3(plane), positive) + plane.w < 0.0f)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+const std::array<glm::vec4, 6> &Frustum::getPlanes() const
+{
+    return planes;
+}
+
+std::vector<bool> Culling::cullBoxes(const Frustum &frustum, const std::vector<BoundingBox> &boxes)
+{
+    std::vector<bool> visible(boxes.size());
+    for (std::size_t i = 0; i < boxes.size(); i++)
+    {
+        visible[i] = frustum.isVisible(boxes[i]);
+    }
+    return visible;
+}
\ No newline at end of file
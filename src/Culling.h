@@ -0,0 +1,61 @@
+#ifndef CULLING_H
+#define CULLING_H
+
+#include <array>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+/**
+ * Axis aligned bounding box.
+ */
+struct BoundingBox
+{
+    glm::vec3 min{0.0f};
+    glm::vec3 max{0.0f};
+
+    /**
+     * Smallest axis aligned box around this box after it has been transformed by the matrix.
+     */
+    BoundingBox transform(const glm::mat4 &matrix) const;
+
+    /**
+     * Box enclosing all given positions.
+     */
+    static BoundingBox fromPositions(const glm::vec3 *positions, std::size_t count, std::size_t stride);
+};
+
+/**
+ * The six planes of a view frustum, extracted from a view projection matrix (Gribb/Hartmann).
+ * Plane normals point to the inside, so a point p is inside a plane if dot(normal, p) + distance >= 0.
+ */
+class Frustum
+{
+public:
+    Frustum();
+    Frustum(const glm::mat4 &viewProjection);
+
+    /**
+     * Conservative test, boxes that intersect a corner of the frustum may be reported as visible.
+     */
+    bool isVisible(const BoundingBox &box) const;
+
+    /**
+     * The planes as (normal.x, normal.y, normal.z, distance), order: left, right, bottom, top, near, far.
+     */
+    const std::array<glm::vec4, 6> &getPlanes() const;
+
+private:
+    std::array<glm::vec4, 6> planes;
+};
+
+namespace Culling
+{
+    /**
+     * CPU reference implementation of the culling done by the GPU culling pass.
+     * @return One entry per box, true if it's visible.
+     */
+    std::vector<bool> cullBoxes(const Frustum &frustum, const std::vector<BoundingBox> &boxes);
+} // namespace Culling
+
+#endif
\ No newline at end of file
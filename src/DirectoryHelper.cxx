@@ -1,12 +1,20 @@
 #include "DirectoryHelper.h"
 
+#include <cstdint>
 #include <iostream>
+#include <utility>
 //#include <filesystem> needs C++17, currently blocked on MXE due to old glibmm
 #include <boost/filesystem.hpp>
 #include <glibmm-2.4/glibmm/miscutils.h>
 
+#include "AssetArchive.h"
 #include "config.h"
 
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
 DirectoryHelper::DirectoryHelper()
 {
     // add data dirs based on glib enumerated paths
@@ -46,6 +54,30 @@ DirectoryHelper::DirectoryHelper()
     {
         configPaths.push_back(systemConfigDir + "/" PROJECT_NAME "/");
     }
+
+    std::string userCacheDir = Glib::get_user_cache_dir();
+    if (!userCacheDir.empty())
+    {
+        cachePath = userCacheDir + "/" PROJECT_NAME "/";
+    }
+
+#ifdef __linux__
+    fileDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fileDescriptor < 0)
+    {
+        std::cerr << "Failed initializing inotify, file lookups won't be cached" << std::endl;
+    }
+#endif
+}
+
+DirectoryHelper::~DirectoryHelper()
+{
+#ifdef __linux__
+    if (fileDescriptor >= 0)
+    {
+        close(fileDescriptor);
+    }
+#endif
 }
 
 DirectoryHelper &DirectoryHelper::getInstance()
@@ -56,28 +88,22 @@ DirectoryHelper &DirectoryHelper::getInstance()
 
 std::string DirectoryHelper::locateData(const std::string &fileName) const
 {
-    for (const std::string &dataPath : dataPaths)
+    // a baked archive is a single lookup, without touching the file system
+    if (AssetArchive::getInstance().contains(fileName))
     {
-        std::string filePath = dataPath + fileName;
-        if (boost::filesystem::exists(filePath))
-        {
-            return filePath;
-        }
+        return AssetArchive::makePath(fileName);
     }
 
-    return "";
+    return locate(dataPaths, dataResults, fileName);
 }
 
 std::string DirectoryHelper::locateConfig(
     const std::string &fileName, bool suggestIfNotFound) const
 {
-    for (const std::string &configPath : configPaths)
+    std::string filePath = locate(configPaths, configResults, fileName);
+    if (!filePath.empty())
     {
-        std::string filePath = configPath + fileName;
-        if (boost::filesystem::exists(filePath))
-        {
-            return filePath;
-        }
+        return filePath;
     }
 
     if (suggestIfNotFound)
@@ -100,8 +126,203 @@ std::string DirectoryHelper::locateConfig(
             }
         }
 
+        // the file is usually created right away, before the next update could report it
+        forget(configPaths[0] + fileName);
         return configPaths[0] + fileName;
     }
 
     return "";
+}
+
+std::string DirectoryHelper::locateCache(const std::string &fileName) const
+{
+    if (cachePath.empty())
+    {
+        return "";
+    }
+
+    if (!boost::filesystem::exists(cachePath))
+    {
+        try
+        {
+            boost::filesystem::create_directories(cachePath);
+        }
+        catch (boost::filesystem::filesystem_error &e)
+        {
+            std::cerr << "Failed creating cache directory " << e.path1() << "\n"
+                      << "\terror code: " << e.code().value()
+                      << " '" << e.code().message() << "'" << std::endl;
+            return "";
+        }
+    }
+
+    return cachePath + fileName;
+}
+
+void DirectoryHelper::update()
+{
+#ifdef __linux__
+    if (fileDescriptor < 0)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    bool changed = false;
+    alignas(inotify_event) char buffer[4096];
+    ssize_t length;
+    while ((length = read(fileDescriptor, buffer, sizeof(buffer))) > 0)
+    {
+        for (char *position = buffer; position < buffer + length;)
+        {
+            const inotify_event *event = reinterpret_cast<const inotify_event *>(position);
+            position += sizeof(inotify_event) + event->len;
+            changed = true;
+
+            // events were lost, nothing can be trusted anymore
+            if (event->mask & IN_Q_OVERFLOW)
+            {
+                listings.clear();
+                watchedListings.clear();
+                continue;
+            }
+
+            // the directory is listed and watched again when it's needed, which returns the same descriptor
+            auto watched = watchedListings.find(event->wd);
+            if (watched != watchedListings.end())
+            {
+                for (const std::string &directory : watched->second)
+                {
+                    listings.erase(directory);
+                }
+                watchedListings.erase(watched);
+            }
+        }
+    }
+
+    // results can depend on any listing, finding them again is cheap while the listings are kept
+    if (changed)
+    {
+        dataResults.clear();
+        configResults.clear();
+    }
+#endif
+}
+
+std::string DirectoryHelper::locate(const std::vector<std::string> &paths,
+                                    std::unordered_map<std::string, std::string> &results,
+                                    const std::string &fileName) const
+{
+    if (fileDescriptor < 0)
+    {
+        for (const std::string &path : paths)
+        {
+            std::string filePath = path + fileName;
+            if (boost::filesystem::exists(filePath))
+            {
+                return filePath;
+            }
+        }
+        return "";
+    }
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto cached = results.find(fileName);
+    if (cached != results.end())
+    {
+        return cached->second;
+    }
+
+    std::string result;
+    bool watched = true;
+    for (const std::string &path : paths)
+    {
+        std::string filePath = path + fileName;
+        bool listingWatched;
+        bool listed = isListed(filePath, listingWatched);
+        watched = watched && listingWatched;
+        if (listed)
+        {
+            result = filePath;
+            break;
+        }
+    }
+
+    if (watched)
+    {
+        results.emplace(fileName, result);
+    }
+    return result;
+}
+
+bool DirectoryHelper::isListed(const std::string &path, bool &watched) const
+{
+    watched = true;
+
+    boost::filesystem::path filePath(path);
+    std::string name = filePath.filename().string();
+
+    // the listing only has real names, not . or the empty name of a trailing slash
+    if (name.empty() || name == "." || name == "..")
+    {
+        return boost::filesystem::exists(filePath);
+    }
+
+    std::string directory = filePath.parent_path().string();
+    if (directory.empty())
+    {
+        directory = ".";
+    }
+
+    auto listing = listings.find(directory);
+    if (listing == listings.end())
+    {
+#ifdef __linux__
+        // the watch is added before the directory is listed, so files created in between are reported,
+        // a missing directory can only appear in an existing one, so the closest existing parent is watched
+        const std::uint32_t MASK = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF;
+        boost::filesystem::path watchedPath(directory);
+        while (!boost::filesystem::is_directory(watchedPath))
+        {
+            watchedPath = watchedPath.has_parent_path() ? watchedPath.parent_path() : boost::filesystem::path(".");
+        }
+        int watchDescriptor = inotify_add_watch(fileDescriptor, watchedPath.c_str(), MASK | IN_ONLYDIR);
+#endif
+
+        DirectoryListing newListing;
+        boost::system::error_code error;
+        boost::filesystem::directory_iterator entry(directory, error), end;
+        newListing.exists = !error;
+        for (; !error && entry != end; entry.increment(error))
+        {
+            newListing.names.insert(entry->path().filename().string());
+        }
+
+#ifdef __linux__
+        // an unwatched listing could never be updated, so it's not kept
+        if (watchDescriptor < 0)
+        {
+            watched = false;
+            return newListing.names.count(name) > 0;
+        }
+        watchedListings[watchDescriptor].push_back(directory);
+#endif
+
+        listing = listings.emplace(directory, std::move(newListing)).first;
+    }
+
+    return listing->second.names.count(name) > 0;
+}
+
+void DirectoryHelper::forget(const std::string &path) const
+{
+    if (fileDescriptor < 0)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    listings.erase(boost::filesystem::path(path).parent_path().string());
+    dataResults.clear();
+    configResults.clear();
 }
\ No newline at end of file
@@ -1,9 +1,19 @@
 #ifndef DATADIRHELPER_H
 #define DATADIRHELPER_H
 
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
+/**
+ * Locates the data, config and cache files of the application.
+ * Data and config lookups are cached where directories can be watched (inotify on Linux): the directories of the
+ * candidate paths are listed once when a lookup first needs them, and results are kept by file name, including
+ * files that weren't found. Changes to the listed directories drop the affected parts of the cache, they're seen
+ * after the next update. All functions can be called from any thread.
+ */
 class DirectoryHelper
 {
 public:
@@ -12,8 +22,9 @@ public:
     /**
      * The application data can be located in different locations based on system.
      * This method makes a best attempt at finding the correct location by iterating through the possible directories.
+     * Files in the AssetArchive are found there first, without probing any directory.
      * @param fileName Name (or relative path) of the data file that's being searched.
-     * @return The path to the data file if found, otherwise an empty string.
+     * @return The path to the data file if found (an archive path for archived files), otherwise an empty string.
      */
     std::string locateData(const std::string &fileName) const;
 
@@ -27,17 +38,72 @@ public:
      */
     std::string locateConfig(const std::string &fileName, bool suggestIfNotFound = false) const;
 
+    /**
+     * Files that can be regenerated at any time (like processed textures) are stored in the user cache directory.
+     * @param fileName Name (or relative path) of the cache file.
+     * @return The path of the cache file, whether it exists or not. The directory is created if needed,
+     * an empty string is returned if that fails.
+     */
+    std::string locateCache(const std::string &fileName) const;
+
+    /**
+     * Apply the changes to the listed directories since the last update to the cache, without blocking.
+     */
+    void update();
+
     // remove some functions for the singleton
     DirectoryHelper(DirectoryHelper const &) = delete;
     void operator=(DirectoryHelper const &) = delete;
 
+    virtual ~DirectoryHelper();
+
 private:
+    // names directly inside a directory
+    struct DirectoryListing
+    {
+        bool exists;
+        std::unordered_set<std::string> names;
+    };
+
     DirectoryHelper();
 
     static DirectoryHelper instance;
 
     std::vector<std::string> dataPaths;
     std::vector<std::string> configPaths;
+    std::string cachePath;
+
+    // inotify, nothing is cached without it
+    int fileDescriptor{-1};
+
+    mutable std::mutex cacheMutex;
+
+    // file name to path, empty if the file wasn't found
+    mutable std::unordered_map<std::string, std::string> dataResults;
+    mutable std::unordered_map<std::string, std::string> configResults;
+
+    mutable std::unordered_map<std::string, DirectoryListing> listings;
+
+    // watch descriptor to the listings that are dropped when the directory changes
+    mutable std::unordered_map<int, std::vector<std::string>> watchedListings;
+
+    /**
+     * Find a file in the first of the directories it exists in, through the cache if there is one.
+     */
+    std::string locate(const std::vector<std::string> &paths, std::unordered_map<std::string, std::string> &results,
+                       const std::string &fileName) const;
+
+    /**
+     * Whether a path exists according to the listing of its directory, which is listed and watched if needed.
+     * The cache mutex needs to be locked.
+     * @param watched Set to false if the directory can't be watched, the result mustn't be cached then.
+     */
+    bool isListed(const std::string &path, bool &watched) const;
+
+    /**
+     * Drop the listing of the directory of a path and all results, e.g. before the file is created.
+     */
+    void forget(const std::string &path) const;
 };
 
 #endif
\ No newline at end of file
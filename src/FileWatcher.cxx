@@ -0,0 +1,123 @@
+#include "FileWatcher.h"
+
+#include <algorithm>
+#include <iostream>
+#include <utility>
+#include <boost/filesystem.hpp>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+FileWatcher::FileWatcher()
+{
+#ifdef __linux__
+    fileDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fileDescriptor < 0)
+    {
+        std::cerr << "Failed initializing inotify, files won't be watched" << std::endl;
+    }
+#endif
+}
+
+FileWatcher::~FileWatcher()
+{
+#ifdef __linux__
+    if (fileDescriptor >= 0)
+    {
+        close(fileDescriptor);
+    }
+#endif
+}
+
+bool FileWatcher::isSupported() const
+{
+    return fileDescriptor >= 0;
+}
+
+bool FileWatcher::watch(const std::string &directory, Callback callback)
+{
+    if (!isSupported())
+    {
+        return false;
+    }
+
+    boost::system::error_code error;
+    std::string canonicalPath = boost::filesystem::canonical(directory, error).string();
+    if (error)
+    {
+        std::cerr << "Can't watch '" << directory << "': " << error.message() << std::endl;
+        return false;
+    }
+
+#ifdef __linux__
+    // writes end with IN_CLOSE_WRITE, editors that save through a temporary file end with IN_MOVED_TO
+    // created files aren't reported until they're closed, they may still be empty before
+    int watchDescriptor = inotify_add_watch(fileDescriptor, canonicalPath.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (watchDescriptor < 0)
+    {
+        std::cerr << "Can't watch '" << canonicalPath << "'" << std::endl;
+        return false;
+    }
+
+    // watching the same directory again returns the same descriptor
+    WatchedDirectory &watched = directories[watchDescriptor];
+    watched.path = canonicalPath;
+    watched.callbacks.push_back(std::move(callback));
+    return true;
+#else
+    return false;
+#endif
+}
+
+void FileWatcher::poll()
+{
+#ifdef __linux__
+    if (!isSupported())
+    {
+        return;
+    }
+
+    // changed files in the order they were first reported, without duplicates
+    std::vector<std::pair<int, std::string>> changes;
+
+    alignas(inotify_event) char buffer[4096];
+    ssize_t length;
+    while ((length = read(fileDescriptor, buffer, sizeof(buffer))) > 0)
+    {
+        for (char *position = buffer; position < buffer + length;)
+        {
+            const inotify_event *event = reinterpret_cast<const inotify_event *>(position);
+            position += sizeof(inotify_event) + event->len;
+
+            // only files are of interest, not the directory itself or subdirectories
+            if (event->len == 0 || (event->mask & IN_ISDIR))
+            {
+                continue;
+            }
+
+            std::pair<int, std::string> change(event->wd, event->name);
+            if (std::find(changes.begin(), changes.end(), change) == changes.end())
+            {
+                changes.push_back(std::move(change));
+            }
+        }
+    }
+
+    for (const auto &change : changes)
+    {
+        auto directory = directories.find(change.first);
+        if (directory == directories.end())
+        {
+            continue;
+        }
+
+        std::string path = directory->second.path + '/' + change.second;
+        for (const Callback &callback : directory->second.callbacks)
+        {
+            callback(path);
+        }
+    }
+#endif
+}
\ No newline at end of file
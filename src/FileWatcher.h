@@ -0,0 +1,59 @@
+#ifndef FILEWATCHER_H
+#define FILEWATCHER_H
+
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Reports files that were written or moved into watched directories (inotify on Linux).
+ * Directories are watched instead of single files, since most editors save by replacing the file,
+ * which would end a watch on the file itself.
+ * Changes are collected in the background by the kernel and handed out by poll, so callbacks always run on the
+ * thread that polls (usually the one that owns the OpenGL context).
+ * On other systems nothing is ever reported.
+ */
+class FileWatcher
+{
+public:
+    /**
+     * Gets the canonical path of the changed file.
+     */
+    using Callback = std::function<void(const std::string &)>;
+
+    FileWatcher();
+    virtual ~FileWatcher();
+
+    bool isSupported() const;
+
+    /**
+     * Watch the files directly inside a directory, subdirectories need to be watched on their own.
+     * @return False if the directory doesn't exist or can't be watched.
+     */
+    bool watch(const std::string &directory, Callback callback);
+
+    /**
+     * Call the callbacks of all changes since the last poll, without blocking.
+     * A file that changed several times (e.g. written in chunks) is only reported once per poll.
+     */
+    void poll();
+
+    // remove copy functions, the watcher owns a file descriptor
+    FileWatcher(FileWatcher const &) = delete;
+    void operator=(FileWatcher const &) = delete;
+
+private:
+    struct WatchedDirectory
+    {
+        std::string path; // canonical
+        std::vector<Callback> callbacks;
+    };
+
+    int fileDescriptor{-1};
+
+    // watch descriptor to directory
+    std::unordered_map<int, WatchedDirectory> directories;
+};
+
+#endif
\ No newline at end of file
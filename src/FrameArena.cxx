@@ -0,0 +1,106 @@
+#include "FrameArena.h"
+
+#include <algorithm>
+#include <cstdint>
+
+FrameArena::FrameArena(std::size_t capacity)
+    : block(new char[capacity]), capacity(capacity)
+{
+}
+
+FrameArena &FrameArena::getThreadArena()
+{
+    thread_local FrameArena arena;
+    return arena;
+}
+
+void *FrameArena::allocate(std::size_t bytes, std::size_t alignment)
+{
+    // the block comes from new, so it's aligned for every fundamental type and offsets can be aligned instead
+    std::size_t alignedOffset = (offset + alignment - 1) / alignment * alignment;
+    if (alignedOffset + bytes <= capacity)
+    {
+        offset = alignedOffset + bytes;
+        peak = std::max(peak, offset + overflowBytes);
+        return block.get() + alignedOffset;
+    }
+
+    // full, the rest of the frame gets its own blocks until the next reset grows the arena
+    overflowBlocks.emplace_back(new char[bytes + alignment]);
+    overflowBytes += bytes + alignment;
+    overflowCount++;
+    peak = std::max(peak, offset + overflowBytes);
+
+    char *memory = overflowBlocks.back().get();
+    std::size_t padding = (alignment - reinterpret_cast<std::uintptr_t>(memory) % alignment) % alignment;
+    return memory + padding;
+}
+
+void FrameArena::reset()
+{
+    if (!overflowBlocks.empty())
+    {
+        overflowBlocks.clear();
+        overflowBytes = 0;
+
+        // make room for the whole frame, with some headroom so a slowly growing frame doesn't grow it every time
+        capacity = peak + peak / 2;
+        block = std::unique_ptr<char[]>(new char[capacity]);
+    }
+    offset = 0;
+}
+
+std::size_t FrameArena::getUsed() const
+{
+    return offset + overflowBytes;
+}
+
+std::size_t FrameArena::getPeak() const
+{
+    return peak;
+}
+
+std::size_t FrameArena::getCapacity() const
+{
+    return capacity;
+}
+
+std::size_t FrameArena::getOverflowCount() const
+{
+    return overflowCount;
+}
+
+FrameArena::Scope::Scope(FrameArena &arena)
+    : arena(arena), offset(arena.offset), overflowBlocks(arena.overflowBlocks.size())
+{
+}
+
+FrameArena::Scope::~Scope()
+{
+    if (offset == 0 && overflowBlocks == 0)
+    {
+        // the arena was empty, so this is a reset, which also grows the arena if the scope overflowed it
+        arena.reset();
+    }
+    else if (arena.overflowBlocks.size() == overflowBlocks)
+    {
+        arena.offset = offset;
+    }
+    // otherwise the overflow blocks of the scope stay until the next reset
+}
+
+void appendNumber(FrameString &string, std::size_t number)
+{
+    char digits[20];
+    std::size_t count = 0;
+    do
+    {
+        digits[count++] = static_cast<char>('0' + number % 10);
+        number /= 10;
+    } while (number > 0);
+
+    while (count > 0)
+    {
+        string += digits[--count];
+    }
+}
\ No newline at end of file
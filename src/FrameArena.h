@@ -0,0 +1,149 @@
+#ifndef FRAMEARENA_H
+#define FRAMEARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * Bump allocator for temporaries that only live until the end of a frame.
+ * Allocating moves a pointer forward, freeing does nothing, everything is released at once by reset.
+ * When a frame needs more than the arena has, the rest comes from additional blocks and the next reset replaces
+ * them with one block large enough for the whole frame. So after the first frames the arena doesn't touch the heap.
+ * Every thread has its own arena (see getThreadArena), so no locking is needed.
+ */
+class FrameArena
+{
+public:
+    explicit FrameArena(std::size_t capacity = DEFAULT_CAPACITY);
+
+    /**
+     * The arena of the calling thread. The render thread resets it at the end of every frame, other threads
+     * release their temporaries with a Scope.
+     */
+    static FrameArena &getThreadArena();
+
+    void *allocate(std::size_t bytes, std::size_t alignment = alignof(std::max_align_t));
+
+    /**
+     * Release everything that was allocated, the memory must not be used anymore.
+     */
+    void reset();
+
+    /**
+     * Bytes allocated since the last reset, and the most that was allocated between two resets.
+     */
+    std::size_t getUsed() const;
+    std::size_t getPeak() const;
+    std::size_t getCapacity() const;
+
+    /**
+     * Blocks allocated from the heap because the arena was full, since it was created.
+     */
+    std::size_t getOverflowCount() const;
+
+    /**
+     * Releases the allocations of the arena made during its lifetime, so jobs can use the arena of their thread
+     * without waiting for the end of the frame. Scopes need to be nested.
+     */
+    class Scope
+    {
+    public:
+        explicit Scope(FrameArena &arena = getThreadArena());
+        virtual ~Scope();
+
+        // remove copy functions
+        Scope(Scope const &) = delete;
+        void operator=(Scope const &) = delete;
+
+    private:
+        FrameArena &arena;
+        std::size_t offset;
+        std::size_t overflowBlocks;
+    };
+
+    // remove copy functions
+    FrameArena(FrameArena const &) = delete;
+    void operator=(FrameArena const &) = delete;
+
+private:
+    static constexpr std::size_t DEFAULT_CAPACITY{256 * 1024};
+
+    std::unique_ptr<char[]> block;
+    std::size_t capacity;
+    std::size_t offset{0};
+
+    // allocations that didn't fit into the block, only kept until the next reset
+    std::vector<std::unique_ptr<char[]>> overflowBlocks;
+    std::size_t overflowBytes{0};
+    std::size_t overflowCount{0};
+
+    std::size_t peak{0};
+};
+
+/**
+ * Allocator for standard containers that takes its memory from a FrameArena, by default the one of the
+ * constructing thread. Containers using it must not outlive the reset of the arena.
+ */
+template <class T>
+class FrameAllocator
+{
+public:
+    using value_type = T;
+
+    FrameAllocator() : arena(&FrameArena::getThreadArena())
+    {
+    }
+
+    explicit FrameAllocator(FrameArena &arena) : arena(&arena)
+    {
+    }
+
+    template <class U>
+    FrameAllocator(const FrameAllocator<U> &other) : arena(other.getArena())
+    {
+    }
+
+    T *allocate(std::size_t count)
+    {
+        return static_cast<T *>(arena->allocate(count * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T *, std::size_t)
+    {
+        // released by the reset of the arena
+    }
+
+    FrameArena *getArena() const
+    {
+        return arena;
+    }
+
+private:
+    FrameArena *arena;
+};
+
+template <class T, class U>
+bool operator==(const FrameAllocator<T> &a, const FrameAllocator<U> &b)
+{
+    return a.getArena() == b.getArena();
+}
+
+template <class T, class U>
+bool operator!=(const FrameAllocator<T> &a, const FrameAllocator<U> &b)
+{
+    return a.getArena() != b.getArena();
+}
+
+template <class T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+using FrameString = std::basic_string<char, std::char_traits<char>, FrameAllocator<char>>;
+
+/**
+ * Append the decimal digits of a number, std::to_string would create a heap string.
+ */
+void appendNumber(FrameString &string, std::size_t number);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,136 @@
+#include "FramePipeline.h"
+
+#include <chrono>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "AllocationTracker.h"
+
+void FrameCommands::clear()
+{
+    pointLightPositions.clear();
+    draws.clear();
+    culledDraws = 0;
+}
+
+FramePipeline::~FramePipeline()
+{
+    // the jobs write into the slots
+    discard();
+}
+
+void FramePipeline::record(const FrameInput &input)
+{
+    Slot &slot = slots[requestSlot];
+
+    // the slot was drawn before the previous frame, so nothing reads it anymore
+    slot.input = input;
+    JobSystem::getInstance().run([&slot] {
+        AllocationTracker::Scope allocationScope(AllocationSubsystem::framePipeline);
+        auto start = std::chrono::steady_clock::now();
+        recordFrame(slot);
+        slot.commands.recordMilliseconds =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }, slot.counter);
+
+    recordingSlot = requestSlot;
+    requestSlot = (requestSlot + 1) % 2;
+}
+
+const FrameCommands *FramePipeline::acquire()
+{
+    if (recordingSlot < 0)
+    {
+        return nullptr;
+    }
+
+    Slot &slot = slots[recordingSlot];
+    recordingSlot = -1;
+
+    auto start = std::chrono::steady_clock::now();
+    JobSystem::getInstance().wait(slot.counter);
+    waitMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    return &slot.commands;
+}
+
+void FramePipeline::discard()
+{
+    acquire();
+}
+
+double FramePipeline::getWaitMilliseconds() const
+{
+    return waitMilliseconds;
+}
+
+void FramePipeline::recordFrame(Slot &slot)
+{
+    const FrameInput &input = slot.input;
+    FrameCommands &commands = slot.commands;
+
+    commands.clear();
+    commands.frame = input.frame;
+    commands.frustumCulled = input.frustumCulling;
+
+    // camera
+    commands.view = input.view;
+    commands.projection = glm::perspective(glm::radians(input.fov), (GLfloat)input.width / (GLfloat)input.height,
+                                           0.1f, 100.0f);
+    commands.cameraPosition = input.cameraPosition;
+    commands.fov = input.fov;
+    commands.height = input.height;
+
+    // lights in view space
+    commands.directionalLightDirection =
+        glm::normalize(glm::vec3(input.view * glm::vec4(input.directionalLightDirection, 0.0)));
+    for (const glm::vec3 &position : input.pointLightPositions)
+    {
+        commands.pointLightPositions.push_back(glm::vec3(input.view * glm::vec4(position, 1.0)));
+    }
+
+    // every instance gets a fixed range of draws, so the instances can be processed in parallel
+    slot.drawOffsets.resize(input.instances.size() + 1);
+    slot.drawOffsets[0] = 0;
+    const ModelPool &modelPool = ModelPool::getInstance();
+    for (std::size_t i = 0; i < input.instances.size(); i++)
+    {
+        slot.drawOffsets[i + 1] = slot.drawOffsets[i] + modelPool.getMeshes(input.instances[i].model).size();
+    }
+    commands.draws.resize(slot.drawOffsets.back());
+    slot.drawVisible.resize(slot.drawOffsets.back());
+
+    // every mesh in world space, tested against the frustum
+    Frustum frustum(commands.projection * commands.view);
+    // the pools aren't changed while a frame is recorded, so the jobs only read them
+    const MeshPool &meshPool = MeshPool::getInstance();
+    JobSystem::getInstance().parallelFor(input.instances.size(), [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; i++)
+        {
+            const ModelInstance &instance = input.instances[i];
+            std::size_t draw = slot.drawOffsets[i];
+            for (MeshHandle mesh : modelPool.getMeshes(instance.model))
+            {
+                BoundingBox worldBounds = meshPool.get(mesh).getBounds().transform(instance.modelMatrix);
+                commands.draws[draw] = {instance.pass, mesh, instance.modelMatrix, worldBounds};
+                slot.drawVisible[draw] = !input.frustumCulling || frustum.isVisible(worldBounds);
+                draw++;
+            }
+        }
+    }, INSTANCE_GRAIN);
+
+    // drop the invisible draws, keeping the order
+    std::size_t visibleCount = 0;
+    for (std::size_t i = 0; i < commands.draws.size(); i++)
+    {
+        if (slot.drawVisible[i])
+        {
+            commands.draws[visibleCount++] = commands.draws[i];
+        }
+        else if (commands.draws[i].pass != RenderPass::virtualTextureFeedback)
+        {
+            commands.culledDraws++;
+        }
+    }
+    commands.draws.resize(visibleCount);
+}
\ No newline at end of file
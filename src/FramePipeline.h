@@ -0,0 +1,168 @@
+#ifndef FRAMEPIPELINE_H
+#define FRAMEPIPELINE_H
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "lib/glad/include/glad/glad.h"
+
+#include "Culling.h"
+#include "JobSystem.h"
+#include "Mesh.h"
+#include "Model.h"
+
+/**
+ * Passes of a frame, in the order they're drawn.
+ */
+enum class RenderPass
+{
+    virtualTextureFeedback,
+    lighting,
+    lightSources
+};
+
+/**
+ * One model placed in the scene for a pass.
+ */
+struct ModelInstance
+{
+    ModelHandle model;
+    glm::mat4 modelMatrix;
+    RenderPass pass;
+};
+
+/**
+ * Everything the jobs need to record a frame, copied from the render thread so the jobs never read state
+ * the render thread changes.
+ */
+struct FrameInput
+{
+    std::uint64_t frame{0};
+
+    // camera
+    glm::mat4 view{1.0f};
+    glm::vec3 cameraPosition{0.0f};
+    float fov{45.0f};
+    GLuint width{1};
+    GLuint height{1};
+
+    // lights in world space
+    glm::vec3 directionalLightDirection{0.0f, -1.0f, 0.0f};
+    std::vector<glm::vec3> pointLightPositions;
+
+    std::vector<ModelInstance> instances;
+
+    // whether the draws should be tested against the view frustum (see RenderQueue::isFrustumCulledOnCpu)
+    bool frustumCulling{false};
+};
+
+/**
+ * A mesh to draw, with its bounds in world space.
+ */
+struct DrawCommand
+{
+    RenderPass pass;
+    MeshHandle mesh;
+    glm::mat4 modelMatrix;
+    BoundingBox worldBounds;
+};
+
+/**
+ * A recorded frame, without any OpenGL calls, which the render thread replays.
+ */
+struct FrameCommands
+{
+    std::uint64_t frame{0};
+
+    glm::mat4 view{1.0f};
+    glm::mat4 projection{1.0f};
+    glm::vec3 cameraPosition{0.0f};
+    float fov{45.0f};
+    GLuint height{1};
+
+    // lights in view space
+    glm::vec3 directionalLightDirection{0.0f};
+    std::vector<glm::vec3> pointLightPositions;
+
+    // visible draws, in the order of their passes
+    std::vector<DrawCommand> draws;
+    bool frustumCulled{false};
+    std::size_t culledDraws{0}; // without the virtual texture feedback pass, which isn't part of the statistics
+
+    double recordMilliseconds{0.0};
+
+    void clear();
+};
+
+/**
+ * Records frames on the job system while the render thread replays the previously recorded frame.
+ * The jobs do the per frame maths of the scene: the camera matrices, the lights in view space,
+ * the world bounds of every mesh and the frustum culling, the instances are split across all threads.
+ * Two frames are in flight at most, one being recorded and one being replayed. The render thread hands them over
+ * through job counters, without locks. So the frame being drawn is the one recorded from the input of the previous
+ * call to record, which adds one frame of latency.
+ * All functions need to be called from the render thread.
+ */
+class FramePipeline
+{
+public:
+    FramePipeline() = default;
+    virtual ~FramePipeline();
+
+    /**
+     * Start recording a frame. The frame of the previous call needs to be acquired first.
+     */
+    void record(const FrameInput &input);
+
+    /**
+     * Wait for the frame of the last call to record, the render thread helps recording it in the meantime.
+     * @return The recorded frame, valid until the next call to record, or nullptr if no frame is being recorded.
+     */
+    const FrameCommands *acquire();
+
+    /**
+     * Wait for the frame that's being recorded and drop it, needed before anything it refers to
+     * (like a model) is destroyed.
+     */
+    void discard();
+
+    /**
+     * Milliseconds the render thread waited for the recording in the last acquire.
+     */
+    double getWaitMilliseconds() const;
+
+    // remove copy functions, the jobs refer to the slots
+    FramePipeline(FramePipeline const &) = delete;
+    void operator=(FramePipeline const &) = delete;
+
+private:
+    struct Slot
+    {
+        JobCounter counter;
+        FrameInput input;
+        FrameCommands commands;
+
+        // first draw of every instance and whether each draw passed the culling, kept to reuse the memory
+        std::vector<std::size_t> drawOffsets;
+        std::vector<char> drawVisible;
+    };
+
+    // instances per job, each has only a few meshes
+    static constexpr std::size_t INSTANCE_GRAIN{16};
+
+    Slot slots[2];
+
+    // next slot to record into, the render thread alternates between them
+    std::size_t requestSlot{0};
+
+    // slot of the last call to record that wasn't acquired yet, or -1
+    int recordingSlot{-1};
+
+    double waitMilliseconds{0.0};
+
+    static void recordFrame(Slot &slot);
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,109 @@
+#include "FreeListAllocator.h"
+
+#include <iostream>
+#include <iterator>
+
+FreeListAllocator::FreeListAllocator(std::size_t capacity)
+    : capacity(0), used(0)
+{
+    grow(capacity);
+}
+
+bool FreeListAllocator::allocate(std::size_t size, std::size_t &offset)
+{
+    if (size == 0)
+    {
+        offset = 0;
+        return true;
+    }
+
+    for (auto it = freeRanges.begin(); it != freeRanges.end(); it++)
+    {
+        if (it->second < size)
+        {
+            continue;
+        }
+
+        offset = it->first;
+        std::size_t remaining = it->second - size;
+        freeRanges.erase(it);
+
+        if (remaining > 0)
+        {
+            // put the rest of the range back
+            freeRanges.insert({offset + size, remaining});
+        }
+
+        used += size;
+        return true;
+    }
+
+    return false;
+}
+
+void FreeListAllocator::free(std::size_t offset, std::size_t size)
+{
+    if (size == 0)
+    {
+        return;
+    }
+
+    if (offset + size > capacity)
+    {
+        std::cerr << "Freeing range outside of allocator capacity: "
+                  << offset << "+" << size << std::endl;
+        return;
+    }
+
+    used -= size;
+
+    std::size_t mergedOffset = offset;
+    std::size_t mergedSize = size;
+    auto next = freeRanges.lower_bound(offset);
+
+    // merge with the preceding free range if they touch
+    if (next != freeRanges.begin())
+    {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == offset)
+        {
+            mergedOffset = previous->first;
+            mergedSize += previous->second;
+            freeRanges.erase(previous);
+        }
+    }
+
+    // merge with the following free range if they touch
+    if (next != freeRanges.end() && offset + size == next->first)
+    {
+        mergedSize += next->second;
+        freeRanges.erase(next);
+    }
+
+    freeRanges.insert({mergedOffset, mergedSize});
+}
+
+void FreeListAllocator::grow(std::size_t newCapacity)
+{
+    if (newCapacity <= capacity)
+    {
+        return;
+    }
+
+    std::size_t oldCapacity = capacity;
+    capacity = newCapacity;
+
+    // hand the new space to free, so it gets merged with a free range at the end
+    used += newCapacity - oldCapacity;
+    free(oldCapacity, newCapacity - oldCapacity);
+}
+
+std::size_t FreeListAllocator::getCapacity() const
+{
+    return capacity;
+}
+
+std::size_t FreeListAllocator::getUsed() const
+{
+    return used;
+}
\ No newline at end of file
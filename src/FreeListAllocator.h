@@ -0,0 +1,46 @@
+#ifndef FREELISTALLOCATOR_H
+#define FREELISTALLOCATOR_H
+
+#include <cstddef>
+#include <map>
+
+/**
+ * Hands out ranges of a linearly addressed resource (for example elements inside a GPU buffer).
+ * The allocator never touches the resource itself, it only keeps track of the offsets.
+ * Free ranges are kept sorted by offset, so that neighbouring ranges can be merged again when freed.
+ */
+class FreeListAllocator
+{
+public:
+    FreeListAllocator(std::size_t capacity = 0);
+
+    /**
+     * Find a free range using a first fit strategy.
+     * @param size Number of elements to allocate.
+     * @param offset Will be set to the offset of the allocated range on success.
+     * @return Whether a large enough free range was found.
+     */
+    bool allocate(std::size_t size, std::size_t &offset);
+
+    /**
+     * Return a range that was previously handed out by allocate.
+     */
+    void free(std::size_t offset, std::size_t size);
+
+    /**
+     * Extend the managed resource, the new space is appended as a free range.
+     */
+    void grow(std::size_t newCapacity);
+
+    std::size_t getCapacity() const;
+    std::size_t getUsed() const;
+
+private:
+    std::size_t capacity;
+    std::size_t used;
+
+    // free ranges, offset -> size
+    std::map<std::size_t, std::size_t> freeRanges;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,180 @@
+#include "GeometryPool.h"
+
+#include <algorithm>
+
+namespace
+{
+    // initial capacities in elements, the buffers double in size whenever they run out of space
+    const std::size_t INITIAL_VERTEX_CAPACITY{1 << 16};
+    const std::size_t INITIAL_INDEX_CAPACITY{1 << 18};
+    const std::size_t INITIAL_DRAW_ID_CAPACITY{1 << 10};
+} // namespace
+
+GeometryPool::GeometryPool()
+    : vertexAllocator(INITIAL_VERTEX_CAPACITY), indexAllocator(INITIAL_INDEX_CAPACITY)
+{
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glGenBuffers(1, &ebo);
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vbo);
+    glBufferData(GL_COPY_WRITE_BUFFER, INITIAL_VERTEX_CAPACITY * sizeof(Vertex), NULL, GL_STATIC_DRAW);
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, ebo);
+    glBufferData(GL_COPY_WRITE_BUFFER, INITIAL_INDEX_CAPACITY * sizeof(GLuint), NULL, GL_STATIC_DRAW);
+
+    setupAttributes();
+}
+
+GeometryPool &GeometryPool::getInstance()
+{
+    // created on first use, since it needs a valid OpenGL context
+    static GeometryPool instance;
+    return instance;
+}
+
+GeometryAllocation GeometryPool::allocate(const std::vector<Vertex> &vertices,
+                                          const std::vector<GLuint> &indices)
+{
+    std::size_t vertexOffset;
+    if (!vertexAllocator.allocate(vertices.size(), vertexOffset))
+    {
+        growVertexBuffer(vertices.size());
+        vertexAllocator.allocate(vertices.size(), vertexOffset);
+    }
+
+    std::size_t indexOffset;
+    if (!indexAllocator.allocate(indices.size(), indexOffset))
+    {
+        growIndexBuffer(indices.size());
+        indexAllocator.allocate(indices.size(), indexOffset);
+    }
+
+    // upload through the copy target, so the element buffer binding of whatever VAO is bound stays untouched
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vbo);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, vertexOffset * sizeof(Vertex),
+                    vertices.size() * sizeof(Vertex), vertices.data());
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, ebo);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, indexOffset * sizeof(GLuint),
+                    indices.size() * sizeof(GLuint), indices.data());
+
+    GeometryAllocation allocation;
+    allocation.baseVertex = vertexOffset;
+    allocation.vertexCount = vertices.size();
+    allocation.firstIndex = indexOffset;
+    allocation.indexCount = indices.size();
+    return allocation;
+}
+
+void GeometryPool::free(const GeometryAllocation &allocation)
+{
+    vertexAllocator.free(allocation.baseVertex, allocation.vertexCount);
+    indexAllocator.free(allocation.firstIndex, allocation.indexCount);
+}
+
+void GeometryPool::bind() const
+{
+    glBindVertexArray(vao);
+}
+
+void GeometryPool::reserveDrawIds(std::size_t count)
+{
+    if (count <= drawIdCapacity)
+    {
+        return;
+    }
+
+    drawIdCapacity = std::max({count, drawIdCapacity * 2, INITIAL_DRAW_ID_CAPACITY});
+
+    std::vector<GLuint> drawIds(drawIdCapacity);
+    for (std::size_t i = 0; i < drawIdCapacity; i++)
+    {
+        drawIds[i] = i;
+    }
+
+    if (!drawIdBuffer)
+    {
+        glGenBuffers(1, &drawIdBuffer);
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, drawIdBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, drawIds.size() * sizeof(GLuint), drawIds.data(), GL_STATIC_DRAW);
+
+    setupAttributes();
+}
+
+void GeometryPool::setupAttributes()
+{
+    glBindVertexArray(vao);
+
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+
+    // vertices
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, position));
+    glEnableVertexAttribArray(0);
+
+    // normals
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, normal));
+    glEnableVertexAttribArray(1);
+
+    // texture coordinates
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+                          (void *)offsetof(Vertex, textureCoordinates));
+    glEnableVertexAttribArray(2);
+
+    // draw index, advances once per instance instead of once per vertex
+    if (drawIdBuffer)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, drawIdBuffer);
+        glVertexAttribIPointer(DRAW_ID_LOCATION, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void *)0);
+        glVertexAttribDivisor(DRAW_ID_LOCATION, 1);
+        glEnableVertexAttribArray(DRAW_ID_LOCATION);
+    }
+
+    glBindVertexArray(0);
+}
+
+void GeometryPool::growVertexBuffer(std::size_t additionalCapacity)
+{
+    // the new space is appended at the end, so it always fits a range of additionalCapacity
+    std::size_t oldCapacity = vertexAllocator.getCapacity();
+    std::size_t newCapacity = std::max(oldCapacity * 2, oldCapacity + additionalCapacity);
+
+    vbo = resizeBuffer(vbo, oldCapacity * sizeof(Vertex), newCapacity * sizeof(Vertex));
+    vertexAllocator.grow(newCapacity);
+
+    // the attribute pointers still reference the old buffer
+    setupAttributes();
+}
+
+void GeometryPool::growIndexBuffer(std::size_t additionalCapacity)
+{
+    // the new space is appended at the end, so it always fits a range of additionalCapacity
+    std::size_t oldCapacity = indexAllocator.getCapacity();
+    std::size_t newCapacity = std::max(oldCapacity * 2, oldCapacity + additionalCapacity);
+
+    ebo = resizeBuffer(ebo, oldCapacity * sizeof(GLuint), newCapacity * sizeof(GLuint));
+    indexAllocator.grow(newCapacity);
+
+    // the VAO still references the old element buffer
+    setupAttributes();
+}
+
+GLuint GeometryPool::resizeBuffer(GLuint buffer, std::size_t oldSize, std::size_t newSize)
+{
+    GLuint newBuffer;
+    glGenBuffers(1, &newBuffer);
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, newSize, NULL, GL_STATIC_DRAW);
+
+    // copy the existing contents on the GPU, no round trip through client memory needed
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldSize);
+
+    glDeleteBuffers(1, &buffer);
+
+    return newBuffer;
+}
\ No newline at end of file
@@ -0,0 +1,83 @@
+#ifndef GEOMETRYPOOL_H
+#define GEOMETRYPOOL_H
+
+#include <vector>
+
+#include "lib/glad/include/glad/glad.h"
+
+#include "FreeListAllocator.h"
+#include "Vertex.h"
+
+/**
+ * Location of a mesh inside the shared vertex and index buffers of a GeometryPool.
+ * Offsets and counts are in elements (vertices and indices), not bytes.
+ */
+struct GeometryAllocation
+{
+    GLint baseVertex{0};
+    GLsizei vertexCount{0};
+    GLuint firstIndex{0};
+    GLsizei indexCount{0};
+};
+
+/**
+ * Stores the geometry of many meshes in one big vertex buffer and one big index buffer.
+ * Since all meshes share a single VAO, consecutive meshes can be drawn without rebinding any buffers,
+ * by using glDrawElementsBaseVertex with the offsets from their GeometryAllocation.
+ * All vertices in a pool share the same layout, the pool returned by getInstance uses the Vertex layout.
+ */
+class GeometryPool
+{
+public:
+    static GeometryPool &getInstance();
+
+    /**
+     * Upload vertices and indices into the pool, growing the buffers if needed.
+     * Indices are relative to the first vertex of the mesh, they are not rebased.
+     */
+    GeometryAllocation allocate(const std::vector<Vertex> &vertices, const std::vector<GLuint> &indices);
+
+    /**
+     * Give the ranges of an allocation back to the pool.
+     */
+    void free(const GeometryAllocation &allocation);
+
+    /**
+     * Bind the VAO of the pool, needs to be done once before drawing meshes from the pool.
+     */
+    void bind() const;
+
+    /**
+     * Make sure the per instance draw index attribute can address at least count draws.
+     * The attribute simply returns 0, 1, 2, ... and is offset by the base instance of an indirect draw,
+     * which lets shaders of the multi draw indirect path find their per draw data.
+     */
+    void reserveDrawIds(std::size_t count);
+
+    // attribute location of the per instance draw index
+    static constexpr GLuint DRAW_ID_LOCATION{3};
+
+    // remove some functions for the singleton
+    GeometryPool(GeometryPool const &) = delete;
+    void operator=(GeometryPool const &) = delete;
+
+private:
+    GeometryPool();
+
+    GLuint vao;
+    GLuint vbo;
+    GLuint ebo;
+    GLuint drawIdBuffer{0};
+    std::size_t drawIdCapacity{0};
+
+    FreeListAllocator vertexAllocator;
+    FreeListAllocator indexAllocator;
+
+    void setupAttributes();
+    void growVertexBuffer(std::size_t additionalCapacity);
+    void growIndexBuffer(std::size_t additionalCapacity);
+
+    static GLuint resizeBuffer(GLuint buffer, std::size_t oldSize, std::size_t newSize);
+};
+
+#endif
\ No newline at end of file
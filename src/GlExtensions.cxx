@@ -0,0 +1,159 @@
+#include "GlExtensions.h"
+
+#include <unordered_set>
+
+namespace
+{
+    std::unordered_set<std::string> extensions;
+
+    bool multiDrawIndirectSupported{false};
+    bool computeShaderSupported{false};
+    bool indirectCountSupported{false};
+    bool s3tcCompressionSupported{false};
+    bool bptcCompressionSupported{false};
+    bool bindlessTextureSupported{false};
+    bool programBinarySupported{false};
+    bool parallelShaderCompileSupported{false};
+} // namespace
+
+PFNGLMULTIDRAWELEMENTSINDIRECTPROC GlExtensions::multiDrawElementsIndirect{nullptr};
+PFNGLMULTIDRAWELEMENTSINDIRECTCOUNTARBPROC GlExtensions::multiDrawElementsIndirectCount{nullptr};
+PFNGLDISPATCHCOMPUTEPROC GlExtensions::dispatchCompute{nullptr};
+PFNGLMEMORYBARRIERPROC GlExtensions::memoryBarrier{nullptr};
+PFNGLCLEARBUFFERDATAPROC GlExtensions::clearBufferData{nullptr};
+PFNGLGETTEXTUREHANDLEARBPROC GlExtensions::getTextureHandle{nullptr};
+PFNGLMAKETEXTUREHANDLERESIDENTARBPROC GlExtensions::makeTextureHandleResident{nullptr};
+PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC GlExtensions::makeTextureHandleNonResident{nullptr};
+PFNGLGETPROGRAMBINARYPROC GlExtensions::getProgramBinary{nullptr};
+PFNGLPROGRAMBINARYPROC GlExtensions::programBinary{nullptr};
+PFNGLPROGRAMPARAMETERIPROC GlExtensions::programParameteri{nullptr};
+PFNGLMAXSHADERCOMPILERTHREADSKHRPROC GlExtensions::maxShaderCompilerThreads{nullptr};
+
+void GlExtensions::init(GLADloadproc load)
+{
+    GLint extensionCount = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+    for (GLint i = 0; i < extensionCount; i++)
+    {
+        extensions.insert(reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, i)));
+    }
+
+    // the indirect shaders are written against GLSL 4.30, so the extensions alone aren't enough
+    if (isVersionSupported(4, 3))
+    {
+        multiDrawElementsIndirect =
+            reinterpret_cast<PFNGLMULTIDRAWELEMENTSINDIRECTPROC>(load("glMultiDrawElementsIndirect"));
+        multiDrawIndirectSupported = multiDrawElementsIndirect != nullptr;
+
+        dispatchCompute = reinterpret_cast<PFNGLDISPATCHCOMPUTEPROC>(load("glDispatchCompute"));
+        memoryBarrier = reinterpret_cast<PFNGLMEMORYBARRIERPROC>(load("glMemoryBarrier"));
+        clearBufferData = reinterpret_cast<PFNGLCLEARBUFFERDATAPROC>(load("glClearBufferData"));
+        computeShaderSupported = dispatchCompute && memoryBarrier && clearBufferData;
+    }
+
+    if (multiDrawIndirectSupported && isExtensionSupported("GL_ARB_indirect_parameters"))
+    {
+        multiDrawElementsIndirectCount = reinterpret_cast<PFNGLMULTIDRAWELEMENTSINDIRECTCOUNTARBPROC>(
+            load("glMultiDrawElementsIndirectCountARB"));
+        indirectCountSupported = multiDrawElementsIndirectCount != nullptr;
+    }
+
+    if (multiDrawIndirectSupported && isExtensionSupported("GL_ARB_bindless_texture"))
+    {
+        getTextureHandle = reinterpret_cast<PFNGLGETTEXTUREHANDLEARBPROC>(load("glGetTextureHandleARB"));
+        makeTextureHandleResident =
+            reinterpret_cast<PFNGLMAKETEXTUREHANDLERESIDENTARBPROC>(load("glMakeTextureHandleResidentARB"));
+        makeTextureHandleNonResident =
+            reinterpret_cast<PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC>(load("glMakeTextureHandleNonResidentARB"));
+        bindlessTextureSupported = getTextureHandle && makeTextureHandleResident && makeTextureHandleNonResident;
+    }
+
+    if (isVersionSupported(4, 1) || isExtensionSupported("GL_ARB_get_program_binary"))
+    {
+        // the extension uses the same names as core, without suffix
+        getProgramBinary = reinterpret_cast<PFNGLGETPROGRAMBINARYPROC>(load("glGetProgramBinary"));
+        programBinary = reinterpret_cast<PFNGLPROGRAMBINARYPROC>(load("glProgramBinary"));
+        programParameteri = reinterpret_cast<PFNGLPROGRAMPARAMETERIPROC>(load("glProgramParameteri"));
+
+        GLint formatCount = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+        programBinarySupported = getProgramBinary && programBinary && programParameteri && formatCount > 0;
+    }
+
+    // the ARB extension is the same as the KHR one, with a different suffix
+    if (isExtensionSupported("GL_KHR_parallel_shader_compile"))
+    {
+        maxShaderCompilerThreads =
+            reinterpret_cast<PFNGLMAXSHADERCOMPILERTHREADSKHRPROC>(load("glMaxShaderCompilerThreadsKHR"));
+    }
+    else if (isExtensionSupported("GL_ARB_parallel_shader_compile"))
+    {
+        maxShaderCompilerThreads =
+            reinterpret_cast<PFNGLMAXSHADERCOMPILERTHREADSKHRPROC>(load("glMaxShaderCompilerThreadsARB"));
+    }
+    if (maxShaderCompilerThreads)
+    {
+        // 0xFFFFFFFF lets the driver choose, some drivers compile on the calling thread until this is called
+        maxShaderCompilerThreads(0xFFFFFFFF);
+        parallelShaderCompileSupported = true;
+    }
+
+    s3tcCompressionSupported = isExtensionSupported("GL_EXT_texture_compression_s3tc");
+    bptcCompressionSupported = isVersionSupported(4, 2) || isExtensionSupported("GL_ARB_texture_compression_bptc");
+}
+
+bool GlExtensions::isVersionSupported(int major, int minor)
+{
+    return GLVersion.major > major || (GLVersion.major == major && GLVersion.minor >= minor);
+}
+
+bool GlExtensions::isExtensionSupported(const std::string &name)
+{
+    return extensions.count(name) > 0;
+}
+
+bool GlExtensions::hasMultiDrawIndirect()
+{
+    return multiDrawIndirectSupported;
+}
+
+bool GlExtensions::hasComputeShader()
+{
+    return computeShaderSupported;
+}
+
+bool GlExtensions::hasIndirectCount()
+{
+    return indirectCountSupported;
+}
+
+bool GlExtensions::hasS3tcCompression()
+{
+    return s3tcCompressionSupported;
+}
+
+bool GlExtensions::hasBptcCompression()
+{
+    return bptcCompressionSupported;
+}
+
+void GlExtensions::setCompressionSupport(bool s3tc, bool bptc)
+{
+    s3tcCompressionSupported = s3tc;
+    bptcCompressionSupported = bptc;
+}
+
+bool GlExtensions::hasBindlessTexture()
+{
+    return bindlessTextureSupported;
+}
+
+bool GlExtensions::hasProgramBinary()
+{
+    return programBinarySupported;
+}
+
+bool GlExtensions::hasParallelShaderCompile()
+{
+    return parallelShaderCompileSupported;
+}
\ No newline at end of file
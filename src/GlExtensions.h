@@ -0,0 +1,180 @@
+#ifndef GLEXTENSIONS_H
+#define GLEXTENSIONS_H
+
+#include <string>
+
+#include "lib/glad/include/glad/glad.h"
+
+// the bundled glad loader only covers OpenGL 3.3 core
+// everything newer is defined and loaded here, and may only be used if the matching feature check returns true
+
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#endif
+
+#ifndef GL_COMPUTE_SHADER
+#define GL_COMPUTE_SHADER 0x91B9
+#endif
+
+#ifndef GL_COMMAND_BARRIER_BIT
+#define GL_COMMAND_BARRIER_BIT 0x00000040
+#endif
+
+#ifndef GL_SHADER_STORAGE_BARRIER_BIT
+#define GL_SHADER_STORAGE_BARRIER_BIT 0x00002000
+#endif
+
+#ifndef GL_PARAMETER_BUFFER_ARB
+#define GL_PARAMETER_BUFFER_ARB 0x80EE
+#endif
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#endif
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+#ifndef GL_MAX_SHADER_COMPILER_THREADS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#endif
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+typedef void(APIENTRYP PFNGLMULTIDRAWELEMENTSINDIRECTPROC)(GLenum mode, GLenum type, const void *indirect,
+                                                            GLsizei drawcount, GLsizei stride);
+typedef void(APIENTRYP PFNGLMULTIDRAWELEMENTSINDIRECTCOUNTARBPROC)(GLenum mode, GLenum type, const void *indirect,
+                                                                   GLintptr drawcount, GLsizei maxdrawcount,
+                                                                   GLsizei stride);
+typedef void(APIENTRYP PFNGLDISPATCHCOMPUTEPROC)(GLuint num_groups_x, GLuint num_groups_y, GLuint num_groups_z);
+typedef void(APIENTRYP PFNGLMEMORYBARRIERPROC)(GLbitfield barriers);
+typedef void(APIENTRYP PFNGLCLEARBUFFERDATAPROC)(GLenum target, GLenum internalformat, GLenum format,
+                                                 GLenum type, const void *data);
+typedef GLuint64(APIENTRYP PFNGLGETTEXTUREHANDLEARBPROC)(GLuint texture);
+typedef void(APIENTRYP PFNGLMAKETEXTUREHANDLERESIDENTARBPROC)(GLuint64 handle);
+typedef void(APIENTRYP PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC)(GLuint64 handle);
+typedef void(APIENTRYP PFNGLGETPROGRAMBINARYPROC)(GLuint program, GLsizei bufSize, GLsizei *length,
+                                                  GLenum *binaryFormat, void *binary);
+typedef void(APIENTRYP PFNGLPROGRAMBINARYPROC)(GLuint program, GLenum binaryFormat, const void *binary,
+                                               GLsizei length);
+typedef void(APIENTRYP PFNGLPROGRAMPARAMETERIPROC)(GLuint program, GLenum pname, GLint value);
+typedef void(APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+/**
+ * Layout of a single draw for glMultiDrawElementsIndirect, as defined by the OpenGL specification.
+ */
+struct DrawElementsIndirectCommand
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+namespace GlExtensions
+{
+    /**
+     * Query the version and extensions of the current context and load the entry points used by optional features.
+     * Needs to be called once after glad has been initialized.
+     * @param load Function used to look up OpenGL entry points (the same one that's used for glad).
+     */
+    void init(GLADloadproc load);
+
+    /**
+     * Whether the version of the current context is at least major.minor.
+     * Note that most drivers hand out the highest core version they support,
+     * even though the window only requests a 3.3 core context.
+     */
+    bool isVersionSupported(int major, int minor);
+
+    bool isExtensionSupported(const std::string &name);
+
+    /**
+     * glMultiDrawElementsIndirect with base instances and shader storage buffers (OpenGL 4.3).
+     */
+    bool hasMultiDrawIndirect();
+
+    /**
+     * Compute shaders, glMemoryBarrier and glClearBufferData (OpenGL 4.3).
+     */
+    bool hasComputeShader();
+
+    /**
+     * glMultiDrawElementsIndirectCountARB, which reads the number of draws from a buffer (GL_ARB_indirect_parameters).
+     */
+    bool hasIndirectCount();
+
+    /**
+     * BC1 to BC3 texture formats (GL_EXT_texture_compression_s3tc), BC4 and BC5 are part of OpenGL 3.0 core.
+     */
+    bool hasS3tcCompression();
+
+    /**
+     * BC7 texture format (OpenGL 4.2 or GL_ARB_texture_compression_bptc).
+     */
+    bool hasBptcCompression();
+
+    /**
+     * Decide which block formats textures are compressed to without a context, for tools that process textures
+     * offline (see pack.cxx). Overwritten by init.
+     */
+    void setCompressionSupport(bool s3tc, bool bptc);
+
+    /**
+     * 64 bit texture handles that shaders can sample without binding the texture (GL_ARB_bindless_texture).
+     * Only used together with shader storage buffers, so it also needs OpenGL 4.3.
+     */
+    bool hasBindlessTexture();
+
+    /**
+     * Reading and loading linked programs as driver specific binaries (OpenGL 4.1 or GL_ARB_get_program_binary).
+     * Also needs the driver to offer at least one binary format, some only do for their own shader caches.
+     */
+    bool hasProgramBinary();
+
+    /**
+     * Compiling and linking on driver threads, with GL_COMPLETION_STATUS_KHR telling whether a shader or program
+     * is done without waiting for it (GL_KHR_parallel_shader_compile or GL_ARB_parallel_shader_compile).
+     * The driver is allowed to pick the number of threads during init.
+     */
+    bool hasParallelShaderCompile();
+
+    extern PFNGLMULTIDRAWELEMENTSINDIRECTPROC multiDrawElementsIndirect;
+    extern PFNGLMULTIDRAWELEMENTSINDIRECTCOUNTARBPROC multiDrawElementsIndirectCount;
+    extern PFNGLDISPATCHCOMPUTEPROC dispatchCompute;
+    extern PFNGLMEMORYBARRIERPROC memoryBarrier;
+    extern PFNGLCLEARBUFFERDATAPROC clearBufferData;
+    extern PFNGLGETTEXTUREHANDLEARBPROC getTextureHandle;
+    extern PFNGLMAKETEXTUREHANDLERESIDENTARBPROC makeTextureHandleResident;
+    extern PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC makeTextureHandleNonResident;
+    extern PFNGLGETPROGRAMBINARYPROC getProgramBinary;
+    extern PFNGLPROGRAMBINARYPROC programBinary;
+    extern PFNGLPROGRAMPARAMETERIPROC programParameteri;
+    extern PFNGLMAXSHADERCOMPILERTHREADSKHRPROC maxShaderCompilerThreads;
+} // namespace GlExtensions
+
+#endif
\ No newline at end of file
@@ -0,0 +1,717 @@
+#include "GltfFile.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#include <glibmm-2.4/glibmm/miscutils.h>
+#include <glm/glm.hpp>
+
+#include "JobSystem.h"
+#include "MaterialTable.h"
+
+namespace
+{
+    // little endian "glTF", and the types of the JSON and binary chunk of a .glb
+    const std::uint32_t GLB_MAGIC{0x46546C67};
+    const std::uint32_t GLB_CHUNK_JSON{0x4E4F534A};
+    const std::uint32_t GLB_CHUNK_BIN{0x004E4942};
+    const std::size_t GLB_HEADER_SIZE{12};
+    const std::size_t GLB_CHUNK_HEADER_SIZE{8};
+
+    // glTF uses the OpenGL enums for primitive modes and component types
+    const int GLTF_TRIANGLES{4};
+
+    std::uint32_t readUint32(const unsigned char *data)
+    {
+        return static_cast<std::uint32_t>(data[0]) | static_cast<std::uint32_t>(data[1]) << 8 |
+               static_cast<std::uint32_t>(data[2]) << 16 | static_cast<std::uint32_t>(data[3]) << 24;
+    }
+
+    std::size_t getComponentSize(int componentType)
+    {
+        switch (componentType)
+        {
+        case GL_BYTE:
+        case GL_UNSIGNED_BYTE:
+            return 1;
+        case GL_SHORT:
+        case GL_UNSIGNED_SHORT:
+            return 2;
+        case GL_UNSIGNED_INT:
+        case GL_FLOAT:
+            return 4;
+        default:
+            return 0;
+        }
+    }
+
+    std::size_t getComponentCount(const std::string &type)
+    {
+        if (type == "SCALAR")
+        {
+            return 1;
+        }
+        if (type.size() == 4 && type.compare(0, 3, "VEC") == 0 && type[3] >= '2' && type[3] <= '4')
+        {
+            return type[3] - '0';
+        }
+        return 0; // matrices aren't used by meshes
+    }
+
+    /**
+     * Read an index into an array of the document, e.g. the accessor of an attribute.
+     */
+    bool getIndex(const JsonValue &value, std::size_t count, std::size_t &index)
+    {
+        double number = value.getNumber(-1.0);
+        if (number < 0.0 || number >= count || number != static_cast<double>(static_cast<std::size_t>(number)))
+        {
+            return false;
+        }
+        index = static_cast<std::size_t>(number);
+        return true;
+    }
+
+    /**
+     * Read a size or offset, invalid ones are too large to pass any bounds check.
+     */
+    std::size_t getSize(const JsonValue &value, double fallback = 0.0)
+    {
+        double number = value.getNumber(fallback);
+        return number >= 0.0 && number < 9.0e15 ? static_cast<std::size_t>(number) : SIZE_MAX;
+    }
+
+    bool decodeBase64(const char *text, std::size_t size, std::vector<unsigned char> &data)
+    {
+        data.clear();
+        data.reserve(size / 4 * 3);
+
+        std::uint32_t bits = 0;
+        int bitCount = 0;
+        for (std::size_t i = 0; i < size && text[i] != '='; i++)
+        {
+            char character = text[i];
+            std::uint32_t value;
+            if (character >= 'A' && character <= 'Z')
+            {
+                value = character - 'A';
+            }
+            else if (character >= 'a' && character <= 'z')
+            {
+                value = character - 'a' + 26;
+            }
+            else if (character >= '0' && character <= '9')
+            {
+                value = character - '0' + 52;
+            }
+            else if (character == '+')
+            {
+                value = 62;
+            }
+            else if (character == '/')
+            {
+                value = 63;
+            }
+            else
+            {
+                return false;
+            }
+
+            bits = bits << 6 | value;
+            bitCount += 6;
+            if (bitCount >= 8)
+            {
+                bitCount -= 8;
+                data.push_back(static_cast<unsigned char>(bits >> bitCount));
+            }
+        }
+        return true;
+    }
+
+    bool isDataUri(const std::string &uri)
+    {
+        return uri.compare(0, 5, "data:") == 0;
+    }
+
+    /**
+     * Decode the content of a base64 data URI, which is how .gltf files embed buffers and images.
+     */
+    bool decodeDataUri(const std::string &uri, std::vector<unsigned char> &data)
+    {
+        std::size_t marker = uri.find(";base64,");
+        if (!isDataUri(uri) || marker == std::string::npos)
+        {
+            return false;
+        }
+
+        std::size_t begin = marker + 8;
+        return decodeBase64(uri.data() + begin, uri.size() - begin, data);
+    }
+
+    /**
+     * Relative URIs of external files are percent encoded.
+     */
+    std::string decodeUri(const std::string &uri)
+    {
+        std::string path;
+        for (std::size_t i = 0; i < uri.size(); i++)
+        {
+            if (uri[i] == '%' && i + 2 < uri.size() && std::isxdigit(static_cast<unsigned char>(uri[i + 1])) &&
+                std::isxdigit(static_cast<unsigned char>(uri[i + 2])))
+            {
+                path += static_cast<char>(std::stoi(uri.substr(i + 1, 2), nullptr, 16));
+                i += 2;
+            }
+            else
+            {
+                path += uri[i];
+            }
+        }
+        return path;
+    }
+
+    /**
+     * Copy one attribute into every vertex, elements are copied as a whole since their layout matches.
+     */
+    template <class Attribute>
+    void copyAttribute(const unsigned char *source, std::size_t stride, std::size_t count, Vertex *vertices,
+                       Attribute Vertex::*member)
+    {
+        for (std::size_t i = 0; i < count; i++)
+        {
+            std::memcpy(&(vertices[i].*member), source + i * stride, sizeof(Attribute));
+        }
+    }
+} // namespace
+
+bool GltfFile::isGltf(const std::string &path)
+{
+    std::size_t dot = path.find_last_of('.');
+    if (dot == std::string::npos)
+    {
+        return false;
+    }
+
+    std::string extension = path.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    return extension == "gltf" || extension == "glb";
+}
+
+bool GltfFile::open(const std::string &path)
+{
+    this->path = path;
+    baseDir = Glib::path_get_dirname(path);
+    if (!file.open(path))
+    {
+        return false;
+    }
+
+    const char *jsonText = reinterpret_cast<const char *>(file.getData());
+    std::size_t jsonSize = file.getSize();
+    bool isGlb = file.getSize() >= GLB_HEADER_SIZE && readUint32(file.getData()) == GLB_MAGIC;
+    if (isGlb && !readGlb(jsonText, jsonSize))
+    {
+        return false;
+    }
+
+    if (!JsonValue::parse(jsonText, jsonSize, json))
+    {
+        std::cerr << "Could not parse glTF file '" << path << "'" << std::endl;
+        return false;
+    }
+
+    // extensions a file requires change how it has to be read, the loader doesn't know any
+    if (json["asset"]["version"].getString().compare(0, 2, "2.") != 0 || json["extensionsRequired"].size() > 0)
+    {
+        std::cerr << "Unsupported glTF version or required extension in '" << path << "'" << std::endl;
+        return false;
+    }
+
+    if (!readBuffers())
+    {
+        return false;
+    }
+
+    const JsonValue &meshes = json["meshes"];
+    for (std::size_t i = 0; i < meshes.size(); i++)
+    {
+        const JsonValue &meshPrimitives = meshes.getElement(i)["primitives"];
+        for (std::size_t j = 0; j < meshPrimitives.size(); j++)
+        {
+            if (!readPrimitive(meshPrimitives.getElement(j)))
+            {
+                std::cerr << "Unsupported mesh " << i << " in glTF file '" << path << "'" << std::endl;
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+void GltfFile::build(std::vector<MeshHandle> &meshes, std::vector<GLuint> &materialIndices)
+{
+    // every image gets one texture per kind of map it's used as, since they are processed differently
+    const JsonValue &materials = json["materials"];
+    std::vector<std::pair<std::size_t, TextureType>> uses;
+    for (std::size_t i = 0; i < materials.size(); i++)
+    {
+        const JsonValue &material = materials.getElement(i);
+        int diffuseImage = getImage(material["pbrMetallicRoughness"]["baseColorTexture"]);
+        int emissiveImage = getImage(material["emissiveTexture"]);
+
+        for (auto use : {std::make_pair(diffuseImage, TextureType::diffuse),
+                         std::make_pair(emissiveImage, TextureType::emissive)})
+        {
+            std::pair<std::size_t, TextureType> imageUse(use.first, use.second);
+            if (use.first >= 0 && std::find(uses.begin(), uses.end(), imageUse) == uses.end())
+            {
+                uses.push_back(imageUse);
+            }
+        }
+    }
+
+    std::vector<Texture> textures = loadTextures(uses);
+
+    materialIndices.reserve(materials.size() + 1);
+    for (std::size_t i = 0; i < materials.size(); i++)
+    {
+        const JsonValue &material = materials.getElement(i);
+        const JsonValue &pbr = material["pbrMetallicRoughness"];
+
+        std::vector<Texture> materialTextures;
+        int diffuseImage = getImage(pbr["baseColorTexture"]);
+        int emissiveImage = getImage(material["emissiveTexture"]);
+        for (std::size_t j = 0; j < uses.size(); j++)
+        {
+            if ((static_cast<int>(uses[j].first) == diffuseImage && uses[j].second == TextureType::diffuse) ||
+                (static_cast<int>(uses[j].first) == emissiveImage && uses[j].second == TextureType::emissive))
+            {
+                materialTextures.push_back(textures[j]);
+            }
+        }
+
+        Material result(material["name"].getString(), materialTextures);
+
+        const JsonValue &baseColor = pbr["baseColorFactor"];
+        if (baseColor.size() == 4)
+        {
+            result.parameters.diffuseColor =
+                glm::vec4(baseColor.getElement(0).getNumber(), baseColor.getElement(1).getNumber(),
+                          baseColor.getElement(2).getNumber(), baseColor.getElement(3).getNumber());
+        }
+
+        const JsonValue &emissive = material["emissiveFactor"];
+        if (emissive.size() == 3)
+        {
+            result.parameters.emissiveColor = glm::vec4(emissive.getElement(0).getNumber(),
+                                                        emissive.getElement(1).getNumber(),
+                                                        emissive.getElement(2).getNumber(), 1.0f);
+        }
+
+        // there's no exact Phong equivalent of the roughness, smooth surfaces get a small and bright highlight
+        float roughness = static_cast<float>(pbr["roughnessFactor"].getNumber(1.0));
+        result.parameters.specularColor = glm::vec4(glm::vec3(0.5f * (1.0f - roughness)), 1.0f);
+        result.parameters.shininess = glm::mix(128.0f, 4.0f, roughness);
+
+        materialIndices.push_back(MaterialTable::getInstance().add(result));
+    }
+
+    // primitives without a material use the default one of the specification, plain white
+    GLuint defaultMaterial = 0;
+    bool hasDefaultMaterial = false;
+
+    meshes.reserve(meshes.size() + primitives.size());
+    for (Primitive &primitive : primitives)
+    {
+        GLuint materialIndex;
+        if (primitive.material >= 0)
+        {
+            materialIndex = materialIndices[primitive.material];
+        }
+        else
+        {
+            if (!hasDefaultMaterial)
+            {
+                defaultMaterial = MaterialTable::getInstance().add(Material("default", {}));
+                materialIndices.push_back(defaultMaterial);
+                hasDefaultMaterial = true;
+            }
+            materialIndex = defaultMaterial;
+        }
+
+        meshes.push_back(MeshPool::getInstance().create(std::move(primitive.vertices), std::move(primitive.indices),
+                                                        materialIndex));
+    }
+    primitives.clear();
+}
+
+std::size_t GltfFile::getVertexCount() const
+{
+    std::size_t count = 0;
+    for (const Primitive &primitive : primitives)
+    {
+        count += primitive.vertices.size();
+    }
+    return count;
+}
+
+bool GltfFile::readGlb(const char *&jsonText, std::size_t &jsonSize)
+{
+    const unsigned char *data = file.getData();
+    std::size_t size = std::min<std::size_t>(file.getSize(), readUint32(data + 8));
+
+    // the JSON chunk comes first, followed by an optional binary chunk
+    bool hasJson = false;
+    std::size_t offset = GLB_HEADER_SIZE;
+    while (offset + GLB_CHUNK_HEADER_SIZE <= size)
+    {
+        std::size_t chunkSize = readUint32(data + offset);
+        std::uint32_t chunkType = readUint32(data + offset + 4);
+        offset += GLB_CHUNK_HEADER_SIZE;
+        if (chunkSize > size - offset)
+        {
+            break;
+        }
+
+        if (chunkType == GLB_CHUNK_JSON && !hasJson)
+        {
+            jsonText = reinterpret_cast<const char *>(data + offset);
+            jsonSize = chunkSize;
+            hasJson = true;
+        }
+        else if (chunkType == GLB_CHUNK_BIN && !binaryChunk.data)
+        {
+            binaryChunk = {data + offset, chunkSize};
+        }
+
+        // chunks are padded to 4 bytes
+        offset += (chunkSize + 3) / 4 * 4;
+    }
+
+    if (!hasJson)
+    {
+        std::cerr << "Invalid glb file '" << path << "'" << std::endl;
+    }
+    return hasJson;
+}
+
+bool GltfFile::readBuffers()
+{
+    const JsonValue &bufferList = json["buffers"];
+    for (std::size_t i = 0; i < bufferList.size(); i++)
+    {
+        const JsonValue &buffer = bufferList.getElement(i);
+        const std::string &uri = buffer["uri"].getString();
+        BufferRange range{nullptr, 0};
+
+        if (uri.empty() && i == 0 && binaryChunk.data)
+        {
+            range = binaryChunk;
+        }
+        else if (isDataUri(uri))
+        {
+            decodedBuffers.emplace_back();
+            if (!decodeDataUri(uri, decodedBuffers.back()))
+            {
+                std::cerr << "Invalid data URI of buffer " << i << " in '" << path << "'" << std::endl;
+                return false;
+            }
+            range = {decodedBuffers.back().data(), decodedBuffers.back().size()};
+        }
+        else if (!uri.empty())
+        {
+            bufferFiles.emplace_back(new MappedFile());
+            if (!bufferFiles.back()->open(baseDir + '/' + decodeUri(uri)))
+            {
+                return false;
+            }
+            range = {bufferFiles.back()->getData(), bufferFiles.back()->getSize()};
+        }
+
+        if (range.size < getSize(buffer["byteLength"]))
+        {
+            std::cerr << "Buffer " << i << " of '" << path << "' is too short" << std::endl;
+            return false;
+        }
+        buffers.push_back(range);
+    }
+
+    return true;
+}
+
+bool GltfFile::readPrimitive(const JsonValue &primitive)
+{
+    if (primitive["mode"].getNumber(GLTF_TRIANGLES) != GLTF_TRIANGLES || primitive.has("extensions") ||
+        primitive.has("targets"))
+    {
+        return false;
+    }
+
+    Primitive result;
+    result.material = -1;
+    if (primitive.has("material"))
+    {
+        std::size_t material;
+        if (!getIndex(primitive["material"], json["materials"].size(), material))
+        {
+            return false;
+        }
+        result.material = static_cast<int>(material);
+    }
+
+    // float attributes have the same layout as the members of the vertex
+    const JsonValue &attributes = primitive["attributes"];
+    AccessorView positions;
+    if (!getAccessor(attributes["POSITION"], positions) || positions.componentType != GL_FLOAT ||
+        positions.componentCount != 3)
+    {
+        return false;
+    }
+
+    // value initialized, so attributes the primitive doesn't have are zero
+    result.vertices.assign(positions.count, Vertex());
+    copyAttribute(positions.data, positions.stride, positions.count, result.vertices.data(), &Vertex::position);
+
+    if (attributes.has("NORMAL"))
+    {
+        AccessorView normals;
+        if (!getAccessor(attributes["NORMAL"], normals) || normals.componentType != GL_FLOAT ||
+            normals.componentCount != 3 || normals.count != positions.count)
+        {
+            return false;
+        }
+        copyAttribute(normals.data, normals.stride, normals.count, result.vertices.data(), &Vertex::normal);
+    }
+
+    if (attributes.has("TEXCOORD_0"))
+    {
+        AccessorView textureCoordinates;
+        if (!getAccessor(attributes["TEXCOORD_0"], textureCoordinates) ||
+            textureCoordinates.componentType != GL_FLOAT || textureCoordinates.componentCount != 2 ||
+            textureCoordinates.count != positions.count)
+        {
+            return false;
+        }
+        copyAttribute(textureCoordinates.data, textureCoordinates.stride, textureCoordinates.count,
+                      result.vertices.data(), &Vertex::textureCoordinates);
+
+        // glTF has the origin of the texture coordinates at the top, the images are flipped on load instead
+        for (Vertex &vertex : result.vertices)
+        {
+            vertex.textureCoordinates.y = 1.0f - vertex.textureCoordinates.y;
+        }
+    }
+
+    if (primitive.has("indices"))
+    {
+        AccessorView indices;
+        if (!getAccessor(primitive["indices"], indices) || indices.componentCount != 1)
+        {
+            return false;
+        }
+
+        result.indices.resize(indices.count);
+        if (indices.componentType == GL_UNSIGNED_INT && indices.stride == sizeof(GLuint))
+        {
+            // already what the geometry pool takes, copied as a block
+            std::memcpy(result.indices.data(), indices.data, indices.count * sizeof(GLuint));
+        }
+        else if (indices.componentType == GL_UNSIGNED_SHORT)
+        {
+            for (std::size_t i = 0; i < indices.count; i++)
+            {
+                std::uint16_t index;
+                std::memcpy(&index, indices.data + i * indices.stride, sizeof(index));
+                result.indices[i] = index;
+            }
+        }
+        else if (indices.componentType == GL_UNSIGNED_BYTE)
+        {
+            for (std::size_t i = 0; i < indices.count; i++)
+            {
+                result.indices[i] = indices.data[i * indices.stride];
+            }
+        }
+        else
+        {
+            return false;
+        }
+
+        // an index out of range would make the GPU read the vertices of other meshes
+        if (!result.indices.empty() &&
+            *std::max_element(result.indices.begin(), result.indices.end()) >= result.vertices.size())
+        {
+            return false;
+        }
+    }
+    else
+    {
+        // every three vertices are a triangle
+        result.indices.resize(result.vertices.size());
+        for (std::size_t i = 0; i < result.indices.size(); i++)
+        {
+            result.indices[i] = static_cast<GLuint>(i);
+        }
+    }
+
+    if (result.indices.size() % 3 != 0)
+    {
+        return false;
+    }
+
+    primitives.push_back(std::move(result));
+    return true;
+}
+
+bool GltfFile::getAccessor(const JsonValue &accessorIndex, AccessorView &view) const
+{
+    const JsonValue &accessors = json["accessors"];
+    std::size_t index;
+    if (!getIndex(accessorIndex, accessors.size(), index))
+    {
+        return false;
+    }
+
+    // accessors without a buffer view are all zero, which no mesh needs
+    const JsonValue &accessor = accessors.getElement(index);
+    if (accessor.has("sparse") || !accessor.has("bufferView"))
+    {
+        return false;
+    }
+
+    view.componentType = static_cast<int>(accessor["componentType"].getNumber());
+    view.componentCount = getComponentCount(accessor["type"].getString());
+    view.count = getSize(accessor["count"]);
+    std::size_t elementSize = getComponentSize(view.componentType) * view.componentCount;
+    if (elementSize == 0 || accessor["normalized"].getBool())
+    {
+        return false;
+    }
+
+    BufferRange range;
+    if (!getBufferView(accessor["bufferView"], range, view.stride))
+    {
+        return false;
+    }
+    if (view.stride == 0)
+    {
+        view.stride = elementSize;
+    }
+
+    // all elements need to be inside the buffer view
+    std::size_t offset = getSize(accessor["byteOffset"]);
+    std::size_t available = offset <= range.size ? range.size - offset : 0;
+    if (view.stride < elementSize ||
+        (view.count > 0 && (available < elementSize || (view.count - 1) > (available - elementSize) / view.stride)))
+    {
+        return false;
+    }
+
+    view.data = range.data + offset;
+    return true;
+}
+
+bool GltfFile::getBufferView(const JsonValue &viewIndex, BufferRange &range, std::size_t &stride) const
+{
+    const JsonValue &views = json["bufferViews"];
+    std::size_t index;
+    std::size_t bufferIndex;
+    if (!getIndex(viewIndex, views.size(), index) ||
+        !getIndex(views.getElement(index)["buffer"], buffers.size(), bufferIndex))
+    {
+        return false;
+    }
+
+    const JsonValue &view = views.getElement(index);
+    const BufferRange &buffer = buffers[bufferIndex];
+    std::size_t offset = getSize(view["byteOffset"]);
+    std::size_t length = getSize(view["byteLength"]);
+    if (offset > buffer.size || length > buffer.size - offset)
+    {
+        return false;
+    }
+
+    range = {buffer.data + offset, length};
+    stride = getSize(view["byteStride"]);
+    return true;
+}
+
+std::vector<Texture> GltfFile::loadTextures(const std::vector<std::pair<std::size_t, TextureType>> &uses)
+{
+    TextureManager &textureManager = TextureManager::getInstance();
+    const JsonValue &images = json["images"];
+
+    std::vector<Texture> textures(uses.size());
+    std::vector<BufferRange> embedded(uses.size(), BufferRange{nullptr, 0});
+    std::vector<std::vector<unsigned char>> decodedImages(uses.size());
+
+    for (std::size_t i = 0; i < uses.size(); i++)
+    {
+        const JsonValue &image = images.getElement(uses[i].first);
+        const std::string &uri = image["uri"].getString();
+        textures[i].type = uses[i].second;
+        textures[i].path = uri.empty() || isDataUri(uri) ? "#image" + std::to_string(uses[i].first) : uri;
+
+        std::size_t stride;
+        if (image.has("bufferView"))
+        {
+            if (!getBufferView(image["bufferView"], embedded[i], stride))
+            {
+                std::cerr << "Invalid buffer view of image " << uses[i].first << " in '" << path << "'" << std::endl;
+            }
+        }
+        else if (isDataUri(uri))
+        {
+            if (decodeDataUri(uri, decodedImages[i]))
+            {
+                embedded[i] = {decodedImages[i].data(), decodedImages[i].size()};
+            }
+        }
+        else if (!uri.empty())
+        {
+            // external images are shared with other models and reloaded when they change
+            textures[i].reference = textureManager.load(baseDir + '/' + decodeUri(uri), uses[i].second);
+        }
+    }
+
+    // decoding and building the mip chains is the slow part, the images are independent of each other
+    std::vector<TextureManager::PreparedTexture> prepared(uses.size());
+    JobSystem::getInstance().parallelFor(uses.size(), [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; i++)
+        {
+            if (embedded[i].data)
+            {
+                prepared[i] = TextureManager::prepareFromMemory(path + textures[i].path, embedded[i].data,
+                                                                embedded[i].size, true, uses[i].second);
+            }
+        }
+    }, 1);
+
+    for (std::size_t i = 0; i < uses.size(); i++)
+    {
+        if (embedded[i].data)
+        {
+            textures[i].reference = textureManager.addPrepared(prepared[i]);
+        }
+        textures[i].id = textures[i].reference.getId();
+    }
+
+    return textures;
+}
+
+int GltfFile::getImage(const JsonValue &textureInfo) const
+{
+    const JsonValue &textures = json["textures"];
+    std::size_t texture;
+    std::size_t image;
+    if (!getIndex(textureInfo["index"], textures.size(), texture) ||
+        !getIndex(textures.getElement(texture)["source"], json["images"].size(), image))
+    {
+        return -1;
+    }
+    return static_cast<int>(image);
+}
\ No newline at end of file
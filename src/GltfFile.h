@@ -0,0 +1,109 @@
+#ifndef GLTFFILE_H
+#define GLTFFILE_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "lib/glad/include/glad/glad.h"
+
+#include "Json.h"
+#include "MappedFile.h"
+#include "Material.h"
+#include "Mesh.h"
+#include "TextureManager.h"
+#include "Vertex.h"
+
+/**
+ * Reads glTF 2.0 models (.gltf and .glb) without assimp.
+ * The file and its buffers are memory mapped, the attributes are copied out of the mapped buffers into the vertex
+ * layout of the geometry pool and 32 bit indices are copied as they are. Embedded images are decoded in parallel
+ * on the job system.
+ * Only triangle meshes with float positions, normals and texture coordinates are read, files with anything else
+ * (e.g. quantized attributes, sparse accessors or Draco compression) are rejected, so they can be imported with
+ * assimp instead. Node transforms are ignored, like the assimp path of the ModelPool does.
+ * Materials are mapped to the Phong materials of the renderer: the base color becomes the diffuse color and map.
+ */
+class GltfFile
+{
+public:
+    /**
+     * Whether the path has the extension of a glTF file.
+     */
+    static bool isGltf(const std::string &path);
+
+    /**
+     * Read the file and convert its meshes, without touching OpenGL, so it can be done on any thread.
+     * @return False if the file can't be read or uses something that isn't supported.
+     */
+    bool open(const std::string &path);
+
+    /**
+     * Decode the images, add the materials and upload the meshes, on the thread that owns the OpenGL context.
+     * The converted meshes are moved into the MeshPool, so this can only be done once.
+     */
+    void build(std::vector<MeshHandle> &meshes, std::vector<GLuint> &materialIndices);
+
+    /**
+     * Vertices of all meshes that were read.
+     */
+    std::size_t getVertexCount() const;
+
+private:
+    // part of a buffer that's read as an array of elements
+    struct AccessorView
+    {
+        const unsigned char *data;
+        std::size_t count;
+        std::size_t stride;
+        int componentType;
+        std::size_t componentCount;
+    };
+
+    struct Primitive
+    {
+        std::vector<Vertex> vertices;
+        std::vector<GLuint> indices;
+        int material; // -1 for the default material
+    };
+
+    struct BufferRange
+    {
+        const unsigned char *data;
+        std::size_t size;
+    };
+
+    std::string path;
+    std::string baseDir;
+    MappedFile file;
+    JsonValue json;
+
+    // the binary chunk of a .glb, external buffer files and decoded data URIs
+    BufferRange binaryChunk{nullptr, 0};
+    std::vector<std::unique_ptr<MappedFile>> bufferFiles;
+    std::vector<std::vector<unsigned char>> decodedBuffers;
+    std::vector<BufferRange> buffers;
+
+    std::vector<Primitive> primitives;
+
+    bool readGlb(const char *&jsonText, std::size_t &jsonSize);
+    bool readBuffers();
+    bool readPrimitive(const JsonValue &primitive);
+    bool getAccessor(const JsonValue &accessorIndex, AccessorView &view) const;
+    bool getBufferView(const JsonValue &viewIndex, BufferRange &range, std::size_t &stride) const;
+
+    /**
+     * Decode the embedded images the materials use, in parallel. External images are loaded by the
+     * TextureManager like the ones of other models.
+     */
+    std::vector<Texture> loadTextures(const std::vector<std::pair<std::size_t, TextureType>> &uses);
+
+    /**
+     * Index of the image a texture reference (like baseColorTexture) of a material points to, or -1.
+     */
+    int getImage(const JsonValue &textureInfo) const;
+};
+
+#endif
\ No newline at end of file
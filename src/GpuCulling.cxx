@@ -0,0 +1,210 @@
+#include "GpuCulling.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "DirectoryHelper.h"
+#include "FrameArena.h"
+
+GpuCulling::GpuCulling()
+{
+    shader = std::unique_ptr<Shader>(
+        new Shader(DirectoryHelper::getInstance().locateData("shaders/07_frustumCull.comp")));
+
+    glGenBuffers(1, &itemBuffer);
+    glGenBuffers(1, &commandBuffer);
+    glGenBuffers(1, &counterBuffer);
+}
+
+GpuCulling::~GpuCulling()
+{
+    glDeleteBuffers(1, &itemBuffer);
+    glDeleteBuffers(1, &commandBuffer);
+    glDeleteBuffers(1, &counterBuffer);
+}
+
+void GpuCulling::upload(const std::vector<CullItem> &items)
+{
+    itemCount = items.size();
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, itemBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, items.size() * sizeof(CullItem), items.data(), GL_STREAM_DRAW);
+}
+
+void GpuCulling::cull(const Frustum &frustum, std::size_t commandCount, std::size_t batchCount,
+                      const HiZBuffer *hiZ, const glm::vec3 &cameraPosition)
+{
+    if (commandCount > commandCapacity)
+    {
+        commandCapacity = std::max(commandCount, commandCapacity * 2);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, commandBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, commandCapacity * sizeof(DrawElementsIndirectCommand),
+                     NULL, GL_DYNAMIC_DRAW);
+    }
+
+    if (batchCount > counterCapacity)
+    {
+        counterCapacity = std::max(batchCount, counterCapacity * 2);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, counterBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, counterCapacity * sizeof(GLuint), NULL, GL_DYNAMIC_DRAW);
+    }
+
+    // culled commands need to stay zero (no instances), and all counters start at zero
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, commandBuffer);
+    GlExtensions::clearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, NULL);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, counterBuffer);
+    GlExtensions::clearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, NULL);
+
+    if (itemCount == 0)
+    {
+        return;
+    }
+
+    shader->use();
+    const std::array<glm::vec4, 6> &planes = frustum.getPlanes();
+    for (std::size_t i = 0; i < planes.size(); i++)
+    {
+        FrameString name("planes[");
+        appendNumber(name, i);
+        name += ']';
+        shader->setFloat(name.c_str(), planes[i]);
+    }
+    shader->setInt("itemCount", itemCount);
+
+    shader->setBool("hiZEnabled", hiZ != nullptr);
+    if (hiZ)
+    {
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, hiZ->getPyramidTexture());
+        shader->setInt("hiZ", 0);
+        shader->setFloat("hiZViewProjection", hiZ->getPyramidViewProjection());
+        shader->setFloat("hiZMargin", glm::distance(cameraPosition, hiZ->getPyramidCameraPosition()));
+        shader->setFloat("hiZSize", hiZ->getPyramidSize());
+        shader->setInt("hiZLevelCount", hiZ->getPyramidLevelCount());
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ITEM_BINDING, itemBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMMAND_BINDING, commandBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COUNTER_BINDING, counterBuffer);
+
+    GlExtensions::dispatchCompute((itemCount + GROUP_SIZE - 1) / GROUP_SIZE, 1, 1);
+
+    // the output is consumed as indirect commands and draw counts
+    GlExtensions::memoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+GLuint GpuCulling::getCommandBuffer() const
+{
+    return commandBuffer;
+}
+
+GLuint GpuCulling::getCounterBuffer() const
+{
+    return counterBuffer;
+}
+
+std::vector<DrawElementsIndirectCommand> GpuCulling::readCommands(std::size_t commandCount) const
+{
+    std::vector<DrawElementsIndirectCommand> commands(commandCount);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, commandBuffer);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, commandCount * sizeof(DrawElementsIndirectCommand),
+                       commands.data());
+    return commands;
+}
+
+std::vector<GLuint> GpuCulling::readCounters(std::size_t batchCount) const
+{
+    std::vector<GLuint> counters(batchCount);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, counterBuffer);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, batchCount * sizeof(GLuint), counters.data());
+    return counters;
+}
+
+CullingBenchmark::Result CullingBenchmark::run(std::size_t instanceCount)
+{
+    Result result;
+    result.instanceCount = instanceCount;
+    result.gpuMilliseconds = -1.0;
+    result.matchesReference = false;
+
+    // a random field of small boxes around a camera in the origin that's looking down -z
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> position(-200.0f, 200.0f);
+    std::uniform_real_distribution<float> size(0.5f, 2.0f);
+
+    std::vector<BoundingBox> boxes(instanceCount);
+    for (BoundingBox &box : boxes)
+    {
+        glm::vec3 center(position(random), position(random), position(random));
+        box.min = center - glm::vec3(size(random));
+        box.max = center + glm::vec3(size(random));
+    }
+
+    Frustum frustum(glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f));
+
+    // CPU reference
+    auto cpuStart = std::chrono::high_resolution_clock::now();
+    std::vector<bool> visible = Culling::cullBoxes(frustum, boxes);
+    auto cpuEnd = std::chrono::high_resolution_clock::now();
+    result.cpuMilliseconds = std::chrono::duration<double, std::milli>(cpuEnd - cpuStart).count();
+    result.visibleCount = std::count(visible.begin(), visible.end(), true);
+
+    if (!GlExtensions::hasComputeShader())
+    {
+        return result;
+    }
+
+    // every box is its own draw, the base instance identifies it in the output
+    std::vector<CullItem> items(instanceCount);
+    for (std::size_t i = 0; i < instanceCount; i++)
+    {
+        items[i].boundsMin = glm::vec4(boxes[i].min, 1.0f);
+        items[i].boundsMax = glm::vec4(boxes[i].max, 1.0f);
+        items[i].command = {36, 1, 0, 0, static_cast<GLuint>(i)};
+        items[i].batch = 0;
+        items[i].batchOffset = 0;
+    }
+
+    GpuCulling gpuCulling;
+    gpuCulling.upload(items);
+
+    // first run allocates the output buffers, only time the second run
+    gpuCulling.cull(frustum, instanceCount, 1);
+
+    GLuint query;
+    glGenQueries(1, &query);
+    glBeginQuery(GL_TIME_ELAPSED, query);
+    gpuCulling.cull(frustum, instanceCount, 1);
+    glEndQuery(GL_TIME_ELAPSED);
+
+    GLuint64 elapsedNanoseconds = 0;
+    glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsedNanoseconds);
+    glDeleteQueries(1, &query);
+    result.gpuMilliseconds = elapsedNanoseconds / 1.0e6;
+
+    // validate: the GPU has to find exactly the boxes the CPU found, in any order
+    GLuint gpuVisibleCount = gpuCulling.readCounters(1)[0];
+    std::vector<DrawElementsIndirectCommand> commands = gpuCulling.readCommands(gpuVisibleCount);
+
+    std::vector<GLuint> gpuVisible;
+    for (const DrawElementsIndirectCommand &command : commands)
+    {
+        gpuVisible.push_back(command.baseInstance);
+    }
+    std::sort(gpuVisible.begin(), gpuVisible.end());
+
+    std::vector<GLuint> cpuVisible;
+    for (std::size_t i = 0; i < visible.size(); i++)
+    {
+        if (visible[i])
+        {
+            cpuVisible.push_back(i);
+        }
+    }
+
+    result.matchesReference = gpuVisible == cpuVisible;
+    return result;
+}
\ No newline at end of file
@@ -0,0 +1,118 @@
+#ifndef GPUCULLING_H
+#define GPUCULLING_H
+
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "lib/glad/include/glad/glad.h"
+
+#include "Culling.h"
+#include "GlExtensions.h"
+#include "HiZBuffer.h"
+#include "Shader.h"
+
+/**
+ * Input of the GPU culling pass, one per object (std430 layout).
+ * The command is copied to the output if the object is visible.
+ */
+struct CullItem
+{
+    glm::vec4 boundsMin;
+    glm::vec4 boundsMax;
+    DrawElementsIndirectCommand command;
+    GLuint batch;       // index of the counter that is used to compact the output of this item
+    GLuint batchOffset; // first output command of the batch
+    GLuint padding;
+};
+
+/**
+ * Frustum (and optionally occlusion) culls objects with a compute shader and writes the draw commands of the visible objects
+ * into an indirect buffer, so visibility never has to be known on the CPU.
+ * The output is compacted per batch: the visible commands of a batch start at its batchOffset, the
+ * remaining commands of the batch have an instance count of zero, and its counter holds the number of
+ * visible commands. Needs OpenGL 4.3 (see GlExtensions::hasComputeShader).
+ */
+class GpuCulling
+{
+public:
+    GpuCulling();
+    virtual ~GpuCulling();
+
+    /**
+     * Upload the items that should be culled, they stay on the GPU until the next upload.
+     */
+    void upload(const std::vector<CullItem> &items);
+
+    /**
+     * Run the culling pass over the uploaded items.
+     * @param commandCount Size of the output, the sum of the command counts of all batches.
+     * @param batchCount Number of batches (and counters) referenced by the items.
+     * @param hiZ Depth pyramid to additionally test occlusion against, may be null. It needs to be built already
+     * (see HiZBuffer::hasPyramid).
+     * @param cameraPosition Current position of the camera, the boxes are grown by the movement since the pyramid.
+     */
+    void cull(const Frustum &frustum, std::size_t commandCount, std::size_t batchCount,
+              const HiZBuffer *hiZ = nullptr, const glm::vec3 &cameraPosition = glm::vec3(0.0f));
+
+    /**
+     * Buffer that holds the compacted commands, to be bound as GL_DRAW_INDIRECT_BUFFER.
+     */
+    GLuint getCommandBuffer() const;
+
+    /**
+     * Buffer that holds one GLuint per batch with the number of visible commands,
+     * can be bound as GL_PARAMETER_BUFFER_ARB if GlExtensions::hasIndirectCount.
+     */
+    GLuint getCounterBuffer() const;
+
+    /**
+     * Read the output back to the CPU (stalls the pipeline, only meant for validation and benchmarking).
+     */
+    std::vector<DrawElementsIndirectCommand> readCommands(std::size_t commandCount) const;
+    std::vector<GLuint> readCounters(std::size_t batchCount) const;
+
+    // remove copy functions, the pass owns buffer objects
+    GpuCulling(GpuCulling const &) = delete;
+    void operator=(GpuCulling const &) = delete;
+
+private:
+    // binding points of the storage buffers, need to match the compute shader
+    static constexpr GLuint ITEM_BINDING{0};
+    static constexpr GLuint COMMAND_BINDING{1};
+    static constexpr GLuint COUNTER_BINDING{2};
+
+    // work group size of the compute shader
+    static constexpr GLuint GROUP_SIZE{64};
+
+    std::unique_ptr<Shader> shader;
+
+    GLuint itemBuffer;
+    GLuint commandBuffer;
+    GLuint counterBuffer;
+
+    std::size_t itemCount{0};
+    std::size_t commandCapacity{0};
+    std::size_t counterCapacity{0};
+};
+
+namespace CullingBenchmark
+{
+    struct Result
+    {
+        std::size_t instanceCount;
+        std::size_t visibleCount;
+        double cpuMilliseconds;
+        double gpuMilliseconds; // negative if GPU culling isn't supported
+        bool matchesReference;  // whether the GPU output equals the CPU reference implementation
+    };
+
+    /**
+     * Cull a random field of boxes with the CPU reference implementation and with the GPU pass,
+     * time both and validate the GPU output against the CPU result.
+     */
+    Result run(std::size_t instanceCount);
+} // namespace CullingBenchmark
+
+#endif
\ No newline at end of file
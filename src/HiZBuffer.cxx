@@ -0,0 +1,348 @@
+#include "HiZBuffer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "DirectoryHelper.h"
+
+HiZBuffer::HiZBuffer(GLuint width, GLuint height)
+{
+    DirectoryHelper &directoryHelper = DirectoryHelper::getInstance();
+    downsampleShader = std::unique_ptr<Shader>(new Shader(
+        directoryHelper.locateData("shaders/07_fullscreen.vert"),
+        directoryHelper.locateData("shaders/07_hiZDownsample.frag")));
+    downsampleShader->setInt("source", 0);
+
+    // core profile needs a VAO for drawing, even if the vertex shader doesn't read any attributes
+    glGenVertexArrays(1, &emptyVao);
+
+    for (Readback &readback : readbacks)
+    {
+        glGenBuffers(1, &readback.pixelBuffer);
+    }
+
+    resize(width, height);
+}
+
+HiZBuffer::~HiZBuffer()
+{
+    deleteTargets();
+
+    for (Readback &readback : readbacks)
+    {
+        glDeleteBuffers(1, &readback.pixelBuffer);
+    }
+
+    glDeleteVertexArrays(1, &emptyVao);
+}
+
+void HiZBuffer::resize(GLuint width, GLuint height)
+{
+    if (width == this->width && height == this->height)
+    {
+        return;
+    }
+
+    this->width = width;
+    this->height = height;
+
+    deleteTargets();
+    createTargets();
+    pyramidBuilt = false;
+
+    // old readbacks don't match the new size anymore
+    for (Readback &readback : readbacks)
+    {
+        readback.pending = false;
+    }
+    cpuDepth.clear();
+    cpuWidth = 0;
+    cpuHeight = 0;
+}
+
+void HiZBuffer::bindSceneFramebuffer() const
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer);
+}
+
+void HiZBuffer::finishFrame(const glm::mat4 &viewProjection, const glm::vec3 &cameraPosition)
+{
+    buildPyramid();
+    pyramidViewProjection = viewProjection;
+    pyramidCameraPosition = cameraPosition;
+    pyramidBuilt = true;
+
+    finishReadback();
+    startReadback(viewProjection, cameraPosition);
+
+    // show the scene
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, sceneFramebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+bool HiZBuffer::hasPyramid() const
+{
+    return pyramidBuilt;
+}
+
+bool HiZBuffer::isOccluded(const BoundingBox &box, const glm::vec3 &cameraPosition) const
+{
+    if (cpuDepth.empty())
+    {
+        return false;
+    }
+
+    // the camera may have moved since the depth was read back, growing the box by that reduces late pop-in
+    glm::vec3 margin(glm::distance(cameraPosition, cpuCameraPosition));
+    glm::vec3 boundsMin = box.min - margin;
+    glm::vec3 boundsMax = box.max + margin;
+
+    // project the corners into the screen of the frame the depth was read back from
+    glm::vec3 ndcMin(1.0f);
+    glm::vec3 ndcMax(-1.0f);
+    for (int i = 0; i < 8; i++)
+    {
+        glm::vec3 corner((i & 1) ? boundsMax.x : boundsMin.x,
+                         (i & 2) ? boundsMax.y : boundsMin.y,
+                         (i & 4) ? boundsMax.z : boundsMin.z);
+        glm::vec4 clip = cpuViewProjection * glm::vec4(corner, 1.0f);
+
+        // crossing the camera plane, the projection is meaningless
+        if (clip.w <= 0.0f)
+        {
+            return false;
+        }
+
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        ndcMin = glm::min(ndcMin, ndc);
+        ndcMax = glm::max(ndcMax, ndc);
+    }
+
+    // only boxes that were completely on screen can be tested
+    if (ndcMin.x < -1.0f || ndcMin.y < -1.0f || ndcMax.x > 1.0f || ndcMax.y > 1.0f)
+    {
+        return false;
+    }
+
+    // texel rectangle covered by the box, rounded outwards
+    GLuint x0 = std::min(static_cast<GLuint>(std::floor((ndcMin.x * 0.5f + 0.5f) * cpuWidth)), cpuWidth - 1);
+    GLuint y0 = std::min(static_cast<GLuint>(std::floor((ndcMin.y * 0.5f + 0.5f) * cpuHeight)), cpuHeight - 1);
+    GLuint x1 = std::min(static_cast<GLuint>(std::ceil((ndcMax.x * 0.5f + 0.5f) * cpuWidth)), cpuWidth - 1);
+    GLuint y1 = std::min(static_cast<GLuint>(std::ceil((ndcMax.y * 0.5f + 0.5f) * cpuHeight)), cpuHeight - 1);
+
+    float furthestOccluderDepth = 0.0f;
+    for (GLuint y = y0; y <= y1; y++)
+    {
+        for (GLuint x = x0; x <= x1; x++)
+        {
+            furthestOccluderDepth = std::max(furthestOccluderDepth, cpuDepth[y * cpuWidth + x]);
+        }
+    }
+
+    // hidden if even the nearest point of the box lies behind everything that was drawn there
+    float nearestBoxDepth = ndcMin.z * 0.5f + 0.5f;
+    return nearestBoxDepth > furthestOccluderDepth;
+}
+
+GLuint HiZBuffer::getPyramidTexture() const
+{
+    return pyramidTexture;
+}
+
+GLuint HiZBuffer::getPyramidLevelCount() const
+{
+    return pyramidLevelCount;
+}
+
+glm::vec2 HiZBuffer::getPyramidSize() const
+{
+    return glm::vec2(std::max(width / 2, 1u), std::max(height / 2, 1u));
+}
+
+const glm::mat4 &HiZBuffer::getPyramidViewProjection() const
+{
+    return pyramidViewProjection;
+}
+
+const glm::vec3 &HiZBuffer::getPyramidCameraPosition() const
+{
+    return pyramidCameraPosition;
+}
+
+void HiZBuffer::createTargets()
+{
+    // scene framebuffer
+    glGenTextures(1, &colorTexture);
+    glBindTexture(GL_TEXTURE_2D, colorTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    glGenTextures(1, &depthTexture);
+    glBindTexture(GL_TEXTURE_2D, depthTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32F, width, height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    glGenFramebuffers(1, &sceneFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cerr << "Hi-Z scene framebuffer is incomplete" << std::endl;
+    }
+
+    // depth pyramid, level 0 is half the size of the depth buffer
+    GLuint levelWidth = std::max(width / 2, 1u);
+    GLuint levelHeight = std::max(height / 2, 1u);
+    pyramidLevelCount = static_cast<GLuint>(std::floor(std::log2(std::max(levelWidth, levelHeight)))) + 1;
+
+    glGenTextures(1, &pyramidTexture);
+    glBindTexture(GL_TEXTURE_2D, pyramidTexture);
+    for (GLuint level = 0; level < pyramidLevelCount; level++)
+    {
+        glTexImage2D(GL_TEXTURE_2D, level, GL_R32F, levelWidth, levelHeight, 0, GL_RED, GL_FLOAT, NULL);
+        levelWidth = std::max(levelWidth / 2, 1u);
+        levelHeight = std::max(levelHeight / 2, 1u);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, pyramidLevelCount - 1);
+
+    pyramidFramebuffers.resize(pyramidLevelCount);
+    glGenFramebuffers(pyramidLevelCount, pyramidFramebuffers.data());
+    for (GLuint level = 0; level < pyramidLevelCount; level++)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, pyramidFramebuffers[level]);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pyramidTexture, level);
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void HiZBuffer::deleteTargets()
+{
+    if (!sceneFramebuffer)
+    {
+        return;
+    }
+
+    glDeleteFramebuffers(1, &sceneFramebuffer);
+    glDeleteTextures(1, &colorTexture);
+    glDeleteTextures(1, &depthTexture);
+    glDeleteFramebuffers(pyramidFramebuffers.size(), pyramidFramebuffers.data());
+    glDeleteTextures(1, &pyramidTexture);
+
+    sceneFramebuffer = 0;
+    pyramidFramebuffers.clear();
+}
+
+void HiZBuffer::buildPyramid()
+{
+    glDisable(GL_DEPTH_TEST);
+    glBindVertexArray(emptyVao);
+    downsampleShader->use();
+    glActiveTexture(GL_TEXTURE0);
+
+    GLuint levelWidth = std::max(width / 2, 1u);
+    GLuint levelHeight = std::max(height / 2, 1u);
+
+    for (GLuint level = 0; level < pyramidLevelCount; level++)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, pyramidFramebuffers[level]);
+        glViewport(0, 0, levelWidth, levelHeight);
+
+        if (level == 0)
+        {
+            glBindTexture(GL_TEXTURE_2D, depthTexture);
+        }
+        else
+        {
+            // only let the shader see the previous level, the current one is being written
+            glBindTexture(GL_TEXTURE_2D, pyramidTexture);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level - 1);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level - 1);
+        }
+
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+
+        levelWidth = std::max(levelWidth / 2, 1u);
+        levelHeight = std::max(levelHeight / 2, 1u);
+    }
+
+    // make the whole pyramid visible again for the culling tests
+    glBindTexture(GL_TEXTURE_2D, pyramidTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, pyramidLevelCount - 1);
+
+    glBindVertexArray(0);
+    glViewport(0, 0, width, height);
+    glEnable(GL_DEPTH_TEST);
+}
+
+void HiZBuffer::startReadback(const glm::mat4 &viewProjection, const glm::vec3 &cameraPosition)
+{
+    // find the first level that's small enough to be tested on the CPU
+    GLuint level = 0;
+    GLuint levelWidth = std::max(width / 2, 1u);
+    GLuint levelHeight = std::max(height / 2, 1u);
+    while (levelWidth > MAX_READBACK_WIDTH && level + 1 < pyramidLevelCount)
+    {
+        level++;
+        levelWidth = std::max(levelWidth / 2, 1u);
+        levelHeight = std::max(levelHeight / 2, 1u);
+    }
+
+    Readback &readback = readbacks[nextReadback];
+    readback.width = levelWidth;
+    readback.height = levelHeight;
+    readback.viewProjection = viewProjection;
+    readback.cameraPosition = cameraPosition;
+    readback.pending = true;
+
+    // copy into the pixel buffer asynchronously, it's mapped once it comes around again
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, pyramidFramebuffers[level]);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pixelBuffer);
+    glBufferData(GL_PIXEL_PACK_BUFFER, levelWidth * levelHeight * sizeof(float), NULL, GL_STREAM_READ);
+    glReadPixels(0, 0, levelWidth, levelHeight, GL_RED, GL_FLOAT, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    nextReadback = (nextReadback + 1) % READBACK_BUFFER_COUNT;
+}
+
+void HiZBuffer::finishReadback()
+{
+    // the buffer that's about to be reused holds the oldest readback, which is done by now
+    Readback &readback = readbacks[nextReadback];
+
+    if (!readback.pending)
+    {
+        return;
+    }
+
+    std::size_t size = readback.width * readback.height;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pixelBuffer);
+    const float *data = static_cast<const float *>(
+        glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size * sizeof(float), GL_MAP_READ_BIT));
+
+    if (data)
+    {
+        cpuDepth.resize(size);
+        std::memcpy(cpuDepth.data(), data, size * sizeof(float));
+        cpuWidth = readback.width;
+        cpuHeight = readback.height;
+        cpuViewProjection = readback.viewProjection;
+        cpuCameraPosition = readback.cameraPosition;
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    readback.pending = false;
+}
\ No newline at end of file
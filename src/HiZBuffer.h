@@ -0,0 +1,125 @@
+#ifndef HIZBUFFER_H
+#define HIZBUFFER_H
+
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "lib/glad/include/glad/glad.h"
+
+#include "Culling.h"
+#include "Shader.h"
+
+/**
+ * Hierarchical depth buffer for occlusion culling.
+ * The scene is rendered into an offscreen framebuffer with a depth texture. After that, a pyramid is built in
+ * which every texel holds the furthest depth of the texels it covers in the level below.
+ * Objects are tested against the pyramid of the previous frame (the CPU copy lags at least one more frame), using
+ * the view projection that pyramid was rendered with. Objects that weren't completely on screen then are always
+ * treated as visible. Each box is grown by the distance the camera travelled since before it's projected.
+ * That's a heuristic which reduces objects popping in late while the camera moves, not a guarantee: a small
+ * occluder close to the camera can uncover more than the margin, objects behind it still appear late.
+ */
+class HiZBuffer
+{
+public:
+    HiZBuffer(GLuint width, GLuint height);
+    virtual ~HiZBuffer();
+
+    void resize(GLuint width, GLuint height);
+
+    /**
+     * Bind the offscreen framebuffer the scene needs to be rendered into.
+     */
+    void bindSceneFramebuffer() const;
+
+    /**
+     * Build the depth pyramid from the depth of the scene framebuffer and start reading back
+     * a coarse level for CPU side tests, then copy the scene to the default framebuffer.
+     * @param viewProjection The matrix the scene was rendered with.
+     * @param cameraPosition The position the scene was rendered from.
+     */
+    void finishFrame(const glm::mat4 &viewProjection, const glm::vec3 &cameraPosition);
+
+    /**
+     * Whether a pyramid was built since the buffer was created or resized, before that its content is undefined.
+     */
+    bool hasPyramid() const;
+
+    /**
+     * Test a box against the CPU copy of the pyramid.
+     * @param cameraPosition The current position of the camera, the box is grown by the movement since the copy.
+     * @return True if the box is hidden, false if it's (potentially) visible.
+     */
+    bool isOccluded(const BoundingBox &box, const glm::vec3 &cameraPosition) const;
+
+    /**
+     * Pyramid texture, level 0 has half the size of the scene framebuffer.
+     */
+    GLuint getPyramidTexture() const;
+    GLuint getPyramidLevelCount() const;
+    glm::vec2 getPyramidSize() const;
+
+    /**
+     * The view projection and camera position the current pyramid was built with.
+     */
+    const glm::mat4 &getPyramidViewProjection() const;
+    const glm::vec3 &getPyramidCameraPosition() const;
+
+    // remove copy functions, the buffer owns OpenGL objects
+    HiZBuffer(HiZBuffer const &) = delete;
+    void operator=(HiZBuffer const &) = delete;
+
+private:
+    // the level read back for CPU tests is the first one that's at most this wide
+    static constexpr GLuint MAX_READBACK_WIDTH{160};
+
+    // number of pixel buffers the readback cycles through, so mapping never waits for the GPU
+    static constexpr std::size_t READBACK_BUFFER_COUNT{2};
+
+    struct Readback
+    {
+        GLuint pixelBuffer{0};
+        GLuint width{0};
+        GLuint height{0};
+        glm::mat4 viewProjection;
+        glm::vec3 cameraPosition;
+        bool pending{false};
+    };
+
+    GLuint width{0};
+    GLuint height{0};
+
+    GLuint sceneFramebuffer{0};
+    GLuint colorTexture{0};
+    GLuint depthTexture{0};
+
+    GLuint pyramidTexture{0};
+    GLuint pyramidLevelCount{0};
+    std::vector<GLuint> pyramidFramebuffers;
+    glm::mat4 pyramidViewProjection;
+    glm::vec3 pyramidCameraPosition;
+    bool pyramidBuilt{false};
+
+    GLuint emptyVao{0};
+    std::unique_ptr<Shader> downsampleShader;
+
+    Readback readbacks[READBACK_BUFFER_COUNT];
+    std::size_t nextReadback{0};
+
+    // CPU copy of the most recently read back level
+    std::vector<float> cpuDepth;
+    GLuint cpuWidth{0};
+    GLuint cpuHeight{0};
+    glm::mat4 cpuViewProjection;
+    glm::vec3 cpuCameraPosition;
+
+    void createTargets();
+    void deleteTargets();
+    void buildPyramid();
+    void startReadback(const glm::mat4 &viewProjection, const glm::vec3 &cameraPosition);
+    void finishReadback();
+};
+
+#endif
\ No newline at end of file
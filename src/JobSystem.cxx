@@ -0,0 +1,454 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "AllocationTracker.h"
+#include "FrameArena.h"
+
+namespace
+{
+    const std::size_t NO_THREAD{std::numeric_limits<std::size_t>::max()};
+
+    // index of the calling thread in the job system, NO_THREAD for threads outside of it
+    thread_local std::size_t currentThread{NO_THREAD};
+} // namespace
+
+bool JobCounter::isDone() const
+{
+    return value.load(std::memory_order_acquire) == 0;
+}
+
+bool JobSystem::Deque::push(QueuedJob *job)
+{
+    std::int64_t b = bottom.load(std::memory_order_relaxed);
+    std::int64_t t = top.load(std::memory_order_acquire);
+    if (b - t >= CAPACITY)
+    {
+        return false;
+    }
+
+    jobs[b % CAPACITY].store(job, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom.store(b + 1, std::memory_order_relaxed);
+    return true;
+}
+
+JobSystem::QueuedJob *JobSystem::Deque::pop()
+{
+    std::int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+    bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::int64_t t = top.load(std::memory_order_relaxed);
+
+    if (t > b)
+    {
+        // empty
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    QueuedJob *job = jobs[b % CAPACITY].load(std::memory_order_relaxed);
+    if (t == b)
+    {
+        // the last job, a thief might take it at the same time
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        {
+            job = nullptr;
+        }
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+JobSystem::QueuedJob *JobSystem::Deque::steal()
+{
+    std::int64_t t = top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::int64_t b = bottom.load(std::memory_order_acquire);
+    if (t >= b)
+    {
+        return nullptr;
+    }
+
+    QueuedJob *job = jobs[t % CAPACITY].load(std::memory_order_relaxed);
+    if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+    {
+        // lost against the owner or another thief
+        return nullptr;
+    }
+    return job;
+}
+
+JobSystem &JobSystem::getInstance()
+{
+    static JobSystem instance;
+    return instance;
+}
+
+JobSystem::JobSystem()
+{
+    std::size_t coreCount = std::max(std::thread::hardware_concurrency(), 1u);
+    for (std::size_t i = 0; i < coreCount; i++)
+    {
+        threadStates.emplace_back(new ThreadState());
+        threadStates.back()->random = static_cast<std::uint32_t>(i) * 2654435761u + 1;
+    }
+    activeThreadCount = coreCount;
+
+    // the creating thread owns the OpenGL context, it keeps the first core to itself
+    currentThread = 0;
+    if (coreCount > 1)
+    {
+        pinThread(0, 1);
+    }
+
+    for (std::size_t i = 1; i < coreCount; i++)
+    {
+        workers.emplace_back(&JobSystem::work, this, i);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        running = false;
+    }
+    sleepCondition.notify_all();
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+void JobSystem::run(Job job, JobCounter &counter, const JobCounter *dependency)
+{
+    if (currentThread == NO_THREAD)
+    {
+        // other threads have no deque, so they do the work themselves
+        if (dependency)
+        {
+            wait(*dependency);
+        }
+        job();
+        return;
+    }
+
+    QueuedJob *queuedJob = allocateJob();
+    queuedJob->job = std::move(job);
+    queuedJob->rangeJob = nullptr;
+    queuedJob->counter = &counter;
+    queuedJob->dependency = dependency;
+    queue(queuedJob);
+}
+
+void JobSystem::wait(const JobCounter &counter)
+{
+    while (!counter.isDone())
+    {
+        if (currentThread != NO_THREAD)
+        {
+            QueuedJob *job = findJob(currentThread);
+            if (job)
+            {
+                execute(job);
+                continue;
+            }
+        }
+        std::this_thread::yield();
+    }
+}
+
+void JobSystem::parallelFor(std::size_t count, const RangeJob &function, std::size_t minGrain)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    // a few ranges per thread, so threads that finish early can steal from the others
+    std::size_t grain = std::max<std::size_t>(minGrain, count / (getActiveThreadCount() * 8));
+    grain = std::max<std::size_t>(grain, 1);
+    if (currentThread == NO_THREAD)
+    {
+        function(0, count);
+        return;
+    }
+
+    JobCounter counter;
+    splitRange(0, count, grain, function, counter);
+    wait(counter);
+}
+
+std::size_t JobSystem::getThreadCount() const
+{
+    return threadStates.size();
+}
+
+void JobSystem::setActiveThreadCount(std::size_t count)
+{
+    activeThreadCount = std::min(std::max<std::size_t>(count, 1), threadStates.size());
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    sleepCondition.notify_all();
+}
+
+std::size_t JobSystem::getActiveThreadCount() const
+{
+    return activeThreadCount;
+}
+
+void JobSystem::work(std::size_t threadIndex)
+{
+    currentThread = threadIndex;
+    pinThread(1, threadStates.size() - 1);
+    AllocationTracker::setFrameThread(true);
+
+    int idleCount = 0;
+    while (running)
+    {
+        if (threadIndex < activeThreadCount)
+        {
+            QueuedJob *job = findJob(threadIndex);
+            if (job)
+            {
+                execute(job);
+                idleCount = 0;
+                continue;
+            }
+
+            if (++idleCount < SPIN_COUNT)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+        }
+
+        // nothing to do, sleep until jobs are queued
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        sleepingWorkerCount++;
+        sleepCondition.wait(lock, [this, threadIndex] {
+            return !running || (threadIndex < activeThreadCount && queuedJobCount > 0);
+        });
+        sleepingWorkerCount--;
+        idleCount = 0;
+    }
+}
+
+JobSystem::QueuedJob *JobSystem::findJob(std::size_t threadIndex)
+{
+    ThreadState &state = *threadStates[threadIndex];
+    QueuedJob *job = state.deque.pop();
+
+    // steal, starting at a random thread so the thieves spread out
+    std::size_t threadCount = threadStates.size();
+    if (!job && threadCount > 1)
+    {
+        state.random ^= state.random << 13;
+        state.random ^= state.random >> 17;
+        state.random ^= state.random << 5;
+
+        std::size_t first = state.random % threadCount;
+        for (std::size_t i = 0; i < threadCount && !job; i++)
+        {
+            std::size_t victim = (first + i) % threadCount;
+            if (victim != threadIndex)
+            {
+                job = threadStates[victim]->deque.steal();
+            }
+        }
+    }
+
+    if (job)
+    {
+        queuedJobCount--;
+    }
+    return job;
+}
+
+JobSystem::QueuedJob *JobSystem::allocateJob()
+{
+    ThreadState &state = *threadStates[currentThread];
+    QueuedJob *job = &state.jobs[state.nextJob];
+    state.nextJob = (state.nextJob + 1) % Deque::CAPACITY;
+
+    // the ring wrapped around to a job that's still queued or running
+    while (job->queued.load(std::memory_order_acquire))
+    {
+        QueuedJob *other = findJob(currentThread);
+        if (other)
+        {
+            execute(other);
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+    return job;
+}
+
+void JobSystem::queue(QueuedJob *job)
+{
+    job->counter->value.fetch_add(1, std::memory_order_relaxed);
+    job->queued.store(true, std::memory_order_relaxed);
+
+    // the ring has as many jobs as the deque has room, so this only fails if the deque is full of other jobs
+    if (!threadStates[currentThread]->deque.push(job))
+    {
+        execute(job);
+        return;
+    }
+
+    queuedJobCount++;
+    wakeWorkers();
+}
+
+void JobSystem::execute(QueuedJob *job)
+{
+    // temporaries of the job in the frame arena are released when it's done
+    FrameArena::Scope scope;
+
+    if (job->dependency)
+    {
+        wait(*job->dependency);
+    }
+
+    if (job->rangeJob)
+    {
+        splitRange(job->begin, job->end, job->grain, *job->rangeJob, *job->counter);
+    }
+    else
+    {
+        job->job();
+        job->job = nullptr;
+    }
+
+    // the counter may be destroyed as soon as it's done, so the job is released first
+    JobCounter *counter = job->counter;
+    job->queued.store(false, std::memory_order_release);
+    counter->value.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+void JobSystem::wakeWorkers()
+{
+    if (sleepingWorkerCount > 0)
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+        }
+        sleepCondition.notify_all();
+    }
+}
+
+void JobSystem::splitRange(std::size_t begin, std::size_t end, std::size_t grain, const RangeJob &rangeJob,
+                           JobCounter &counter)
+{
+    // queue the upper half until the rest is small enough, the own thread continues with the lower half
+    while (end - begin > grain)
+    {
+        std::size_t middle = begin + (end - begin) / 2;
+
+        QueuedJob *job = allocateJob();
+        job->rangeJob = &rangeJob;
+        job->begin = middle;
+        job->end = end;
+        job->grain = grain;
+        job->counter = &counter;
+        job->dependency = nullptr;
+        queue(job);
+
+        end = middle;
+    }
+    rangeJob(begin, end);
+}
+
+void JobSystem::pinThread(std::size_t firstCore, std::size_t coreCount)
+{
+#ifdef __linux__
+    cpu_set_t cores;
+    CPU_ZERO(&cores);
+    for (std::size_t core = firstCore; core < firstCore + coreCount; core++)
+    {
+        CPU_SET(core, &cores);
+    }
+
+    // only a hint, the system might restrict the process to fewer cores
+    int error = pthread_setaffinity_np(pthread_self(), sizeof(cores), &cores);
+    if (error != 0)
+    {
+        std::cerr << "Failed to pin thread to cores " << firstCore << " - " << firstCore + coreCount - 1
+                  << ", error " << error << std::endl;
+    }
+#endif
+}
+
+std::vector<JobBenchmark::Result> JobBenchmark::run()
+{
+    JobSystem &jobSystem = JobSystem::getInstance();
+    std::size_t previousThreadCount = jobSystem.getActiveThreadCount();
+
+    const std::size_t JOB_COUNT = 100000;
+    const std::size_t ELEMENT_COUNT = 1 << 20;
+    std::vector<float> output(ELEMENT_COUNT);
+
+    std::vector<std::size_t> threadCounts;
+    for (std::size_t threadCount = 1; threadCount < jobSystem.getThreadCount(); threadCount *= 2)
+    {
+        threadCounts.push_back(threadCount);
+    }
+    threadCounts.push_back(jobSystem.getThreadCount());
+
+    std::vector<Result> results;
+    for (std::size_t threadCount : threadCounts)
+    {
+        jobSystem.setActiveThreadCount(threadCount);
+
+        Result result;
+        result.threadCount = threadCount;
+
+        // spawn overhead
+        auto spawnStart = std::chrono::high_resolution_clock::now();
+        JobCounter counter;
+        for (std::size_t i = 0; i < JOB_COUNT; i++)
+        {
+            jobSystem.run([] {}, counter);
+        }
+        jobSystem.wait(counter);
+        auto spawnEnd = std::chrono::high_resolution_clock::now();
+        result.spawnNanoseconds = std::chrono::duration<double, std::nano>(spawnEnd - spawnStart).count() / JOB_COUNT;
+
+        // parallel for with some math per element
+        auto forStart = std::chrono::high_resolution_clock::now();
+        jobSystem.parallelFor(ELEMENT_COUNT, [&output](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; i++)
+            {
+                float value = static_cast<float>(i);
+                for (int iteration = 0; iteration < 16; iteration++)
+                {
+                    value = std::sqrt(value) * std::sin(value) + static_cast<float>(i);
+                }
+                output[i] = value;
+            }
+        }, 256);
+        auto forEnd = std::chrono::high_resolution_clock::now();
+        result.parallelForMilliseconds = std::chrono::duration<double, std::milli>(forEnd - forStart).count();
+
+        result.speedup =
+            results.empty() ? 1.0 : results.front().parallelForMilliseconds / result.parallelForMilliseconds;
+        results.push_back(result);
+    }
+
+    jobSystem.setActiveThreadCount(previousThreadCount);
+    return results;
+}
\ No newline at end of file
@@ -0,0 +1,217 @@
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Number of unfinished jobs that were started with it. Waiting for a counter with JobSystem::wait
+ * is how the results of jobs are joined.
+ */
+class JobCounter
+{
+public:
+    JobCounter() = default;
+
+    bool isDone() const;
+
+    // remove copy functions, jobs refer to the counter
+    JobCounter(JobCounter const &) = delete;
+    void operator=(JobCounter const &) = delete;
+
+private:
+    friend class JobSystem;
+
+    std::atomic<int> value{0};
+};
+
+/**
+ * Work-stealing task scheduler shared by the whole engine.
+ * Every thread of the system owns a Chase-Lev deque: it pushes and pops its own jobs at the bottom without locks,
+ * idle threads steal from the top of the others. The thread that creates the system (the one owning the OpenGL
+ * context) is part of it and is pinned to the first core, the workers run on the remaining ones. The system
+ * thread never blocks in wait, it runs jobs until the counter is done.
+ * Jobs can only be queued from threads of the system, other threads run them right away.
+ * Jobs may use the FrameArena of their thread, it's rewound after every job.
+ */
+class JobSystem
+{
+public:
+    using Job = std::function<void()>;
+
+    /**
+     * Refers to a function that gets a subrange, without copying it. A std::function would allocate for lambdas
+     * with larger captures, which parallelFor is called with every frame. Only valid while the function exists,
+     * parallelFor waits for all ranges, so lambdas can be passed directly.
+     */
+    class RangeJob
+    {
+    public:
+        template <class Function,
+                  class = typename std::enable_if<!std::is_same<typename std::decay<Function>::type,
+                                                                RangeJob>::value>::type>
+        RangeJob(const Function &function)
+            : function(&function), call([](const void *function, std::size_t begin, std::size_t end) {
+                  (*static_cast<const Function *>(function))(begin, end);
+              })
+        {
+        }
+
+        void operator()(std::size_t begin, std::size_t end) const
+        {
+            call(function, begin, end);
+        }
+
+    private:
+        const void *function;
+        void (*call)(const void *function, std::size_t begin, std::size_t end);
+    };
+
+    static JobSystem &getInstance();
+
+    /**
+     * Queue a job, the counter is incremented until it's done.
+     * @param dependency Counter that has to be done before the job starts, optional.
+     */
+    void run(Job job, JobCounter &counter, const JobCounter *dependency = nullptr);
+
+    /**
+     * Run jobs until the counter is done.
+     */
+    void wait(const JobCounter &counter);
+
+    /**
+     * Call the function for subranges of [0, count) on all threads and wait for them.
+     * Ranges are split in halves as long as they're larger than the grain size, so idle threads can steal the
+     * other half. The grain size adapts to the number of threads, but is at least minGrain.
+     */
+    void parallelFor(std::size_t count, const RangeJob &function, std::size_t minGrain = 1);
+
+    /**
+     * Threads of the system, including the one that created it.
+     */
+    std::size_t getThreadCount() const;
+
+    /**
+     * Let only the given number of threads (at least 1, the creating one) run jobs, the others sleep.
+     * Meant to measure the scaling.
+     */
+    void setActiveThreadCount(std::size_t count);
+    std::size_t getActiveThreadCount() const;
+
+    // remove some functions for the singleton
+    JobSystem(JobSystem const &) = delete;
+    void operator=(JobSystem const &) = delete;
+
+private:
+    struct QueuedJob
+    {
+        // either a plain job, or a range of a parallel for that's split further when it runs
+        Job job;
+        const RangeJob *rangeJob{nullptr};
+        std::size_t begin{0};
+        std::size_t end{0};
+        std::size_t grain{1};
+
+        JobCounter *counter{nullptr};
+        const JobCounter *dependency{nullptr};
+        std::atomic<bool> queued{false};
+    };
+
+    /**
+     * Chase-Lev deque of a fixed capacity, only the owning thread may push and pop.
+     */
+    class Deque
+    {
+    public:
+        static constexpr std::int64_t CAPACITY{1024};
+
+        bool push(QueuedJob *job);
+        QueuedJob *pop();
+        QueuedJob *steal();
+
+    private:
+        std::atomic<std::int64_t> top{0};
+        std::atomic<std::int64_t> bottom{0};
+        std::atomic<QueuedJob *> jobs[CAPACITY];
+    };
+
+    struct ThreadState
+    {
+        Deque deque;
+
+        // jobs are reused in a ring, so queueing doesn't allocate them
+        std::unique_ptr<QueuedJob[]> jobs{new QueuedJob[Deque::CAPACITY]};
+        std::size_t nextJob{0};
+
+        // state of the thread's random number generator for picking a victim to steal from
+        std::uint32_t random{1};
+    };
+
+    // failed attempts to find a job before a worker goes to sleep
+    static constexpr int SPIN_COUNT{1000};
+
+    std::vector<std::unique_ptr<ThreadState>> threadStates;
+    std::vector<std::thread> workers;
+
+    std::atomic<std::size_t> activeThreadCount{1};
+    std::atomic<bool> running{true};
+
+    // queued jobs not taken yet, sleeping workers wake up for them
+    std::atomic<int> queuedJobCount{0};
+    std::atomic<int> sleepingWorkerCount{0};
+    std::mutex sleepMutex;
+    std::condition_variable sleepCondition;
+
+    JobSystem();
+    virtual ~JobSystem();
+
+    void work(std::size_t threadIndex);
+
+    /**
+     * Take a job from the own deque, or steal one from another thread.
+     */
+    QueuedJob *findJob(std::size_t threadIndex);
+
+    /**
+     * Take the next job of the calling thread's ring, helping with other jobs while it's still in use.
+     */
+    QueuedJob *allocateJob();
+    void queue(QueuedJob *job);
+    void execute(QueuedJob *job);
+    void wakeWorkers();
+
+    void splitRange(std::size_t begin, std::size_t end, std::size_t grain, const RangeJob &rangeJob,
+                    JobCounter &counter);
+
+    /**
+     * Restrict the calling thread to a range of cores (only on Linux).
+     */
+    static void pinThread(std::size_t firstCore, std::size_t coreCount);
+};
+
+namespace JobBenchmark
+{
+    struct Result
+    {
+        std::size_t threadCount;
+        double spawnNanoseconds;      // cost of queueing and running one empty job
+        double parallelForMilliseconds;
+        double speedup;               // over the same parallel for with one thread
+    };
+
+    /**
+     * Measure the job overhead and the scaling of a parallel for with a fixed amount of math per element,
+     * for 1, 2, 4, ... and all threads of the system.
+     */
+    std::vector<Result> run();
+} // namespace JobBenchmark
+
+#endif
\ No newline at end of file
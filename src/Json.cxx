@@ -0,0 +1,444 @@
+#include "Json.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+    const JsonValue nullValue;
+
+    void appendUtf8(std::string &string, unsigned long codePoint)
+    {
+        if (codePoint < 0x80)
+        {
+            string += static_cast<char>(codePoint);
+        }
+        else if (codePoint < 0x800)
+        {
+            string += static_cast<char>(0xC0 | codePoint >> 6);
+            string += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+        else if (codePoint < 0x10000)
+        {
+            string += static_cast<char>(0xE0 | codePoint >> 12);
+            string += static_cast<char>(0x80 | (codePoint >> 6 & 0x3F));
+            string += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+        else
+        {
+            string += static_cast<char>(0xF0 | codePoint >> 18);
+            string += static_cast<char>(0x80 | (codePoint >> 12 & 0x3F));
+            string += static_cast<char>(0x80 | (codePoint >> 6 & 0x3F));
+            string += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+    }
+} // namespace
+
+/**
+ * Recursive descent over the text, which is only read once.
+ */
+struct JsonValue::Parser
+{
+    const char *begin;
+    const char *position;
+    const char *end;
+
+    bool fail(const char *message)
+    {
+        std::cerr << "Invalid JSON at offset " << position - begin << ": " << message << std::endl;
+        return false;
+    }
+
+    void skipWhitespace()
+    {
+        while (position < end && (*position == ' ' || *position == '\t' || *position == '\n' || *position == '\r'))
+        {
+            position++;
+        }
+    }
+
+    bool consume(const char *literal)
+    {
+        std::size_t length = std::strlen(literal);
+        if (static_cast<std::size_t>(end - position) < length || std::memcmp(position, literal, length) != 0)
+        {
+            return false;
+        }
+        position += length;
+        return true;
+    }
+
+    bool parseValue(JsonValue &value, int depth)
+    {
+        if (depth > MAX_DEPTH)
+        {
+            return fail("nested too deeply");
+        }
+
+        skipWhitespace();
+        if (position == end)
+        {
+            return fail("unexpected end");
+        }
+
+        switch (*position)
+        {
+        case '{':
+            return parseObject(value, depth);
+        case '[':
+            return parseArray(value, depth);
+        case '"':
+            value.type = Type::string;
+            return parseString(value.string);
+        case 't':
+        case 'f':
+            value.type = Type::boolean;
+            value.boolean = *position == 't';
+            return consume(value.boolean ? "true" : "false") || fail("unknown literal");
+        case 'n':
+            value.type = Type::null;
+            return consume("null") || fail("unknown literal");
+        default:
+            return parseNumber(value);
+        }
+    }
+
+    bool parseObject(JsonValue &value, int depth)
+    {
+        value.type = Type::object;
+        position++;
+
+        skipWhitespace();
+        if (position < end && *position == '}')
+        {
+            position++;
+            return true;
+        }
+
+        while (true)
+        {
+            skipWhitespace();
+            if (position == end || *position != '"')
+            {
+                return fail("expected a member name");
+            }
+
+            value.members.emplace_back();
+            if (!parseString(value.members.back().first))
+            {
+                return false;
+            }
+
+            skipWhitespace();
+            if (position == end || *position != ':')
+            {
+                return fail("expected ':'");
+            }
+            position++;
+
+            if (!parseValue(value.members.back().second, depth + 1))
+            {
+                return false;
+            }
+
+            skipWhitespace();
+            if (position < end && *position == ',')
+            {
+                position++;
+            }
+            else if (position < end && *position == '}')
+            {
+                position++;
+                return true;
+            }
+            else
+            {
+                return fail("expected ',' or '}'");
+            }
+        }
+    }
+
+    bool parseArray(JsonValue &value, int depth)
+    {
+        value.type = Type::array;
+        position++;
+
+        skipWhitespace();
+        if (position < end && *position == ']')
+        {
+            position++;
+            return true;
+        }
+
+        while (true)
+        {
+            value.elements.emplace_back();
+            if (!parseValue(value.elements.back(), depth + 1))
+            {
+                return false;
+            }
+
+            skipWhitespace();
+            if (position < end && *position == ',')
+            {
+                position++;
+            }
+            else if (position < end && *position == ']')
+            {
+                position++;
+                return true;
+            }
+            else
+            {
+                return fail("expected ',' or ']'");
+            }
+        }
+    }
+
+    bool parseHex(unsigned long &codePoint)
+    {
+        if (end - position < 4)
+        {
+            return fail("incomplete escape");
+        }
+
+        codePoint = 0;
+        for (int i = 0; i < 4; i++)
+        {
+            char digit = *position++;
+            codePoint <<= 4;
+            if (digit >= '0' && digit <= '9')
+            {
+                codePoint |= digit - '0';
+            }
+            else if (digit >= 'a' && digit <= 'f')
+            {
+                codePoint |= digit - 'a' + 10;
+            }
+            else if (digit >= 'A' && digit <= 'F')
+            {
+                codePoint |= digit - 'A' + 10;
+            }
+            else
+            {
+                return fail("invalid escape");
+            }
+        }
+        return true;
+    }
+
+    bool parseString(std::string &string)
+    {
+        position++;
+
+        while (true)
+        {
+            // copy everything up to the next quote or escape at once
+            const char *run = position;
+            while (position < end && *position != '"' && *position != '\\')
+            {
+                position++;
+            }
+            string.append(run, position);
+
+            if (position == end)
+            {
+                return fail("unterminated string");
+            }
+            if (*position++ == '"')
+            {
+                return true;
+            }
+
+            if (position == end)
+            {
+                return fail("unterminated string");
+            }
+
+            char escape = *position++;
+            switch (escape)
+            {
+            case '"':
+            case '\\':
+            case '/':
+                string += escape;
+                break;
+            case 'b':
+                string += '\b';
+                break;
+            case 'f':
+                string += '\f';
+                break;
+            case 'n':
+                string += '\n';
+                break;
+            case 'r':
+                string += '\r';
+                break;
+            case 't':
+                string += '\t';
+                break;
+            case 'u':
+            {
+                unsigned long codePoint;
+                if (!parseHex(codePoint))
+                {
+                    return false;
+                }
+
+                // characters outside the basic plane are escaped as a surrogate pair, halves of a pair can't be
+                // encoded on their own
+                if (codePoint >= 0xDC00 && codePoint < 0xE000)
+                {
+                    return fail("invalid surrogate pair");
+                }
+                if (codePoint >= 0xD800 && codePoint < 0xDC00)
+                {
+                    unsigned long low;
+                    if (!consume("\\u"))
+                    {
+                        return fail("invalid surrogate pair");
+                    }
+                    if (!parseHex(low))
+                    {
+                        return false;
+                    }
+                    if (low < 0xDC00 || low >= 0xE000)
+                    {
+                        return fail("invalid surrogate pair");
+                    }
+                    codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                }
+                appendUtf8(string, codePoint);
+                break;
+            }
+            default:
+                return fail("invalid escape");
+            }
+        }
+    }
+
+    bool parseNumber(JsonValue &value)
+    {
+        const char *start = position;
+        while (position < end && *position != '\0' &&
+               (std::strchr("+-.eE", *position) || (*position >= '0' && *position <= '9')))
+        {
+            position++;
+        }
+
+        // strtod needs a terminated string, and the text may be a mapped file without one
+        char number[64];
+        std::size_t length = position - start;
+        if (length == 0 || length >= sizeof(number))
+        {
+            return fail("invalid value");
+        }
+        std::memcpy(number, start, length);
+        number[length] = '\0';
+
+        char *numberEnd;
+        value.type = Type::number;
+        value.number = std::strtod(number, &numberEnd);
+        return numberEnd == number + length || fail("invalid number");
+    }
+};
+
+bool JsonValue::parse(const char *text, std::size_t size, JsonValue &value)
+{
+    value = JsonValue();
+
+    Parser parser{text, text, text + size};
+    if (!parser.parseValue(value, 0))
+    {
+        value = JsonValue();
+        return false;
+    }
+
+    parser.skipWhitespace();
+    if (parser.position != parser.end)
+    {
+        value = JsonValue();
+        return parser.fail("unexpected text after the document");
+    }
+    return true;
+}
+
+JsonValue::Type JsonValue::getType() const
+{
+    return type;
+}
+
+bool JsonValue::isNull() const
+{
+    return type == Type::null;
+}
+
+bool JsonValue::isNumber() const
+{
+    return type == Type::number;
+}
+
+bool JsonValue::isString() const
+{
+    return type == Type::string;
+}
+
+bool JsonValue::isArray() const
+{
+    return type == Type::array;
+}
+
+bool JsonValue::isObject() const
+{
+    return type == Type::object;
+}
+
+bool JsonValue::getBool(bool fallback) const
+{
+    return type == Type::boolean ? boolean : fallback;
+}
+
+double JsonValue::getNumber(double fallback) const
+{
+    return type == Type::number ? number : fallback;
+}
+
+const std::string &JsonValue::getString() const
+{
+    // null values have an empty string
+    return type == Type::string ? string : nullValue.string;
+}
+
+std::size_t JsonValue::size() const
+{
+    return type == Type::array ? elements.size() : type == Type::object ? members.size() : 0;
+}
+
+const JsonValue &JsonValue::getElement(std::size_t index) const
+{
+    return type == Type::array && index < elements.size() ? elements[index] : nullValue;
+}
+
+const JsonValue &JsonValue::operator[](const char *key) const
+{
+    for (const auto &member : members)
+    {
+        if (member.first == key)
+        {
+            return member.second;
+        }
+    }
+    return nullValue;
+}
+
+bool JsonValue::has(const char *key) const
+{
+    return !(*this)[key].isNull();
+}
+
+const std::string &JsonValue::getKey(std::size_t index) const
+{
+    return type == Type::object && index < members.size() ? members[index].first : nullValue.string;
+}
\ No newline at end of file
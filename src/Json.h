@@ -0,0 +1,85 @@
+#ifndef JSON_H
+#define JSON_H
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * A parsed JSON document, or one value inside it.
+ * Just enough JSON for asset formats like glTF: the whole document is parsed at once, values are read only.
+ * Looking up something that doesn't exist returns a null value instead of failing, so optional parts of a document
+ * can be read without checking every step, e.g. json["materials"].getElement(0)["name"].getString().
+ */
+class JsonValue
+{
+public:
+    enum class Type
+    {
+        null,
+        boolean,
+        number,
+        string,
+        array,
+        object
+    };
+
+    /**
+     * Parse a UTF-8 document, it doesn't need to be null terminated.
+     * @return False if the document isn't valid JSON, the error is written to stderr.
+     */
+    static bool parse(const char *text, std::size_t size, JsonValue &value);
+
+    Type getType() const;
+    bool isNull() const;
+    bool isNumber() const;
+    bool isString() const;
+    bool isArray() const;
+    bool isObject() const;
+
+    /**
+     * The value, or the fallback if it has a different type.
+     */
+    bool getBool(bool fallback = false) const;
+    double getNumber(double fallback = 0.0) const;
+    const std::string &getString() const; // empty if the value isn't a string
+
+    /**
+     * Elements of an array or members of an object, 0 for everything else.
+     */
+    std::size_t size() const;
+
+    /**
+     * Element of an array, a null value if it's out of range or this isn't an array.
+     */
+    const JsonValue &getElement(std::size_t index) const;
+
+    /**
+     * Member of an object, a null value if it doesn't exist or this isn't an object.
+     */
+    const JsonValue &operator[](const char *key) const;
+    bool has(const char *key) const;
+
+    /**
+     * Name of a member of an object, by the order in the document.
+     */
+    const std::string &getKey(std::size_t index) const;
+
+private:
+    // deeper documents are rejected instead of overflowing the stack
+    static constexpr int MAX_DEPTH{256};
+
+    Type type{Type::null};
+    bool boolean{false};
+    double number{0.0};
+    std::string string;
+    std::vector<JsonValue> elements;
+
+    // objects of asset formats are small, so they are searched linearly
+    std::vector<std::pair<std::string, JsonValue>> members;
+
+    struct Parser;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,149 @@
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+#include "AssetArchive.h"
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open(const std::string &path)
+{
+    close();
+
+    // entries of the asset archive are views into its mapping
+    if (AssetArchive::isArchivePath(path))
+    {
+        if (!AssetArchive::getInstance().find(AssetArchive::getName(path), data, size))
+        {
+            std::cerr << "Could not find '" << path << "' in the asset archive" << std::endl;
+            data = nullptr;
+            size = 0;
+            return false;
+        }
+        borrowed = true;
+        opened = true;
+        return true;
+    }
+
+#ifdef __linux__
+    int descriptor = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (descriptor < 0)
+    {
+        std::cerr << "Could not open '" << path << "'" << std::endl;
+        return false;
+    }
+
+    struct stat status;
+    if (fstat(descriptor, &status) != 0)
+    {
+        std::cerr << "Could not get the size of '" << path << "'" << std::endl;
+        ::close(descriptor);
+        return false;
+    }
+
+    // mapping nothing fails, empty files are simply open without data
+    size = static_cast<std::size_t>(status.st_size);
+    if (size > 0)
+    {
+        void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (mapping == MAP_FAILED)
+        {
+            std::cerr << "Could not map '" << path << "'" << std::endl;
+            ::close(descriptor);
+            size = 0;
+            return false;
+        }
+        data = static_cast<const unsigned char *>(mapping);
+    }
+
+    // the mapping keeps the file alive
+    ::close(descriptor);
+#else
+    std::ifstream file(path, std::ios::binary);
+    buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    if (!file && !file.eof())
+    {
+        std::cerr << "Could not read '" << path << "'" << std::endl;
+        buffer.clear();
+        return false;
+    }
+    data = buffer.empty() ? nullptr : buffer.data();
+    size = buffer.size();
+#endif
+
+    opened = true;
+    return true;
+}
+
+void MappedFile::close()
+{
+#ifdef __linux__
+    if (data && !borrowed)
+    {
+        munmap(const_cast<unsigned char *>(data), size);
+    }
+#else
+    buffer = std::vector<unsigned char>();
+#endif
+
+    data = nullptr;
+    borrowed = false;
+    size = 0;
+    opened = false;
+}
+
+bool MappedFile::isOpen() const
+{
+    return opened;
+}
+
+const unsigned char *MappedFile::getData() const
+{
+    return data;
+}
+
+std::size_t MappedFile::getSize() const
+{
+    return size;
+}
+
+void MappedFile::release(std::size_t offset, std::size_t length) const
+{
+#ifdef __linux__
+    if (!data || offset >= size)
+    {
+        return;
+    }
+
+    std::size_t pageSize = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    std::size_t begin = (offset + pageSize - 1) / pageSize * pageSize;
+    std::size_t end = std::min(offset + length, size) / pageSize * pageSize;
+    if (begin < end)
+    {
+        madvise(const_cast<unsigned char *>(data) + begin, end - begin, MADV_DONTNEED);
+    }
+#endif
+}
+
+void MappedFile::adviseSequential() const
+{
+#ifdef __linux__
+    if (data)
+    {
+        madvise(const_cast<unsigned char *>(data), size, MADV_SEQUENTIAL);
+    }
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * Read only view of a whole file, mapped into memory (mmap on Linux).
+ * Pages are only read from disk when they're touched, and the page cache is used directly without copying the file.
+ * On other systems the file is read into memory instead.
+ * Paths into the AssetArchive open a view of the entry, the archive is mapped already.
+ */
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    virtual ~MappedFile();
+
+    /**
+     * Map a file, a file that was mapped before is unmapped first.
+     * @return False if the file doesn't exist or can't be mapped.
+     */
+    bool open(const std::string &path);
+
+    void close();
+
+    bool isOpen() const;
+
+    /**
+     * Contents of the file, valid until the file is closed. Empty files have no data.
+     */
+    const unsigned char *getData() const;
+    std::size_t getSize() const;
+
+    /**
+     * Tell the system the file is read front to back, so it reads ahead further.
+     */
+    void adviseSequential() const;
+
+    /**
+     * Drop the pages of a range that was read already from the memory of the process, so reading a file
+     * that's larger than the memory only ever keeps a part of it resident. The data stays valid, dropped pages
+     * are read again if they're touched. Only whole pages inside the range are dropped.
+     */
+    void release(std::size_t offset, std::size_t length) const;
+
+    // remove copy functions, the mapping would be released twice
+    MappedFile(MappedFile const &) = delete;
+    void operator=(MappedFile const &) = delete;
+
+private:
+    const unsigned char *data{nullptr};
+    std::size_t size{0};
+    bool opened{false};
+    bool borrowed{false}; // views into the asset archive are unmapped with the archive
+
+    // only used without mmap
+    std::vector<unsigned char> buffer;
+};
+
+#endif
\ No newline at end of file
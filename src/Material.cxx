@@ -0,0 +1,120 @@
+#include "Material.h"
+
+#include <iostream>
+#include <type_traits>
+
+#include "FrameArena.h"
+
+Material::Material(std::string name, std::vector<Texture> textures)
+    : name(name), textures(textures)
+{
+    updateFeatures();
+}
+
+Material Material::fromAssimp(const aiMaterial &material, std::vector<Texture> textures)
+{
+    aiString name;
+    material.Get(AI_MATKEY_NAME, name);
+    Material result(name.C_Str(), textures);
+
+    aiColor3D color;
+    if (material.Get(AI_MATKEY_COLOR_DIFFUSE, color) == AI_SUCCESS)
+    {
+        result.parameters.diffuseColor = glm::vec4(color.r, color.g, color.b, 1.0f);
+    }
+    if (material.Get(AI_MATKEY_COLOR_SPECULAR, color) == AI_SUCCESS)
+    {
+        result.parameters.specularColor = glm::vec4(color.r, color.g, color.b, 1.0f);
+    }
+    if (material.Get(AI_MATKEY_COLOR_EMISSIVE, color) == AI_SUCCESS)
+    {
+        result.parameters.emissiveColor = glm::vec4(color.r, color.g, color.b, 1.0f);
+    }
+
+    // formats without a specular exponent report 0, which would spread the highlight over the whole surface
+    float shininess = 0.0f;
+    if (material.Get(AI_MATKEY_SHININESS, shininess) == AI_SUCCESS && shininess > 0.0f)
+    {
+        result.parameters.shininess = shininess;
+    }
+
+    // an emissive map without an emissive color would stay black
+    if ((result.parameters.features & MATERIAL_EMISSIVE_MAP) &&
+        glm::vec3(result.parameters.emissiveColor) == glm::vec3(0.0f))
+    {
+        result.parameters.emissiveColor = glm::vec4(1.0f);
+    }
+
+    return result;
+}
+
+const std::vector<std::string> &Material::getFeatureDefines()
+{
+    static const std::vector<std::string> defines{"HAS_DIFFUSE_MAP", "HAS_SPECULAR_MAP", "HAS_EMISSIVE_MAP"};
+    return defines;
+}
+
+void Material::bindTextures(Shader &shader) const
+{
+    int diffuseNr = 0;
+    int specularNr = 0;
+    int emissiveNr = 0;
+
+    for (std::size_t i = 0; i < textures.size(); i++)
+    {
+        glActiveTexture(GL_TEXTURE0 + i); // activate texture based on index
+
+        // bound for every draw, so the name is built in the frame arena
+        FrameString uniformName("material.");
+        switch (textures[i].type)
+        {
+        case TextureType::diffuse:
+            uniformName += "textureDiffuse";
+            appendNumber(uniformName, diffuseNr);
+            diffuseNr++;
+            break;
+        case TextureType::specular:
+            uniformName += "textureSpecular";
+            appendNumber(uniformName, specularNr);
+            specularNr++;
+            break;
+        case TextureType::emissive:
+            uniformName += "textureEmissive";
+            appendNumber(uniformName, emissiveNr);
+            emissiveNr++;
+            break;
+        default:
+            std::cerr << "Unknown texture type: "
+                      << static_cast<std::underlying_type_t<TextureType>>(textures[i].type);
+            break;
+        }
+
+        shader.setInt(uniformName.c_str(), i);
+        glBindTexture(GL_TEXTURE_2D, textures[i].id);
+    }
+}
+
+void Material::updateFeatures()
+{
+    parameters.features = 0;
+    for (const Texture &texture : textures)
+    {
+        if (texture.id == 0)
+        {
+            continue;
+        }
+
+        switch (texture.type)
+        {
+        case TextureType::diffuse:
+            parameters.features |= MATERIAL_DIFFUSE_MAP;
+            break;
+        case TextureType::specular:
+            parameters.features |= MATERIAL_SPECULAR_MAP;
+            break;
+        case TextureType::emissive:
+            parameters.features |= MATERIAL_EMISSIVE_MAP;
+            break;
+        }
+    }
+}
\ No newline at end of file
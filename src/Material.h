@@ -0,0 +1,82 @@
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+#include <string>
+#include <vector>
+
+#include <assimp/material.h>
+#include <glm/glm.hpp>
+
+#include "lib/glad/include/glad/glad.h"
+
+#include "Shader.h"
+#include "TextureManager.h"
+
+struct Texture
+{
+    GLuint id;
+    TextureType type;
+    std::string path;
+
+    // keeps the texture loaded as long as a material uses it
+    SharedTexture reference;
+};
+
+/**
+ * Optional parts of a material, the shaders only sample the maps whose feature is set.
+ * Materials with the same features use the same shader variant.
+ */
+enum MaterialFeature : GLuint
+{
+    MATERIAL_DIFFUSE_MAP = 1 << 0,
+    MATERIAL_SPECULAR_MAP = 1 << 1,
+    MATERIAL_EMISSIVE_MAP = 1 << 2
+};
+
+/**
+ * Parameter block of a material as seen by the shader.
+ * Laid out the same in std140 and std430, so it's used for uniform blocks and storage buffers alike.
+ */
+struct MaterialParameters
+{
+    glm::vec4 diffuseColor{1.0f};                    // replaced by the diffuse map if the material has one
+    glm::vec4 specularColor{0.0f, 0.0f, 0.0f, 1.0f}; // replaced by the specular map if the material has one
+    glm::vec4 emissiveColor{0.0f, 0.0f, 0.0f, 1.0f}; // multiplies the emissive map if the material has one
+    GLuint features{0};
+    GLfloat shininess{32.0f};
+    GLuint padding[2]{};
+};
+
+/**
+ * Everything needed to shade a mesh: the textures, the parameters and the features they result in.
+ */
+class Material
+{
+public:
+    std::string name;
+    std::vector<Texture> textures;
+    MaterialParameters parameters;
+
+    Material() = default;
+    Material(std::string name, std::vector<Texture> textures);
+
+    /**
+     * Read the colors and the shininess of an assimp material, the textures are loaded by the model.
+     */
+    static Material fromAssimp(const aiMaterial &material, std::vector<Texture> textures);
+
+    /**
+     * Shader define of every MaterialFeature bit, bit 0 first (see ShaderVariants).
+     */
+    static const std::vector<std::string> &getFeatureDefines();
+
+    /**
+     * Bind the textures of the material and point the material samplers of the shader at them.
+     */
+    void bindTextures(Shader &shader) const;
+
+private:
+    void updateFeatures();
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,217 @@
+#include "MaterialTable.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "GlExtensions.h"
+
+MaterialTable &MaterialTable::getInstance()
+{
+    // created on first use, since it needs a valid OpenGL context
+    static MaterialTable instance;
+    return instance;
+}
+
+GLuint MaterialTable::add(const Material &material)
+{
+    std::string key = makeKey(material);
+    auto existing = materialIndices.find(key);
+    if (existing != materialIndices.end())
+    {
+        referenceCounts[existing->second]++;
+        return existing->second;
+    }
+
+    GLuint index;
+    if (!freeIndices.empty())
+    {
+        index = freeIndices.back();
+        freeIndices.pop_back();
+        materials[index] = material;
+        revision++;
+    }
+    else
+    {
+        index = materials.size();
+        materials.push_back(material);
+        referenceCounts.push_back(0);
+    }
+    referenceCounts[index] = 1;
+    materialIndices[key] = index;
+    changed = true;
+    return index;
+}
+
+void MaterialTable::release(GLuint index)
+{
+    if (index >= referenceCounts.size() || referenceCounts[index] == 0 || --referenceCounts[index] > 0)
+    {
+        return;
+    }
+
+    // the key can't be made again, setParameters changes the material but not its key
+    for (auto it = materialIndices.begin(); it != materialIndices.end(); ++it)
+    {
+        if (it->second == index)
+        {
+            materialIndices.erase(it);
+            break;
+        }
+    }
+
+    // dropping the textures releases their references
+    materials[index] = Material();
+    freeIndices.push_back(index);
+    revision++;
+    changed = true;
+}
+
+const Material &MaterialTable::get(GLuint index) const
+{
+    return materials[index];
+}
+
+std::size_t MaterialTable::getCount() const
+{
+    return materials.size();
+}
+
+bool MaterialTable::isUsed(GLuint index) const
+{
+    return referenceCounts[index] > 0;
+}
+
+std::size_t MaterialTable::getRevision() const
+{
+    return revision;
+}
+
+void MaterialTable::setParameters(GLuint index, const MaterialParameters &parameters)
+{
+    // the features depend on the textures, they can't be changed here
+    GLuint features = materials[index].parameters.features;
+    materials[index].parameters = parameters;
+    materials[index].parameters.features = features;
+    changed = true;
+}
+
+void MaterialTable::replaceTextures(const std::vector<std::pair<GLuint, GLuint>> &replaced)
+{
+    for (Material &material : materials)
+    {
+        for (Texture &texture : material.textures)
+        {
+            for (const auto &replacement : replaced)
+            {
+                if (texture.id == replacement.first)
+                {
+                    texture.id = replacement.second;
+                    break;
+                }
+            }
+        }
+    }
+
+    // the keys contain the texture ids
+    materialIndices.clear();
+    for (std::size_t i = 0; i < materials.size(); i++)
+    {
+        if (referenceCounts[i] > 0)
+        {
+            materialIndices.insert({makeKey(materials[i]), i});
+        }
+    }
+}
+
+void MaterialTable::setupShader(ShaderVariants &shader) const
+{
+    shader.setUniformBlockBinding("MaterialBlock", UNIFORM_BLOCK_BINDING);
+
+    // the storage buffer is an array of vec4, the stride includes the alignment of the uniform blocks
+    shader.setInt("materialStride", static_cast<GLint>(computeStride() / sizeof(glm::vec4)));
+}
+
+void MaterialTable::bind(GLuint index, Shader &shader)
+{
+    upload();
+    materials[index].bindTextures(shader);
+    glBindBufferRange(GL_UNIFORM_BUFFER, UNIFORM_BLOCK_BINDING, buffer, index * stride, sizeof(MaterialParameters));
+}
+
+void MaterialTable::bindAll()
+{
+    upload();
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, STORAGE_BUFFER_BINDING, buffer);
+}
+
+void MaterialTable::clear()
+{
+    glDeleteBuffers(1, &buffer);
+    buffer = 0;
+    bufferCapacity = 0;
+    materials.clear();
+    referenceCounts.clear();
+    freeIndices.clear();
+    materialIndices.clear();
+    revision++;
+    changed = false;
+}
+
+std::string MaterialTable::makeKey(const Material &material)
+{
+    // the raw bytes of the parameters and the texture names identify a material, the name doesn't matter
+    std::string key(reinterpret_cast<const char *>(&material.parameters), sizeof(MaterialParameters));
+    for (const Texture &texture : material.textures)
+    {
+        key.append(reinterpret_cast<const char *>(&texture.id), sizeof(texture.id));
+        key.append(reinterpret_cast<const char *>(&texture.type), sizeof(texture.type));
+    }
+    return key;
+}
+
+GLsizeiptr MaterialTable::computeStride()
+{
+    GLint alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    alignment = std::max(alignment, 1);
+    return (sizeof(MaterialParameters) + alignment - 1) / alignment * alignment;
+}
+
+void MaterialTable::upload()
+{
+    if (!changed)
+    {
+        return;
+    }
+
+    if (stride == 0)
+    {
+        stride = computeStride();
+    }
+
+    // every block starts at a multiple of the alignment, the gaps stay unused
+    std::vector<unsigned char> blocks(materials.size() * stride);
+    for (std::size_t i = 0; i < materials.size(); i++)
+    {
+        std::memcpy(&blocks[i * stride], &materials[i].parameters, sizeof(MaterialParameters));
+    }
+
+    if (buffer == 0)
+    {
+        glGenBuffers(1, &buffer);
+    }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    if (materials.size() > bufferCapacity)
+    {
+        bufferCapacity = materials.size();
+        glBufferData(GL_UNIFORM_BUFFER, blocks.size(), blocks.data(), GL_STATIC_DRAW);
+    }
+    else
+    {
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, blocks.size(), blocks.data());
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    changed = false;
+}
\ No newline at end of file
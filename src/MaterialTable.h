@@ -0,0 +1,125 @@
+#ifndef MATERIALTABLE_H
+#define MATERIALTABLE_H
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "lib/glad/include/glad/glad.h"
+
+#include "Material.h"
+#include "Shader.h"
+#include "ShaderVariants.h"
+
+/**
+ * Materials of all models in the process, meshes and draws refer to them by their index.
+ * The parameter blocks of all materials are kept in one buffer, each at an offset a uniform block can be bound to,
+ * so switching the material of a draw is a single glBindBufferRange instead of setting every uniform.
+ * The multi draw indirect shaders read the same buffer as a storage buffer and index it with the material index
+ * of their per draw data.
+ * Materials are reference counted: every add of a material needs a release, models release theirs when they're
+ * destroyed (see ModelSource). Released materials drop their textures, so the TextureManager can evict them, and
+ * their index is reused by the next new material.
+ * Only meant to be used from the thread that owns the OpenGL context.
+ */
+class MaterialTable
+{
+public:
+    static MaterialTable &getInstance();
+
+    // binding point of the uniform block MaterialBlock
+    static constexpr GLuint UNIFORM_BLOCK_BINDING{0};
+
+    // binding point of the storage buffer MaterialParameterBuffer, after the per draw data and the material textures
+    static constexpr GLuint STORAGE_BUFFER_BINDING{2};
+
+    /**
+     * Add a material, an identical material that was added before (same textures and parameters) is shared.
+     * @return Index of the material.
+     */
+    GLuint add(const Material &material);
+
+    /**
+     * Release a material that was added, it's removed once every add was released.
+     */
+    void release(GLuint index);
+
+    const Material &get(GLuint index) const;
+
+    /**
+     * Number of indices, including the ones of removed materials (see isUsed).
+     */
+    std::size_t getCount() const;
+    bool isUsed(GLuint index) const;
+
+    /**
+     * Changes whenever a material was removed or its index was reused, but not when materials are only appended.
+     * Data that's kept per index needs to be built again then (see MaterialTextures).
+     */
+    std::size_t getRevision() const;
+
+    /**
+     * Replace the parameters of a material, every mesh using it is affected.
+     */
+    void setParameters(GLuint index, const MaterialParameters &parameters);
+
+    /**
+     * Follow textures that were swapped by the TextureManager (see TextureManager::finishReloads).
+     * @param replaced Old and new id of every replaced texture.
+     */
+    void replaceTextures(const std::vector<std::pair<GLuint, GLuint>> &replaced);
+
+    /**
+     * Point the MaterialBlock of the variants at the uniform block binding and tell them the stride of the
+     * storage buffer. Needs to be done once after creating shader variants that use materials.
+     */
+    void setupShader(ShaderVariants &shader) const;
+
+    /**
+     * Bind the textures and the parameter block of one material.
+     */
+    void bind(GLuint index, Shader &shader);
+
+    /**
+     * Bind the parameter blocks of all materials as storage buffer (multi draw indirect path only).
+     */
+    void bindAll();
+
+    /**
+     * Delete all materials and the buffer, needs to be called while the OpenGL context still exists.
+     */
+    void clear();
+
+    // remove some functions for the singleton
+    MaterialTable(MaterialTable const &) = delete;
+    void operator=(MaterialTable const &) = delete;
+
+private:
+    MaterialTable() = default;
+
+    std::vector<Material> materials;
+    std::vector<GLuint> referenceCounts;
+    std::vector<GLuint> freeIndices;
+    std::unordered_map<std::string, GLuint> materialIndices;
+    std::size_t revision{0};
+
+    GLuint buffer{0};
+    std::size_t bufferCapacity{0};
+    GLsizeiptr stride{0};
+    bool changed{false};
+
+    static std::string makeKey(const Material &material);
+
+    /**
+     * Size of a parameter block rounded up to the offset alignment of uniform buffer bindings.
+     */
+    static GLsizeiptr computeStride();
+
+    /**
+     * Write the parameter blocks into the buffer if materials were added or changed since the last upload.
+     */
+    void upload();
+};
+
+#endif
\ No newline at end of file
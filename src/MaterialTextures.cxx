@@ -0,0 +1,293 @@
+#include "MaterialTextures.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "GlExtensions.h"
+
+MaterialTextures::MaterialTextures(TextureBindingMode mode)
+    : mode(mode)
+{
+    const unsigned char white[4]{255, 255, 255, 255};
+    const unsigned char black[4]{0, 0, 0, 255};
+    whiteTexture = createSolidTexture(white);
+    blackTexture = createSolidTexture(black);
+
+    glGenBuffers(1, &materialBuffer);
+}
+
+MaterialTextures::~MaterialTextures()
+{
+    reset();
+    glDeleteTextures(1, &whiteTexture);
+    glDeleteTextures(1, &blackTexture);
+    glDeleteBuffers(1, &materialBuffer);
+}
+
+TextureBindingMode MaterialTextures::getMode() const
+{
+    return mode;
+}
+
+void MaterialTextures::update()
+{
+    MaterialTable &table = MaterialTable::getInstance();
+
+    // removed materials leave holes and their indices get reused, which the arrays can't follow
+    if (table.getRevision() != tableRevision)
+    {
+        reset();
+        tableRevision = table.getRevision();
+    }
+
+    for (GLuint index = materials.size(); index < table.getCount(); index++)
+    {
+        // the lighting shader only samples the first map of each type
+        const Material &material = table.get(index);
+        bool used = table.isUsed(index);
+        GLuint diffuse = used ? findTexture(material, TextureType::diffuse, whiteTexture) : whiteTexture;
+        GLuint specular = used ? findTexture(material, TextureType::specular, blackTexture) : blackTexture;
+
+        MaterialTextureSet textureSet;
+        textureSet.entry = MaterialEntry();
+        if (mode == TextureBindingMode::bindless)
+        {
+            textureSet.entry.diffuseHandle = makeResident(diffuse);
+            textureSet.entry.specularHandle = makeResident(specular);
+        }
+        else
+        {
+            std::pair<std::size_t, GLuint> diffuseLayer = addLayer(diffuse);
+            std::pair<std::size_t, GLuint> specularLayer = addLayer(specular);
+            textureSet.diffuseGroup = diffuseLayer.first;
+            textureSet.entry.diffuseLayer = diffuseLayer.second;
+            textureSet.specularGroup = specularLayer.first;
+            textureSet.entry.specularLayer = specularLayer.second;
+        }
+
+        materials.push_back(textureSet);
+        materialsChanged = true;
+    }
+}
+
+std::uint64_t MaterialTextures::getBatchKey(GLuint materialIndex) const
+{
+    if (mode == TextureBindingMode::bindless)
+    {
+        return 0;
+    }
+
+    const MaterialTextureSet &textureSet = materials[materialIndex];
+    return (static_cast<std::uint64_t>(textureSet.diffuseGroup) << 32) | textureSet.specularGroup;
+}
+
+void MaterialTextures::prepare()
+{
+    for (ArrayGroup &group : groups)
+    {
+        if (group.changed)
+        {
+            buildArray(group);
+        }
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, materialBuffer);
+    if (materialsChanged)
+    {
+        std::vector<MaterialEntry> entries;
+        entries.reserve(materials.size());
+        for (const MaterialTextureSet &textureSet : materials)
+        {
+            entries.push_back(textureSet.entry);
+        }
+
+        glBufferData(GL_SHADER_STORAGE_BUFFER, entries.size() * sizeof(MaterialEntry), entries.data(),
+                     GL_STATIC_DRAW);
+        materialsChanged = false;
+    }
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MATERIAL_BUFFER_BINDING, materialBuffer);
+}
+
+void MaterialTextures::bindBatch(GLuint materialIndex, Shader &shader) const
+{
+    if (mode == TextureBindingMode::bindless)
+    {
+        return;
+    }
+
+    const MaterialTextureSet &textureSet = materials[materialIndex];
+    glActiveTexture(GL_TEXTURE0 + DIFFUSE_ARRAY_UNIT);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, groups[textureSet.diffuseGroup].array);
+    glActiveTexture(GL_TEXTURE0 + SPECULAR_ARRAY_UNIT);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, groups[textureSet.specularGroup].array);
+    glActiveTexture(GL_TEXTURE0);
+
+    shader.setInt("diffuseArray", DIFFUSE_ARRAY_UNIT);
+    shader.setInt("specularArray", SPECULAR_ARRAY_UNIT);
+}
+
+GLuint MaterialTextures::createSolidTexture(const unsigned char *color)
+{
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, color);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    return texture;
+}
+
+GLuint MaterialTextures::findTexture(const Material &material, TextureType type, GLuint fallback)
+{
+    for (const Texture &texture : material.textures)
+    {
+        if (texture.type == type && texture.id != 0)
+        {
+            references.push_back(texture.reference);
+            return texture.id;
+        }
+    }
+    return fallback;
+}
+
+void MaterialTextures::reset()
+{
+    for (const auto &handle : handles)
+    {
+        GlExtensions::makeTextureHandleNonResident(handle.second);
+    }
+    handles.clear();
+
+    for (ArrayGroup &group : groups)
+    {
+        glDeleteTextures(1, &group.array);
+    }
+    groups.clear();
+    layerOfTexture.clear();
+
+    materials.clear();
+    materialsChanged = true;
+
+    // last, releasing a texture can delete it right away
+    references.clear();
+}
+
+std::pair<std::size_t, GLuint> MaterialTextures::addLayer(GLuint texture)
+{
+    auto existing = layerOfTexture.find(texture);
+    if (existing != layerOfTexture.end())
+    {
+        return existing->second;
+    }
+
+    GLint internalFormat, width, height, compressed, maxLevel;
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED, &compressed);
+    glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, &maxLevel);
+
+    // the maximum level is 1000 for textures that never set it
+    GLsizei fullLevelCount = static_cast<GLsizei>(std::log2(std::max(width, height))) + 1;
+    GLsizei levelCount = std::min(maxLevel + 1, fullLevelCount);
+
+    auto group = std::find_if(groups.begin(), groups.end(), [&](const ArrayGroup &group) {
+        return group.internalFormat == static_cast<GLenum>(internalFormat) && group.width == width &&
+               group.height == height && group.levelCount == levelCount;
+    });
+
+    if (group == groups.end())
+    {
+        ArrayGroup newGroup;
+        newGroup.internalFormat = internalFormat;
+        newGroup.width = width;
+        newGroup.height = height;
+        newGroup.levelCount = levelCount;
+        newGroup.compressed = compressed == GL_TRUE;
+        groups.push_back(newGroup);
+        group = groups.end() - 1;
+    }
+
+    std::pair<std::size_t, GLuint> layer(group - groups.begin(), group->layers.size());
+    group->layers.push_back(texture);
+    group->changed = true;
+    layerOfTexture[texture] = layer;
+    return layer;
+}
+
+void MaterialTextures::buildArray(ArrayGroup &group)
+{
+    // arrays can't grow, so the whole array is built again whenever a layer was added,
+    // which only happens while new models are loaded
+    glDeleteTextures(1, &group.array);
+    glGenTextures(1, &group.array);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, group.array);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, group.levelCount - 1);
+
+    GLsizei layerCount = group.layers.size();
+    std::vector<unsigned char> pixels;
+
+    for (GLsizei level = 0; level < group.levelCount; level++)
+    {
+        GLsizei levelWidth = std::max(group.width >> level, 1);
+        GLsizei levelHeight = std::max(group.height >> level, 1);
+
+        // the layers are copied through client memory, OpenGL 3.3 can't copy between textures directly
+        if (group.compressed)
+        {
+            glBindTexture(GL_TEXTURE_2D, group.layers[0]);
+            GLint levelSize = 0;
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &levelSize);
+            pixels.resize(levelSize);
+
+            glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, group.internalFormat, levelWidth, levelHeight,
+                                   layerCount, 0, levelSize * layerCount, NULL);
+            for (GLsizei layer = 0; layer < layerCount; layer++)
+            {
+                glBindTexture(GL_TEXTURE_2D, group.layers[layer]);
+                glGetCompressedTexImage(GL_TEXTURE_2D, level, pixels.data());
+                glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, levelWidth, levelHeight, 1,
+                                          group.internalFormat, levelSize, pixels.data());
+            }
+        }
+        else
+        {
+            pixels.resize(static_cast<std::size_t>(levelWidth) * levelHeight * 4);
+
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, level, group.internalFormat, levelWidth, levelHeight, layerCount, 0,
+                         GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+            for (GLsizei layer = 0; layer < layerCount; layer++)
+            {
+                glBindTexture(GL_TEXTURE_2D, group.layers[layer]);
+                glGetTexImage(GL_TEXTURE_2D, level, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+                glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, levelWidth, levelHeight, 1, GL_RGBA,
+                                GL_UNSIGNED_BYTE, pixels.data());
+            }
+        }
+    }
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    group.changed = false;
+}
+
+GLuint64 MaterialTextures::makeResident(GLuint texture)
+{
+    auto existing = handles.find(texture);
+    if (existing != handles.end())
+    {
+        return existing->second;
+    }
+
+    // the sampler state of the texture is baked into the handle, textures mustn't change it afterwards
+    GLuint64 handle = GlExtensions::getTextureHandle(texture);
+    GlExtensions::makeTextureHandleResident(handle);
+    handles[texture] = handle;
+    return handle;
+}
\ No newline at end of file
@@ -0,0 +1,140 @@
+#ifndef MATERIALTEXTURES_H
+#define MATERIALTEXTURES_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "lib/glad/include/glad/glad.h"
+
+#include "MaterialTable.h"
+#include "Shader.h"
+#include "TextureManager.h"
+
+enum class TextureBindingMode
+{
+    perMesh,      // bind the textures of every batch to units 0..N
+    textureArray, // same sized textures are layers of one array, a batch binds its arrays and draws pick the layer
+    bindless      // the material buffer holds texture handles, nothing is bound at all (GL_ARB_bindless_texture)
+};
+
+/**
+ * Makes the textures of many materials available to one multi draw indirect call, so batches of meshes with
+ * different textures don't need any texture binds in between.
+ * Every material of the MaterialTable gets an entry in the material texture buffer (for its first diffuse and
+ * specular map), which the shader indexes with the material index of the per draw data.
+ * Only meant to be used with the multi draw indirect path and the 07_materialTextures shaders.
+ */
+class MaterialTextures
+{
+public:
+    explicit MaterialTextures(TextureBindingMode mode);
+    virtual ~MaterialTextures();
+
+    TextureBindingMode getMode() const;
+
+    /**
+     * Add the textures of the materials that were added to the MaterialTable since the last update,
+     * everything is added again once materials were removed from it.
+     */
+    void update();
+
+    /**
+     * Materials with the same key can be drawn in one batch, which is always the case for bindless textures.
+     */
+    std::uint64_t getBatchKey(GLuint materialIndex) const;
+
+    /**
+     * Build the arrays or make the handles of new materials resident, upload the material buffer and bind it.
+     * Needs to be called before the batches are drawn.
+     */
+    void prepare();
+
+    /**
+     * Bind what a batch needs, which are the arrays of its material for texture arrays and nothing for bindless.
+     */
+    void bindBatch(GLuint materialIndex, Shader &shader) const;
+
+    // remove copy functions, the material textures own OpenGL objects
+    MaterialTextures(MaterialTextures const &) = delete;
+    void operator=(MaterialTextures const &) = delete;
+
+private:
+    // binding point of the material texture buffer, after the per draw data
+    static constexpr GLuint MATERIAL_BUFFER_BINDING{1};
+
+    // texture units of the arrays, the same ones that per mesh binding uses
+    static constexpr GLuint DIFFUSE_ARRAY_UNIT{0};
+    static constexpr GLuint SPECULAR_ARRAY_UNIT{1};
+
+    // material entry as seen by the shader (std430 layout)
+    struct MaterialEntry
+    {
+        GLuint64 diffuseHandle;
+        GLuint64 specularHandle;
+        GLuint diffuseLayer;
+        GLuint specularLayer;
+    };
+
+    // textures with the same format, size and number of levels, which can be layers of one array
+    struct ArrayGroup
+    {
+        GLenum internalFormat;
+        GLsizei width;
+        GLsizei height;
+        GLsizei levelCount;
+        bool compressed;
+
+        GLuint array{0};
+        std::vector<GLuint> layers;
+        bool changed{false};
+    };
+
+    struct MaterialTextureSet
+    {
+        MaterialEntry entry;
+        std::size_t diffuseGroup{0};
+        std::size_t specularGroup{0};
+    };
+
+    TextureBindingMode mode;
+
+    // same order as the MaterialTable, removed materials get the stand-ins
+    std::vector<MaterialTextureSet> materials;
+    bool materialsChanged{false};
+    std::size_t tableRevision{0};
+
+    // the arrays and handles are made from these textures, removed materials don't keep them alive anymore
+    std::vector<SharedTexture> references;
+
+    // stand-ins for meshes without a diffuse or specular map
+    GLuint whiteTexture{0};
+    GLuint blackTexture{0};
+
+    // texture arrays
+    std::vector<ArrayGroup> groups;
+    std::unordered_map<GLuint, std::pair<std::size_t, GLuint>> layerOfTexture;
+
+    // bindless textures, every texture gets one handle no matter how many materials use it
+    std::unordered_map<GLuint, GLuint64> handles;
+
+    GLuint materialBuffer{0};
+
+    static GLuint createSolidTexture(const unsigned char *color);
+    GLuint findTexture(const Material &material, TextureType type, GLuint fallback);
+
+    /**
+     * Drop the arrays, handles and entries of all materials.
+     */
+    void reset();
+
+    /**
+     * Find or add the layer of a texture in the array of its format and size.
+     */
+    std::pair<std::size_t, GLuint> addLayer(GLuint texture);
+    void buildArray(ArrayGroup &group);
+
+    GLuint64 makeResident(GLuint texture);
+};
+
+#endif
\ No newline at end of file
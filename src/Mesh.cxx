@@ -2,79 +2,128 @@
 
 #include "Mesh.h"
 
-Mesh::Mesh(std::vector<Vertex> vertices, std::vector<GLuint> indices, std::vector<Texture> textures)
-    : vertices(vertices), indices(indices), textures(textures)
+#include "MaterialTable.h"
+#include "MeshSimplifier.h"
+
+namespace
 {
-    setupMesh();
-}
+    // fraction of the triangles of the full mesh every further level of detail keeps
+    const float LOD_TRIANGLE_RATIOS[Mesh::MAX_LOD_COUNT - 1]{0.5f, 0.25f, 0.1f};
+
+    // a level is dropped if simplifying can't get it noticeably below the previous one (e.g. everything is seams)
+    const float MIN_LOD_REDUCTION{0.9f};
+} // namespace
 
-void Mesh::setupMesh()
+void Mesh::draw(Shader &shader, std::size_t lod) const
 {
-    glGenVertexArrays(1, &vao);
-    glGenBuffers(1, &vbo);
-    glGenBuffers(1, &ebo);
+    MaterialTable::getInstance().bind(materialIndex, shader);
 
-    glBindVertexArray(vao);
+    shader.use();
+    glDrawElementsBaseVertex(GL_TRIANGLES, lods[lod].indexCount, GL_UNSIGNED_INT,
+                             (void *)(lods[lod].firstIndex * sizeof(GLuint)), geometry.baseVertex);
+}
 
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+const GeometryAllocation &Mesh::getGeometry() const
+{
+    return geometry;
+}
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+std::size_t Mesh::getLodCount() const
+{
+    return lodCount;
+}
 
-    // vertices
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, position));
-    glEnableVertexAttribArray(0);
+const MeshLod &Mesh::getLod(std::size_t lod) const
+{
+    return lods[lod];
+}
 
-    // normals
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, normal));
-    glEnableVertexAttribArray(1);
+const BoundingBox &Mesh::getBounds() const
+{
+    return bounds;
+}
 
-    // texture coordinates
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
-                          (void *)offsetof(Vertex, textureCoordinates));
-    glEnableVertexAttribArray(2);
+GLuint Mesh::getMaterialIndex() const
+{
+    return materialIndex;
+}
 
-    glBindVertexArray(0);
+MeshPool &MeshPool::getInstance()
+{
+    static MeshPool instance;
+    return instance;
 }
 
-void Mesh::draw(Shader &shader)
+MeshHandle MeshPool::create(std::vector<Vertex> vertices, std::vector<GLuint> indices, GLuint materialIndex)
 {
-    int diffuseNr = 0;
-    int specularNr = 0;
-    int emissiveNr = 0;
+    Mesh mesh;
+    mesh.materialIndex = materialIndex;
 
-    for (std::size_t i = 0; i < textures.size(); i++)
-    {
-        glActiveTexture(GL_TEXTURE0 + i); // activate texture based on index
+    // all levels of detail are stored back to back in one allocation, so they share the vertices
+    std::vector<GLuint> lodIndices = indices;
+    std::size_t lodSizes[Mesh::MAX_LOD_COUNT]{indices.size()};
+    mesh.lodCount = 1;
 
-        std::string uniformName;
-        switch (textures[i].type)
+    if (indices.size() / 3 >= MIN_LOD_TRIANGLE_COUNT)
+    {
+        std::vector<GLuint> previous = indices;
+        for (float ratio : LOD_TRIANGLE_RATIOS)
         {
-        case TextureType::diffuse:
-            uniformName = "textureDiffuse" + std::to_string(diffuseNr);
-            diffuseNr++;
-            break;
-        case TextureType::specular:
-            uniformName = "textureSpecular" + std::to_string(specularNr);
-            specularNr++;
-            break;
-        case TextureType::emissive:
-            uniformName = "textureEmissive" + std::to_string(emissiveNr);
-            emissiveNr++;
-            break;
-        default:
-            std::cerr << "Unknown texture type: "
-                      << static_cast<std::underlying_type_t<TextureType>>(textures[i].type);
-            break;
+            std::size_t targetIndexCount = static_cast<std::size_t>(indices.size() / 3 * ratio) * 3;
+            std::vector<GLuint> simplified = MeshSimplifier::simplify(vertices, previous, targetIndexCount);
+            if (simplified.empty() || simplified.size() > previous.size() * MIN_LOD_REDUCTION)
+            {
+                break;
+            }
+
+            lodIndices.insert(lodIndices.end(), simplified.begin(), simplified.end());
+            lodSizes[mesh.lodCount++] = simplified.size();
+            previous.swap(simplified);
         }
+    }
 
-        shader.setInt("material." + uniformName, i);
-        glBindTexture(GL_TEXTURE_2D, textures[i].id);
+    mesh.geometry = GeometryPool::getInstance().allocate(vertices, lodIndices);
+
+    GLuint firstIndex = mesh.geometry.firstIndex;
+    for (std::size_t lod = 0; lod < mesh.lodCount; lod++)
+    {
+        mesh.lods[lod] = {firstIndex, static_cast<GLsizei>(lodSizes[lod])};
+        firstIndex += lodSizes[lod];
     }
 
-    glBindVertexArray(vao);
-    shader.use();
-    glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+    if (!vertices.empty())
+    {
+        mesh.bounds = BoundingBox::fromPositions(&vertices[0].position, vertices.size(), sizeof(Vertex));
+    }
+
+    return meshes.create(mesh, {std::move(vertices), std::move(indices)});
+}
+
+void MeshPool::destroy(MeshHandle handle)
+{
+    if (meshes.isValid(handle))
+    {
+        GeometryPool::getInstance().free(meshes.getHot(handle).geometry);
+        meshes.destroy(handle);
+    }
+}
+
+bool MeshPool::isValid(MeshHandle handle) const
+{
+    return meshes.isValid(handle);
+}
+
+const Mesh &MeshPool::get(MeshHandle handle) const
+{
+    return meshes.getHot(handle);
+}
+
+const MeshSource &MeshPool::getSource(MeshHandle handle) const
+{
+    return meshes.getCold(handle);
+}
+
+std::size_t MeshPool::getCount() const
+{
+    return meshes.getCount();
 }
\ No newline at end of file
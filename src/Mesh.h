@@ -1,50 +1,124 @@
 #ifndef MESH_H
 #define MESH_H
 
+#include <array>
 #include <vector>
 #include <glm/glm.hpp>
 
+#include "Culling.h"
+#include "GeometryPool.h"
+#include "ObjectPool.h"
 #include "Shader.h"
 
-enum class TextureType
+/**
+ * Index range of one level of detail inside the index buffer of the geometry pool.
+ * All levels of a mesh share its vertices.
+ */
+struct MeshLod
 {
-    diffuse,
-    specular,
-    emissive
+    GLuint firstIndex;
+    GLsizei indexCount;
 };
 
-// note: this could be optimized for meshes that don't have textures (or even normals)
-// separate vertex types could be introduced for that as an optimization
-struct Vertex
+struct MeshTag;
+using MeshHandle = Handle<MeshTag>;
+
+/**
+ * Everything needed to draw a mesh, kept together in the MeshPool so culling and drawing only touch this.
+ */
+class Mesh
 {
-    glm::vec3 position;
-    glm::vec3 normal;
-    glm::vec2 textureCoordinates;
+public:
+    // level 0 is the full mesh, the others have about 50%, 25% and 10% of its triangles
+    static constexpr std::size_t MAX_LOD_COUNT{4};
+
+    /**
+     * Draw the mesh from the shared geometry pool with its material.
+     * The VAO of the pool needs to be bound already (see GeometryPool::bind).
+     * @param lod Level of detail to draw, needs to be smaller than getLodCount().
+     */
+    void draw(Shader &shader, std::size_t lod = 0) const;
+
+    const GeometryAllocation &getGeometry() const;
+
+    /**
+     * Number of generated levels of detail, small meshes only have level 0.
+     */
+    std::size_t getLodCount() const;
+    const MeshLod &getLod(std::size_t lod) const;
+
+    /**
+     * Bounding box of the mesh in model space.
+     */
+    const BoundingBox &getBounds() const;
+
+    /**
+     * Index of the material in the MaterialTable.
+     */
+    GLuint getMaterialIndex() const;
+
+private:
+    friend class MeshPool;
+
+    GeometryAllocation geometry;
+    std::array<MeshLod, MAX_LOD_COUNT> lods{};
+    std::size_t lodCount{0};
+    BoundingBox bounds;
+    GLuint materialIndex{0};
 };
 
-struct Texture
+/**
+ * CPU copy of the data a mesh was built from, not needed for drawing.
+ */
+struct MeshSource
 {
-    GLuint id;
-    TextureType type;
-    std::string path;
+    std::vector<Vertex> vertices;
+    std::vector<GLuint> indices;
 };
 
-class Mesh
+/**
+ * Owns all meshes of the process. Their draw data is stored contiguously, apart from the CPU copies, and they are
+ * referred to by handles, which detect meshes that were destroyed in the meantime.
+ * Meshes are only created and destroyed on the thread that owns the OpenGL context, while no other thread reads
+ * them (e.g. no frame is being recorded, see FramePipeline::discard).
+ */
+class MeshPool
 {
 public:
-    const std::vector<Vertex> vertices;
-    const std::vector<GLuint> indices;
-    const std::vector<Texture> textures;
+    static MeshPool &getInstance();
+
+    /**
+     * Upload a mesh into the geometry pool, together with its levels of detail.
+     * @param materialIndex Index of the material in the MaterialTable.
+     */
+    MeshHandle create(std::vector<Vertex> vertices, std::vector<GLuint> indices, GLuint materialIndex);
+
+    /**
+     * Free the geometry of a mesh, invalid handles are ignored.
+     */
+    void destroy(MeshHandle handle);
 
-    Mesh(std::vector<Vertex> vertices, std::vector<GLuint> indices, std::vector<Texture> textures);
-    void draw(Shader &shader);
+    bool isValid(MeshHandle handle) const;
+
+    /**
+     * The handles need to be valid, references are only valid until the next mesh is created.
+     */
+    const Mesh &get(MeshHandle handle) const;
+    const MeshSource &getSource(MeshHandle handle) const;
+
+    std::size_t getCount() const;
+
+    // remove some functions for the singleton
+    MeshPool(MeshPool const &) = delete;
+    void operator=(MeshPool const &) = delete;
 
 private:
-    GLuint vao;
-    GLuint vbo;
-    GLuint ebo;
+    // meshes with fewer triangles aren't simplified
+    static constexpr std::size_t MIN_LOD_TRIANGLE_COUNT{256};
+
+    ObjectPool<MeshTag, Mesh, MeshSource> meshes;
 
-    void setupMesh();
+    MeshPool() = default;
 };
 
 #endif
\ No newline at end of file
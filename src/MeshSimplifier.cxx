@@ -0,0 +1,346 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+namespace
+{
+    // maximum number of collapse passes, every pass rebuilds adjacency and candidates
+    const int MAX_PASSES{32};
+
+    /**
+     * Symmetric 4x4 matrix that sums up the squared distances to a set of planes.
+     */
+    struct Quadric
+    {
+        double a2{0}, ab{0}, ac{0}, ad{0};
+        double b2{0}, bc{0}, bd{0};
+        double c2{0}, cd{0};
+        double d2{0};
+
+        static Quadric fromPlane(double a, double b, double c, double d, double weight)
+        {
+            Quadric q;
+            q.a2 = a * a * weight;
+            q.ab = a * b * weight;
+            q.ac = a * c * weight;
+            q.ad = a * d * weight;
+            q.b2 = b * b * weight;
+            q.bc = b * c * weight;
+            q.bd = b * d * weight;
+            q.c2 = c * c * weight;
+            q.cd = c * d * weight;
+            q.d2 = d * d * weight;
+            return q;
+        }
+
+        Quadric &operator+=(const Quadric &o)
+        {
+            a2 += o.a2;
+            ab += o.ab;
+            ac += o.ac;
+            ad += o.ad;
+            b2 += o.b2;
+            bc += o.bc;
+            bd += o.bd;
+            c2 += o.c2;
+            cd += o.cd;
+            d2 += o.d2;
+            return *this;
+        }
+
+        double evaluate(const glm::vec3 &p) const
+        {
+            double x = p.x, y = p.y, z = p.z;
+            return a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x +
+                   b2 * y * y + 2 * bc * y * z + 2 * bd * y +
+                   c2 * z * z + 2 * cd * z +
+                   d2;
+        }
+    };
+
+    struct Collapse
+    {
+        GLuint from;
+        GLuint to;
+        double cost;
+    };
+
+    struct PositionHash
+    {
+        std::size_t operator()(const glm::vec3 &position) const
+        {
+            std::uint32_t bits[3];
+            std::memcpy(bits, &position, sizeof(bits));
+            return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+        }
+    };
+
+    struct PositionEqual
+    {
+        bool operator()(const glm::vec3 &a, const glm::vec3 &b) const
+        {
+            return a.x == b.x && a.y == b.y && a.z == b.z;
+        }
+    };
+
+    std::uint64_t edgeKey(GLuint a, GLuint b)
+    {
+        if (a > b)
+        {
+            std::swap(a, b);
+        }
+        return (static_cast<std::uint64_t>(a) << 32) | b;
+    }
+
+    glm::vec3 triangleNormal(const glm::vec3 &p0, const glm::vec3 &p1, const glm::vec3 &p2)
+    {
+        return glm::cross(p1 - p0, p2 - p0);
+    }
+
+    /**
+     * Vertices that must not be moved: seams (position shared by several vertices) and open or non-manifold borders.
+     */
+    std::vector<bool> findLockedVertices(const std::vector<Vertex> &vertices, const std::vector<GLuint> &indices)
+    {
+        // give all vertices with the same position the same id
+        std::unordered_map<glm::vec3, GLuint, PositionHash, PositionEqual> positionIds;
+        std::vector<GLuint> positionId(vertices.size());
+        std::vector<GLuint> verticesPerPosition;
+        for (std::size_t i = 0; i < vertices.size(); i++)
+        {
+            auto inserted = positionIds.insert({vertices[i].position, static_cast<GLuint>(positionIds.size())});
+            positionId[i] = inserted.first->second;
+            if (inserted.second)
+            {
+                verticesPerPosition.push_back(0);
+            }
+            verticesPerPosition[positionId[i]]++;
+        }
+
+        // an edge that isn't shared by exactly two triangles is a border
+        std::unordered_map<std::uint64_t, int> trianglesPerEdge;
+        for (std::size_t i = 0; i + 2 < indices.size(); i += 3)
+        {
+            for (int e = 0; e < 3; e++)
+            {
+                GLuint a = positionId[indices[i + e]];
+                GLuint b = positionId[indices[i + (e + 1) % 3]];
+                trianglesPerEdge[edgeKey(a, b)]++;
+            }
+        }
+
+        std::vector<bool> borderPosition(verticesPerPosition.size(), false);
+        for (const auto &edge : trianglesPerEdge)
+        {
+            if (edge.second != 2)
+            {
+                borderPosition[edge.first >> 32] = true;
+                borderPosition[edge.first & 0xffffffff] = true;
+            }
+        }
+
+        std::vector<bool> locked(vertices.size());
+        for (std::size_t i = 0; i < vertices.size(); i++)
+        {
+            locked[i] = verticesPerPosition[positionId[i]] > 1 || borderPosition[positionId[i]];
+        }
+        return locked;
+    }
+
+    /**
+     * Whether moving vertex from onto vertex to would flip (or fully collapse) a triangle that stays.
+     */
+    bool wouldFlip(const std::vector<Vertex> &vertices, const std::vector<GLuint> &indices,
+                   const GLuint *trianglesBegin, const GLuint *trianglesEnd, GLuint from, GLuint to)
+    {
+        for (const GLuint *triangle = trianglesBegin; triangle != trianglesEnd; triangle++)
+        {
+            const GLuint *t = &indices[*triangle * 3];
+            if (t[0] == to || t[1] == to || t[2] == to)
+            {
+                // this triangle becomes degenerate and is removed
+                continue;
+            }
+
+            glm::vec3 before[3];
+            glm::vec3 after[3];
+            for (int i = 0; i < 3; i++)
+            {
+                before[i] = vertices[t[i]].position;
+                after[i] = t[i] == from ? vertices[to].position : before[i];
+            }
+
+            glm::vec3 normalBefore = triangleNormal(before[0], before[1], before[2]);
+            glm::vec3 normalAfter = triangleNormal(after[0], after[1], after[2]);
+            if (glm::dot(normalBefore, normalAfter) <= 0.0f)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+} // namespace
+
+std::vector<GLuint> MeshSimplifier::simplify(const std::vector<Vertex> &vertices, const std::vector<GLuint> &indices,
+                                             std::size_t targetIndexCount)
+{
+    std::vector<GLuint> result = indices;
+    if (result.size() <= targetIndexCount || vertices.empty())
+    {
+        return result;
+    }
+
+    std::vector<bool> locked = findLockedVertices(vertices, indices);
+
+    // sum up the planes of all triangles around every vertex, weighted by triangle area
+    std::vector<Quadric> quadrics(vertices.size());
+    for (std::size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        const glm::vec3 &p0 = vertices[indices[i]].position;
+        glm::vec3 normal = triangleNormal(p0, vertices[indices[i + 1]].position, vertices[indices[i + 2]].position);
+        float doubleArea = glm::length(normal);
+        if (doubleArea == 0.0f)
+        {
+            continue;
+        }
+
+        normal /= doubleArea;
+        Quadric quadric = Quadric::fromPlane(normal.x, normal.y, normal.z, -glm::dot(normal, p0), doubleArea * 0.5f);
+        for (int v = 0; v < 3; v++)
+        {
+            quadrics[indices[i + v]] += quadric;
+        }
+    }
+
+    std::vector<Collapse> collapses;
+    std::vector<GLuint> remap(vertices.size());
+    std::vector<bool> touched(vertices.size());
+    std::vector<GLuint> triangleOffsets(vertices.size() + 1);
+    std::vector<GLuint> vertexTriangles;
+
+    for (int pass = 0; pass < MAX_PASSES && result.size() > targetIndexCount; pass++)
+    {
+        std::size_t triangleCount = result.size() / 3;
+
+        // triangles around every vertex, in a compact offset + list layout
+        std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+        for (GLuint index : result)
+        {
+            triangleOffsets[index + 1]++;
+        }
+        for (std::size_t i = 1; i < triangleOffsets.size(); i++)
+        {
+            triangleOffsets[i] += triangleOffsets[i - 1];
+        }
+        vertexTriangles.resize(result.size());
+        std::vector<GLuint> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+        for (std::size_t i = 0; i < result.size(); i++)
+        {
+            vertexTriangles[fill[result[i]]++] = i / 3;
+        }
+
+        // every edge can be collapsed in both directions, as long as the moving vertex isn't locked
+        collapses.clear();
+        for (std::size_t i = 0; i < result.size(); i += 3)
+        {
+            for (int e = 0; e < 3; e++)
+            {
+                GLuint a = result[i + e];
+                GLuint b = result[i + (e + 1) % 3];
+
+                if (!locked[a])
+                {
+                    Quadric quadric = quadrics[a];
+                    quadric += quadrics[b];
+                    collapses.push_back({a, b, quadric.evaluate(vertices[b].position)});
+                }
+
+                if (!locked[b])
+                {
+                    Quadric quadric = quadrics[b];
+                    quadric += quadrics[a];
+                    collapses.push_back({b, a, quadric.evaluate(vertices[a].position)});
+                }
+            }
+        }
+
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse &x, const Collapse &y) {
+            return x.cost < y.cost;
+        });
+
+        for (std::size_t i = 0; i < remap.size(); i++)
+        {
+            remap[i] = i;
+        }
+        std::fill(touched.begin(), touched.end(), false);
+
+        // a collapse usually removes two triangles, stop once the target is reached
+        std::size_t targetTriangleCount = targetIndexCount / 3;
+        std::size_t removedTriangles = 0;
+        std::size_t collapseCount = 0;
+
+        for (const Collapse &collapse : collapses)
+        {
+            if (triangleCount - removedTriangles <= targetTriangleCount)
+            {
+                break;
+            }
+
+            if (touched[collapse.from] || touched[collapse.to])
+            {
+                continue;
+            }
+
+            // the triangles around the vertex, used in place since this runs for every candidate
+            const GLuint *trianglesBegin = vertexTriangles.data() + triangleOffsets[collapse.from];
+            const GLuint *trianglesEnd = vertexTriangles.data() + triangleOffsets[collapse.from + 1];
+            if (wouldFlip(vertices, result, trianglesBegin, trianglesEnd, collapse.from, collapse.to))
+            {
+                continue;
+            }
+
+            remap[collapse.from] = collapse.to;
+            quadrics[collapse.to] += quadrics[collapse.from];
+
+            // neighbours are frozen for the rest of this pass, so that the flip test above stays valid
+            for (const GLuint *triangle = trianglesBegin; triangle != trianglesEnd; triangle++)
+            {
+                for (int v = 0; v < 3; v++)
+                {
+                    touched[result[*triangle * 3 + v]] = true;
+                }
+            }
+
+            removedTriangles += 2;
+            collapseCount++;
+        }
+
+        if (collapseCount == 0)
+        {
+            break;
+        }
+
+        // apply the collapses and drop triangles that became degenerate
+        std::size_t writeIndex = 0;
+        for (std::size_t i = 0; i < result.size(); i += 3)
+        {
+            GLuint a = remap[result[i]];
+            GLuint b = remap[result[i + 1]];
+            GLuint c = remap[result[i + 2]];
+
+            if (a != b && b != c && a != c)
+            {
+                result[writeIndex++] = a;
+                result[writeIndex++] = b;
+                result[writeIndex++] = c;
+            }
+        }
+        result.resize(writeIndex);
+    }
+
+    return result;
+}
\ No newline at end of file
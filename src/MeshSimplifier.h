@@ -0,0 +1,26 @@
+#ifndef MESHSIMPLIFIER_H
+#define MESHSIMPLIFIER_H
+
+#include <vector>
+
+#include "lib/glad/include/glad/glad.h"
+
+#include "Vertex.h"
+
+namespace MeshSimplifier
+{
+    /**
+     * Reduce the triangle count of an indexed triangle list by collapsing edges in the order of their
+     * quadric error (Garland/Heckbert).
+     * A vertex is always collapsed onto one of its neighbours, so no new vertices are created and the
+     * result still indexes into the original vertex array. Vertices on open borders and on attribute seams
+     * (several vertices sharing one position, like UV seams or hard normals) are never moved, and collapses
+     * that would flip a triangle are rejected.
+     * @param targetIndexCount Number of indices the result should have at most.
+     * @return The simplified indices, which may be more than targetIndexCount if the mesh can't be reduced further.
+     */
+    std::vector<GLuint> simplify(const std::vector<Vertex> &vertices, const std::vector<GLuint> &indices,
+                                 std::size_t targetIndexCount);
+} // namespace MeshSimplifier
+
+#endif
\ No newline at end of file
@@ -0,0 +1,340 @@
+#include "MipmapGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "JobSystem.h"
+
+namespace
+{
+    // radius of the filter in pixels of the smaller level
+    const double FILTER_RADIUS{3.0};
+
+    // shape of the Kaiser window, larger values trade sharpness for less ringing
+    const double KAISER_ALPHA{4.0};
+
+    // number of rows of the smaller level that are filtered at once
+    const GLuint BAND_ROWS{32};
+
+    // resolution of the table that converts linear values back to sRGB, fine enough for the steep dark end
+    const int LINEAR_TO_SRGB_STEPS{16384};
+
+    // alpha test threshold the coverage is preserved for (0.5 in 8 bit)
+    const double ALPHA_REFERENCE{127.5};
+
+    const double PI{3.14159265358979323846};
+
+    struct ColorTables
+    {
+        float toLinear[256];
+        unsigned char toSrgb[LINEAR_TO_SRGB_STEPS + 1];
+    };
+
+    const ColorTables &getColorTables()
+    {
+        static const ColorTables tables = [] {
+            ColorTables result;
+            for (int i = 0; i < 256; i++)
+            {
+                double value = i / 255.0;
+                result.toLinear[i] = value <= 0.04045 ? value / 12.92 : std::pow((value + 0.055) / 1.055, 2.4);
+            }
+            for (int i = 0; i <= LINEAR_TO_SRGB_STEPS; i++)
+            {
+                double value = static_cast<double>(i) / LINEAR_TO_SRGB_STEPS;
+                double encoded = value <= 0.0031308 ? value * 12.92 : 1.055 * std::pow(value, 1.0 / 2.4) - 0.055;
+                result.toSrgb[i] = static_cast<unsigned char>(encoded * 255.0 + 0.5);
+            }
+            return result;
+        }();
+        return tables;
+    }
+
+    double besselI0(double x)
+    {
+        // power series, converges quickly for the small arguments used here
+        double sum = 1.0;
+        double term = 1.0;
+        for (int k = 1; k < 32; k++)
+        {
+            double factor = x / (2.0 * k);
+            term *= factor * factor;
+            sum += term;
+        }
+        return sum;
+    }
+
+    double kaiserSinc(double x)
+    {
+        if (std::abs(x) >= FILTER_RADIUS)
+        {
+            return 0.0;
+        }
+
+        double sinc = x == 0.0 ? 1.0 : std::sin(PI * x) / (PI * x);
+        double ratio = x / FILTER_RADIUS;
+        double window = besselI0(KAISER_ALPHA * std::sqrt(1.0 - ratio * ratio)) / besselI0(KAISER_ALPHA);
+        return sinc * window;
+    }
+
+    /**
+     * Source pixels and normalized weights of every pixel of the smaller level, along one axis.
+     */
+    struct FilterTaps
+    {
+        std::vector<std::size_t> offsets; // first tap of every pixel, plus one past the last tap
+        std::vector<GLuint> sources;
+        std::vector<float> weights;
+
+        FilterTaps(GLuint sourceSize, GLuint size)
+        {
+            double scale = static_cast<double>(sourceSize) / size;
+            double support = FILTER_RADIUS * scale;
+
+            offsets.push_back(0);
+            for (GLuint i = 0; i < size; i++)
+            {
+                double center = (i + 0.5) * scale;
+                int first = static_cast<int>(std::floor(center - support));
+                int last = static_cast<int>(std::ceil(center + support));
+
+                std::size_t firstTap = weights.size();
+                double sum = 0.0;
+                for (int source = first; source <= last; source++)
+                {
+                    double weight = kaiserSinc((source + 0.5 - center) / scale);
+                    if (weight == 0.0)
+                    {
+                        continue;
+                    }
+
+                    // pixels outside of the image repeat the edge
+                    sources.push_back(std::min<int>(std::max(source, 0), sourceSize - 1));
+                    weights.push_back(weight);
+                    sum += weight;
+                }
+
+                for (std::size_t tap = firstTap; tap < weights.size(); tap++)
+                {
+                    weights[tap] /= sum;
+                }
+                offsets.push_back(weights.size());
+            }
+        }
+    };
+
+    void addWeighted(float *destination, const float *source, float weight, std::size_t count)
+    {
+        std::size_t i = 0;
+#if defined(__SSE2__)
+        __m128 weights = _mm_set1_ps(weight);
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 sum = _mm_add_ps(_mm_loadu_ps(destination + i), _mm_mul_ps(_mm_loadu_ps(source + i), weights));
+            _mm_storeu_ps(destination + i, sum);
+        }
+#endif
+        for (; i < count; i++)
+        {
+            destination[i] += source[i] * weight;
+        }
+    }
+
+    // every pixel is filtered as four floats, missing channels are carried along as zero
+    void decodeRow(const unsigned char *row, GLuint width, int nrChannels, const bool *isSrgb, float *output)
+    {
+        const ColorTables &tables = getColorTables();
+        for (GLuint x = 0; x < width; x++)
+        {
+            for (int c = 0; c < 4; c++)
+            {
+                float value = 0.0f;
+                if (c < nrChannels)
+                {
+                    unsigned char encoded = row[x * nrChannels + c];
+                    value = isSrgb[c] ? tables.toLinear[encoded] : encoded / 255.0f;
+                }
+                output[x * 4 + c] = value;
+            }
+        }
+    }
+
+    void encodeRow(const float *row, GLuint width, int nrChannels, const bool *isSrgb, unsigned char *output)
+    {
+        const ColorTables &tables = getColorTables();
+        for (GLuint x = 0; x < width; x++)
+        {
+            for (int c = 0; c < nrChannels; c++)
+            {
+                // the negative lobes of the filter can overshoot
+                float value = std::min(std::max(row[x * 4 + c], 0.0f), 1.0f);
+                output[x * nrChannels + c] = isSrgb[c]
+                                                 ? tables.toSrgb[static_cast<int>(value * LINEAR_TO_SRGB_STEPS + 0.5f)]
+                                                 : static_cast<unsigned char>(value * 255.0f + 0.5f);
+            }
+        }
+    }
+
+    /**
+     * Filter the rows firstRow to lastRow - 1 of a level, first horizontally into a temporary band and
+     * then vertically out of it.
+     */
+    void filterBand(const std::vector<unsigned char> &source, GLuint sourceWidth, int nrChannels,
+                    const FilterTaps &horizontal, const FilterTaps &vertical, const bool *isSrgb,
+                    std::vector<unsigned char> &level, GLuint levelWidth, GLuint firstRow, GLuint lastRow)
+    {
+        // source rows needed for this band, the taps of consecutive rows are in ascending order
+        GLuint firstSourceRow = vertical.sources[vertical.offsets[firstRow]];
+        GLuint lastSourceRow = vertical.sources[vertical.offsets[lastRow] - 1];
+
+        std::size_t rowFloats = static_cast<std::size_t>(levelWidth) * 4;
+        std::vector<float> decoded(static_cast<std::size_t>(sourceWidth) * 4);
+        std::vector<float> band((lastSourceRow - firstSourceRow + 1) * rowFloats, 0.0f);
+
+        for (GLuint sourceRow = firstSourceRow; sourceRow <= lastSourceRow; sourceRow++)
+        {
+            decodeRow(&source[static_cast<std::size_t>(sourceRow) * sourceWidth * nrChannels], sourceWidth,
+                      nrChannels, isSrgb, decoded.data());
+
+            float *bandRow = &band[(sourceRow - firstSourceRow) * rowFloats];
+            for (GLuint x = 0; x < levelWidth; x++)
+            {
+                for (std::size_t tap = horizontal.offsets[x]; tap < horizontal.offsets[x + 1]; tap++)
+                {
+                    addWeighted(bandRow + x * 4, &decoded[horizontal.sources[tap] * 4], horizontal.weights[tap], 4);
+                }
+            }
+        }
+
+        std::vector<float> row(rowFloats);
+        for (GLuint y = firstRow; y < lastRow; y++)
+        {
+            std::fill(row.begin(), row.end(), 0.0f);
+            for (std::size_t tap = vertical.offsets[y]; tap < vertical.offsets[y + 1]; tap++)
+            {
+                addWeighted(row.data(), &band[(vertical.sources[tap] - firstSourceRow) * rowFloats],
+                            vertical.weights[tap], rowFloats);
+            }
+
+            encodeRow(row.data(), levelWidth, nrChannels, isSrgb,
+                      &level[static_cast<std::size_t>(y) * levelWidth * nrChannels]);
+        }
+    }
+
+    void buildAlphaHistogram(const std::vector<unsigned char> &pixels, int nrChannels, std::size_t *histogram)
+    {
+        std::fill(histogram, histogram + 256, 0);
+        for (std::size_t i = nrChannels - 1; i < pixels.size(); i += nrChannels)
+        {
+            histogram[pixels[i]]++;
+        }
+    }
+
+    // fraction of the pixels that pass the alpha test if their alpha is multiplied by scale
+    double getAlphaCoverage(const std::size_t *histogram, std::size_t pixelCount, double scale)
+    {
+        std::size_t covered = 0;
+        for (int alpha = 0; alpha < 256; alpha++)
+        {
+            if (alpha * scale > ALPHA_REFERENCE)
+            {
+                covered += histogram[alpha];
+            }
+        }
+        return static_cast<double>(covered) / pixelCount;
+    }
+
+    void scaleAlphaToCoverage(std::vector<unsigned char> &pixels, int nrChannels, double targetCoverage)
+    {
+        std::size_t histogram[256];
+        buildAlphaHistogram(pixels, nrChannels, histogram);
+        std::size_t pixelCount = pixels.size() / nrChannels;
+
+        // coverage grows with the scale, search the smallest scale that reaches the target
+        double low = 0.0;
+        double high = 256.0;
+        for (int iteration = 0; iteration < 24; iteration++)
+        {
+            double middle = (low + high) * 0.5;
+            if (getAlphaCoverage(histogram, pixelCount, middle) < targetCoverage)
+            {
+                low = middle;
+            }
+            else
+            {
+                high = middle;
+            }
+        }
+
+        for (std::size_t i = nrChannels - 1; i < pixels.size(); i += nrChannels)
+        {
+            pixels[i] = static_cast<unsigned char>(std::min(pixels[i] * high + 0.5, 255.0));
+        }
+    }
+} // namespace
+
+std::vector<std::vector<unsigned char>> MipmapGenerator::generate(const unsigned char *pixels, GLuint width,
+                                                                  GLuint height, int nrChannels,
+                                                                  const MipmapOptions &options)
+{
+    std::vector<std::vector<unsigned char>> levels;
+    levels.emplace_back(pixels, pixels + static_cast<std::size_t>(width) * height * nrChannels);
+
+    // grey + alpha and RGBA images have alpha in the last channel
+    bool hasAlpha = nrChannels == 2 || nrChannels == 4;
+    bool isSrgb[4]{};
+    for (int c = 0; c < nrChannels; c++)
+    {
+        isSrgb[c] = options.srgb && !(hasAlpha && c == nrChannels - 1);
+    }
+
+    double targetCoverage = 0.0;
+    if (options.preserveAlphaCoverage && hasAlpha)
+    {
+        std::size_t histogram[256];
+        buildAlphaHistogram(levels[0], nrChannels, histogram);
+        targetCoverage = getAlphaCoverage(histogram, static_cast<std::size_t>(width) * height, 1.0);
+    }
+
+    GLuint sourceWidth = width;
+    GLuint sourceHeight = height;
+    while (sourceWidth > 1 || sourceHeight > 1)
+    {
+        GLuint levelWidth = std::max<GLuint>(sourceWidth / 2, 1);
+        GLuint levelHeight = std::max<GLuint>(sourceHeight / 2, 1);
+
+        FilterTaps horizontal(sourceWidth, levelWidth);
+        FilterTaps vertical(sourceHeight, levelHeight);
+
+        const std::vector<unsigned char> &source = levels.back();
+        std::vector<unsigned char> level(static_cast<std::size_t>(levelWidth) * levelHeight * nrChannels);
+
+        std::size_t bandCount = (levelHeight + BAND_ROWS - 1) / BAND_ROWS;
+        // callers may run on the job system already (e.g. parallel texture loading), waiting threads help out
+        JobSystem::getInstance().parallelFor(bandCount, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t band = begin; band < end; band++)
+            {
+                GLuint firstRow = band * BAND_ROWS;
+                GLuint lastRow = std::min<GLuint>(firstRow + BAND_ROWS, levelHeight);
+                filterBand(source, sourceWidth, nrChannels, horizontal, vertical, isSrgb, level, levelWidth,
+                           firstRow, lastRow);
+            }
+        });
+
+        // nothing passes the alpha test in the full image (e.g. glass), so there is nothing to preserve
+        if (targetCoverage > 0.0)
+        {
+            scaleAlphaToCoverage(level, nrChannels, targetCoverage);
+        }
+
+        levels.push_back(std::move(level));
+        sourceWidth = levelWidth;
+        sourceHeight = levelHeight;
+    }
+
+    return levels;
+}
\ No newline at end of file
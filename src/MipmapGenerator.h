@@ -0,0 +1,33 @@
+#ifndef MIPMAPGENERATOR_H
+#define MIPMAPGENERATOR_H
+
+#include <vector>
+
+#include "lib/glad/include/glad/glad.h"
+
+struct MipmapOptions
+{
+    // color channels are sRGB encoded and filtered in linear space, alpha is always linear
+    bool srgb{false};
+
+    // rescale the alpha of every level so that the same fraction of pixels passes an alpha test at 0.5,
+    // otherwise cutout textures (foliage, fences) fade away at a distance
+    bool preserveAlphaCoverage{false};
+};
+
+/**
+ * CPU mip chain generation with a Kaiser windowed sinc filter, which keeps a lot more detail than a box filter
+ * without ringing much. Levels are split into bands of rows that are filtered on all cores,
+ * the filter loops use SSE2 if available.
+ */
+namespace MipmapGenerator
+{
+    /**
+     * @param pixels Tightly packed 8 bit pixels with nrChannels channels.
+     * @return All levels down to 1x1, level 0 is a copy of the input.
+     */
+    std::vector<std::vector<unsigned char>> generate(const unsigned char *pixels, GLuint width, GLuint height,
+                                                     int nrChannels, const MipmapOptions &options);
+} // namespace MipmapGenerator
+
+#endif
\ No newline at end of file
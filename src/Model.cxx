@@ -1,275 +1,470 @@
-#define STB_IMAGE_IMPLEMENTATION // stb_image.h one time initialization
-
 #include "Model.h"
 
+#include <chrono>
+#include <iostream>
+#include <unordered_map>
+
 #include <assimp/Importer.hpp>
+#include <assimp/material.h>
+#include <assimp/mesh.h>
 #include <assimp/postprocess.h>
+#include <boost/filesystem.hpp>
 #include <glibmm-2.4/glibmm/miscutils.h>
-#include <glm/glm.hpp>
-#include <glm/gtc/matrix_transform.hpp>
-
-#include "lib/stb_image.h"
 
-Model::Model(const std::string &path)
-{
-    loadModel(path);
-}
+#include "AssetArchive.h"
+#include "GltfFile.h"
+#include "Material.h"
+#include "MaterialTable.h"
+#include "ObjFile.h"
+#include "PackedModel.h"
+#include "TextureManager.h"
 
-void Model::draw(Shader &shader)
+namespace
 {
-    for (Mesh &mesh : meshes)
+    /**
+     * Copy the attributes of all vertices in one pass, which attributes exist is decided once per mesh instead of
+     * per vertex, so the loop has no branches and the compiler is free to vectorize it.
+     */
+    template <bool hasNormals, bool hasTextureCoordinates>
+    void copyVertices(const aiMesh &mesh, Vertex *vertices)
     {
-        mesh.draw(shader);
-    }
-}
+        const aiVector3D *positions = mesh.mVertices;
+        const aiVector3D *normals = mesh.mNormals;
 
-void Model::loadModel(const std::string &path)
-{
-    Assimp::Importer importer;
-    const aiScene *scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs);
-
-    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
-    {
-        std::cerr << "Assimp: " << importer.GetErrorString() << std::endl;
-        return;
-    }
-
-    baseDir = Glib::path_get_dirname(path);
-
-    processNode(scene->mRootNode, scene);
-}
+        // a vertex can have up to 8 texture coordinates in assimp, we only use the first one for now
+        const aiVector3D *textureCoordinates = mesh.mTextureCoords[0];
 
-void Model::processNode(aiNode *node, const aiScene *scene)
-{
-    // iterate through all the meshes in the current node
-    for (unsigned int i = 0; i < node->mNumMeshes; i++)
-    {
-        // get the actual mesh, since the node only stores the index
-        aiMesh *mesh = scene->mMeshes[node->mMeshes[i]];
-        meshes.push_back(processMesh(mesh, scene));
-    }
-
-    // process child nodes recursively
-    for (unsigned int i = 0; i < node->mNumChildren; i++)
-    {
-        processNode(node->mChildren[i], scene);
+        for (unsigned int i = 0; i < mesh.mNumVertices; i++)
+        {
+            Vertex &vertex = vertices[i];
+            vertex.position = glm::vec3(positions[i].x, positions[i].y, positions[i].z);
+            if (hasNormals)
+            {
+                vertex.normal = glm::vec3(normals[i].x, normals[i].y, normals[i].z);
+            }
+            if (hasTextureCoordinates)
+            {
+                vertex.textureCoordinates = glm::vec2(textureCoordinates[i].x, textureCoordinates[i].y);
+            }
+        }
     }
-}
 
-Mesh Model::processMesh(aiMesh *mesh, const aiScene *scene)
-{
-    std::vector<Vertex> vertices;
-    std::vector<GLuint> indices;
-    std::vector<Texture> textures;
-
-    // for every vertex of the mesh
-    for (unsigned int i = 0; i < mesh->mNumVertices; i++)
+    /**
+     * Builds the materials and meshes of one scene.
+     */
+    class ModelLoader
     {
-        Vertex vertex;
-
-        vertex.position.x = mesh->mVertices[i].x;
-        vertex.position.y = mesh->mVertices[i].y;
-        vertex.position.z = mesh->mVertices[i].z;
-
-        if (mesh->HasNormals())
+    public:
+        ModelLoader(const std::string &path, const aiScene &scene)
+            : path(path), baseDir(Glib::path_get_dirname(path)), scene(scene)
         {
-            vertex.normal.x = mesh->mNormals[i].x;
-            vertex.normal.y = mesh->mNormals[i].y;
-            vertex.normal.z = mesh->mNormals[i].z;
         }
 
-        if (mesh->HasTextureCoords(0))
+        void load(std::vector<MeshHandle> &meshes, std::vector<GLuint> &materialIndices)
         {
-            // a vertex can heave up to 8 texture coordinates in assimp
-            // we only use the first one for now
-            vertex.textureCoordinates.x = mesh->mTextureCoords[0][i].x;
-            vertex.textureCoordinates.y = mesh->mTextureCoords[0][i].y;
-        }
-
-        vertices.push_back(vertex);
-    }
+            // materials are shared by the meshes, so they're loaded before them
+            materialIndices.reserve(scene.mNumMaterials);
+            for (unsigned int i = 0; i < scene.mNumMaterials; i++)
+            {
+                materialIndices.push_back(loadMaterial(scene.mMaterials[i]));
+            }
 
-    // for every face (vertices that form a primitive)
-    for (unsigned int i = 0; i < mesh->mNumFaces; i++)
-    {
-        aiFace face = mesh->mFaces[i];
-        for (unsigned int j = 0; j < face.mNumIndices; j++)
-        {
-            indices.push_back(face.mIndices[j]);
+            // usually every mesh is referenced by exactly one node
+            meshes.reserve(scene.mNumMeshes);
+            processNode(scene.mRootNode, materialIndices, meshes);
         }
-    }
-
-    aiMaterial *material = scene->mMaterials[mesh->mMaterialIndex];
 
-    std::vector<Texture> diffuseMaps =
-        loadMaterialTextures(material, scene,
-                             aiTextureType_DIFFUSE, TextureType::diffuse);
-    textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
+    private:
+        const std::string &path;
+        std::string baseDir;
+        const aiScene &scene;
 
-    std::vector<Texture> specularMaps =
-        loadMaterialTextures(material, scene,
-                             aiTextureType_SPECULAR, TextureType::specular);
-    textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
+        // textures of this model by the path assimp reports, so materials sharing a texture look it up only once
+        std::unordered_map<std::string, Texture> loadedTextureByPath;
 
-    std::vector<Texture> emissiveMaps =
-        loadMaterialTextures(material, scene,
-                             aiTextureType_EMISSIVE, TextureType::specular);
-    textures.insert(textures.end(), emissiveMaps.begin(), emissiveMaps.end());
+        void processNode(const aiNode *node, const std::vector<GLuint> &materialIndices,
+                         std::vector<MeshHandle> &meshes)
+        {
+            // iterate through all the meshes in the current node
+            for (unsigned int i = 0; i < node->mNumMeshes; i++)
+            {
+                // get the actual mesh, since the node only stores the index
+                const aiMesh *mesh = scene.mMeshes[node->mMeshes[i]];
+                meshes.push_back(processMesh(mesh, materialIndices[mesh->mMaterialIndex]));
+            }
 
-    return Mesh(vertices, indices, textures);
-}
+            // process child nodes recursively
+            for (unsigned int i = 0; i < node->mNumChildren; i++)
+            {
+                processNode(node->mChildren[i], materialIndices, meshes);
+            }
+        }
 
-std::vector<Texture> Model::loadMaterialTextures(aiMaterial *material, const aiScene *scene,
-                                                 aiTextureType aiType, TextureType type)
-{
-    std::vector<Texture> textures;
+        MeshHandle processMesh(const aiMesh *mesh, GLuint materialIndex)
+        {
+            std::vector<Vertex> vertices;
+            std::vector<GLuint> indices;
+            ModelPool::convertMesh(*mesh, vertices, indices);
 
-    for (unsigned int i = 0; i < material->GetTextureCount(aiType); i++)
-    {
-        aiString path;
-        material->GetTexture(aiType, i, &path);
-        std::string stdPath = path.C_Str();
+            return MeshPool::getInstance().create(std::move(vertices), std::move(indices), materialIndex);
+        }
 
-        if (stdPath.length() == 0)
+        GLuint loadMaterial(const aiMaterial *material)
         {
-            std::cerr << "Got texture from Assimp with no path" << std::endl;
-            return textures;
+            std::vector<Texture> textures;
+            loadMaterialTextures(material, aiTextureType_DIFFUSE, TextureType::diffuse, textures);
+            loadMaterialTextures(material, aiTextureType_SPECULAR, TextureType::specular, textures);
+            loadMaterialTextures(material, aiTextureType_EMISSIVE, TextureType::emissive, textures);
+
+            return MaterialTable::getInstance().add(Material::fromAssimp(*material, textures));
         }
 
-        if (loadedTextureByPath.count(stdPath) > 0)
+        void loadMaterialTextures(const aiMaterial *material, aiTextureType aiType, TextureType type,
+                                  std::vector<Texture> &textures)
         {
-            // texture exists already
-            textures.push_back(loadedTextureByPath.at(stdPath));
+            for (unsigned int i = 0; i < material->GetTextureCount(aiType); i++)
+            {
+                aiString path;
+                material->GetTexture(aiType, i, &path);
+                std::string stdPath = path.C_Str();
+
+                if (stdPath.length() == 0)
+                {
+                    std::cerr << "Got texture from Assimp with no path" << std::endl;
+                    return;
+                }
+
+                auto loaded = loadedTextureByPath.find(stdPath);
+                if (loaded != loadedTextureByPath.end())
+                {
+                    // texture exists already
+                    textures.push_back(loaded->second);
+                    continue;
+                }
+
+                // new in this model, the texture manager shares it with other models if they use it too
+                Texture texture;
+
+                if (stdPath[0] == '*')
+                {
+                    // texture is embedded in same file, needs to be extracted through assimp
+                    int assimpTextureIndex = std::stoi(stdPath.substr(1, std::string::npos));
+                    texture.reference = loadEmbeddedTexture(scene.mTextures[assimpTextureIndex], stdPath, type);
+                }
+                else
+                {
+                    // texture paths are provided as relative paths to the model
+                    texture.reference = TextureManager::getInstance().load(baseDir + '/' + stdPath, type);
+                }
+
+                texture.id = texture.reference.getId();
+                texture.path = stdPath;
+                texture.type = type;
+                textures.push_back(texture);
+                loadedTextureByPath.insert({stdPath, texture});
+            }
         }
-        else
+
+        SharedTexture loadEmbeddedTexture(const aiTexture *texture, const std::string &name, TextureType type)
         {
-            // new texture, needs to be loaded
-            Texture texture;
+            // the name needs to be unique in the whole process, not only in this model
+            std::string uniqueName = path + name;
 
-            if (stdPath[0] == '*')
+            if (texture->mHeight == 0)
             {
-                // texture is embedded in same file, needs to be extracted through assimp
-                int assimpTextureIndex = std::stoi(stdPath.substr(1, std::string::npos));
-                aiTexture *aiTexture = scene->mTextures[assimpTextureIndex];
-                texture.id = loadEmbeddedTexture(aiTexture);
+                // texture is compressed
+                return TextureManager::getInstance().loadFromMemory(uniqueName, (const unsigned char *)texture->pcData,
+                                                                    texture->mWidth, type);
             }
             else
             {
-                texture.id = loadTextureFromFile(stdPath, baseDir);
+                return TextureManager::getInstance().loadFromPixels(uniqueName, (const unsigned char *)texture->pcData,
+                                                                    texture->mWidth, texture->mHeight, type);
             }
+        }
+    };
+} // namespace
+
+ModelPool::PreparedModel::PreparedModel() = default;
+ModelPool::PreparedModel::PreparedModel(PreparedModel &&other) noexcept = default;
+ModelPool::PreparedModel &ModelPool::PreparedModel::operator=(PreparedModel &&other) noexcept = default;
+ModelPool::PreparedModel::~PreparedModel() = default;
+
+ModelPool &ModelPool::getInstance()
+{
+    static ModelPool instance;
+    return instance;
+}
+
+template <class File>
+ModelHandle ModelPool::createFromFile(const std::string &path, File &file)
+{
+    std::vector<MeshHandle> meshes;
+    ModelSource source;
+    source.path = path;
+    file.build(meshes, source.materialIndices);
+    return models.create(std::move(meshes), std::move(source));
+}
 
-            texture.path = stdPath;
-            texture.type = type;
-            textures.push_back(texture);
-            loadedTextureByPath.insert({stdPath, texture});
+ModelHandle ModelPool::load(const std::string &path)
+{
+    // models baked into the asset archive only need to be copied out of it
+    if (AssetArchive::isArchivePath(path))
+    {
+        PackedModel file;
+        if (file.open(path))
+        {
+            return createFromFile(path, file);
         }
     }
 
-    return textures;
+    PreparedModel prepared = prepare(path);
+    ModelHandle handle = create(path, prepared);
+    if (!models.isValid(handle))
+    {
+        ModelSource source;
+        source.path = path;
+        return models.create({}, std::move(source));
+    }
+    return handle;
 }
 
-GLuint Model::loadEmbeddedTexture(const aiTexture *texture, GLint wrappingMode)
+ModelPool::PreparedModel ModelPool::prepare(const std::string &path)
 {
-    int width, height, nrChannels;
+    PreparedModel prepared;
 
-    if (texture->mHeight == 0)
+    // glTF and OBJ have their own readers, assimp is the fallback for files they don't support
+    if (GltfFile::isGltf(path))
     {
-        // texture is compressed
-        unsigned char *textureData =
-            stbi_load_from_memory((const stbi_uc *)texture->pcData, texture->mWidth,
-                                  &width, &height, &nrChannels, 0);
-
-        if (!textureData)
+        prepared.gltf.reset(new GltfFile());
+        if (prepared.gltf->open(path))
         {
-            // TODO: Add some error handling or fallback behavior
-            std::cerr << "Could not read embedded texture" << std::endl;
-            return -1;
+            return prepared;
         }
+        prepared.gltf.reset();
+        std::cerr << "Importing '" << path << "' with assimp instead" << std::endl;
+    }
+    else if (ObjFile::isObj(path))
+    {
+        prepared.obj.reset(new ObjFile());
+        if (prepared.obj->open(path))
+        {
+            return prepared;
+        }
+        prepared.obj.reset();
+        std::cerr << "Importing '" << path << "' with assimp instead" << std::endl;
+    }
 
-        GLuint glTextureId = createGlTexture(textureData, width, height, nrChannels, wrappingMode);
-
-        // free the texture data again
-        stbi_image_free(textureData);
+    prepared.scene = importScene(path);
+    return prepared;
+}
 
-        return glTextureId;
+ModelHandle ModelPool::create(const std::string &path, PreparedModel &prepared)
+{
+    if (prepared.gltf)
+    {
+        return createFromFile(path, *prepared.gltf);
     }
-    else
+    if (prepared.obj)
+    {
+        return createFromFile(path, *prepared.obj);
+    }
+    if (prepared.scene)
     {
-        return createGlTexture((unsigned char *)texture->pcData,
-                               texture->mWidth, texture->mHeight, 4);
+        return create(path, *prepared.scene);
     }
+    return ModelHandle();
 }
 
-GLuint Model::loadTextureFromFile(const std::string &texturePath, const std::string &baseDir,
-                                  GLint wrappingMode)
+ModelHandle ModelPool::create(const std::string &path, const aiScene &scene)
 {
-    // texture paths are provided as relative paths to the model
-    std::string path = baseDir + '/' + texturePath;
+    std::vector<MeshHandle> meshes;
+    ModelSource source;
+    source.path = path;
+    ModelLoader(path, scene).load(meshes, source.materialIndices);
 
-    // make sure the image is loaded in a way that represents OpenGL texture coordinates
-    stbi_set_flip_vertically_on_load(true);
+    return models.create(std::move(meshes), std::move(source));
+}
 
-    // read image into byte array
-    int width, height, nrChannels;
-    unsigned char *textureData = stbi_load(path.c_str(), &width, &height, &nrChannels, 0);
+void ModelPool::destroy(ModelHandle handle)
+{
+    if (!models.isValid(handle))
+    {
+        return;
+    }
 
-    // disable vertical flipping again, for future loads that might not need it
-    stbi_set_flip_vertically_on_load(false);
+    for (MeshHandle mesh : models.getHot(handle))
+    {
+        MeshPool::getInstance().destroy(mesh);
+    }
 
-    if (!textureData)
+    // the materials keep their textures loaded until the last model using them is gone
+    for (GLuint materialIndex : models.getCold(handle).materialIndices)
     {
-        // TODO: Add some error handling or fallback behavior
-        std::cerr << "Could not read texture from '" << path << "'" << std::endl;
-        return -1;
+        MaterialTable::getInstance().release(materialIndex);
     }
+    models.destroy(handle);
+}
 
-    GLuint glTextureId = createGlTexture(textureData, width, height, nrChannels, wrappingMode);
+bool ModelPool::isValid(ModelHandle handle) const
+{
+    return models.isValid(handle);
+}
+
+const std::vector<MeshHandle> &ModelPool::getMeshes(ModelHandle handle) const
+{
+    return models.getHot(handle);
+}
 
-    // free the texture data again
-    stbi_image_free(textureData);
+const std::string &ModelPool::getPath(ModelHandle handle) const
+{
+    return models.getCold(handle).path;
+}
 
-    return glTextureId;
+std::size_t ModelPool::getCount() const
+{
+    return models.getCount();
 }
 
-GLuint Model::createGlTexture(unsigned char *buffer, int width, int height, int nrChannels,
-                              GLint wrappingMode)
+void ModelPool::convertMesh(const aiMesh &mesh, std::vector<Vertex> &vertices, std::vector<GLuint> &indices)
 {
-    GLenum format;
+    // exact sizes, value initialized so attributes the mesh doesn't have are zero
+    vertices.assign(mesh.mNumVertices, Vertex());
 
-    if (nrChannels == 1)
+    bool hasNormals = mesh.HasNormals();
+    bool hasTextureCoordinates = mesh.HasTextureCoords(0);
+    if (hasNormals && hasTextureCoordinates)
+    {
+        copyVertices<true, true>(mesh, vertices.data());
+    }
+    else if (hasNormals)
     {
-        format = GL_RED;
+        copyVertices<true, false>(mesh, vertices.data());
     }
-    else if (nrChannels == 3)
+    else if (hasTextureCoordinates)
     {
-        format = GL_RGB;
+        copyVertices<false, true>(mesh, vertices.data());
     }
-    else if (nrChannels == 4)
+    else
+    {
+        copyVertices<false, false>(mesh, vertices.data());
+    }
+
+    if (mesh.mPrimitiveTypes == aiPrimitiveType_TRIANGLE)
     {
-        format = GL_RGBA;
+        // triangulated meshes are the common case, every face has three indices, so they're written without
+        // looking at the index count of the faces
+        indices.resize(static_cast<std::size_t>(mesh.mNumFaces) * 3);
+        GLuint *index = indices.data();
+        for (unsigned int i = 0; i < mesh.mNumFaces; i++)
+        {
+            const unsigned int *face = mesh.mFaces[i].mIndices;
+            index[0] = face[0];
+            index[1] = face[1];
+            index[2] = face[2];
+            index += 3;
+        }
     }
     else
     {
-        std::cerr << "Unexpected number of channels: " << nrChannels << std::endl;
-        return -1;
+        // points or lines are left after triangulating, the faces have different sizes
+        indices.clear();
+        indices.reserve(static_cast<std::size_t>(mesh.mNumFaces) * 3);
+        for (unsigned int i = 0; i < mesh.mNumFaces; i++)
+        {
+            const aiFace &face = mesh.mFaces[i];
+            indices.insert(indices.end(), face.mIndices, face.mIndices + face.mNumIndices);
+        }
+    }
+}
+
+std::unique_ptr<aiScene> ModelPool::importScene(const std::string &path)
+{
+    Assimp::Importer importer;
+    const aiScene *scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs);
+
+    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+    {
+        std::cerr << "Assimp: " << importer.GetErrorString() << std::endl;
+        return nullptr;
     }
 
-    // create texture
-    GLuint texture;
-    glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
+    // the scene belongs to the importer until it's taken over
+    return std::unique_ptr<aiScene>(importer.GetOrphanedScene());
+}
+
+std::vector<LoaderBenchmark::Result> LoaderBenchmark::run(const std::vector<std::string> &paths)
+{
+    std::vector<Result> results;
+    std::vector<Vertex> vertices;
+    std::vector<GLuint> indices;
+
+    for (const std::string &path : paths)
+    {
+        Result result;
+        result.path = path;
+
+        // only the size of the model file itself, materials and textures aren't part of the measurement
+        boost::system::error_code error;
+        result.fileBytes = static_cast<std::size_t>(boost::filesystem::file_size(path, error));
+        if (error)
+        {
+            result.fileBytes = 0;
+        }
+
+        auto importStart = std::chrono::high_resolution_clock::now();
+        std::unique_ptr<aiScene> scene = ModelPool::importScene(path);
+        auto importEnd = std::chrono::high_resolution_clock::now();
+        if (!scene)
+        {
+            continue;
+        }
 
-    // set texture attributes (repeat and use linear filtering)
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrappingMode);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrappingMode);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        // the vectors are reused, like the allocator would after the first few meshes of a real load
+        for (unsigned int i = 0; i < scene->mNumMeshes; i++)
+        {
+            ModelPool::convertMesh(*scene->mMeshes[i], vertices, indices);
+            result.vertexCount += vertices.size();
+        }
+        auto convertEnd = std::chrono::high_resolution_clock::now();
+
+        result.importMilliseconds = std::chrono::duration<double, std::milli>(importEnd - importStart).count();
+        result.convertMilliseconds = std::chrono::duration<double, std::milli>(convertEnd - importEnd).count();
+
+        double seconds = std::chrono::duration<double>(convertEnd - importStart).count();
+        result.verticesPerSecond = seconds > 0.0 ? result.vertexCount / seconds : 0.0;
+        result.megabytesPerSecond = seconds > 0.0 ? result.fileBytes / 1.0e6 / seconds : 0.0;
+        result.convertVerticesPerSecond =
+            result.convertMilliseconds > 0.0 ? result.vertexCount / (result.convertMilliseconds / 1000.0) : 0.0;
+
+        // the native readers do both parts at once
+        auto nativeStart = std::chrono::high_resolution_clock::now();
+        bool opened = false;
+        std::size_t nativeVertexCount = 0;
+        if (GltfFile::isGltf(path))
+        {
+            GltfFile file;
+            opened = file.open(path);
+            nativeVertexCount = file.getVertexCount();
+        }
+        else if (ObjFile::isObj(path))
+        {
+            ObjFile file;
+            opened = file.open(path);
+            nativeVertexCount = file.getVertexCount();
+        }
+        auto nativeEnd = std::chrono::high_resolution_clock::now();
 
-    // copy texture data
-    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, buffer);
+        if (opened)
+        {
+            double nativeSeconds = std::chrono::duration<double>(nativeEnd - nativeStart).count();
+            result.nativeMilliseconds = nativeSeconds * 1000.0;
+            result.nativeVerticesPerSecond = nativeSeconds > 0.0 ? nativeVertexCount / nativeSeconds : 0.0;
+            result.nativeMegabytesPerSecond = nativeSeconds > 0.0 ? result.fileBytes / 1.0e6 / nativeSeconds : 0.0;
+        }
 
-    // let OpenGL generate mipmaps for us
-    glGenerateMipmap(GL_TEXTURE_2D);
+        results.push_back(result);
+    }
 
-    return texture;
+    return results;
 }
\ No newline at end of file
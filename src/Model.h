@@ -1,44 +1,154 @@
 #ifndef MODEL_H
 #define MODEL_H
 
+#include <memory>
 #include <string>
-#include <unordered_map>
 #include <vector>
 
-#include <assimp/scene.h>
 #include <assimp/mesh.h>
-#include <assimp/material.h>
+#include <assimp/scene.h>
 
 #include "lib/glad/include/glad/glad.h"
 
 #include "Mesh.h"
-#include "Shader.h"
+#include "ObjectPool.h"
+
+struct ModelTag;
+using ModelHandle = Handle<ModelTag>;
+
+class GltfFile;
+class ObjFile;
+
+/**
+ * Where a model came from, not needed for drawing.
+ */
+struct ModelSource
+{
+    std::string path;
 
-class Model
+    // index in the MaterialTable of every material of the scene
+    std::vector<GLuint> materialIndices;
+};
+
+/**
+ * Owns all models of the process, a model is the list of its meshes in the MeshPool.
+ * Like the meshes, models are only created and destroyed on the thread that owns the OpenGL context, while
+ * no other thread reads them.
+ */
+class ModelPool
 {
 public:
-    Model(const std::string &path);
+    static ModelPool &getInstance();
 
-    void draw(Shader &shader);
+    /**
+     * Model file that was read, but not built yet (see prepare), by the reader of its format or assimp.
+     * Everything is empty if the file couldn't be read.
+     */
+    struct PreparedModel
+    {
+        std::unique_ptr<GltfFile> gltf;
+        std::unique_ptr<ObjFile> obj;
+        std::unique_ptr<aiScene> scene;
 
-private:
-    std::vector<Mesh> meshes;
-    std::string baseDir;
-    std::unordered_map<std::string, Texture> loadedTextureByPath;
+        // the readers are incomplete types here
+        PreparedModel();
+        PreparedModel(PreparedModel &&other) noexcept;
+        PreparedModel &operator=(PreparedModel &&other) noexcept;
+        ~PreparedModel();
+    };
+
+    /**
+     * Import a model file and build its meshes, glTF and OBJ files are read by their own readers (GltfFile, ObjFile),
+     * everything else by assimp. Models baked into the AssetArchive are copied out of it (see PackedModel).
+     * A file that can't be imported still gets a model, without meshes, so it can be reloaded once it's fixed.
+     */
+    ModelHandle load(const std::string &path);
+
+    /**
+     * Build a model from a scene that was imported already, e.g. on another thread (see importScene).
+     */
+    ModelHandle create(const std::string &path, const aiScene &scene);
+
+    /**
+     * Read a model file like load does, without touching OpenGL, so it can be done on any thread.
+     * Models baked into the AssetArchive aren't read from it, the loose file is read.
+     */
+    static PreparedModel prepare(const std::string &path);
 
-    void loadModel(const std::string &path);
-    void processNode(aiNode *node, const aiScene *scene);
-    Mesh processMesh(aiMesh *mesh, const aiScene *scene);
-    std::vector<Texture> loadMaterialTextures(aiMaterial *material, const aiScene *scene,
-                                              aiTextureType aiType, TextureType type);
+    /**
+     * Build a model from a prepared file, which can only be done once.
+     * @return An invalid handle if the file couldn't be read.
+     */
+    ModelHandle create(const std::string &path, PreparedModel &prepared);
 
-    static GLuint loadEmbeddedTexture(const aiTexture *texture, GLint wrappingMode = GL_REPEAT);
+    /**
+     * Destroy a model together with its meshes, invalid handles are ignored.
+     */
+    void destroy(ModelHandle handle);
 
-    static GLuint loadTextureFromFile(const std::string &texturePath, const std::string &baseDir,
-                                      GLint wrappingMode = GL_REPEAT);
+    bool isValid(ModelHandle handle) const;
 
-    static GLuint createGlTexture(unsigned char *buffer, int width, int height, int nrChannels,
-                                  GLint wrappingMode = GL_REPEAT);
+    /**
+     * The handles need to be valid, references are only valid until the next model is created.
+     */
+    const std::vector<MeshHandle> &getMeshes(ModelHandle handle) const;
+    const std::string &getPath(ModelHandle handle) const;
+
+    std::size_t getCount() const;
+
+    /**
+     * Copy the vertices and faces of an imported mesh into the layout of the geometry pool.
+     * Doesn't touch OpenGL, the vectors are overwritten.
+     */
+    static void convertMesh(const aiMesh &mesh, std::vector<Vertex> &vertices, std::vector<GLuint> &indices);
+
+    /**
+     * Import a model file without touching OpenGL, so it can be done on any thread.
+     * @return The scene, or nullptr if the file can't be imported.
+     */
+    static std::unique_ptr<aiScene> importScene(const std::string &path);
+
+    // remove some functions for the singleton
+    ModelPool(ModelPool const &) = delete;
+    void operator=(ModelPool const &) = delete;
+
+private:
+    ObjectPool<ModelTag, std::vector<MeshHandle>, ModelSource> models;
+
+    ModelPool() = default;
+
+    /**
+     * Build a model from a file a native reader has opened.
+     */
+    template <class File>
+    ModelHandle createFromFile(const std::string &path, File &file);
 };
 
+namespace LoaderBenchmark
+{
+    struct Result
+    {
+        std::string path;
+        std::size_t fileBytes{0};
+        std::size_t vertexCount{0};
+        double importMilliseconds{0.0};  // reading and post processing the file with assimp
+        double convertMilliseconds{0.0}; // converting the meshes with ModelPool::convertMesh
+        double verticesPerSecond{0.0};   // of the whole import
+        double convertVerticesPerSecond{0.0};
+        double megabytesPerSecond{0.0};       // of the whole import, by the size of the file
+
+        // reading the file with the reader of its format instead of assimp, 0 if the format doesn't have one
+        double nativeMilliseconds{0.0};
+        double nativeVerticesPerSecond{0.0};
+        double nativeMegabytesPerSecond{0.0};
+    };
+
+    /**
+     * Import model files and convert their meshes, without uploading them, with assimp and the native reader of
+     * their format if there's one.
+     * Files that can't be imported are skipped.
+     */
+    std::vector<Result> run(const std::vector<std::string> &paths);
+} // namespace LoaderBenchmark
+
 #endif
\ No newline at end of file
@@ -0,0 +1,824 @@
+#include "ObjFile.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+
+#include <glibmm-2.4/glibmm/miscutils.h>
+
+#include "JobSystem.h"
+#include "Material.h"
+#include "MaterialTable.h"
+#include "TextureManager.h"
+
+namespace
+{
+    // powers of ten that are exact in a double, a mantissa below 2^53 scaled by them is rounded only once
+    const double POWERS_OF_TEN[]{1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    const int MAX_EXACT_POWER{22};
+    const std::uint64_t MAX_EXACT_MANTISSA{std::uint64_t(1) << 53};
+
+    // digits that fit into the 64 bit mantissa, further ones are below the precision of a float anyway
+    const int MAX_MANTISSA_DIGITS{19};
+
+    // the vertex a corner becomes, corners with the same attributes share it
+    struct VertexKey
+    {
+        std::int32_t position;
+        std::int32_t textureCoordinate;
+        std::int32_t normal;
+
+        bool operator==(const VertexKey &other) const
+        {
+            return position == other.position && textureCoordinate == other.textureCoordinate &&
+                   normal == other.normal;
+        }
+    };
+
+    struct VertexKeyHash
+    {
+        std::size_t operator()(const VertexKey &key) const
+        {
+            std::uint64_t hash = static_cast<std::uint32_t>(key.position);
+            hash = hash * 0x9E3779B97F4A7C15ull ^ static_cast<std::uint32_t>(key.textureCoordinate);
+            hash = hash * 0x9E3779B97F4A7C15ull ^ static_cast<std::uint32_t>(key.normal);
+            return static_cast<std::size_t>(hash ^ hash >> 32);
+        }
+    };
+
+    bool isSpace(char character)
+    {
+        return character == ' ' || character == '\t' || character == '\r';
+    }
+
+    bool isDigit(char character)
+    {
+        return character >= '0' && character <= '9';
+    }
+
+    const char *skipSpaces(const char *text, const char *end)
+    {
+        while (text < end && isSpace(*text))
+        {
+            text++;
+        }
+        return text;
+    }
+
+    /**
+     * Whether a number ends at the position, numbers have to be followed by a space or the end of the line.
+     */
+    bool isTokenEnd(const char *text, const char *end)
+    {
+        return text == end || isSpace(*text);
+    }
+
+    /**
+     * Parse a decimal floating point number like strtod, but without the locale, the checks for hexadecimal
+     * numbers and the arbitrary precision fallback, which make strtod the slowest part of reading an OBJ file.
+     * The digits are gathered into an integer mantissa that's scaled by a power of ten, which is exact for the
+     * numbers OBJ files contain (up to 15 significant digits and small exponents).
+     */
+    bool parseFloat(const char *&text, const char *end, float &value)
+    {
+        const char *position = skipSpaces(text, end);
+        bool negative = false;
+        if (position < end && (*position == '-' || *position == '+'))
+        {
+            negative = *position == '-';
+            position++;
+        }
+
+        std::uint64_t mantissa = 0;
+        int digits = 0;
+        int exponent = 0;
+        bool hasDigits = false;
+        for (; position < end && isDigit(*position); position++)
+        {
+            if (digits < MAX_MANTISSA_DIGITS)
+            {
+                mantissa = mantissa * 10 + (*position - '0');
+                digits += mantissa > 0 ? 1 : 0;
+            }
+            else
+            {
+                exponent++;
+            }
+            hasDigits = true;
+        }
+
+        if (position < end && *position == '.')
+        {
+            for (position++; position < end && isDigit(*position); position++)
+            {
+                if (digits < MAX_MANTISSA_DIGITS)
+                {
+                    mantissa = mantissa * 10 + (*position - '0');
+                    digits += mantissa > 0 ? 1 : 0;
+                    exponent--;
+                }
+                hasDigits = true;
+            }
+        }
+
+        if (!hasDigits)
+        {
+            return false;
+        }
+
+        if (position < end && (*position == 'e' || *position == 'E'))
+        {
+            const char *exponentPosition = position + 1;
+            bool negativeExponent = false;
+            if (exponentPosition < end && (*exponentPosition == '-' || *exponentPosition == '+'))
+            {
+                negativeExponent = *exponentPosition == '-';
+                exponentPosition++;
+            }
+
+            // an e without digits isn't part of the number
+            if (exponentPosition < end && isDigit(*exponentPosition))
+            {
+                int explicitExponent = 0;
+                for (; exponentPosition < end && isDigit(*exponentPosition); exponentPosition++)
+                {
+                    // clamped, anything this large is zero or infinite anyway
+                    explicitExponent = std::min(explicitExponent * 10 + (*exponentPosition - '0'), 100000);
+                }
+                exponent += negativeExponent ? -explicitExponent : explicitExponent;
+                position = exponentPosition;
+            }
+        }
+
+        if (!isTokenEnd(position, end))
+        {
+            return false;
+        }
+
+        double result = static_cast<double>(mantissa);
+        if (mantissa <= MAX_EXACT_MANTISSA && exponent >= -MAX_EXACT_POWER && exponent <= MAX_EXACT_POWER)
+        {
+            result = exponent < 0 ? result / POWERS_OF_TEN[-exponent] : result * POWERS_OF_TEN[exponent];
+        }
+        else if (mantissa != 0)
+        {
+            result *= std::pow(10.0, exponent);
+        }
+
+        value = static_cast<float>(negative ? -result : result);
+        text = position;
+        return true;
+    }
+
+    /**
+     * Parse an index of a face corner, negative ones count back from the last element that was read.
+     */
+    bool parseIndex(const char *&text, const char *end, std::int32_t &value)
+    {
+        const char *position = text;
+        bool negative = position < end && *position == '-';
+        if (negative)
+        {
+            position++;
+        }
+
+        std::int64_t index = 0;
+        const char *digitsBegin = position;
+        for (; position < end && isDigit(*position); position++)
+        {
+            index = index * 10 + (*position - '0');
+            if (index > INT32_MAX)
+            {
+                return false;
+            }
+        }
+
+        // 0 isn't a valid index, the first element is 1
+        if (position == digitsBegin || index == 0)
+        {
+            return false;
+        }
+
+        value = static_cast<std::int32_t>(negative ? -index : index);
+        text = position;
+        return true;
+    }
+
+    /**
+     * The rest of the line without the spaces around it, e.g. the name of a material.
+     */
+    std::string readName(const char *text, const char *end)
+    {
+        text = skipSpaces(text, end);
+        while (end > text && isSpace(end[-1]))
+        {
+            end--;
+        }
+        return std::string(text, end);
+    }
+
+    /**
+     * Path of a texture map, after options like -bm 0.5 that come before it. Paths are usually written on
+     * Windows, so backslashes are replaced.
+     */
+    std::string readMapPath(const char *text, const char *end)
+    {
+        std::string line = readName(text, end);
+        std::size_t space = line.find_last_of(" \t");
+        std::string mapPath = space == std::string::npos ? line : line.substr(space + 1);
+        std::replace(mapPath.begin(), mapPath.end(), '\\', '/');
+        return mapPath;
+    }
+
+    bool readColor(const char *text, const char *end, glm::vec3 &color)
+    {
+        return parseFloat(text, end, color.r) && parseFloat(text, end, color.g) && parseFloat(text, end, color.b);
+    }
+
+    /**
+     * Split off the keyword at the start of a line, text is moved behind it.
+     */
+    bool isKeyword(const char *&text, const char *end, const char *keyword)
+    {
+        std::size_t length = std::strlen(keyword);
+        if (static_cast<std::size_t>(end - text) < length || std::memcmp(text, keyword, length) != 0 ||
+            !isTokenEnd(text + length, end))
+        {
+            return false;
+        }
+        text += length;
+        return true;
+    }
+} // namespace
+
+bool ObjFile::isObj(const std::string &path)
+{
+    std::size_t dot = path.find_last_of('.');
+    if (dot == std::string::npos)
+    {
+        return false;
+    }
+
+    std::string extension = path.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    return extension == "obj";
+}
+
+bool ObjFile::open(const std::string &path)
+{
+    this->path = path;
+    baseDir = Glib::path_get_dirname(path);
+    if (!file.open(path))
+    {
+        return false;
+    }
+    fileSize = file.getSize();
+    file.adviseSequential();
+
+    // the chunks are parsed in parallel, each one drops its part of the file when it's done
+    std::vector<Chunk> chunks = splitChunks();
+    const char *text = reinterpret_cast<const char *>(file.getData());
+    JobSystem::getInstance().parallelFor(chunks.size(), [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; i++)
+        {
+            parseChunk(chunks[i]);
+            file.release(chunks[i].begin - text, chunks[i].end - chunks[i].begin);
+        }
+    }, 1);
+
+    for (const Chunk &chunk : chunks)
+    {
+        if (chunk.errorOffset >= 0)
+        {
+            std::cerr << "Malformed line at byte " << chunk.begin - text + chunk.errorOffset << " of OBJ file '"
+                      << path << "'" << std::endl;
+            return false;
+        }
+    }
+
+    if (!mergeChunks(chunks))
+    {
+        std::cerr << "Relative index before the start of OBJ file '" << path << "'" << std::endl;
+        return false;
+    }
+    file.close();
+
+    // materials can be used before the library that defines them is referenced
+    std::vector<std::string> libraries;
+    for (const Chunk &chunk : chunks)
+    {
+        for (const std::string &library : chunk.libraries)
+        {
+            if (std::find(libraries.begin(), libraries.end(), library) == libraries.end())
+            {
+                libraries.push_back(library);
+                readMaterialLibrary(library);
+            }
+        }
+    }
+
+    groupByMaterial(chunks);
+
+    std::vector<char> built(groups.size());
+    JobSystem::getInstance().parallelFor(groups.size(), [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; i++)
+        {
+            built[i] = buildGroup(chunks, groups[i]);
+        }
+    }, 1);
+
+    // the vertices have their own copies of the attributes now
+    positions = std::vector<glm::vec3>();
+    textureCoordinates = std::vector<glm::vec2>();
+    normals = std::vector<glm::vec3>();
+
+    if (std::find(built.begin(), built.end(), 0) != built.end())
+    {
+        std::cerr << "Face with a missing vertex attribute in OBJ file '" << path << "'" << std::endl;
+        groups.clear();
+        return false;
+    }
+
+    return true;
+}
+
+void ObjFile::build(std::vector<MeshHandle> &meshes, std::vector<GLuint> &materialIndices)
+{
+    // textures of this model by their path in the material library, like the assimp path shares them
+    std::unordered_map<std::string, Texture> loadedTextureByPath;
+
+    materialIndices.reserve(materials.size() + 1);
+    for (const ObjMaterial &material : materials)
+    {
+        std::vector<Texture> textures;
+        for (auto map : {std::make_pair(&material.diffuseMap, TextureType::diffuse),
+                         std::make_pair(&material.specularMap, TextureType::specular),
+                         std::make_pair(&material.emissiveMap, TextureType::emissive)})
+        {
+            const std::string &mapPath = *map.first;
+            if (mapPath.empty())
+            {
+                continue;
+            }
+
+            auto loaded = loadedTextureByPath.find(mapPath);
+            if (loaded == loadedTextureByPath.end())
+            {
+                Texture texture;
+                texture.reference = TextureManager::getInstance().load(baseDir + '/' + mapPath, map.second);
+                texture.id = texture.reference.getId();
+                texture.path = mapPath;
+                texture.type = map.second;
+                loaded = loadedTextureByPath.insert({mapPath, texture}).first;
+            }
+            textures.push_back(loaded->second);
+        }
+
+        Material result(material.name, textures);
+        if (material.hasDiffuseColor)
+        {
+            result.parameters.diffuseColor = glm::vec4(material.diffuseColor, 1.0f);
+        }
+        if (material.hasSpecularColor)
+        {
+            result.parameters.specularColor = glm::vec4(material.specularColor, 1.0f);
+        }
+        if (material.hasEmissiveColor)
+        {
+            result.parameters.emissiveColor = glm::vec4(material.emissiveColor, 1.0f);
+        }
+
+        // same rules as Material::fromAssimp, so both readers give the same materials
+        if (material.shininess > 0.0f)
+        {
+            result.parameters.shininess = material.shininess;
+        }
+        if ((result.parameters.features & MATERIAL_EMISSIVE_MAP) &&
+            glm::vec3(result.parameters.emissiveColor) == glm::vec3(0.0f))
+        {
+            result.parameters.emissiveColor = glm::vec4(1.0f);
+        }
+
+        materialIndices.push_back(MaterialTable::getInstance().add(result));
+    }
+
+    GLuint defaultMaterial = 0;
+    bool hasDefaultMaterial = false;
+
+    meshes.reserve(meshes.size() + groups.size());
+    for (Group &group : groups)
+    {
+        GLuint materialIndex;
+        if (group.material >= 0)
+        {
+            materialIndex = materialIndices[group.material];
+        }
+        else
+        {
+            if (!hasDefaultMaterial)
+            {
+                defaultMaterial = MaterialTable::getInstance().add(Material("default", {}));
+                materialIndices.push_back(defaultMaterial);
+                hasDefaultMaterial = true;
+            }
+            materialIndex = defaultMaterial;
+        }
+
+        meshes.push_back(MeshPool::getInstance().create(std::move(group.vertices), std::move(group.indices),
+                                                        materialIndex));
+    }
+    groups.clear();
+}
+
+std::size_t ObjFile::getVertexCount() const
+{
+    std::size_t count = 0;
+    for (const Group &group : groups)
+    {
+        count += group.vertices.size();
+    }
+    return count;
+}
+
+std::size_t ObjFile::getFileSize() const
+{
+    return fileSize;
+}
+
+std::vector<ObjFile::Chunk> ObjFile::splitChunks() const
+{
+    std::vector<Chunk> chunks;
+    const char *text = reinterpret_cast<const char *>(file.getData());
+    std::size_t size = file.getSize();
+    if (size == 0)
+    {
+        return chunks;
+    }
+
+    // a few chunks per thread, so threads that finish early can take over the work of slower ones
+    std::size_t maxChunkCount = JobSystem::getInstance().getThreadCount() * 4;
+    std::size_t chunkCount = std::max<std::size_t>(1, std::min(size / MIN_CHUNK_SIZE, maxChunkCount));
+
+    const char *begin = text;
+    const char *end = text + size;
+    for (std::size_t i = 1; i <= chunkCount && begin < end; i++)
+    {
+        // every chunk ends behind a line break, so no line is split
+        const char *chunkEnd = end;
+        if (i < chunkCount)
+        {
+            const char *target = std::max(begin, text + size / chunkCount * i);
+            const void *lineBreak = std::memchr(target, '\n', end - target);
+            chunkEnd = lineBreak ? static_cast<const char *>(lineBreak) + 1 : end;
+        }
+
+        Chunk chunk;
+        chunk.begin = begin;
+        chunk.end = chunkEnd;
+        chunks.push_back(std::move(chunk));
+        begin = chunkEnd;
+    }
+
+    return chunks;
+}
+
+void ObjFile::parseChunk(Chunk &chunk)
+{
+    chunk.runs.push_back({INHERITED_MATERIAL, 0});
+
+    // indices of the current face as they are in the file, 0 where an attribute is missing
+    std::vector<Corner> polygon;
+
+    const char *line = chunk.begin;
+    while (line < chunk.end)
+    {
+        const void *lineBreak = std::memchr(line, '\n', chunk.end - line);
+        const char *lineEnd = lineBreak ? static_cast<const char *>(lineBreak) : chunk.end;
+        const char *text = skipSpaces(line, lineEnd);
+        bool valid = true;
+
+        if (isKeyword(text, lineEnd, "v"))
+        {
+            glm::vec3 position;
+            valid = readColor(text, lineEnd, position);
+            chunk.positions.push_back(position);
+        }
+        else if (isKeyword(text, lineEnd, "vt"))
+        {
+            // the second coordinate is optional, a third one is ignored
+            glm::vec2 textureCoordinate(0.0f);
+            valid = parseFloat(text, lineEnd, textureCoordinate.x);
+            if (valid && skipSpaces(text, lineEnd) != lineEnd)
+            {
+                valid = parseFloat(text, lineEnd, textureCoordinate.y);
+            }
+            chunk.textureCoordinates.push_back(textureCoordinate);
+        }
+        else if (isKeyword(text, lineEnd, "vn"))
+        {
+            glm::vec3 normal;
+            valid = readColor(text, lineEnd, normal);
+            chunk.normals.push_back(normal);
+        }
+        else if (isKeyword(text, lineEnd, "f"))
+        {
+            // corners are v, v/vt, v//vn or v/vt/vn
+            polygon.clear();
+            for (text = skipSpaces(text, lineEnd); valid && text < lineEnd; text = skipSpaces(text, lineEnd))
+            {
+                if (*text == '#')
+                {
+                    break;
+                }
+
+                Corner corner{0, 0, 0};
+                valid = parseIndex(text, lineEnd, corner.position);
+                if (valid && text < lineEnd && *text == '/')
+                {
+                    text++;
+                    if (text < lineEnd && *text != '/')
+                    {
+                        valid = parseIndex(text, lineEnd, corner.textureCoordinate);
+                    }
+                    if (valid && text < lineEnd && *text == '/')
+                    {
+                        text++;
+                        valid = parseIndex(text, lineEnd, corner.normal);
+                    }
+                }
+                valid = valid && isTokenEnd(text, lineEnd);
+                polygon.push_back(corner);
+            }
+
+            // polygons become triangle fans, points and lines are skipped
+            for (std::size_t i = 2; valid && i < polygon.size(); i++)
+            {
+                for (const Corner *corner : {&polygon[0], &polygon[i - 1], &polygon[i]})
+                {
+                    // relative indices are turned into indices from the start of the chunk
+                    std::int32_t indices[3]{corner->position, corner->textureCoordinate, corner->normal};
+                    std::size_t counts[3]{chunk.positions.size(), chunk.textureCoordinates.size(),
+                                          chunk.normals.size()};
+                    for (int attribute = 0; attribute < 3; attribute++)
+                    {
+                        if (indices[attribute] < 0)
+                        {
+                            chunk.relativeIndices.push_back({chunk.corners.size(), attribute,
+                                                             static_cast<std::int32_t>(counts[attribute]) +
+                                                                 indices[attribute]});
+                            indices[attribute] = 0;
+                        }
+                    }
+                    chunk.corners.push_back({indices[0], indices[1], indices[2]});
+                }
+            }
+        }
+        else if (isKeyword(text, lineEnd, "usemtl"))
+        {
+            std::string name = readName(text, lineEnd);
+            auto known = std::find(chunk.materialNames.begin(), chunk.materialNames.end(), name);
+            int material = static_cast<int>(known - chunk.materialNames.begin());
+            if (known == chunk.materialNames.end())
+            {
+                chunk.materialNames.push_back(name);
+            }
+
+            // a run without faces is replaced
+            if (chunk.runs.back().firstCorner == chunk.corners.size())
+            {
+                chunk.runs.back().material = material;
+            }
+            else
+            {
+                chunk.runs.push_back({material, chunk.corners.size()});
+            }
+        }
+        else if (isKeyword(text, lineEnd, "mtllib"))
+        {
+            chunk.libraries.push_back(readName(text, lineEnd));
+        }
+
+        // everything else (comments, objects, groups, smoothing groups, lines) doesn't change the meshes
+        if (!valid)
+        {
+            chunk.errorOffset = line - chunk.begin;
+            return;
+        }
+        line = lineEnd + 1;
+    }
+}
+
+bool ObjFile::mergeChunks(std::vector<Chunk> &chunks)
+{
+    std::size_t positionCount = 0;
+    std::size_t textureCoordinateCount = 0;
+    std::size_t normalCount = 0;
+    for (const Chunk &chunk : chunks)
+    {
+        positionCount += chunk.positions.size();
+        textureCoordinateCount += chunk.textureCoordinates.size();
+        normalCount += chunk.normals.size();
+    }
+
+    positions.reserve(positionCount);
+    textureCoordinates.reserve(textureCoordinateCount);
+    normals.reserve(normalCount);
+
+    for (Chunk &chunk : chunks)
+    {
+        // relative indices are resolved with the number of elements in front of the chunk
+        std::int64_t offsets[3]{static_cast<std::int64_t>(positions.size()),
+                                static_cast<std::int64_t>(textureCoordinates.size()),
+                                static_cast<std::int64_t>(normals.size())};
+        for (const RelativeIndex &relative : chunk.relativeIndices)
+        {
+            std::int64_t index = offsets[relative.attribute] + relative.chunkIndex;
+            if (index < 0)
+            {
+                return false;
+            }
+
+            Corner &corner = chunk.corners[relative.corner];
+            std::int32_t *fields[3]{&corner.position, &corner.textureCoordinate, &corner.normal};
+            *fields[relative.attribute] = static_cast<std::int32_t>(index + 1);
+        }
+
+        // the copies of the chunks are released right away, so the attributes are never in memory twice
+        positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+        textureCoordinates.insert(textureCoordinates.end(), chunk.textureCoordinates.begin(),
+                                  chunk.textureCoordinates.end());
+        normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+        chunk.positions = std::vector<glm::vec3>();
+        chunk.textureCoordinates = std::vector<glm::vec2>();
+        chunk.normals = std::vector<glm::vec3>();
+        chunk.relativeIndices = std::vector<RelativeIndex>();
+    }
+
+    return true;
+}
+
+void ObjFile::readMaterialLibrary(const std::string &name)
+{
+    MappedFile library;
+    if (!library.open(baseDir + '/' + name))
+    {
+        return;
+    }
+
+    const char *line = reinterpret_cast<const char *>(library.getData());
+    const char *end = line + library.getSize();
+    while (line < end)
+    {
+        const void *lineBreak = std::memchr(line, '\n', end - line);
+        const char *lineEnd = lineBreak ? static_cast<const char *>(lineBreak) : end;
+        const char *text = skipSpaces(line, lineEnd);
+        line = lineEnd + 1;
+
+        if (isKeyword(text, lineEnd, "newmtl"))
+        {
+            ObjMaterial material;
+            material.name = readName(text, lineEnd);
+            materials.push_back(material);
+            continue;
+        }
+
+        // statements before the first material don't belong to any
+        if (materials.empty())
+        {
+            continue;
+        }
+
+        ObjMaterial &material = materials.back();
+        if (isKeyword(text, lineEnd, "Kd"))
+        {
+            material.hasDiffuseColor = readColor(text, lineEnd, material.diffuseColor);
+        }
+        else if (isKeyword(text, lineEnd, "Ks"))
+        {
+            material.hasSpecularColor = readColor(text, lineEnd, material.specularColor);
+        }
+        else if (isKeyword(text, lineEnd, "Ke"))
+        {
+            material.hasEmissiveColor = readColor(text, lineEnd, material.emissiveColor);
+        }
+        else if (isKeyword(text, lineEnd, "Ns"))
+        {
+            parseFloat(text, lineEnd, material.shininess);
+        }
+        else if (isKeyword(text, lineEnd, "map_Kd"))
+        {
+            material.diffuseMap = readMapPath(text, lineEnd);
+        }
+        else if (isKeyword(text, lineEnd, "map_Ks"))
+        {
+            material.specularMap = readMapPath(text, lineEnd);
+        }
+        else if (isKeyword(text, lineEnd, "map_Ke"))
+        {
+            material.emissiveMap = readMapPath(text, lineEnd);
+        }
+    }
+}
+
+int ObjFile::findMaterial(const std::string &name) const
+{
+    for (std::size_t i = 0; i < materials.size(); i++)
+    {
+        if (materials[i].name == name)
+        {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+void ObjFile::groupByMaterial(const std::vector<Chunk> &chunks)
+{
+    // group of every material, the last one is for faces without a material
+    std::vector<int> groupIndices(materials.size() + 1, -1);
+    int material = -1;
+
+    for (std::size_t i = 0; i < chunks.size(); i++)
+    {
+        const Chunk &chunk = chunks[i];
+        for (std::size_t j = 0; j < chunk.runs.size(); j++)
+        {
+            const MaterialRun &run = chunk.runs[j];
+            if (run.material != INHERITED_MATERIAL)
+            {
+                material = findMaterial(chunk.materialNames[run.material]);
+            }
+
+            std::size_t end = j + 1 < chunk.runs.size() ? chunk.runs[j + 1].firstCorner : chunk.corners.size();
+            if (run.firstCorner == end)
+            {
+                continue;
+            }
+
+            int &group = groupIndices[material >= 0 ? static_cast<std::size_t>(material) : materials.size()];
+            if (group < 0)
+            {
+                group = static_cast<int>(groups.size());
+                groups.emplace_back();
+                groups.back().material = material;
+            }
+            groups[group].ranges.push_back({i, run.firstCorner, end});
+        }
+    }
+}
+
+bool ObjFile::buildGroup(const std::vector<Chunk> &chunks, Group &group) const
+{
+    std::size_t cornerCount = 0;
+    for (const CornerRange &range : group.ranges)
+    {
+        cornerCount += range.end - range.begin;
+    }
+
+    // a vertex of a closed mesh is usually shared by about six triangles
+    std::unordered_map<VertexKey, GLuint, VertexKeyHash> vertexByKey;
+    vertexByKey.reserve(cornerCount / 4);
+    group.vertices.reserve(cornerCount / 4);
+    group.indices.reserve(cornerCount);
+
+    for (const CornerRange &range : group.ranges)
+    {
+        const std::vector<Corner> &corners = chunks[range.chunk].corners;
+        for (std::size_t i = range.begin; i < range.end; i++)
+        {
+            const Corner &corner = corners[i];
+            if (corner.position <= 0 || static_cast<std::size_t>(corner.position) > positions.size() ||
+                static_cast<std::size_t>(corner.textureCoordinate) > textureCoordinates.size() ||
+                static_cast<std::size_t>(corner.normal) > normals.size())
+            {
+                return false;
+            }
+
+            VertexKey key{corner.position, corner.textureCoordinate, corner.normal};
+            auto inserted = vertexByKey.insert({key, static_cast<GLuint>(group.vertices.size())});
+            if (inserted.second)
+            {
+                Vertex vertex{};
+                vertex.position = positions[corner.position - 1];
+                if (corner.normal > 0)
+                {
+                    vertex.normal = normals[corner.normal - 1];
+                }
+                if (corner.textureCoordinate > 0)
+                {
+                    // flipped like the assimp path does, the images are flipped on load instead
+                    const glm::vec2 &textureCoordinate = textureCoordinates[corner.textureCoordinate - 1];
+                    vertex.textureCoordinates = glm::vec2(textureCoordinate.x, 1.0f - textureCoordinate.y);
+                }
+                group.vertices.push_back(vertex);
+            }
+            group.indices.push_back(inserted.first->second);
+        }
+    }
+
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,176 @@
+#ifndef OBJFILE_H
+#define OBJFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "lib/glad/include/glad/glad.h"
+
+#include "MappedFile.h"
+#include "Mesh.h"
+#include "Vertex.h"
+
+/**
+ * Reads Wavefront OBJ models and their MTL materials without assimp, meant for large scanned models.
+ * The file is memory mapped and cut into chunks at line ends, which are parsed in parallel on the job system.
+ * Pages of the file are dropped once their chunk is parsed, so files larger than the memory can be read.
+ * The faces are grouped by material, each group becomes one mesh whose vertices are deduplicated by their
+ * combination of position, texture coordinate and normal, the groups are built in parallel as well.
+ * Polygons are split into triangle fans, points and lines are skipped. Objects and groups (o, g) don't split meshes.
+ * Like the assimp path of the ModelPool, texture coordinates are flipped and the textures are loaded flipped.
+ */
+class ObjFile
+{
+public:
+    /**
+     * Whether the path has the extension of an OBJ file.
+     */
+    static bool isObj(const std::string &path);
+
+    /**
+     * Read the file, its materials and convert its meshes, without touching OpenGL.
+     * @return False if the file can't be read or is malformed (e.g. a face refers to a missing vertex).
+     */
+    bool open(const std::string &path);
+
+    /**
+     * Load the textures, add the materials and upload the meshes, on the thread that owns the OpenGL context.
+     * The converted meshes are moved into the MeshPool, so this can only be done once.
+     */
+    void build(std::vector<MeshHandle> &meshes, std::vector<GLuint> &materialIndices);
+
+    /**
+     * Vertices of all meshes that were read, after the deduplication.
+     */
+    std::size_t getVertexCount() const;
+
+    /**
+     * Size of the OBJ file itself.
+     */
+    std::size_t getFileSize() const;
+
+private:
+    // files below this size are parsed in one piece, the jobs wouldn't pay off
+    static constexpr std::size_t MIN_CHUNK_SIZE{1024 * 1024};
+
+    // a face corner, 0 means the corner has no such attribute, other indices start at 1 like in the file
+    struct Corner
+    {
+        std::int32_t position;
+        std::int32_t textureCoordinate;
+        std::int32_t normal;
+    };
+
+    // material of the first run of a chunk, which continues the material of the previous chunk
+    static constexpr int INHERITED_MATERIAL{-1};
+
+    // the faces of a chunk from a usemtl line on, the material is an index into the names of the chunk
+    struct MaterialRun
+    {
+        int material;
+        std::size_t firstCorner;
+    };
+
+    // a negative index of the file, relative to the end of the list when the face was read, which is only known
+    // within the chunk, the corner is fixed up after the sizes of all previous chunks are known
+    struct RelativeIndex
+    {
+        std::size_t corner;
+        int attribute; // 0 position, 1 texture coordinate, 2 normal
+        std::int32_t chunkIndex; // 0-based from the first element of the chunk, can point into previous chunks
+    };
+
+    struct Chunk
+    {
+        const char *begin;
+        const char *end;
+
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec2> textureCoordinates;
+        std::vector<glm::vec3> normals;
+
+        // three corners per triangle
+        std::vector<Corner> corners;
+        std::vector<MaterialRun> runs;
+        std::vector<RelativeIndex> relativeIndices;
+
+        // materials by their index in the chunk, libraries in the order they're referenced
+        std::vector<std::string> materialNames;
+        std::vector<std::string> libraries;
+
+        // offset of the first malformed line, or -1
+        std::ptrdiff_t errorOffset{-1};
+    };
+
+    struct ObjMaterial
+    {
+        std::string name;
+        glm::vec3 diffuseColor{1.0f};
+        glm::vec3 specularColor{0.0f};
+        glm::vec3 emissiveColor{0.0f};
+        float shininess{0.0f};
+        bool hasDiffuseColor{false};
+        bool hasSpecularColor{false};
+        bool hasEmissiveColor{false};
+        std::string diffuseMap;
+        std::string specularMap;
+        std::string emissiveMap;
+    };
+
+    // corners [begin, end) of a chunk
+    struct CornerRange
+    {
+        std::size_t chunk;
+        std::size_t begin;
+        std::size_t end;
+    };
+
+    struct Group
+    {
+        int material; // -1 for faces without usemtl or with an unknown material
+        std::vector<CornerRange> ranges;
+        std::vector<Vertex> vertices;
+        std::vector<GLuint> indices;
+    };
+
+    std::string path;
+    std::string baseDir;
+    MappedFile file;
+    std::size_t fileSize{0};
+
+    // attributes of the whole file, only kept while the groups are built
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec2> textureCoordinates;
+    std::vector<glm::vec3> normals;
+
+    std::vector<ObjMaterial> materials;
+    std::vector<Group> groups;
+
+    std::vector<Chunk> splitChunks() const;
+    static void parseChunk(Chunk &chunk);
+
+    /**
+     * Append the attributes of the chunks and turn the indices of their corners into absolute ones.
+     * @return False if a relative index points before the start of the file.
+     */
+    bool mergeChunks(std::vector<Chunk> &chunks);
+
+    /**
+     * Add the materials of an MTL file, a missing file only leaves its materials undefined.
+     */
+    void readMaterialLibrary(const std::string &name);
+    int findMaterial(const std::string &name) const;
+    void groupByMaterial(const std::vector<Chunk> &chunks);
+
+    /**
+     * Deduplicate the corners of the triangles of a group.
+     * @return False if a corner refers to an element that doesn't exist.
+     */
+    bool buildGroup(const std::vector<Chunk> &chunks, Group &group) const;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,147 @@
+#ifndef OBJECTPOOL_H
+#define OBJECTPOOL_H
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/**
+ * Reference to an object of an ObjectPool.
+ * The generation tells a handle to a destroyed object apart from a handle to the object that reused its slot,
+ * the tag makes handles of different pools different types.
+ */
+template <class Tag>
+struct Handle
+{
+    std::uint32_t index{0};
+    std::uint32_t generation{0}; // live objects never have generation 0, so default handles are invalid
+
+    bool operator==(const Handle &other) const
+    {
+        return index == other.index && generation == other.generation;
+    }
+
+    bool operator!=(const Handle &other) const
+    {
+        return !(*this == other);
+    }
+};
+
+template <class Tag>
+struct HandleHash
+{
+    std::size_t operator()(const Handle<Tag> &handle) const
+    {
+        return std::hash<std::uint64_t>()(static_cast<std::uint64_t>(handle.generation) << 32 | handle.index);
+    }
+};
+
+/**
+ * Stores objects in contiguous arrays and hands out generational handles to them.
+ * Every object is split into a hot part, which is what's touched while drawing, and a cold part with everything
+ * else (paths, CPU copies). Both live in their own array, so iterating over the hot parts doesn't pull the cold
+ * ones into the cache. Slots of destroyed objects are reused, the arrays never shrink.
+ * Creating objects may move the others, so references to them are only valid until the next create.
+ */
+template <class Tag, class Hot, class Cold>
+class ObjectPool
+{
+public:
+    using HandleType = Handle<Tag>;
+
+    HandleType create(Hot hotPart, Cold coldPart)
+    {
+        HandleType handle;
+        if (freeSlots.empty())
+        {
+            handle.index = static_cast<std::uint32_t>(hot.size());
+            hot.push_back(std::move(hotPart));
+            cold.push_back(std::move(coldPart));
+            generations.push_back(1);
+        }
+        else
+        {
+            handle.index = freeSlots.back();
+            freeSlots.pop_back();
+            hot[handle.index] = std::move(hotPart);
+            cold[handle.index] = std::move(coldPart);
+        }
+
+        handle.generation = generations[handle.index];
+        count++;
+        return handle;
+    }
+
+    /**
+     * Release the slot of an object, handles to it become invalid. Invalid handles are ignored.
+     */
+    void destroy(HandleType handle)
+    {
+        if (!isValid(handle))
+        {
+            return;
+        }
+
+        // the parts are replaced so the memory they own is released right away
+        hot[handle.index] = Hot();
+        cold[handle.index] = Cold();
+
+        std::uint32_t &generation = generations[handle.index];
+        generation = generation == UINT32_MAX ? 1 : generation + 1;
+        freeSlots.push_back(handle.index);
+        count--;
+    }
+
+    bool isValid(HandleType handle) const
+    {
+        return handle.index < generations.size() && generations[handle.index] == handle.generation;
+    }
+
+    /**
+     * Parts of an object, the handle needs to be valid.
+     */
+    Hot &getHot(HandleType handle)
+    {
+        return hot[handle.index];
+    }
+
+    const Hot &getHot(HandleType handle) const
+    {
+        return hot[handle.index];
+    }
+
+    Cold &getCold(HandleType handle)
+    {
+        return cold[handle.index];
+    }
+
+    const Cold &getCold(HandleType handle) const
+    {
+        return cold[handle.index];
+    }
+
+    /**
+     * Number of live objects.
+     */
+    std::size_t getCount() const
+    {
+        return count;
+    }
+
+    /**
+     * Number of slots, live or free.
+     */
+    std::size_t getCapacity() const
+    {
+        return hot.size();
+    }
+
+private:
+    std::vector<Hot> hot;
+    std::vector<Cold> cold;
+    std::vector<std::uint32_t> generations;
+    std::vector<std::uint32_t> freeSlots;
+    std::size_t count{0};
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,363 @@
+#include "PackedModel.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+
+#include <assimp/material.h>
+#include <glibmm-2.4/glibmm/miscutils.h>
+
+#include "AssetArchive.h"
+#include "MaterialTable.h"
+#include "Model.h"
+#include "Vertex.h"
+
+namespace
+{
+    const char MODEL_MAGIC[4]{'O', 'G', 'M', 'D'};
+
+    // needs to be increased whenever the layout changes, models of older archives are imported from their files then
+    const std::uint32_t MODEL_VERSION{1};
+
+    // vertices and indices start on this boundary, so they can be copied with aligned loads
+    const std::size_t ARRAY_ALIGNMENT{16};
+
+    struct ModelHeader
+    {
+        char magic[4];
+        std::uint32_t version;
+        std::uint32_t materialCount;
+        std::uint32_t meshCount;
+    };
+
+    // followed by the name and the textures
+    struct MaterialHeader
+    {
+        MaterialParameters parameters;
+        std::uint32_t nameSize;
+        std::uint32_t textureCount;
+    };
+
+    // followed by the path
+    struct TextureHeader
+    {
+        std::uint32_t type;
+        std::uint32_t pathSize;
+    };
+
+    struct MeshHeader
+    {
+        std::uint32_t material;
+        std::uint32_t padding;
+        std::uint64_t vertexCount;
+        std::uint64_t indexCount;
+    };
+
+    template <class Value>
+    void append(std::vector<unsigned char> &data, const Value &value)
+    {
+        const unsigned char *bytes = reinterpret_cast<const unsigned char *>(&value);
+        data.insert(data.end(), bytes, bytes + sizeof(Value));
+    }
+
+    void appendAligned(std::vector<unsigned char> &data, const void *array, std::size_t size)
+    {
+        data.resize((data.size() + ARRAY_ALIGNMENT - 1) / ARRAY_ALIGNMENT * ARRAY_ALIGNMENT, 0);
+        const unsigned char *bytes = static_cast<const unsigned char *>(array);
+        data.insert(data.end(), bytes, bytes + size);
+    }
+
+    /**
+     * Reads an entry front to back, every read is checked against its end.
+     */
+    class EntryReader
+    {
+    public:
+        EntryReader(const unsigned char *data, std::size_t size) : data(data), size(size)
+        {
+        }
+
+        template <class Value>
+        bool read(Value &value)
+        {
+            const unsigned char *bytes;
+            if (!view(sizeof(Value), bytes))
+            {
+                return false;
+            }
+            std::memcpy(&value, bytes, sizeof(Value));
+            return true;
+        }
+
+        bool readString(std::size_t length, std::string &text)
+        {
+            const unsigned char *bytes;
+            if (!view(length, bytes))
+            {
+                return false;
+            }
+            text.assign(reinterpret_cast<const char *>(bytes), length);
+            return true;
+        }
+
+        bool readAligned(std::size_t length, const unsigned char *&bytes)
+        {
+            offset = std::min((offset + ARRAY_ALIGNMENT - 1) / ARRAY_ALIGNMENT * ARRAY_ALIGNMENT, size);
+            return view(length, bytes);
+        }
+
+    private:
+        const unsigned char *data;
+        std::size_t size;
+        std::size_t offset{0};
+
+        bool view(std::size_t length, const unsigned char *&bytes)
+        {
+            if (length > size - offset)
+            {
+                return false;
+            }
+            bytes = data + offset;
+            offset += length;
+            return true;
+        }
+    };
+
+    /**
+     * Meshes in the order the ModelPool creates them, a mesh that's referenced by several nodes is repeated.
+     */
+    void collectMeshes(const aiNode *node, std::vector<unsigned int> &meshes)
+    {
+        meshes.insert(meshes.end(), node->mMeshes, node->mMeshes + node->mNumMeshes);
+        for (unsigned int i = 0; i < node->mNumChildren; i++)
+        {
+            collectMeshes(node->mChildren[i], meshes);
+        }
+    }
+} // namespace
+
+std::string PackedModel::getEntryName(const std::string &modelName)
+{
+    return modelName + "|model";
+}
+
+bool PackedModel::bake(const aiScene &scene, std::vector<unsigned char> &data,
+                       std::vector<std::pair<std::string, TextureType>> &textures)
+{
+    std::vector<unsigned int> meshIndices;
+    collectMeshes(scene.mRootNode, meshIndices);
+
+    data.clear();
+    ModelHeader header;
+    std::memcpy(header.magic, MODEL_MAGIC, sizeof(MODEL_MAGIC));
+    header.version = MODEL_VERSION;
+    header.materialCount = scene.mNumMaterials;
+    header.meshCount = meshIndices.size();
+    append(data, header);
+
+    for (unsigned int i = 0; i < scene.mNumMaterials; i++)
+    {
+        const aiMaterial &material = *scene.mMaterials[i];
+        std::vector<std::pair<std::string, TextureType>> materialTextures;
+        for (auto type : {std::make_pair(aiTextureType_DIFFUSE, TextureType::diffuse),
+                          std::make_pair(aiTextureType_SPECULAR, TextureType::specular),
+                          std::make_pair(aiTextureType_EMISSIVE, TextureType::emissive)})
+        {
+            for (unsigned int j = 0; j < material.GetTextureCount(type.first); j++)
+            {
+                aiString path;
+                material.GetTexture(type.first, j, &path);
+                std::string texturePath = path.C_Str();
+                if (texturePath.empty())
+                {
+                    continue;
+                }
+
+                // embedded textures are only known to assimp
+                if (texturePath[0] == '*')
+                {
+                    return false;
+                }
+
+                std::replace(texturePath.begin(), texturePath.end(), '\\', '/');
+                materialTextures.push_back({texturePath, type.second});
+            }
+        }
+
+        // the features depend on the textures that could be loaded, they're set when the model is built
+        Material converted = Material::fromAssimp(material, {});
+        MaterialHeader materialHeader;
+        materialHeader.parameters = converted.parameters;
+        materialHeader.nameSize = converted.name.size();
+        materialHeader.textureCount = materialTextures.size();
+        append(data, materialHeader);
+        data.insert(data.end(), converted.name.begin(), converted.name.end());
+
+        for (const std::pair<std::string, TextureType> &texture : materialTextures)
+        {
+            append(data, TextureHeader{static_cast<std::uint32_t>(texture.second),
+                                       static_cast<std::uint32_t>(texture.first.size())});
+            data.insert(data.end(), texture.first.begin(), texture.first.end());
+            if (std::find(textures.begin(), textures.end(), texture) == textures.end())
+            {
+                textures.push_back(texture);
+            }
+        }
+    }
+
+    // all headers come first, so the arrays follow each other
+    std::vector<std::vector<Vertex>> vertices(meshIndices.size());
+    std::vector<std::vector<GLuint>> indices(meshIndices.size());
+    for (std::size_t i = 0; i < meshIndices.size(); i++)
+    {
+        const aiMesh &mesh = *scene.mMeshes[meshIndices[i]];
+        ModelPool::convertMesh(mesh, vertices[i], indices[i]);
+        append(data, MeshHeader{mesh.mMaterialIndex, 0, vertices[i].size(), indices[i].size()});
+    }
+
+    for (std::size_t i = 0; i < meshIndices.size(); i++)
+    {
+        appendAligned(data, vertices[i].data(), vertices[i].size() * sizeof(Vertex));
+        appendAligned(data, indices[i].data(), indices[i].size() * sizeof(GLuint));
+    }
+
+    return true;
+}
+
+bool PackedModel::open(const std::string &path)
+{
+    baseDir = Glib::path_get_dirname(path);
+    materials.clear();
+    meshes.clear();
+
+    const unsigned char *data;
+    std::size_t size;
+    if (!AssetArchive::getInstance().find(getEntryName(AssetArchive::getName(path)), data, size))
+    {
+        return false;
+    }
+
+    EntryReader reader(data, size);
+    ModelHeader header;
+    if (!reader.read(header) || std::memcmp(header.magic, MODEL_MAGIC, sizeof(MODEL_MAGIC)) != 0 ||
+        header.version != MODEL_VERSION)
+    {
+        return false;
+    }
+
+    bool valid = true;
+    for (std::uint32_t i = 0; valid && i < header.materialCount; i++)
+    {
+        MaterialHeader materialHeader;
+        MaterialEntry material;
+        valid = reader.read(materialHeader) && reader.readString(materialHeader.nameSize, material.name);
+        material.parameters = materialHeader.parameters;
+
+        for (std::uint32_t j = 0; valid && j < materialHeader.textureCount; j++)
+        {
+            TextureHeader textureHeader;
+            std::string texturePath;
+            valid = reader.read(textureHeader) && reader.readString(textureHeader.pathSize, texturePath) &&
+                    textureHeader.type <= static_cast<std::uint32_t>(TextureType::emissive);
+            material.textures.push_back({texturePath, static_cast<TextureType>(textureHeader.type)});
+        }
+        materials.push_back(std::move(material));
+    }
+
+    for (std::uint32_t i = 0; valid && i < header.meshCount; i++)
+    {
+        MeshHeader meshHeader;
+        valid = reader.read(meshHeader) && meshHeader.material < header.materialCount &&
+                meshHeader.vertexCount <= SIZE_MAX / sizeof(Vertex) &&
+                meshHeader.indexCount <= SIZE_MAX / sizeof(GLuint);
+        meshes.push_back({meshHeader.material, nullptr, static_cast<std::size_t>(meshHeader.vertexCount), nullptr,
+                          static_cast<std::size_t>(meshHeader.indexCount)});
+    }
+
+    for (MeshEntry &mesh : meshes)
+    {
+        valid = valid && reader.readAligned(mesh.vertexCount * sizeof(Vertex), mesh.vertices) &&
+                reader.readAligned(mesh.indexCount * sizeof(GLuint), mesh.indices);
+    }
+
+    if (!valid)
+    {
+        std::cerr << "Invalid baked model '" << path << "' in the asset archive" << std::endl;
+        materials.clear();
+        meshes.clear();
+    }
+    return valid;
+}
+
+void PackedModel::build(std::vector<MeshHandle> &meshHandles, std::vector<GLuint> &materialIndices)
+{
+    // textures of this model by their path, like the assimp path shares them
+    std::unordered_map<std::string, Texture> loadedTextureByPath;
+
+    materialIndices.reserve(materials.size());
+    for (const MaterialEntry &material : materials)
+    {
+        std::vector<Texture> textures;
+        for (const std::pair<std::string, TextureType> &materialTexture : material.textures)
+        {
+            auto loaded = loadedTextureByPath.find(materialTexture.first);
+            if (loaded == loadedTextureByPath.end())
+            {
+                Texture texture;
+                texture.reference =
+                    TextureManager::getInstance().load(baseDir + '/' + materialTexture.first, materialTexture.second);
+                texture.id = texture.reference.getId();
+                texture.path = materialTexture.first;
+                texture.type = materialTexture.second;
+                loaded = loadedTextureByPath.insert({materialTexture.first, texture}).first;
+            }
+            textures.push_back(loaded->second);
+        }
+
+        Material result(material.name, textures);
+        GLuint features = result.parameters.features;
+        result.parameters = material.parameters;
+        result.parameters.features = features;
+
+        // same rule as Material::fromAssimp, the features weren't known when the model was baked
+        if ((features & MATERIAL_EMISSIVE_MAP) && glm::vec3(result.parameters.emissiveColor) == glm::vec3(0.0f))
+        {
+            result.parameters.emissiveColor = glm::vec4(1.0f);
+        }
+
+        materialIndices.push_back(MaterialTable::getInstance().add(result));
+    }
+
+    // copied out of the archive, the pool keeps a CPU copy of every mesh for its levels of detail
+    meshHandles.reserve(meshHandles.size() + meshes.size());
+    for (const MeshEntry &mesh : meshes)
+    {
+        std::vector<Vertex> vertices(mesh.vertexCount);
+        std::vector<GLuint> indices(mesh.indexCount);
+        std::memcpy(vertices.data(), mesh.vertices, mesh.vertexCount * sizeof(Vertex));
+        std::memcpy(indices.data(), mesh.indices, mesh.indexCount * sizeof(GLuint));
+
+        // an index out of range would make the GPU read the vertices of other meshes
+        if (!indices.empty() && *std::max_element(indices.begin(), indices.end()) >= vertices.size())
+        {
+            std::cerr << "Baked mesh with an index out of range in '" << baseDir << "'" << std::endl;
+            continue;
+        }
+
+        meshHandles.push_back(MeshPool::getInstance().create(std::move(vertices), std::move(indices),
+                                                             materialIndices[mesh.material]));
+    }
+    meshes.clear();
+}
+
+std::size_t PackedModel::getVertexCount() const
+{
+    std::size_t count = 0;
+    for (const MeshEntry &mesh : meshes)
+    {
+        count += mesh.vertexCount;
+    }
+    return count;
+}
\ No newline at end of file
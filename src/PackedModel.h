@@ -0,0 +1,77 @@
+#ifndef PACKEDMODEL_H
+#define PACKEDMODEL_H
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <assimp/scene.h>
+
+#include "lib/glad/include/glad/glad.h"
+
+#include "Material.h"
+#include "Mesh.h"
+#include "TextureManager.h"
+
+/**
+ * Model baked into the AssetArchive by the oglr-pack tool (see pack.cxx).
+ * The meshes are stored in the vertex layout of the geometry pool, the materials with their parameters and the
+ * paths of their textures, so loading a baked model copies the meshes out of the archive instead of importing
+ * the model file. The entry is named after the model file plus a suffix, the file itself is archived as well.
+ */
+class PackedModel
+{
+public:
+    /**
+     * Name of the archive entry of a model file (e.g. "objects/sphere/sphere.obj").
+     */
+    static std::string getEntryName(const std::string &modelName);
+
+    /**
+     * Convert an imported scene into the content of an entry, the meshes in the order the ModelPool creates them.
+     * @param textures Paths (relative to the model) and types of the textures the materials use, so they can be
+     * baked as well.
+     * @return False if the scene can't be baked (embedded textures aren't supported).
+     */
+    static bool bake(const aiScene &scene, std::vector<unsigned char> &data,
+                     std::vector<std::pair<std::string, TextureType>> &textures);
+
+    /**
+     * Find and check the entry of a model, without touching OpenGL.
+     * @param path Archive path of the model file (see AssetArchive::makePath).
+     * @return False if the model wasn't baked or the entry is invalid.
+     */
+    bool open(const std::string &path);
+
+    /**
+     * Load the textures, add the materials and upload the meshes, on the thread that owns the OpenGL context.
+     */
+    void build(std::vector<MeshHandle> &meshHandles, std::vector<GLuint> &materialIndices);
+
+    std::size_t getVertexCount() const;
+
+private:
+    struct MaterialEntry
+    {
+        std::string name;
+        MaterialParameters parameters;
+        std::vector<std::pair<std::string, TextureType>> textures;
+    };
+
+    // where the vertices and indices of a mesh are in the entry
+    struct MeshEntry
+    {
+        GLuint material;
+        const unsigned char *vertices;
+        std::size_t vertexCount;
+        const unsigned char *indices;
+        std::size_t indexCount;
+    };
+
+    std::string baseDir;
+    std::vector<MaterialEntry> materials;
+    std::vector<MeshEntry> meshes;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,170 @@
+#include "ProgramCache.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <boost/filesystem.hpp>
+
+#include "DirectoryHelper.h"
+#include "GlExtensions.h"
+
+namespace
+{
+    const char CACHE_MAGIC[4]{'O', 'G', 'P', 'B'};
+
+    // needs to be increased whenever the file layout changes, older entries are ignored then
+    const std::uint32_t CACHE_VERSION{1};
+
+    // guards against reading garbage sizes from broken files
+    const std::uint32_t MAX_BINARY_SIZE{64 * 1024 * 1024};
+
+    struct CacheHeader
+    {
+        char magic[4];
+        std::uint32_t version;
+        std::uint32_t binaryFormat;
+        std::uint32_t size;
+    };
+
+    std::uint64_t hashBytes(const char *data, std::size_t size, std::uint64_t hash)
+    {
+        // FNV-1a
+        for (std::size_t i = 0; i < size; i++)
+        {
+            hash ^= static_cast<unsigned char>(data[i]);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    std::uint64_t hashString(const std::string &string, std::uint64_t hash)
+    {
+        // the terminating zero separates consecutive strings
+        return hashBytes(string.c_str(), string.size() + 1, hash);
+    }
+
+    std::string getDriver()
+    {
+        // binaries are only valid for the driver that created them
+        std::string driver;
+        for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION})
+        {
+            const GLubyte *value = glGetString(name);
+            driver += value ? reinterpret_cast<const char *>(value) : "";
+            driver += '\n';
+        }
+        return driver;
+    }
+
+    std::string getPath(const std::string &key)
+    {
+        return DirectoryHelper::getInstance().locateCache(key + ".program");
+    }
+} // namespace
+
+std::string ProgramCache::makeKey(const std::vector<std::string> &sources)
+{
+    // the driver doesn't change while the application runs
+    static const std::string driver = getDriver();
+
+    std::uint64_t hash = hashString(driver, 14695981039346656037ull);
+    for (const std::string &source : sources)
+    {
+        hash = hashString(source, hash);
+    }
+
+    std::ostringstream key;
+    key << std::hex << std::setw(16) << std::setfill('0') << hash;
+    return key.str();
+}
+
+bool ProgramCache::read(const std::string &key, GLuint program)
+{
+    std::string path = getPath(key);
+    if (path.empty())
+    {
+        return false;
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+
+    CacheHeader header;
+    if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.version != CACHE_VERSION ||
+        header.size == 0 || header.size > MAX_BINARY_SIZE)
+    {
+        return false;
+    }
+
+    std::vector<char> binary(header.size);
+    if (!file.read(binary.data(), binary.size()))
+    {
+        std::cerr << "Program cache entry '" << path << "' is truncated" << std::endl;
+        return false;
+    }
+
+    // drivers may reject binaries of their own at any time, the program is compiled from source then
+    GlExtensions::programBinary(program, header.binaryFormat, binary.data(), binary.size());
+    GLint success = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    return success == GL_TRUE;
+}
+
+void ProgramCache::write(const std::string &key, GLuint program)
+{
+    std::string path = getPath(key);
+    if (path.empty())
+    {
+        return;
+    }
+
+    GLint size = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+    if (size <= 0 || static_cast<std::uint32_t>(size) > MAX_BINARY_SIZE)
+    {
+        return;
+    }
+
+    std::vector<char> binary(size);
+    GLsizei length = 0;
+    GLenum binaryFormat = 0;
+    GlExtensions::getProgramBinary(program, size, &length, &binaryFormat, binary.data());
+    if (length <= 0)
+    {
+        return;
+    }
+
+    CacheHeader header;
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.binaryFormat = binaryFormat;
+    header.size = length;
+
+    // write to a temporary file first, so that a crash never leaves a half written entry behind
+    std::string temporaryPath = path + ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(binary.data(), length);
+
+        if (!file)
+        {
+            std::cerr << "Failed writing program cache entry '" << temporaryPath << "'" << std::endl;
+            return;
+        }
+    }
+
+    boost::system::error_code error;
+    boost::filesystem::rename(temporaryPath, path, error);
+    if (error)
+    {
+        std::cerr << "Failed moving program cache entry to '" << path << "': " << error.message() << std::endl;
+    }
+}
\ No newline at end of file
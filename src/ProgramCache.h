@@ -0,0 +1,37 @@
+#ifndef PROGRAMCACHE_H
+#define PROGRAMCACHE_H
+
+#include <string>
+#include <vector>
+
+#include "lib/glad/include/glad/glad.h"
+
+/**
+ * Stores linked shader programs as driver specific binaries (glGetProgramBinary) in the user cache directory,
+ * so that the shaders only have to be compiled on the first start.
+ * Entries are looked up by a key derived from the final sources (with includes and defines) and the driver,
+ * a driver update makes the old entries unreachable and they are rebuilt from source.
+ * May only be used if GlExtensions::hasProgramBinary is true.
+ */
+namespace ProgramCache
+{
+    /**
+     * Build the key of a program.
+     * @param sources Source of every stage, in the order they're attached.
+     */
+    std::string makeKey(const std::vector<std::string> &sources);
+
+    /**
+     * Load a binary into the program.
+     * @return True if an entry was found and the driver accepted it, the program is linked then.
+     */
+    bool read(const std::string &key, GLuint program);
+
+    /**
+     * Store the binary of a linked program, failures are only logged since the cache is optional.
+     * The program should be linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set.
+     */
+    void write(const std::string &key, GLuint program);
+} // namespace ProgramCache
+
+#endif
\ No newline at end of file
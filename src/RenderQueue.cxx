@@ -0,0 +1,538 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+
+#include "FrameArena.h"
+#include "GeometryPool.h"
+#include "MaterialTable.h"
+
+constexpr float RenderQueue::LOD_SCREEN_SIZES[];
+
+RenderQueue::RenderQueue()
+    : multiDrawIndirect(GlExtensions::hasMultiDrawIndirect())
+{
+    if (multiDrawIndirect)
+    {
+        glGenBuffers(1, &indirectBuffer);
+        glGenBuffers(1, &drawDataBuffer);
+    }
+}
+
+RenderQueue::~RenderQueue()
+{
+    if (multiDrawIndirect)
+    {
+        glDeleteBuffers(1, &indirectBuffer);
+        glDeleteBuffers(1, &drawDataBuffer);
+    }
+}
+
+void RenderQueue::submit(ModelHandle model, const glm::mat4 &modelMatrix)
+{
+    for (MeshHandle handle : ModelPool::getInstance().getMeshes(model))
+    {
+        const Mesh &mesh = MeshPool::getInstance().get(handle);
+        BoundingBox worldBounds = mesh.getBounds().transform(modelMatrix);
+        items.push_back({&mesh, selectLod(handle, mesh, worldBounds), modelMatrix, worldBounds, false});
+    }
+}
+
+void RenderQueue::submit(MeshHandle handle, const glm::mat4 &modelMatrix, const BoundingBox &worldBounds,
+                         bool frustumTested)
+{
+    const Mesh &mesh = MeshPool::getInstance().get(handle);
+    items.push_back({&mesh, selectLod(handle, mesh, worldBounds), modelMatrix, worldBounds, frustumTested});
+}
+
+void RenderQueue::countCulledDraws(std::size_t count)
+{
+    statistics.submittedDraws += count;
+    statistics.culledDraws += count;
+}
+
+void RenderQueue::flush(Shader &shader)
+{
+    flushShader = &shader;
+    flushVariants = nullptr;
+    flushItems();
+}
+
+void RenderQueue::flush(ShaderVariants &variants)
+{
+    flushShader = nullptr;
+    flushVariants = &variants;
+    flushItems();
+}
+
+void RenderQueue::flushItems()
+{
+    if (items.empty())
+    {
+        return;
+    }
+
+    statistics.submittedDraws += items.size();
+
+    bool gpuCullingActive = cullingMode == CullingMode::gpu && isGpuCullingSupported();
+    if ((cullingMode != CullingMode::none || hiZBuffer) && !gpuCullingActive)
+    {
+        cullOnCpu();
+    }
+
+    for (const DrawItem &item : items)
+    {
+        statistics.triangles += item.mesh->getLod(item.lod).indexCount / 3;
+        statistics.drawsPerLod[item.lod]++;
+    }
+
+    if (gpuCullingActive)
+    {
+        flushGpuCulled();
+    }
+    else if (multiDrawIndirect)
+    {
+        flushMultiDrawIndirect();
+    }
+    else
+    {
+        flushSingle();
+    }
+
+    items.clear();
+}
+
+bool RenderQueue::isMultiDrawIndirect() const
+{
+    return multiDrawIndirect;
+}
+
+void RenderQueue::setCamera(const glm::mat4 &viewProjection, const glm::vec3 &position, float fov,
+                            GLuint viewportHeight)
+{
+    frustum = Frustum(viewProjection);
+    cameraPosition = position;
+
+    // radius / (distance * tan(fov / 2)) is the fraction of the viewport height the diameter of a sphere covers
+    lodScale = viewportHeight / std::tan(glm::radians(fov) * 0.5f);
+
+    // a new frame starts, draws are matched to the previous one by the order they are submitted in,
+    // the counts are reset instead of cleared to keep the nodes of the map
+    for (auto &submitCount : submitCounts)
+    {
+        submitCount.second = 0;
+    }
+}
+
+void RenderQueue::setLodEnabled(bool enabled)
+{
+    lodEnabled = enabled;
+}
+
+bool RenderQueue::isLodEnabled() const
+{
+    return lodEnabled;
+}
+
+void RenderQueue::setOcclusionCulling(const HiZBuffer *hiZBuffer)
+{
+    this->hiZBuffer = hiZBuffer;
+}
+
+void RenderQueue::setCullingMode(CullingMode mode)
+{
+    cullingMode = mode;
+
+    // the compute shader is only loaded once it's needed
+    if (cullingMode == CullingMode::gpu && isGpuCullingSupported() && !gpuCulling)
+    {
+        gpuCulling = std::unique_ptr<GpuCulling>(new GpuCulling());
+    }
+}
+
+CullingMode RenderQueue::getCullingMode() const
+{
+    return cullingMode;
+}
+
+bool RenderQueue::isFrustumCulledOnCpu() const
+{
+    return cullingMode == CullingMode::cpu || (cullingMode == CullingMode::gpu && !isGpuCullingSupported());
+}
+
+bool RenderQueue::isGpuCullingSupported() const
+{
+    return multiDrawIndirect && GlExtensions::hasComputeShader();
+}
+
+void RenderQueue::setTextureBindingMode(TextureBindingMode mode)
+{
+    if (!isTextureBindingModeSupported(mode))
+    {
+        mode = TextureBindingMode::perMesh;
+    }
+
+    if (mode == getTextureBindingMode())
+    {
+        return;
+    }
+
+    materialTextures.reset();
+    if (mode != TextureBindingMode::perMesh)
+    {
+        materialTextures = std::unique_ptr<MaterialTextures>(new MaterialTextures(mode));
+    }
+}
+
+void RenderQueue::resetMaterialTextures()
+{
+    if (materialTextures)
+    {
+        TextureBindingMode mode = materialTextures->getMode();
+        materialTextures.reset();
+        materialTextures = std::unique_ptr<MaterialTextures>(new MaterialTextures(mode));
+    }
+}
+
+TextureBindingMode RenderQueue::getTextureBindingMode() const
+{
+    return materialTextures ? materialTextures->getMode() : TextureBindingMode::perMesh;
+}
+
+bool RenderQueue::isTextureBindingModeSupported(TextureBindingMode mode) const
+{
+    switch (mode)
+    {
+    case TextureBindingMode::textureArray:
+        return multiDrawIndirect;
+    case TextureBindingMode::bindless:
+        return multiDrawIndirect && GlExtensions::hasBindlessTexture();
+    default:
+        return true;
+    }
+}
+
+const RenderQueue::Statistics &RenderQueue::getStatistics() const
+{
+    return statistics;
+}
+
+void RenderQueue::resetStatistics()
+{
+    statistics = Statistics();
+}
+
+std::size_t RenderQueue::selectLod(MeshHandle handle, const Mesh &mesh, const BoundingBox &worldBounds)
+{
+    std::size_t lodCount = mesh.getLodCount();
+    if (!lodEnabled || lodCount <= 1)
+    {
+        return 0;
+    }
+
+    // the n-th submission of a mesh in this frame is assumed to be the same object as in the previous frame
+    std::size_t submitIndex = submitCounts[handle]++;
+    std::vector<std::size_t> &meshLods = previousLods[handle];
+    if (meshLods.size() <= submitIndex)
+    {
+        meshLods.resize(submitIndex + 1, 0);
+    }
+    std::size_t &lod = meshLods[submitIndex];
+
+    glm::vec3 center = (worldBounds.min + worldBounds.max) * 0.5f;
+    float radius = glm::length(worldBounds.max - worldBounds.min) * 0.5f;
+    float distance = glm::length(center - cameraPosition);
+    if (distance <= radius)
+    {
+        // the camera is inside the bounds
+        lod = 0;
+        return lod;
+    }
+
+    float screenSize = radius / distance * lodScale;
+
+    // only switch once the size is clearly past a threshold in either direction
+    std::size_t coarserLod = lodForScreenSize(screenSize * (1.0f + LOD_HYSTERESIS), lodCount);
+    std::size_t finerLod = lodForScreenSize(screenSize * (1.0f - LOD_HYSTERESIS), lodCount);
+    if (coarserLod > lod)
+    {
+        lod = coarserLod;
+    }
+    else if (finerLod < lod)
+    {
+        lod = finerLod;
+    }
+
+    return lod;
+}
+
+std::size_t RenderQueue::lodForScreenSize(float screenSize, std::size_t lodCount)
+{
+    std::size_t lod = 0;
+    while (lod + 1 < lodCount && screenSize < LOD_SCREEN_SIZES[lod])
+    {
+        lod++;
+    }
+    return lod;
+}
+
+void RenderQueue::cullOnCpu()
+{
+    bool frustumCulling = cullingMode != CullingMode::none;
+
+    items.erase(std::remove_if(items.begin(), items.end(), [this, frustumCulling](const DrawItem &item) {
+                    if (frustumCulling && !item.frustumTested && !frustum.isVisible(item.worldBounds))
+                    {
+                        statistics.culledDraws++;
+                        return true;
+                    }
+
+                    if (hiZBuffer && hiZBuffer->isOccluded(item.worldBounds, cameraPosition))
+                    {
+                        statistics.occludedDraws++;
+                        return true;
+                    }
+
+                    return false;
+                }),
+                items.end());
+}
+
+void RenderQueue::buildCommands(bool mergeInstances)
+{
+    if (materialTextures)
+    {
+        materialTextures->update();
+    }
+
+    // sort so that draws of the same mesh end up next to each other and can become one instanced command,
+    // the shader variant and the textures are the primary keys so that draws which can share a call form long batches
+    // the keys are computed once per draw into the frame arena, the submission order keeps the sort stable
+    struct SortKey
+    {
+        std::pair<GLuint, std::uint64_t> batch;
+        const Mesh *mesh;
+        std::size_t lod;
+        std::size_t item;
+
+        bool operator<(const SortKey &other) const
+        {
+            return std::tie(batch, mesh, lod, item) < std::tie(other.batch, other.mesh, other.lod, other.item);
+        }
+    };
+
+    FrameVector<SortKey> keys;
+    keys.reserve(items.size());
+    for (std::size_t i = 0; i < items.size(); i++)
+    {
+        keys.push_back({batchKey(items[i].mesh->getMaterialIndex()), items[i].mesh, items[i].lod, i});
+    }
+    std::sort(keys.begin(), keys.end());
+
+    FrameVector<DrawItem> sortedItems;
+    sortedItems.reserve(items.size());
+    for (const SortKey &key : keys)
+    {
+        sortedItems.push_back(items[key.item]);
+    }
+    std::copy(sortedItems.begin(), sortedItems.end(), items.begin());
+
+    commands.clear();
+    drawData.clear();
+    batches.clear();
+
+    const Mesh *previousMesh = nullptr;
+    std::size_t previousLod = 0;
+    for (const DrawItem &item : items)
+    {
+        GLuint materialIndex = item.mesh->getMaterialIndex();
+
+        if (mergeInstances && item.mesh == previousMesh && item.lod == previousLod)
+        {
+            // same mesh and level of detail again, the per draw data is consecutive, so an additional instance is enough
+            commands.back().instanceCount++;
+        }
+        else
+        {
+            const GeometryAllocation &geometry = item.mesh->getGeometry();
+            const MeshLod &lod = item.mesh->getLod(item.lod);
+            DrawElementsIndirectCommand command;
+            command.count = lod.indexCount;
+            command.instanceCount = 1;
+            command.firstIndex = lod.firstIndex;
+            command.baseVertex = geometry.baseVertex;
+            command.baseInstance = drawData.size(); // used to look up the per draw data in the shader
+            commands.push_back(command);
+
+            std::pair<GLuint, std::uint64_t> key = batchKey(materialIndex);
+            if (batches.empty() || batchKey(batches.back().materialIndex) != key)
+            {
+                batches.push_back({key.first, materialIndex, commands.size() - 1, 0});
+            }
+            batches.back().commandCount++;
+
+            previousMesh = item.mesh;
+            previousLod = item.lod;
+        }
+
+        DrawData data;
+        data.modelMatrix = item.modelMatrix;
+        data.materialIndex = materialIndex;
+        drawData.push_back(data);
+    }
+}
+
+void RenderQueue::flushSingle()
+{
+    GeometryPool::getInstance().bind();
+
+    for (const DrawItem &item : items)
+    {
+        const Material &material = MaterialTable::getInstance().get(item.mesh->getMaterialIndex());
+        Shader &shader = shaderForVariant(material.parameters.features);
+        shader.setFloat("model", item.modelMatrix);
+        item.mesh->draw(shader, item.lod);
+    }
+}
+
+void RenderQueue::flushMultiDrawIndirect()
+{
+    if (items.empty())
+    {
+        return;
+    }
+
+    buildCommands(true);
+    uploadDrawData();
+
+    // upload the commands of this frame, orphaning the buffer of the previous frame
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand),
+                 commands.data(), GL_STREAM_DRAW);
+
+    if (materialTextures)
+    {
+        materialTextures->prepare();
+        MaterialTable::getInstance().bindAll();
+    }
+    statistics.batches += batches.size();
+
+    for (const Batch &batch : batches)
+    {
+        Shader &shader = shaderForVariant(batch.variant);
+        bindBatchMaterial(batch, shader);
+        shader.use();
+
+        GlExtensions::multiDrawElementsIndirect(
+            GL_TRIANGLES, GL_UNSIGNED_INT,
+            (void *)(batch.firstCommand * sizeof(DrawElementsIndirectCommand)),
+            batch.commandCount, sizeof(DrawElementsIndirectCommand));
+    }
+}
+
+void RenderQueue::flushGpuCulled()
+{
+    // every draw gets its own command, since visibility is decided per draw
+    buildCommands(false);
+
+    cullItems.resize(items.size());
+    for (std::size_t batchIndex = 0; batchIndex < batches.size(); batchIndex++)
+    {
+        const Batch &batch = batches[batchIndex];
+        for (std::size_t i = batch.firstCommand; i < batch.firstCommand + batch.commandCount; i++)
+        {
+            CullItem &cullItem = cullItems[i];
+            cullItem.boundsMin = glm::vec4(items[i].worldBounds.min, 1.0f);
+            cullItem.boundsMax = glm::vec4(items[i].worldBounds.max, 1.0f);
+            cullItem.command = commands[i];
+            cullItem.batch = batchIndex;
+            cullItem.batchOffset = batch.firstCommand;
+        }
+    }
+
+    gpuCulling->upload(cullItems);
+    // the pyramid is undefined until the first frame with occlusion culling was rendered
+    const HiZBuffer *hiZ = hiZBuffer && hiZBuffer->hasPyramid() ? hiZBuffer : nullptr;
+    gpuCulling->cull(frustum, commands.size(), batches.size(), hiZ, cameraPosition);
+
+    // the culling pass uses the same storage buffer binding points, so the per draw data is bound afterwards
+    uploadDrawData();
+
+    if (materialTextures)
+    {
+        materialTextures->prepare();
+        MaterialTable::getInstance().bindAll();
+    }
+    statistics.batches += batches.size();
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, gpuCulling->getCommandBuffer());
+    if (GlExtensions::hasIndirectCount())
+    {
+        glBindBuffer(GL_PARAMETER_BUFFER_ARB, gpuCulling->getCounterBuffer());
+    }
+
+    for (std::size_t batchIndex = 0; batchIndex < batches.size(); batchIndex++)
+    {
+        const Batch &batch = batches[batchIndex];
+        Shader &shader = shaderForVariant(batch.variant);
+        bindBatchMaterial(batch, shader);
+        shader.use();
+
+        const void *firstCommand = (void *)(batch.firstCommand * sizeof(DrawElementsIndirectCommand));
+        if (GlExtensions::hasIndirectCount())
+        {
+            // only as many draws as the culling pass found visible
+            GlExtensions::multiDrawElementsIndirectCount(
+                GL_TRIANGLES, GL_UNSIGNED_INT, firstCommand, batchIndex * sizeof(GLuint),
+                batch.commandCount, sizeof(DrawElementsIndirectCommand));
+        }
+        else
+        {
+            // culled commands at the end of the batch have no instances and are skipped by the GPU
+            GlExtensions::multiDrawElementsIndirect(
+                GL_TRIANGLES, GL_UNSIGNED_INT, firstCommand,
+                batch.commandCount, sizeof(DrawElementsIndirectCommand));
+        }
+    }
+}
+
+std::pair<GLuint, std::uint64_t> RenderQueue::batchKey(GLuint materialIndex) const
+{
+    // with texture arrays and bindless textures the parameters come from the storage buffer, so only the arrays
+    // split batches, otherwise every material needs its own textures and parameter block bound
+    GLuint variant = MaterialTable::getInstance().get(materialIndex).parameters.features;
+    std::uint64_t textures = materialTextures ? materialTextures->getBatchKey(materialIndex) : materialIndex;
+    return {variant, textures};
+}
+
+Shader &RenderQueue::shaderForVariant(GLuint variant)
+{
+    // variants that are still compiling are drawn with the fallback variant for a few frames
+    return flushVariants ? flushVariants->getReady(variant) : *flushShader;
+}
+
+void RenderQueue::bindBatchMaterial(const Batch &batch, Shader &shader) const
+{
+    if (materialTextures)
+    {
+        materialTextures->bindBatch(batch.materialIndex, shader);
+    }
+    else
+    {
+        MaterialTable::getInstance().bind(batch.materialIndex, shader);
+    }
+}
+
+void RenderQueue::uploadDrawData()
+{
+    // reserving may touch the VAO, so bind it afterwards
+    GeometryPool::getInstance().reserveDrawIds(drawData.size());
+    GeometryPool::getInstance().bind();
+
+    // upload the per draw data of this frame, orphaning the buffer of the previous frame
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, drawDataBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, drawData.size() * sizeof(DrawData),
+                 drawData.data(), GL_STREAM_DRAW);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAW_DATA_BINDING, drawDataBuffer);
+}
\ No newline at end of file
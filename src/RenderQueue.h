@@ -0,0 +1,225 @@
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "lib/glad/include/glad/glad.h"
+
+#include "Culling.h"
+#include "GlExtensions.h"
+#include "GpuCulling.h"
+#include "HiZBuffer.h"
+#include "MaterialTextures.h"
+#include "Mesh.h"
+#include "Model.h"
+#include "Shader.h"
+#include "ShaderVariants.h"
+
+enum class CullingMode
+{
+    none,
+    cpu, // test every draw against the view frustum before submitting it
+    gpu  // let a compute shader write the commands of the visible draws (multi draw indirect path only)
+};
+
+/**
+ * Collects the meshes that should be drawn with one shader and submits them in one go.
+ * If the context supports it (OpenGL 4.3), all draws that use the same material are submitted
+ * with a single glMultiDrawElementsIndirect call, otherwise every mesh is drawn on its own.
+ * With texture arrays or bindless textures (see TextureBindingMode) draws with different textures
+ * can share a call as well.
+ */
+class RenderQueue
+{
+public:
+    struct Statistics
+    {
+        std::size_t submittedDraws{0};
+        std::size_t culledDraws{0};   // only counted when culling on the CPU
+        std::size_t occludedDraws{0}; // only counted when culling on the CPU
+        std::size_t triangles{0};     // with GPU culling this includes the triangles of draws culled on the GPU
+        std::size_t drawsPerLod[Mesh::MAX_LOD_COUNT]{};
+        std::size_t batches{0};       // multi draw indirect calls, each one binds the textures it needs once
+    };
+
+    RenderQueue();
+    virtual ~RenderQueue();
+
+    /**
+     * Queue all meshes of a model.
+     */
+    void submit(ModelHandle model, const glm::mat4 &modelMatrix);
+
+    /**
+     * Queue a mesh whose world bounds were computed elsewhere (e.g. by the FramePipeline).
+     * @param frustumTested Whether the bounds were tested against the view frustum already, the queue doesn't
+     * test them again then.
+     */
+    void submit(MeshHandle mesh, const glm::mat4 &modelMatrix, const BoundingBox &worldBounds, bool frustumTested);
+
+    /**
+     * Count draws that were frustum culled before they were submitted, so the statistics include them.
+     */
+    void countCulledDraws(std::size_t count);
+
+    /**
+     * Draw everything that was queued with the given shader and empty the queue.
+     * The shader needs to match the draw path, see isMultiDrawIndirect.
+     */
+    void flush(Shader &shader);
+
+    /**
+     * Draw everything that was queued, every batch with the variant for the features of its materials
+     * (see MaterialFeature), and empty the queue.
+     */
+    void flush(ShaderVariants &variants);
+
+    /**
+     * Whether queued meshes are drawn through the multi draw indirect path.
+     * Shaders used with this queue need to read their model matrix from the per draw buffer in that case.
+     */
+    bool isMultiDrawIndirect() const;
+
+    /**
+     * Set the camera used for culling and level of detail selection, needs to be updated at the start of every frame.
+     * @param fov Vertical field of view in degrees.
+     * @param viewportHeight Height of the viewport in pixels.
+     */
+    void setCamera(const glm::mat4 &viewProjection, const glm::vec3 &position, float fov, GLuint viewportHeight);
+
+    /**
+     * Choose the level of detail of every draw by the size of its bounds on screen.
+     * If disabled, the full meshes are drawn.
+     */
+    void setLodEnabled(bool enabled);
+    bool isLodEnabled() const;
+
+    /**
+     * Choose how draws are culled, GPU culling falls back to CPU culling if it isn't supported.
+     */
+    void setCullingMode(CullingMode mode);
+    CullingMode getCullingMode() const;
+    bool isGpuCullingSupported() const;
+
+    /**
+     * Whether draws are tested against the view frustum on the CPU, which can be done before they are submitted.
+     */
+    bool isFrustumCulledOnCpu() const;
+
+    /**
+     * Additionally skip draws that are hidden according to the depth pyramid of the previous frame.
+     * Applies in every culling mode, pass null to turn occlusion culling off.
+     */
+    void setOcclusionCulling(const HiZBuffer *hiZBuffer);
+
+    /**
+     * Choose how the textures of the draws are made available to the shader.
+     * Texture arrays and bindless textures need the multi draw indirect path and a shader based on
+     * 07_materialTextures, unsupported modes fall back to binding the textures per mesh.
+     */
+    void setTextureBindingMode(TextureBindingMode mode);
+    TextureBindingMode getTextureBindingMode() const;
+    bool isTextureBindingModeSupported(TextureBindingMode mode) const;
+
+    /**
+     * Build the texture arrays or handles again, needed when textures of the MaterialTable were replaced.
+     */
+    void resetMaterialTextures();
+
+    const Statistics &getStatistics() const;
+    void resetStatistics();
+
+    // remove copy functions, the queue owns buffer objects
+    RenderQueue(RenderQueue const &) = delete;
+    void operator=(RenderQueue const &) = delete;
+
+private:
+    struct DrawItem
+    {
+        const Mesh *mesh; // looked up once on submit, the pool doesn't change until the queue is flushed
+        std::size_t lod;
+        glm::mat4 modelMatrix;
+        BoundingBox worldBounds;
+        bool frustumTested;
+    };
+
+    // per draw data as seen by the shader (std430 layout)
+    struct DrawData
+    {
+        glm::mat4 modelMatrix;
+        GLuint materialIndex;
+        GLuint padding[3];
+    };
+
+    // a run of commands that can be submitted with the same shader variant and without binding
+    // different textures or materials in between
+    struct Batch
+    {
+        GLuint variant; // features of the materials, see MaterialFeature
+        GLuint materialIndex;
+        std::size_t firstCommand;
+        std::size_t commandCount;
+    };
+
+    // binding point of the per draw data buffer
+    static constexpr GLuint DRAW_DATA_BINDING{0};
+
+    // projected diameter in pixels the bounds of a draw have to go below to switch to the next coarser level
+    static constexpr float LOD_SCREEN_SIZES[Mesh::MAX_LOD_COUNT - 1]{320.0f, 160.0f, 64.0f};
+
+    // relative size change needed to switch the level of a draw again, avoids popping back and forth at a threshold
+    static constexpr float LOD_HYSTERESIS{0.15f};
+
+    bool multiDrawIndirect;
+    CullingMode cullingMode{CullingMode::none};
+    Frustum frustum;
+    glm::vec3 cameraPosition;
+    float lodScale{0.0f};
+    bool lodEnabled{true};
+
+    // level of detail every draw had in the previous frame, by mesh and the order the mesh was submitted in
+    std::unordered_map<MeshHandle, std::vector<std::size_t>, HandleHash<MeshTag>> previousLods;
+    std::unordered_map<MeshHandle, std::size_t, HandleHash<MeshTag>> submitCounts;
+    const HiZBuffer *hiZBuffer{nullptr};
+    Statistics statistics;
+
+    std::vector<DrawItem> items;
+
+    // what the current flush draws with, either one shader for everything or a variant per batch
+    Shader *flushShader{nullptr};
+    ShaderVariants *flushVariants{nullptr};
+
+    // only used by the multi draw indirect path
+    GLuint indirectBuffer{0};
+    GLuint drawDataBuffer{0};
+    std::vector<DrawElementsIndirectCommand> commands;
+    std::vector<DrawData> drawData;
+    std::vector<Batch> batches;
+    std::vector<CullItem> cullItems;
+    std::unique_ptr<GpuCulling> gpuCulling;
+
+    // only exists for texture arrays and bindless textures, per mesh binding doesn't need a material buffer
+    std::unique_ptr<MaterialTextures> materialTextures;
+
+    std::size_t selectLod(MeshHandle handle, const Mesh &mesh, const BoundingBox &worldBounds);
+    static std::size_t lodForScreenSize(float screenSize, std::size_t lodCount);
+    void cullOnCpu();
+    void buildCommands(bool mergeInstances);
+    /**
+     * Draws with the same key can be in one batch, the first part is the shader variant.
+     */
+    std::pair<GLuint, std::uint64_t> batchKey(GLuint materialIndex) const;
+    void bindBatchMaterial(const Batch &batch, Shader &shader) const;
+    Shader &shaderForVariant(GLuint variant);
+    void flushItems();
+    void flushSingle();
+    void flushMultiDrawIndirect();
+    void flushGpuCulled();
+    void uploadDrawData();
+};
+
+#endif
\ No newline at end of file
@@ -2,15 +2,18 @@
 
 #define GLFW_INCLUDE_NONE // Hinder GLFW from including gl headers, since glad does that for us
 
+#include <array>
+#include <chrono>
+#include <future>
 #include <memory>
 #include <string>
-#include <unordered_map>
 #include <vector>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <GLFW/glfw3.h>
+#include <boost/filesystem.hpp>
 
 #include "lib/glad/include/glad/glad.h"
 
@@ -19,10 +22,23 @@
 #include "lib/imgui/imgui_impl_glfw.h"
 #include "lib/imgui/imgui_impl_opengl3.h"
 
+#include "AllocationTracker.h"
+#include "AssetArchive.h"
 #include "Camera.h"
 #include "DirectoryHelper.h"
+#include "FileWatcher.h"
+#include "FrameArena.h"
+#include "FramePipeline.h"
+#include "GlExtensions.h"
+#include "HiZBuffer.h"
+#include "JobSystem.h"
+#include "MaterialTable.h"
 #include "Model.h"
+#include "RenderQueue.h"
 #include "Shader.h"
+#include "ShaderVariants.h"
+#include "TextureManager.h"
+#include "VirtualTextureSystem.h"
 
 namespace
 {
@@ -30,6 +46,9 @@ namespace
     const GLuint DEFAULT_WIDTH{1280};
     const GLuint DEFAULT_HEIGHT{720};
 
+    // the virtual texture uses the units after the ones of the material textures
+    const GLuint VIRTUAL_TEXTURE_UNIT{8};
+
     // reusable identity transformation matrix
     const glm::mat4 identityMatrix(1.0);
 
@@ -43,11 +62,6 @@ namespace
     } imguiState;
 
     // shader uniforms state
-    struct
-    {
-        float shininess{32.0f};
-    } material;
-
     struct
     {
         glm::vec3 direction;                           // direction of light in view space (calculated every frame)
@@ -90,37 +104,197 @@ namespace
     float deltaTime{0.0f};
     float lastFrame{0.0f};
 
-    // this map will store the state for each key being pressed on the keyboard
+    // this array will store the state for each key being pressed on the keyboard, indexed by the GLFW key code
     // TODO: Replace this with a more flexible keyboard/input handling class at some point
-    std::unordered_map<int, bool> keyStates;
-
-    // variables for transformation matrices to convert between the different coordinate spaces
-    glm::mat4 model;      // from local to world space
-    glm::mat4 view;       // from world to view space
-    glm::mat4 projection; // from view to clip space
+    std::array<bool, GLFW_KEY_LAST + 1> keyStates{};
 
     std::unique_ptr<Camera> camera;
-    std::unique_ptr<Shader> lightingShader;
+    std::unique_ptr<ShaderVariants> lightingShader;
     std::unique_ptr<Shader> lightSourceShader;
+    std::unique_ptr<Shader> virtualTextureFeedbackShader;
 
     std::vector<glm::vec3> pointLightPositions;
 
-    std::unique_ptr<Model> sphere;
-    std::unique_ptr<Model> backpack;
+    ModelHandle sphere;
+    ModelHandle backpack;
+
+    // backpacks per side of the grid they're placed in, to test larger scenes
+    int backpackGridSize{1};
+    const float BACKPACK_SPACING{4.0f};
+
+    // the camera matrices, the lights in view space and the culling of a frame are recorded on the job system,
+    // by default while the previous frame is drawn
+    std::unique_ptr<FramePipeline> framePipeline;
+    bool pipelinedFrames{true};
+    FrameInput frameInput;
+    std::uint64_t frameCounter{0};
+    double recordMilliseconds{0.0};
+
+    std::unique_ptr<RenderQueue> renderQueue;
+    std::unique_ptr<HiZBuffer> hiZBuffer; // only exists while occlusion culling is enabled
+    std::vector<CullingBenchmark::Result> cullingBenchmarkResults;
+    std::vector<JobBenchmark::Result> jobBenchmarkResults;
+    std::vector<LoaderBenchmark::Result> loaderBenchmarkResults;
+    std::array<char, 1024> loaderBenchmarkPath{}; // additional file to benchmark, e.g. a large glTF or OBJ model
+
+    // only exists while virtual texturing is enabled, the backpack's diffuse map is streamed through it then
+    std::unique_ptr<VirtualTextureSystem> virtualTextures;
+    int backpackVirtualTexture{-1};
+
+    // hot reload, models are imported on worker threads and swapped in once they're done
+    struct ModelReload
+    {
+        ModelHandle *model;
+        std::string path;
+        std::future<ModelPool::PreparedModel> prepared;
+    };
+
+    std::unique_ptr<FileWatcher> fileWatcher;
+    std::vector<ModelReload> modelReloads;
 
     // prototypes
+    void initAssets();
     int initGlfw();
     int initGlad();
     void initGl();
     void initImgui();
     void initScene();
+    void createLightingShader();
+    void prepareLightingShader();
+    void initHotReload();
+    void reloadModel(const std::string &path);
+    void updateHotReload();
 
     void moveCamera();
-    void drawScene();
+    const FrameInput &captureFrameInput();
+    void drawScene(const FrameCommands &commands);
+    void drawVirtualTextureFeedback(const FrameCommands &commands);
+    void submitPass(const FrameCommands &commands, RenderPass pass);
     void drawImgui();
+    void drawPipelineImgui();
+    void drawJobImgui();
+    void drawLoaderImgui();
+    void drawCullingImgui();
+    void drawTextureImgui();
+    void drawMaterialImgui();
+    void setVirtualTexturing(bool enabled);
+
+    void drawTextureImgui()
+    {
+        if (!ImGui::CollapsingHeader("Textures"))
+        {
+            return;
+        }
+
+        TextureManager &textureManager = TextureManager::getInstance();
+        const float megabyte = 1024.0f * 1024.0f;
+
+        ImGui::Text("Textures loaded: %d", static_cast<int>(textureManager.getTextureCount()));
+        ImGui::Text("Video memory: %.1f MB (%.1f MB unreferenced)", textureManager.getUsedBytes() / megabyte,
+                    textureManager.getUnusedBytes() / megabyte);
+
+        int budget = static_cast<int>(textureManager.getBudget() / (1024 * 1024));
+        if (ImGui::SliderInt("Budget (MB)##Textures", &budget, 0, 4096))
+        {
+            textureManager.setBudget(static_cast<std::size_t>(budget) * 1024 * 1024);
+        }
+
+        // the lighting shader depends on how the textures are bound, so it's built again on a change
+        int bindingMode = static_cast<int>(renderQueue->getTextureBindingMode());
+        bool changed =
+            ImGui::RadioButton("Per mesh##Textures", &bindingMode, static_cast<int>(TextureBindingMode::perMesh));
+        if (renderQueue->isTextureBindingModeSupported(TextureBindingMode::textureArray))
+        {
+            ImGui::SameLine();
+            changed |= ImGui::RadioButton("Texture arrays##Textures", &bindingMode,
+                                          static_cast<int>(TextureBindingMode::textureArray));
+        }
+        if (renderQueue->isTextureBindingModeSupported(TextureBindingMode::bindless))
+        {
+            ImGui::SameLine();
+            changed |= ImGui::RadioButton("Bindless##Textures", &bindingMode,
+                                          static_cast<int>(TextureBindingMode::bindless));
+        }
+
+        if (changed)
+        {
+            renderQueue->setTextureBindingMode(static_cast<TextureBindingMode>(bindingMode));
+            createLightingShader();
+        }
+        ImGui::Text("Batches: %d", static_cast<int>(renderQueue->getStatistics().batches));
+
+        // only the per mesh lighting shader samples the virtual texture
+        bool virtualTexturing = virtualTextures != nullptr;
+        if (ImGui::Checkbox("Virtual texturing (backpack diffuse)##Textures", &virtualTexturing))
+        {
+            setVirtualTexturing(virtualTexturing);
+        }
+
+        if (virtualTextures)
+        {
+            const VirtualTextureStatistics &statistics = virtualTextures->getStatistics();
+            ImGui::Text("Resident pages: %d / %d", static_cast<int>(statistics.residentPages),
+                        static_cast<int>(statistics.cachePages));
+            ImGui::Text("Pending pages: %d", static_cast<int>(statistics.pendingPages));
+            ImGui::Text("Pages uploaded / evicted: %d / %d", static_cast<int>(statistics.uploadedPages),
+                        static_cast<int>(statistics.evictedPages));
+        }
+    }
+
+    void drawMaterialImgui()
+    {
+        MaterialTable &materialTable = MaterialTable::getInstance();
+        ImGui::Text("Materials: %d", static_cast<int>(materialTable.getCount()));
+        ImGui::Text("Lighting shader variants: %d (%d pending)", static_cast<int>(lightingShader->getVariantCount()),
+                    static_cast<int>(lightingShader->getPendingCount()));
+
+        // the parameters of every material, changes apply to all meshes using it
+        for (std::size_t i = 0; i < materialTable.getCount(); i++)
+        {
+            if (!materialTable.isUsed(i))
+            {
+                continue;
+            }
+
+            const Material &material = materialTable.get(i);
+            MaterialParameters parameters = material.parameters;
+            std::string id = "##Material" + std::to_string(i);
+
+            ImGui::Text("%s", material.name.empty() ? "(unnamed)" : material.name.c_str());
+            bool changed = ImGui::SliderFloat(("Shininess" + id).c_str(), &parameters.shininess, 1.0f, 256.0f,
+                                              NULL, ImGuiSliderFlags_Logarithmic);
+            changed |= ImGui::ColorEdit3(("Diffuse color" + id).c_str(), glm::value_ptr(parameters.diffuseColor));
+            changed |= ImGui::ColorEdit3(("Specular color" + id).c_str(), glm::value_ptr(parameters.specularColor));
+            changed |= ImGui::ColorEdit3(("Emissive color" + id).c_str(), glm::value_ptr(parameters.emissiveColor));
+            if (changed)
+            {
+                materialTable.setParameters(i, parameters);
+            }
+        }
+    }
+
+    void setVirtualTexturing(bool enabled)
+    {
+        virtualTextures.reset();
+        backpackVirtualTexture = -1;
+
+        if (enabled)
+        {
+            virtualTextures = std::unique_ptr<VirtualTextureSystem>(new VirtualTextureSystem(curWidth, curHeight));
+            backpackVirtualTexture = virtualTextures->addTexture(
+                DirectoryHelper::getInstance().locateData("objects/backpack/diffuse.jpg"));
+            if (backpackVirtualTexture < 0)
+            {
+                virtualTextures.reset();
+            }
+        }
+
+        // only the per mesh lighting shader has a variant that samples the virtual texture
+        createLightingShader();
+    }
 
     template <class T>
-    void updatePointLightAttribute(std::string attribute, T &value);
+    void updatePointLightAttribute(const char *attribute, T &value);
 
     void framebufferSizeCallback(GLFWwindow *window, int width, int height);
     void mouseCallback(GLFWwindow *window, double xPos, double yPos);
@@ -128,6 +302,17 @@ namespace
     void keyboardCallback(GLFWwindow *window, int key, int scancode, int action, int mods);
     void errorCallback(int error, const char *description);
 
+    void initAssets()
+    {
+        // a baked archive replaces probing the data directories for every file, it's mapped once
+        std::string archivePath = DirectoryHelper::getInstance().locateData(AssetArchive::getFileName());
+        if (!archivePath.empty() && AssetArchive::getInstance().open(archivePath))
+        {
+            std::cout << "Using the asset archive '" << archivePath << "' with "
+                      << AssetArchive::getInstance().getEntryCount() << " entries" << std::endl;
+        }
+    }
+
     int initGlfw()
     {
         glfwSetErrorCallback(errorCallback);
@@ -149,6 +334,10 @@ namespace
         }
         glfwMakeContextCurrent(window);
 
+        // the job system takes the thread that creates it as the render thread
+        JobSystem::getInstance();
+        AllocationTracker::setFrameThread(true);
+
         glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
 
         glfwSetCursorPosCallback(window, mouseCallback);
@@ -168,6 +357,9 @@ namespace
             std::cerr << "Failed to initialize GLAD" << std::endl;
             return Renderer::INIT_FAIL_GLAD;
         }
+
+        // detect optional features of newer OpenGL versions
+        GlExtensions::init((GLADloadproc)glfwGetProcAddress);
         return 0;
     }
 
@@ -201,24 +393,42 @@ namespace
         ImGui_ImplOpenGL3_Init("#version 330");
     }
 
-    void initScene()
+    void createLightingShader()
     {
         DirectoryHelper &directoryHelper = DirectoryHelper::getInstance();
 
-        // clang-format off
-        pointLightPositions = {
-            glm::vec3( 0.7f,  0.2f,  2.0f),
-            glm::vec3( 2.3f, -3.3f, -4.0f),
-            glm::vec3(-4.0f,  2.0f, -12.0f),
-            glm::vec3( 0.0f,  0.0f, -3.0f)
-        };
-        // clang-format on
+        // the variants only differ in the features of the materials, the rest of the defines is shared
+        std::vector<std::string> defines{"NUM_POINT_LIGHTS " + std::to_string(pointLightPositions.size())};
+        std::string vertexShader;
+        std::string fragmentShader;
 
-        // configure shader programs
-        lightingShader = std::unique_ptr<Shader>(new Shader(
-            directoryHelper.locateData("shaders/06_normalTexCoord.vert"),
-            directoryHelper.locateData("shaders/06_multipleLights.frag")));
-        lightingShader->setFloat("material.shininess", material.shininess);
+        // texture arrays and bindless textures take the textures of every draw from the material buffer
+        switch (renderQueue->getTextureBindingMode())
+        {
+        case TextureBindingMode::textureArray:
+        case TextureBindingMode::bindless:
+            vertexShader = "shaders/07_materialTextures.vert";
+            fragmentShader = "shaders/07_lightingMaterialBuffer.frag";
+            defines.push_back(renderQueue->getTextureBindingMode() == TextureBindingMode::textureArray
+                                  ? "TEXTURE_ARRAYS"
+                                  : "BINDLESS_TEXTURES");
+            break;
+        default:
+            vertexShader = renderQueue->isMultiDrawIndirect() ? "shaders/07_multiDrawIndirect.vert"
+                                                              : "shaders/06_normalTexCoord.vert";
+            fragmentShader = "shaders/07_lighting.frag";
+            if (virtualTextures)
+            {
+                defines.push_back("VIRTUAL_TEXTURE");
+            }
+            break;
+        }
+
+        lightingShader = std::unique_ptr<ShaderVariants>(new ShaderVariants(
+            directoryHelper.locateData(vertexShader), directoryHelper.locateData(fragmentShader),
+            Material::getFeatureDefines(), defines));
+
+        MaterialTable::getInstance().setupShader(*lightingShader);
 
         // directional light
         lightingShader->setFloat("directionalLight.ambient", directionalLight.ambient);
@@ -231,12 +441,12 @@ namespace
             std::ostringstream pointLightIdentifier;
             pointLightIdentifier << "pointLights[" << i << "]";
             std::string pointLightIdentifierStr = pointLightIdentifier.str();
-            lightingShader->setFloat(pointLightIdentifierStr + ".ambient", pointLight.ambient);
-            lightingShader->setFloat(pointLightIdentifierStr + ".diffuse", pointLight.diffuse);
-            lightingShader->setFloat(pointLightIdentifierStr + ".specular", pointLight.specular);
-            lightingShader->setFloat(pointLightIdentifierStr + ".constant", pointLight.constant);
-            lightingShader->setFloat(pointLightIdentifierStr + ".linear", pointLight.linear);
-            lightingShader->setFloat(pointLightIdentifierStr + ".quadratic", pointLight.quadratic);
+            lightingShader->setFloat((pointLightIdentifierStr + ".ambient").c_str(), pointLight.ambient);
+            lightingShader->setFloat((pointLightIdentifierStr + ".diffuse").c_str(), pointLight.diffuse);
+            lightingShader->setFloat((pointLightIdentifierStr + ".specular").c_str(), pointLight.specular);
+            lightingShader->setFloat((pointLightIdentifierStr + ".constant").c_str(), pointLight.constant);
+            lightingShader->setFloat((pointLightIdentifierStr + ".linear").c_str(), pointLight.linear);
+            lightingShader->setFloat((pointLightIdentifierStr + ".quadratic").c_str(), pointLight.quadratic);
         }
 
         // spotlight
@@ -252,11 +462,57 @@ namespace
         lightingShader->setFloat("spotLight.cutOff", spotLight.cutOff);
         lightingShader->setFloat("spotLight.outerCutOff", spotLight.outerCutOff);
 
+        prepareLightingShader();
+    }
+
+    void prepareLightingShader()
+    {
+        // start compiling the variants of all known materials, they're drawn with the fallback until they're done
+        lightingShader->prepare(0);
+        MaterialTable &materialTable = MaterialTable::getInstance();
+        for (std::size_t i = 0; i < materialTable.getCount(); i++)
+        {
+            if (materialTable.isUsed(i))
+            {
+                lightingShader->prepare(materialTable.get(i).parameters.features);
+            }
+        }
+    }
+
+    void initScene()
+    {
+        DirectoryHelper &directoryHelper = DirectoryHelper::getInstance();
+
+        // clang-format off
+        pointLightPositions = {
+            glm::vec3( 0.7f,  0.2f,  2.0f),
+            glm::vec3( 2.3f, -3.3f, -4.0f),
+            glm::vec3(-4.0f,  2.0f, -12.0f),
+            glm::vec3( 0.0f,  0.0f, -3.0f)
+        };
+        // clang-format on
+
+        // the render queue decides whether draws are submitted indirectly,
+        // in which case the vertex shaders need to fetch their model matrix from the per draw data
+        renderQueue = std::unique_ptr<RenderQueue>(new RenderQueue());
+        std::string objectVertexShader = renderQueue->isMultiDrawIndirect()
+                                             ? "shaders/07_multiDrawIndirect.vert"
+                                             : "shaders/06_normalTexCoord.vert";
+        std::string lightSourceVertexShader = renderQueue->isMultiDrawIndirect()
+                                                  ? "shaders/07_multiDrawIndirect.vert"
+                                                  : "shaders/04_normalCorrected.vert";
+
+        // configure shader programs
+        createLightingShader();
+
+        virtualTextureFeedbackShader = std::unique_ptr<Shader>(new Shader(
+            directoryHelper.locateData(objectVertexShader),
+            directoryHelper.locateData("shaders/07_virtualTextureFeedback.frag")));
+
         // shader for the light source objects
         lightSourceShader = std::unique_ptr<Shader>(new Shader(
-            DirectoryHelper::getInstance().locateData("shaders/04_normalCorrected.vert"),
+            DirectoryHelper::getInstance().locateData(lightSourceVertexShader),
             DirectoryHelper::getInstance().locateData("shaders/04_color.frag")));
-        lightSourceShader->setFloat("iColor", pointLight.objectColor);
 
         // camera slightly off to the side and looking down from above
         camera = std::unique_ptr<Camera>(new Camera(
@@ -265,10 +521,107 @@ namespace
             -10.0f,
             -100.0f));
 
-        backpack = std::unique_ptr<Model>(
-            new Model(directoryHelper.locateData("objects/backpack/backpack.obj")));
-        sphere = std::unique_ptr<Model>(
-            new Model(directoryHelper.locateData("objects/sphere/sphere.obj")));
+        ModelPool &modelPool = ModelPool::getInstance();
+        backpack = modelPool.load(directoryHelper.locateData("objects/backpack/backpack.obj"));
+        sphere = modelPool.load(directoryHelper.locateData("objects/sphere/sphere.obj"));
+
+        // the shaders were compiling while the models loaded, setting uniforms waits for them
+        prepareLightingShader();
+        lightSourceShader->setFloat("iColor", pointLight.objectColor);
+
+        framePipeline = std::unique_ptr<FramePipeline>(new FramePipeline());
+    }
+
+    void initHotReload()
+    {
+        // the archive doesn't change while it's open, the files it was baked from aren't used
+        if (AssetArchive::getInstance().isOpen())
+        {
+            return;
+        }
+
+        DirectoryHelper &directoryHelper = DirectoryHelper::getInstance();
+        fileWatcher = std::unique_ptr<FileWatcher>(new FileWatcher());
+
+        // every program that was built from a changed file is rebuilt, includes too
+        for (const char *directory : {"shaders", "shaders/include"})
+        {
+            fileWatcher->watch(directoryHelper.locateData(directory), Shader::reloadChanged);
+        }
+
+        // the models keep their textures next to them
+        for (const char *directory : {"objects/backpack", "objects/sphere"})
+        {
+            fileWatcher->watch(directoryHelper.locateData(directory), [](const std::string &path) {
+                TextureManager::getInstance().reloadChanged(path);
+                reloadModel(path);
+            });
+        }
+    }
+
+    void reloadModel(const std::string &path)
+    {
+        for (ModelHandle *model : {&backpack, &sphere})
+        {
+            boost::system::error_code error;
+            std::string modelPath = ModelPool::getInstance().getPath(*model);
+            if (boost::filesystem::canonical(modelPath, error).string() != path || error)
+            {
+                continue;
+            }
+
+            // reading the file is the slow part, building the meshes needs the OpenGL context
+            std::cout << "Reloading model " << path << std::endl;
+            ModelReload reload;
+            reload.model = model;
+            reload.path = path;
+            reload.prepared = std::async(std::launch::async, ModelPool::prepare, path);
+            modelReloads.push_back(std::move(reload));
+        }
+    }
+
+    void updateHotReload()
+    {
+        // nothing is watched while the asset archive is used
+        if (!fileWatcher)
+        {
+            return;
+        }
+
+        fileWatcher->poll();
+
+        // textures are swapped in place, everything that copied their ids needs to follow
+        std::vector<std::pair<GLuint, GLuint>> replaced = TextureManager::getInstance().finishReloads();
+        if (!replaced.empty())
+        {
+            MaterialTable::getInstance().replaceTextures(replaced);
+            renderQueue->resetMaterialTextures();
+        }
+
+        for (auto reload = modelReloads.begin(); reload != modelReloads.end();)
+        {
+            if (reload->prepared.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            {
+                reload++;
+                continue;
+            }
+
+            // the frame that's being recorded still refers to the meshes of the old model
+            framePipeline->discard();
+
+            // a model that fails to import keeps the previous version, the old one is destroyed after the new one
+            // was built so the materials and textures that didn't change are shared instead of loaded again
+            ModelPool::PreparedModel prepared = reload->prepared.get();
+            ModelPool &modelPool = ModelPool::getInstance();
+            ModelHandle model = modelPool.create(reload->path, prepared);
+            if (modelPool.isValid(model))
+            {
+                modelPool.destroy(*reload->model);
+                *reload->model = model;
+                prepareLightingShader();
+            }
+            reload = modelReloads.erase(reload);
+        }
     }
 
     void moveCamera()
@@ -294,55 +647,139 @@ namespace
         }
     }
 
-    void drawScene()
+    const FrameInput &captureFrameInput()
     {
+        // kept between frames, so the vectors keep their memory
+        FrameInput &input = frameInput;
+        input.instances.clear();
+        input.frame = frameCounter++;
+
+        input.view = camera->calculateView();
+        input.cameraPosition = camera->getPosition();
+        input.fov = camera->getFov();
+        input.width = curWidth;
+        input.height = curHeight;
+
+        input.directionalLightDirection = directionalLight.worldDirection;
+        input.pointLightPositions = pointLightPositions;
+        input.frustumCulling = renderQueue->isFrustumCulledOnCpu();
+
+        // backpacks in a grid centered on the origin, the virtual texture feedback needs all of them as well
+        float gridOffset = (backpackGridSize - 1) * BACKPACK_SPACING * 0.5f;
+        for (RenderPass pass : {RenderPass::virtualTextureFeedback, RenderPass::lighting})
+        {
+            if (pass == RenderPass::virtualTextureFeedback && !virtualTextures)
+            {
+                continue;
+            }
+
+            for (int x = 0; x < backpackGridSize; x++)
+            {
+                for (int z = 0; z < backpackGridSize; z++)
+                {
+                    glm::vec3 position(x * BACKPACK_SPACING - gridOffset, 0.0f, -z * BACKPACK_SPACING + gridOffset);
+                    input.instances.push_back({backpack, glm::translate(identityMatrix, position), pass});
+                }
+            }
+        }
+
+        // light sources
+        for (const glm::vec3 &pointLightPosition : pointLightPositions)
+        {
+            glm::mat4 model = glm::translate(identityMatrix, pointLightPosition);
+            model = glm::scale(model, glm::vec3(0.2f));
+            input.instances.push_back({sphere, model, RenderPass::lightSources});
+        }
+
+        return input;
+    }
+
+    void drawScene(const FrameCommands &commands)
+    {
+        recordMilliseconds = commands.recordMilliseconds;
+        glm::mat4 viewProjection = commands.projection * commands.view;
+        renderQueue->setCamera(viewProjection, commands.cameraPosition, commands.fov, commands.height);
+
+        if (virtualTextures)
+        {
+            drawVirtualTextureFeedback(commands);
+        }
+        renderQueue->resetStatistics();
+        renderQueue->countCulledDraws(commands.culledDraws);
+
+        // occlusion culling needs the depth of the scene, so it's rendered offscreen
+        if (hiZBuffer)
+        {
+            hiZBuffer->bindSceneFramebuffer();
+        }
+
         // render background
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        // calculate new view and projection
-        view = camera->calculateView();
-        projection = glm::perspective(glm::radians(camera->getFov()), (GLfloat)curWidth / (GLfloat)curHeight, 0.1f, 100.0f);
-
         // update object shader
-        lightingShader->use();
-        lightingShader->setFloat("view", view);
-        lightingShader->setFloat("projection", projection);
-
-        // move emission texture based on time for a cool effect 😎
-        lightingShader->setFloat("material.emissionVerticalOffset", -glfwGetTime() / 5.0);
+        lightingShader->setFloat("view", commands.view);
+        lightingShader->setFloat("projection", commands.projection);
 
-        // calculate the direction of the directional light in view space
-        directionalLight.direction =
-            glm::normalize(glm::vec3(view * glm::vec4(directionalLight.worldDirection, 0.0)));
+        // the lights were transformed into view space while recording
+        directionalLight.direction = commands.directionalLightDirection;
         lightingShader->setFloat("directionalLight.direction", directionalLight.direction);
-
-        // calculate the view positions of the point lights
-        for (std::size_t i = 0; i < pointLightPositions.size(); i++)
+        for (std::size_t i = 0; i < commands.pointLightPositions.size(); i++)
         {
-            std::ostringstream pointLightIdentifier;
-            pointLightIdentifier << "pointLights[" << i << "].position";
-            glm::vec3 viewPosition = glm::vec3(view * glm::vec4(pointLightPositions[i], 1.0));
-            lightingShader->setFloat(pointLightIdentifier.str(), viewPosition);
+            FrameString identifier("pointLights[");
+            appendNumber(identifier, i);
+            identifier += "].position";
+            lightingShader->setFloat(identifier.c_str(), commands.pointLightPositions[i]);
         }
 
-        // draw backpack
-        model = glm::translate(identityMatrix, glm::vec3(0.0f, 0.0f, 0.0f));
-        model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));
-        lightingShader->setFloat("model", model);
-        backpack->draw(*lightingShader);
+        // draw backpacks
+        if (virtualTextures)
+        {
+            virtualTextures->bind(*lightingShader, backpackVirtualTexture, VIRTUAL_TEXTURE_UNIT);
+        }
+        submitPass(commands, RenderPass::lighting);
+        renderQueue->flush(*lightingShader);
 
         // update light shader
         lightSourceShader->use();
-        lightSourceShader->setFloat("view", view);
-        lightSourceShader->setFloat("projection", projection);
+        lightSourceShader->setFloat("view", commands.view);
+        lightSourceShader->setFloat("projection", commands.projection);
 
         // draw light sources
-        for (glm::vec3 &pointLightPosition : pointLightPositions)
+        submitPass(commands, RenderPass::lightSources);
+        renderQueue->flush(*lightSourceShader);
+
+        // build the depth pyramid for the next frame and present the scene
+        if (hiZBuffer)
         {
-            model = glm::translate(identityMatrix, pointLightPosition);
-            model = glm::scale(model, glm::vec3(0.2f));
-            lightSourceShader->setFloat("model", model);
-            sphere->draw(*lightSourceShader);
+            hiZBuffer->finishFrame(viewProjection, commands.cameraPosition);
+        }
+    }
+
+    void drawVirtualTextureFeedback(const FrameCommands &commands)
+    {
+        // upload what was streamed in since the last frame, then record what this frame needs
+        virtualTextures->update();
+        virtualTextures->beginFeedback();
+
+        virtualTextureFeedbackShader->use();
+        virtualTextureFeedbackShader->setFloat("view", commands.view);
+        virtualTextureFeedbackShader->setFloat("projection", commands.projection);
+        virtualTextures->bind(*virtualTextureFeedbackShader, backpackVirtualTexture, VIRTUAL_TEXTURE_UNIT);
+
+        submitPass(commands, RenderPass::virtualTextureFeedback);
+        renderQueue->flush(*virtualTextureFeedbackShader);
+
+        virtualTextures->endFeedback();
+    }
+
+    void submitPass(const FrameCommands &commands, RenderPass pass)
+    {
+        for (const DrawCommand &draw : commands.draws)
+        {
+            if (draw.pass == pass)
+            {
+                renderQueue->submit(draw.mesh, draw.modelMatrix, draw.worldBounds, commands.frustumCulled);
+            }
         }
     }
 
@@ -384,15 +821,7 @@ namespace
 
             if (ImGui::CollapsingHeader("Material"))
             {
-                if (ImGui::SliderFloat("Shininess##Material",
-                                       &material.shininess,
-                                       0.0f,
-                                       128.0f,
-                                       NULL,
-                                       ImGuiSliderFlags_Logarithmic))
-                {
-                    lightingShader->setFloat("material.shininess", material.shininess);
-                }
+                drawMaterialImgui();
             }
 
             if (ImGui::CollapsingHeader("Directional light"))
@@ -562,11 +991,20 @@ namespace
                 }
             }
 
+            drawCullingImgui();
+            drawTextureImgui();
+            drawPipelineImgui();
+            drawJobImgui();
+            drawLoaderImgui();
+
             if (ImGui::Button("Quit"))
             {
                 glfwSetWindowShouldClose(window, true);
             }
 
+            ImGui::Text("Draw path: %s",
+                        renderQueue->isMultiDrawIndirect() ? "multi draw indirect" : "one draw per mesh");
+
             ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
             ImGui::End();
         }
@@ -582,14 +1020,227 @@ namespace
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
     }
 
+    void drawPipelineImgui()
+    {
+        if (!ImGui::CollapsingHeader("Frame pipeline"))
+        {
+            return;
+        }
+
+        // the frame that's being recorded was meant to be drawn next frame, with the other order it never would be
+        if (ImGui::Checkbox("Record next frame while drawing##Frame pipeline", &pipelinedFrames))
+        {
+            framePipeline->discard();
+        }
+
+        ImGui::SliderInt("Backpack grid size##Frame pipeline", &backpackGridSize, 1, 32);
+        ImGui::Text("Recording: %.3f ms", recordMilliseconds);
+        ImGui::Text("Waited for the recording: %.3f ms", framePipeline->getWaitMilliseconds());
+
+        if (AllocationTracker::isEnabled())
+        {
+            const AllocationTracker::FrameCounts &counts = AllocationTracker::getLastFrame();
+            ImGui::Text("Heap allocations last frame: %d (%d bytes)", static_cast<int>(counts.allocations),
+                        static_cast<int>(counts.bytes));
+            for (std::size_t i = 0; i < static_cast<std::size_t>(AllocationSubsystem::count); i++)
+            {
+                ImGui::Text("  %s: %d", AllocationTracker::getSubsystemName(static_cast<AllocationSubsystem>(i)),
+                            static_cast<int>(counts.perSubsystem[i]));
+            }
+            ImGui::Text("Allocating frames after the warm-up: %d",
+                        static_cast<int>(AllocationTracker::getAllocatingFrameCount()));
+        }
+
+        const FrameArena &arena = FrameArena::getThreadArena();
+        ImGui::Text("Frame arena: %d of %d KiB used at most, %d overflows", static_cast<int>(arena.getPeak() / 1024),
+                    static_cast<int>(arena.getCapacity() / 1024), static_cast<int>(arena.getOverflowCount()));
+    }
+
+    void drawJobImgui()
+    {
+        if (!ImGui::CollapsingHeader("Job system"))
+        {
+            return;
+        }
+
+        ImGui::Text("Threads: %d", static_cast<int>(JobSystem::getInstance().getThreadCount()));
+
+        if (ImGui::Button("Run benchmark##Job system"))
+        {
+            jobBenchmarkResults = JobBenchmark::run();
+            for (const JobBenchmark::Result &result : jobBenchmarkResults)
+            {
+                std::cout << "Jobs with " << result.threadCount << " threads: " << result.spawnNanoseconds
+                          << " ns per job, parallel for " << result.parallelForMilliseconds << " ms (speedup "
+                          << result.speedup << ")" << std::endl;
+            }
+        }
+
+        for (const JobBenchmark::Result &result : jobBenchmarkResults)
+        {
+            ImGui::Text("%d threads: %.1f ns per job, parallel for %.3f ms (%.2fx)",
+                        static_cast<int>(result.threadCount), result.spawnNanoseconds,
+                        result.parallelForMilliseconds, result.speedup);
+        }
+    }
+
+    void drawLoaderImgui()
+    {
+        if (!ImGui::CollapsingHeader("Model loading"))
+        {
+            return;
+        }
+
+        ImGui::Text("Models: %d, meshes: %d", static_cast<int>(ModelPool::getInstance().getCount()),
+                    static_cast<int>(MeshPool::getInstance().getCount()));
+
+        ImGui::InputText("Additional file##Model loading", loaderBenchmarkPath.data(), loaderBenchmarkPath.size());
+
+        // imports the files of the scene again, without replacing the loaded models
+        if (ImGui::Button("Run benchmark##Model loading"))
+        {
+            ModelPool &modelPool = ModelPool::getInstance();
+            std::vector<std::string> paths{modelPool.getPath(backpack), modelPool.getPath(sphere)};
+            if (loaderBenchmarkPath[0] != '\0')
+            {
+                paths.push_back(loaderBenchmarkPath.data());
+            }
+
+            loaderBenchmarkResults = LoaderBenchmark::run(paths);
+            for (const LoaderBenchmark::Result &result : loaderBenchmarkResults)
+            {
+                std::cout << "Imported " << result.path << ": " << result.vertexCount << " vertices, assimp "
+                          << result.importMilliseconds << " ms, converting " << result.convertMilliseconds << " ms, "
+                          << result.verticesPerSecond << " vertices/s (converting alone "
+                          << result.convertVerticesPerSecond << " vertices/s), " << result.megabytesPerSecond
+                          << " MB/s";
+                if (result.nativeMilliseconds > 0.0)
+                {
+                    std::cout << ", native reader " << result.nativeMilliseconds << " ms, "
+                              << result.nativeVerticesPerSecond << " vertices/s, " << result.nativeMegabytesPerSecond
+                              << " MB/s";
+                }
+                std::cout << std::endl;
+            }
+        }
+
+        for (const LoaderBenchmark::Result &result : loaderBenchmarkResults)
+        {
+            ImGui::TextWrapped("%s", result.path.c_str());
+            ImGui::Text("%d vertices: assimp %.1f ms, converting %.2f ms, %.2f M vertices/s (converting %.1f M/s)",
+                        static_cast<int>(result.vertexCount), result.importMilliseconds, result.convertMilliseconds,
+                        result.verticesPerSecond / 1e6, result.convertVerticesPerSecond / 1e6);
+            ImGui::Text("%.1f MB, assimp %.1f MB/s", result.fileBytes / 1e6, result.megabytesPerSecond);
+            if (result.nativeMilliseconds > 0.0)
+            {
+                ImGui::Text("Native reader %.1f ms, %.2f M vertices/s, %.1f MB/s (%.1fx assimp)",
+                            result.nativeMilliseconds, result.nativeVerticesPerSecond / 1e6,
+                            result.nativeMegabytesPerSecond,
+                            (result.importMilliseconds + result.convertMilliseconds) / result.nativeMilliseconds);
+            }
+        }
+    }
+
+    void drawCullingImgui()
+    {
+        if (!ImGui::CollapsingHeader("Culling"))
+        {
+            return;
+        }
+
+        int cullingMode = static_cast<int>(renderQueue->getCullingMode());
+        bool changed = ImGui::RadioButton("None##Culling", &cullingMode, static_cast<int>(CullingMode::none));
+        ImGui::SameLine();
+        changed |= ImGui::RadioButton("CPU##Culling", &cullingMode, static_cast<int>(CullingMode::cpu));
+        if (renderQueue->isGpuCullingSupported())
+        {
+            ImGui::SameLine();
+            changed |= ImGui::RadioButton("GPU##Culling", &cullingMode, static_cast<int>(CullingMode::gpu));
+        }
+
+        if (changed)
+        {
+            renderQueue->setCullingMode(static_cast<CullingMode>(cullingMode));
+        }
+
+        bool occlusionCulling = hiZBuffer != nullptr;
+        if (ImGui::Checkbox("Occlusion culling (Hi-Z)##Culling", &occlusionCulling))
+        {
+            if (occlusionCulling)
+            {
+                hiZBuffer = std::unique_ptr<HiZBuffer>(new HiZBuffer(curWidth, curHeight));
+            }
+            else
+            {
+                hiZBuffer.reset();
+            }
+            renderQueue->setOcclusionCulling(hiZBuffer.get());
+        }
+
+        const RenderQueue::Statistics &statistics = renderQueue->getStatistics();
+        ImGui::Text("Draws submitted: %d", static_cast<int>(statistics.submittedDraws));
+        if (renderQueue->getCullingMode() == CullingMode::gpu && renderQueue->isGpuCullingSupported())
+        {
+            ImGui::Text("Draws culled and occluded: decided on the GPU");
+        }
+        else
+        {
+            ImGui::Text("Draws culled: %d", static_cast<int>(statistics.culledDraws));
+            ImGui::Text("Draws occluded: %d", static_cast<int>(statistics.occludedDraws));
+        }
+
+        bool lodEnabled = renderQueue->isLodEnabled();
+        if (ImGui::Checkbox("Level of detail##Culling", &lodEnabled))
+        {
+            renderQueue->setLodEnabled(lodEnabled);
+        }
+
+        ImGui::Text("Triangles: %d", static_cast<int>(statistics.triangles));
+        ImGui::Text("Draws per level of detail: %d / %d / %d / %d", static_cast<int>(statistics.drawsPerLod[0]),
+                    static_cast<int>(statistics.drawsPerLod[1]), static_cast<int>(statistics.drawsPerLod[2]),
+                    static_cast<int>(statistics.drawsPerLod[3]));
+
+        if (ImGui::Button("Run benchmark##Culling"))
+        {
+            cullingBenchmarkResults.clear();
+            for (std::size_t instanceCount : {10000, 100000, 1000000})
+            {
+                CullingBenchmark::Result result = CullingBenchmark::run(instanceCount);
+                std::cout << "Culling " << result.instanceCount << " instances ("
+                          << result.visibleCount << " visible): CPU " << result.cpuMilliseconds << " ms, GPU "
+                          << result.gpuMilliseconds << " ms, GPU matches CPU: " << result.matchesReference
+                          << std::endl;
+                cullingBenchmarkResults.push_back(result);
+            }
+        }
+
+        for (const CullingBenchmark::Result &result : cullingBenchmarkResults)
+        {
+            if (result.gpuMilliseconds < 0.0)
+            {
+                ImGui::Text("%d instances: CPU %.3f ms, GPU not supported",
+                            static_cast<int>(result.instanceCount), result.cpuMilliseconds);
+            }
+            else
+            {
+                ImGui::Text("%d instances: CPU %.3f ms, GPU %.3f ms%s",
+                            static_cast<int>(result.instanceCount), result.cpuMilliseconds, result.gpuMilliseconds,
+                            result.matchesReference ? "" : " (GPU output differs from CPU reference!)");
+            }
+        }
+    }
+
     template <class T>
-    void updatePointLightAttribute(std::string attribute, T &value)
+    void updatePointLightAttribute(const char *attribute, T &value)
     {
         // apply an attribute to all point lights
         for (std::size_t i = 0; i < pointLightPositions.size(); i++)
         {
-            std::string identifier = "pointLights[" + std::to_string(i) + "]." + attribute;
-            lightingShader->setFloat(identifier, value);
+            FrameString identifier("pointLights[");
+            appendNumber(identifier, i);
+            identifier += "].";
+            identifier += attribute;
+            lightingShader->setFloat(identifier.c_str(), value);
         }
     }
 
@@ -598,6 +1249,16 @@ namespace
         curWidth = width;
         curHeight = height;
         glViewport(0, 0, width, height);
+
+        if (hiZBuffer)
+        {
+            hiZBuffer->resize(width, height);
+        }
+
+        if (virtualTextures)
+        {
+            virtualTextures->resize(width, height);
+        }
     }
 
     void mouseCallback(GLFWwindow *window, double xPos, double yPos)
@@ -624,7 +1285,7 @@ namespace
             // reset camera so that it doesn't jerk when the imgui window is closed
             camera->reset();
         }
-        else
+        else if (key >= 0 && key <= GLFW_KEY_LAST)
         {
             keyStates[key] = action != GLFW_RELEASE; // we want to treat GLFW_PRESS and GLFW_REPEAT as the same
         }
@@ -639,6 +1300,7 @@ namespace
 
 int Renderer::init()
 {
+    initAssets();
     if (int ret = initGlfw())
     {
         return ret;
@@ -650,11 +1312,28 @@ int Renderer::init()
     initGl();
     initImgui();
     initScene();
+    initHotReload();
     return 0;
 }
 
 void Renderer::deinit()
 {
+    // the recording jobs read the models, so they have to finish first
+    framePipeline.reset();
+
+    // destroying the futures waits for the imports that are still running
+    modelReloads.clear();
+    fileWatcher.reset();
+
+    // release GL objects while the context is still alive
+    renderQueue.reset();
+    hiZBuffer.reset();
+    virtualTextures.reset();
+    ModelPool::getInstance().destroy(backpack);
+    ModelPool::getInstance().destroy(sphere);
+    MaterialTable::getInstance().clear();
+    TextureManager::getInstance().releaseUnused();
+
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
@@ -670,7 +1349,14 @@ bool Renderer::isRunning()
 
 void Renderer::renderFrame()
 {
+    AllocationTracker::beginFrame();
+
     glfwPollEvents();
+    {
+        AllocationTracker::Scope allocationScope(AllocationSubsystem::hotReload);
+        DirectoryHelper::getInstance().update();
+        updateHotReload();
+    }
 
     // keep record of time
     float currentFrame = glfwGetTime();
@@ -678,9 +1364,42 @@ void Renderer::renderFrame()
     lastFrame = currentFrame;
 
     moveCamera();
-    drawScene();
-    drawImgui();
+
+    // the jobs record this frame while the previous one is drawn, or right before it's drawn without pipelining
+    AllocationTracker::Scope allocationScope(AllocationSubsystem::framePipeline);
+    const FrameCommands *commands = nullptr;
+    if (pipelinedFrames)
+    {
+        commands = framePipeline->acquire();
+        framePipeline->record(captureFrameInput());
+    }
+    else
+    {
+        framePipeline->record(captureFrameInput());
+        commands = framePipeline->acquire();
+    }
+
+    // nothing was recorded yet in the first frame
+    if (commands)
+    {
+        AllocationTracker::Scope drawScope(AllocationSubsystem::renderQueue);
+        drawScene(*commands);
+    }
+    else
+    {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    }
+
+    {
+        AllocationTracker::Scope imguiScope(AllocationSubsystem::imgui);
+        drawImgui();
+    }
 
     // swap buffers
     glfwSwapBuffers(window);
-}
+
+    // nothing allocated during the frame is used anymore
+    FrameArena::getThreadArena().reset();
+
+    AllocationTracker::endFrame();
+}
\ No newline at end of file
@@ -1,207 +1,586 @@
 #include "Shader.h"
 
+#include <algorithm>
+#include <unordered_set>
+#include <boost/filesystem.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
-Shader::Shader(const std::string &vertexShaderPath, const std::string &fragmentShaderPath)
-{
-    // retrieve shader source from file system
-    std::string vertexCode;
-    std::string fragmentCode;
-    std::ifstream vShaderFile;
-    std::ifstream fShaderFile;
-
-    // ifstream requires you to define what should throw an exception
-    vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-
-    try
-    {
-        vShaderFile.open(vertexShaderPath);
-        fShaderFile.open(fragmentShaderPath);
-
-        // read files
-        std::stringstream vShaderStream, fShaderStream;
-        vShaderStream << vShaderFile.rdbuf();
-        fShaderStream << fShaderFile.rdbuf();
+#include "GlExtensions.h"
+#include "MappedFile.h"
+#include "ProgramCache.h"
 
-        // close files
-        vShaderFile.close();
-        fShaderFile.close();
+namespace
+{
+    // all shaders of the process, for reloading the ones that use a changed file
+    std::unordered_set<Shader *> liveShaders;
 
-        // convert streams into C strings
-        vertexCode = vShaderStream.str();
-        fragmentCode = fShaderStream.str();
-    }
-    catch (const std::ifstream::failure &e)
+    void copyUniformValue(GLuint from, GLint fromLocation, GLint toLocation, GLenum type)
     {
-        std::cerr << e.what() << '\n';
+        GLfloat floats[16];
+        GLint integers[4];
+        GLuint unsignedIntegers[4];
+
+        switch (type)
+        {
+        case GL_FLOAT:
+            glGetUniformfv(from, fromLocation, floats);
+            glUniform1fv(toLocation, 1, floats);
+            break;
+        case GL_FLOAT_VEC2:
+            glGetUniformfv(from, fromLocation, floats);
+            glUniform2fv(toLocation, 1, floats);
+            break;
+        case GL_FLOAT_VEC3:
+            glGetUniformfv(from, fromLocation, floats);
+            glUniform3fv(toLocation, 1, floats);
+            break;
+        case GL_FLOAT_VEC4:
+            glGetUniformfv(from, fromLocation, floats);
+            glUniform4fv(toLocation, 1, floats);
+            break;
+        case GL_FLOAT_MAT2:
+            glGetUniformfv(from, fromLocation, floats);
+            glUniformMatrix2fv(toLocation, 1, GL_FALSE, floats);
+            break;
+        case GL_FLOAT_MAT3:
+            glGetUniformfv(from, fromLocation, floats);
+            glUniformMatrix3fv(toLocation, 1, GL_FALSE, floats);
+            break;
+        case GL_FLOAT_MAT4:
+            glGetUniformfv(from, fromLocation, floats);
+            glUniformMatrix4fv(toLocation, 1, GL_FALSE, floats);
+            break;
+        case GL_INT_VEC2:
+        case GL_BOOL_VEC2:
+            glGetUniformiv(from, fromLocation, integers);
+            glUniform2iv(toLocation, 1, integers);
+            break;
+        case GL_INT_VEC3:
+        case GL_BOOL_VEC3:
+            glGetUniformiv(from, fromLocation, integers);
+            glUniform3iv(toLocation, 1, integers);
+            break;
+        case GL_INT_VEC4:
+        case GL_BOOL_VEC4:
+            glGetUniformiv(from, fromLocation, integers);
+            glUniform4iv(toLocation, 1, integers);
+            break;
+        case GL_UNSIGNED_INT:
+            glGetUniformuiv(from, fromLocation, unsignedIntegers);
+            glUniform1uiv(toLocation, 1, unsignedIntegers);
+            break;
+        case GL_UNSIGNED_INT_VEC2:
+            glGetUniformuiv(from, fromLocation, unsignedIntegers);
+            glUniform2uiv(toLocation, 1, unsignedIntegers);
+            break;
+        case GL_UNSIGNED_INT_VEC3:
+            glGetUniformuiv(from, fromLocation, unsignedIntegers);
+            glUniform3uiv(toLocation, 1, unsignedIntegers);
+            break;
+        case GL_UNSIGNED_INT_VEC4:
+            glGetUniformuiv(from, fromLocation, unsignedIntegers);
+            glUniform4uiv(toLocation, 1, unsignedIntegers);
+            break;
+        default:
+            // int, bool and all kinds of samplers
+            glGetUniformiv(from, fromLocation, integers);
+            glUniform1iv(toLocation, 1, integers);
+            break;
+        }
     }
+} // namespace
 
-    const char *vertexCodeC = vertexCode.c_str();
-    const char *fragmentCodeC = fragmentCode.c_str();
-
-    // vertex shader
-    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexCodeC, NULL);
-    glCompileShader(vertexShader);
-    checkShaderCompileSuccess(vertexShader);
-
-    // fragment shader
-    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentCodeC, NULL);
-    glCompileShader(fragmentShader);
-    checkShaderCompileSuccess(fragmentShader);
+Shader::Shader(const std::string &vertexShaderPath, const std::string &fragmentShaderPath)
+    : Shader(vertexShaderPath, fragmentShaderPath, {})
+{
+}
 
-    // linking
-    id = glCreateProgram();
-    glAttachShader(id, vertexShader);
-    glAttachShader(id, fragmentShader);
-    glLinkProgram(id);
-    checkProgramLinkSuccess(id);
+Shader::Shader(const std::string &vertexShaderPath, const std::string &fragmentShaderPath,
+               const std::vector<std::string> &defines)
+{
+    buildProgram({{GL_VERTEX_SHADER, vertexShaderPath}, {GL_FRAGMENT_SHADER, fragmentShaderPath}}, defines);
+}
 
-    // delete linked shaders
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+Shader::Shader(const std::string &computeShaderPath)
+{
+    buildProgram({{GL_COMPUTE_SHADER, computeShaderPath}}, {});
 }
 
-Shader::~Shader() {}
+Shader::~Shader()
+{
+    liveShaders.erase(this);
+}
 
 void Shader::use() const
 {
+    updateProgram();
     glUseProgram(id);
 }
 
+bool Shader::isReady() const
+{
+    return !pending || isBuildDone(id);
+}
+
 // OpenGL 4.1 added glProgramUniform, which doesn't require you to use the program before setting a uniform
 // This might perform better than manually calling glUseProgram before setting uniforms, as below
 // Can be implemented when switching to OpenGL >= 4.1
 
-void Shader::setBool(const std::string &name, bool v1) const
+void Shader::setBool(const GLchar *name, bool v1) const
 {
     use();
-    glUniform1i(glGetUniformLocation(id, name.c_str()), static_cast<int>(v1));
+    glUniform1i(glGetUniformLocation(id, name), static_cast<int>(v1));
 }
 
-void Shader::setInt(const std::string &name, GLint v1) const
+void Shader::setInt(const GLchar *name, GLint v1) const
 {
     use();
-    glUniform1i(glGetUniformLocation(id, name.c_str()), v1);
+    glUniform1i(glGetUniformLocation(id, name), v1);
 }
 
-void Shader::setFloat(const std::string &name, GLfloat v1) const
+void Shader::setFloat(const GLchar *name, GLfloat v1) const
 {
     use();
-    glUniform1f(glGetUniformLocation(id, name.c_str()), v1);
+    glUniform1f(glGetUniformLocation(id, name), v1);
 }
 
-void Shader::setBool(const std::string &name, bool v1, bool v2) const
+void Shader::setBool(const GLchar *name, bool v1, bool v2) const
 {
     use();
-    glUniform2i(glGetUniformLocation(id, name.c_str()), static_cast<int>(v1), static_cast<int>(v2));
+    glUniform2i(glGetUniformLocation(id, name), static_cast<int>(v1), static_cast<int>(v2));
 }
 
-void Shader::setInt(const std::string &name, GLint v1, GLint v2) const
+void Shader::setInt(const GLchar *name, GLint v1, GLint v2) const
 {
     use();
-    glUniform2i(glGetUniformLocation(id, name.c_str()), v1, v2);
+    glUniform2i(glGetUniformLocation(id, name), v1, v2);
 }
 
-void Shader::setFloat(const std::string &name, GLfloat v1, GLfloat v2) const
+void Shader::setFloat(const GLchar *name, GLfloat v1, GLfloat v2) const
 {
     use();
-    glUniform2f(glGetUniformLocation(id, name.c_str()), v1, v2);
+    glUniform2f(glGetUniformLocation(id, name), v1, v2);
 }
 
-void Shader::setBool(const std::string &name, bool v1, bool v2, bool v3) const
+void Shader::setBool(const GLchar *name, bool v1, bool v2, bool v3) const
 {
     use();
-    glUniform3i(glGetUniformLocation(id, name.c_str()), static_cast<int>(v1), static_cast<int>(v2), static_cast<int>(v3));
+    glUniform3i(glGetUniformLocation(id, name), static_cast<int>(v1), static_cast<int>(v2), static_cast<int>(v3));
 }
 
-void Shader::setInt(const std::string &name, GLint v1, GLint v2, GLint v3) const
+void Shader::setInt(const GLchar *name, GLint v1, GLint v2, GLint v3) const
 {
     use();
-    glUniform3i(glGetUniformLocation(id, name.c_str()), v1, v2, v3);
+    glUniform3i(glGetUniformLocation(id, name), v1, v2, v3);
 }
 
-void Shader::setFloat(const std::string &name, GLfloat v1, GLfloat v2, GLfloat v3) const
+void Shader::setFloat(const GLchar *name, GLfloat v1, GLfloat v2, GLfloat v3) const
 {
     use();
-    glUniform3f(glGetUniformLocation(id, name.c_str()), v1, v2, v3);
+    glUniform3f(glGetUniformLocation(id, name), v1, v2, v3);
 }
 
-void Shader::setBool(const std::string &name, bool v1, bool v2, bool v3, bool v4) const
+void Shader::setBool(const GLchar *name, bool v1, bool v2, bool v3, bool v4) const
 {
     use();
-    glUniform4i(glGetUniformLocation(id, name.c_str()), static_cast<int>(v1), static_cast<int>(v2), static_cast<int>(v3), static_cast<int>(v4));
+    glUniform4i(glGetUniformLocation(id, name), static_cast<int>(v1), static_cast<int>(v2), static_cast<int>(v3), static_cast<int>(v4));
 }
 
-void Shader::setInt(const std::string &name, GLint v1, GLint v2, GLint v3, GLint v4) const
+void Shader::setInt(const GLchar *name, GLint v1, GLint v2, GLint v3, GLint v4) const
 {
     use();
-    glUniform4i(glGetUniformLocation(id, name.c_str()), v1, v2, v3, v4);
+    glUniform4i(glGetUniformLocation(id, name), v1, v2, v3, v4);
 }
 
-void Shader::setFloat(const std::string &name, GLfloat v1, GLfloat v2, GLfloat v3, GLfloat v4) const
+void Shader::setFloat(const GLchar *name, GLfloat v1, GLfloat v2, GLfloat v3, GLfloat v4) const
 {
     use();
-    glUniform4f(glGetUniformLocation(id, name.c_str()), v1, v2, v3, v4);
+    glUniform4f(glGetUniformLocation(id, name), v1, v2, v3, v4);
 }
 
-void Shader::setFloat(const std::string &name, const glm::vec2 &vec) const
+void Shader::setFloat(const GLchar *name, const glm::vec2 &vec) const
 {
     use();
-    glUniform2f(glGetUniformLocation(id, name.c_str()), vec.x, vec.y);
+    glUniform2f(glGetUniformLocation(id, name), vec.x, vec.y);
 }
 
-void Shader::setFloat(const std::string &name, const glm::vec3 &vec) const
+void Shader::setFloat(const GLchar *name, const glm::vec3 &vec) const
 {
     use();
-    glUniform3f(glGetUniformLocation(id, name.c_str()), vec.x, vec.y, vec.z);
+    glUniform3f(glGetUniformLocation(id, name), vec.x, vec.y, vec.z);
 }
 
-void Shader::setFloat(const std::string &name, const glm::vec4 &vec) const
+void Shader::setFloat(const GLchar *name, const glm::vec4 &vec) const
 {
     use();
-    glUniform4f(glGetUniformLocation(id, name.c_str()), vec.x, vec.y, vec.z, vec.w);
+    glUniform4f(glGetUniformLocation(id, name), vec.x, vec.y, vec.z, vec.w);
 }
 
-void Shader::setFloat(const std::string &name, const glm::mat2 &mat) const
+void Shader::setFloat(const GLchar *name, const glm::mat2 &mat) const
 {
     use();
-    glUniformMatrix2fv(glGetUniformLocation(id, name.c_str()), 1, GL_FALSE, glm::value_ptr(mat));
+    glUniformMatrix2fv(glGetUniformLocation(id, name), 1, GL_FALSE, glm::value_ptr(mat));
 }
 
-void Shader::setFloat(const std::string &name, const glm::mat3 &mat) const
+void Shader::setFloat(const GLchar *name, const glm::mat3 &mat) const
 {
     use();
-    glUniformMatrix3fv(glGetUniformLocation(id, name.c_str()), 1, GL_FALSE, glm::value_ptr(mat));
+    glUniformMatrix3fv(glGetUniformLocation(id, name), 1, GL_FALSE, glm::value_ptr(mat));
 }
 
-void Shader::setFloat(const std::string &name, const glm::mat4 &mat) const
+void Shader::setFloat(const GLchar *name, const glm::mat4 &mat) const
 {
     use();
-    glUniformMatrix4fv(glGetUniformLocation(id, name.c_str()), 1, GL_FALSE, glm::value_ptr(mat));
+    glUniformMatrix4fv(glGetUniformLocation(id, name), 1, GL_FALSE, glm::value_ptr(mat));
 }
 
-void Shader::getBool(const std::string &name, bool *result) const
+void Shader::getBool(const GLchar *name, bool *result) const
 {
     use();
-    glGetUniformiv(id, glGetUniformLocation(id, name.c_str()), reinterpret_cast<int *>(result));
+    glGetUniformiv(id, glGetUniformLocation(id, name), reinterpret_cast<int *>(result));
 }
 
-void Shader::getInt(const std::string &name, GLint *result) const
+void Shader::getInt(const GLchar *name, GLint *result) const
 {
     use();
-    glGetUniformiv(id, glGetUniformLocation(id, name.c_str()), result);
+    glGetUniformiv(id, glGetUniformLocation(id, name), result);
 }
 
-void Shader::getFloat(const std::string &name, GLfloat *result) const
+void Shader::getFloat(const GLchar *name, GLfloat *result) const
 {
     use();
-    glGetUniformfv(id, glGetUniformLocation(id, name.c_str()), result);
+    glGetUniformfv(id, glGetUniformLocation(id, name), result);
 }
 
-void Shader::checkProgramLinkSuccess(GLuint program) const
+void Shader::setUniformBlockBinding(const GLchar *name, GLuint binding) const
+{
+    updateProgram();
+    GLuint index = glGetUniformBlockIndex(id, name);
+    if (index != GL_INVALID_INDEX)
+    {
+        glUniformBlockBinding(id, index, binding);
+    }
+}
+
+void Shader::reload()
+{
+    // a reload that's still running is outdated already
+    if (reloading)
+    {
+        finishBuild(*reloading);
+        glDeleteProgram(reloading->program);
+        reloading.reset();
+    }
+    updateProgram();
+
+    GLuint program = glCreateProgram();
+    reloading = startBuild(program);
+    if (!reloading)
+    {
+        // taken from the program cache, so it can be swapped right away
+        copyUniforms(id, program);
+        glDeleteProgram(id);
+        id = program;
+    }
+}
+
+const std::vector<std::string> &Shader::getFiles() const
+{
+    return files;
+}
+
+void Shader::reloadChanged(const std::string &path)
+{
+    for (Shader *shader : liveShaders)
+    {
+        if (std::find(shader->files.begin(), shader->files.end(), path) != shader->files.end())
+        {
+            std::cout << "Reloading shader " << shader->stages.front().second << std::endl;
+            shader->reload();
+        }
+    }
+}
+
+std::string Shader::loadSource(const std::string &path, const std::vector<std::string> &defines,
+                              std::vector<std::string> &files)
+{
+    std::string code;
+    if (!appendSource(path, code, files, 0))
+    {
+        return code;
+    }
+
+    // the version needs to stay the first statement, so the defines go right behind it
+    if (!defines.empty())
+    {
+        std::string defineLines;
+        for (const std::string &define : defines)
+        {
+            defineLines += "#define " + define + "\n";
+        }
+
+        // continue with the line numbers of the file
+        std::size_t versionEnd = code.compare(0, 8, "#version") == 0 ? code.find('\n') : std::string::npos;
+        defineLines += versionEnd == std::string::npos ? "#line 1 0\n" : "#line 2 0\n";
+        code.insert(versionEnd == std::string::npos ? 0 : versionEnd + 1, defineLines);
+    }
+
+    return code;
+}
+
+bool Shader::appendSource(const std::string &path, std::string &code, std::vector<std::string> &files, int depth)
+{
+    // mapped, so sources in the asset archive are read the same way
+    MappedFile shaderFile;
+    if (!shaderFile.open(path))
+    {
+        std::cerr << "Failed to read shader file " << path << std::endl;
+        return false;
+    }
+    std::istringstream shaderStream(
+        std::string(reinterpret_cast<const char *>(shaderFile.getData()), shaderFile.getSize()));
+
+    // the number of the source string in compile errors is the index of the file
+    int fileIndex = files.size();
+    files.push_back(path);
+    std::string directory = boost::filesystem::path(path).parent_path().string();
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(shaderStream, line))
+    {
+        lineNumber++;
+
+        // #include "file", relative to the including file
+        std::size_t start = line.find_first_not_of(" \t");
+        if (start == std::string::npos || line.compare(start, 8, "#include") != 0)
+        {
+            code += line + '\n';
+            continue;
+        }
+
+        std::size_t nameStart = line.find('"', start + 8);
+        std::size_t nameEnd = nameStart == std::string::npos ? std::string::npos : line.find('"', nameStart + 1);
+        if (nameEnd == std::string::npos)
+        {
+            std::cerr << path << ":" << lineNumber << ": malformed #include" << std::endl;
+            return false;
+        }
+
+        std::string includePath = directory + '/' + line.substr(nameStart + 1, nameEnd - nameStart - 1);
+        includePath = boost::filesystem::path(includePath).lexically_normal().string();
+
+        // every file is only included once, like with include guards
+        if (std::find(files.begin(), files.end(), includePath) != files.end())
+        {
+            code += '\n';
+            continue;
+        }
+
+        if (depth + 1 > MAX_INCLUDE_DEPTH)
+        {
+            std::cerr << path << ":" << lineNumber << ": includes are nested too deep" << std::endl;
+            return false;
+        }
+
+        code += "#line 1 " + std::to_string(files.size()) + '\n';
+        if (!appendSource(includePath, code, files, depth + 1))
+        {
+            return false;
+        }
+        code += "#line " + std::to_string(lineNumber + 1) + ' ' + std::to_string(fileIndex) + '\n';
+    }
+
+    return true;
+}
+
+void Shader::buildProgram(const std::vector<std::pair<GLenum, std::string>> &stages,
+                          const std::vector<std::string> &defines)
+{
+    this->stages = stages;
+    this->defines = defines;
+    liveShaders.insert(this);
+
+    id = glCreateProgram();
+    pending = startBuild(id);
+}
+
+std::unique_ptr<Shader::PendingBuild> Shader::startBuild(GLuint program)
+{
+    // retrieve shader sources from file system, with their includes and defines
+    std::vector<std::string> sources;
+    std::vector<std::vector<std::string>> stageFiles(stages.size());
+    files.clear();
+    for (std::size_t i = 0; i < stages.size(); i++)
+    {
+        sources.push_back(loadSource(stages[i].second, defines, stageFiles[i]));
+        for (const std::string &file : stageFiles[i])
+        {
+            boost::system::error_code error;
+            boost::filesystem::path canonicalPath = boost::filesystem::canonical(file, error);
+            files.push_back(error ? file : canonicalPath.string());
+        }
+    }
+
+    // skip compiling and linking if the driver already did it for the same sources
+    std::string cacheKey;
+    if (GlExtensions::hasProgramBinary())
+    {
+        cacheKey = ProgramCache::makeKey(sources);
+        if (ProgramCache::read(cacheKey, program))
+        {
+            return nullptr;
+        }
+    }
+
+    // only issue the work, the driver may compile on other threads until the program is used
+    std::unique_ptr<PendingBuild> build(new PendingBuild());
+    build->program = program;
+    build->files = std::move(stageFiles);
+    build->cacheKey = cacheKey;
+    for (std::size_t i = 0; i < stages.size(); i++)
+    {
+        const char *code = sources[i].c_str();
+        GLuint shader = glCreateShader(stages[i].first);
+        glShaderSource(shader, 1, &code, NULL);
+        glCompileShader(shader);
+        glAttachShader(program, shader);
+        build->shaders.push_back(shader);
+    }
+
+    // linking, failed compiles show up as failed link
+    if (!cacheKey.empty())
+    {
+        GlExtensions::programParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glLinkProgram(program);
+    return build;
+}
+
+bool Shader::finishBuild(PendingBuild &build) const
+{
+    for (std::size_t i = 0; i < build.shaders.size(); i++)
+    {
+        if (!checkShaderCompileSuccess(build.shaders[i]))
+        {
+            // errors name the file by its number
+            for (std::size_t j = 0; j < build.files[i].size(); j++)
+            {
+                std::cerr << "  " << j << ": " << build.files[i][j] << std::endl;
+            }
+        }
+    }
+
+    bool linked = checkProgramLinkSuccess(build.program);
+
+    // delete linked shaders
+    for (GLuint shader : build.shaders)
+    {
+        glDeleteShader(shader);
+    }
+    build.shaders.clear();
+
+    if (linked && !build.cacheKey.empty())
+    {
+        ProgramCache::write(build.cacheKey, build.program);
+    }
+
+    return linked;
+}
+
+void Shader::updateProgram() const
+{
+    // release the builds before reporting, so that errors are only reported once
+    if (pending)
+    {
+        std::unique_ptr<PendingBuild> build = std::move(pending);
+        finishBuild(*build);
+    }
+
+    if (reloading && isBuildDone(reloading->program))
+    {
+        std::unique_ptr<PendingBuild> build = std::move(reloading);
+        if (finishBuild(*build))
+        {
+            copyUniforms(id, build->program);
+            glDeleteProgram(id);
+            id = build->program;
+        }
+        else
+        {
+            std::cerr << "Keeping the previous program of " << stages.front().second << std::endl;
+            glDeleteProgram(build->program);
+        }
+    }
+}
+
+bool Shader::isBuildDone(GLuint program)
+{
+    if (!GlExtensions::hasParallelShaderCompile())
+    {
+        return true;
+    }
+
+    // the link status covers the compiles of the attached shaders as well
+    GLint completed = GL_FALSE;
+    glGetProgramiv(program, GL_COMPLETION_STATUS_KHR, &completed);
+    return completed == GL_TRUE;
+}
+
+void Shader::copyUniforms(GLuint from, GLuint to)
+{
+    glUseProgram(to);
+
+    GLint uniformCount = 0;
+    glGetProgramiv(from, GL_ACTIVE_UNIFORMS, &uniformCount);
+    for (GLint i = 0; i < uniformCount; i++)
+    {
+        char name[256];
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(from, i, sizeof(name), &length, &size, &type, name);
+
+        // arrays are reported by their first element, every element has its own location
+        std::string baseName(name, length);
+        if (size > 1 && baseName.size() > 3 && baseName.compare(baseName.size() - 3, 3, "[0]") == 0)
+        {
+            baseName.resize(baseName.size() - 3);
+        }
+
+        for (GLint element = 0; element < size; element++)
+        {
+            std::string elementName = size > 1 ? baseName + '[' + std::to_string(element) + ']' : baseName;
+
+            // uniforms in blocks have no location, neither do uniforms the new program doesn't have anymore
+            GLint fromLocation = glGetUniformLocation(from, elementName.c_str());
+            GLint toLocation = glGetUniformLocation(to, elementName.c_str());
+            if (fromLocation >= 0 && toLocation >= 0)
+            {
+                copyUniformValue(from, fromLocation, toLocation, type);
+            }
+        }
+    }
+
+    GLint blockCount = 0;
+    glGetProgramiv(from, GL_ACTIVE_UNIFORM_BLOCKS, &blockCount);
+    for (GLint i = 0; i < blockCount; i++)
+    {
+        char name[256];
+        GLsizei length = 0;
+        glGetActiveUniformBlockName(from, i, sizeof(name), &length, name);
+
+        GLint binding = 0;
+        glGetActiveUniformBlockiv(from, i, GL_UNIFORM_BLOCK_BINDING, &binding);
+        GLuint index = glGetUniformBlockIndex(to, name);
+        if (index != GL_INVALID_INDEX)
+        {
+            glUniformBlockBinding(to, index, binding);
+        }
+    }
+}
+
+bool Shader::checkProgramLinkSuccess(GLuint program) const
 {
     GLint success;
     glGetProgramiv(program, GL_LINK_STATUS, &success);
@@ -214,9 +593,11 @@ void Shader::checkProgramLinkSuccess(GLuint program) const
                   << success
                   << infoLog << std::endl;
     }
+
+    return success;
 }
 
-void Shader::checkShaderCompileSuccess(GLuint shader) const
+bool Shader::checkShaderCompileSuccess(GLuint shader) const
 {
     GLint success;
     glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
@@ -228,4 +609,6 @@ void Shader::checkShaderCompileSuccess(GLuint shader) const
         std::cerr << "Shader compilation failed\n"
                   << infoLog << std::endl;
     }
+
+    return success;
 }
\ No newline at end of file
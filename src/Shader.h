@@ -2,7 +2,10 @@
 #define SHADER_H
 
 #include <array>
+#include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -10,46 +13,154 @@
 
 #include "lib/glad/include/glad/glad.h"
 
+/**
+ * Constructors only issue the compiles and the link, the driver may work on them in the background
+ * (see GlExtensions::hasParallelShaderCompile). The results are checked when the program is used first,
+ * so creating all shaders before using any of them lets them compile in parallel.
+ */
 class Shader
 {
 public:
     // constructor reads and builds the shader program
     Shader(const std::string &vertexShaderPath, const std::string &fragmentShaderPath);
 
+    // constructor for variants of a program, every name in defines is #defined right after the #version line
+    Shader(const std::string &vertexShaderPath, const std::string &fragmentShaderPath,
+           const std::vector<std::string> &defines);
+
+    // constructor for compute programs, needs OpenGL 4.3 (see GlExtensions::hasComputeShader)
+    Shader(const std::string &computeShaderPath);
+
     virtual ~Shader();
 
-    // use/activate the shader
+    // use/activate the shader, waits for the build if it's not done yet
     void use() const;
 
-    // uniform functions
-    void setBool(const std::string &name, bool v1) const;
-    void setInt(const std::string &name, GLint v1) const;
-    void setFloat(const std::string &name, GLfloat v1) const;
-    void setBool(const std::string &name, bool v1, bool v2) const;
-    void setInt(const std::string &name, GLint v1, GLint v2) const;
-    void setFloat(const std::string &name, GLfloat v1, GLfloat v2) const;
-    void setBool(const std::string &name, bool v1, bool v2, bool v3) const;
-    void setInt(const std::string &name, GLint v1, GLint v2, GLint v3) const;
-    void setFloat(const std::string &name, GLfloat v1, GLfloat v2, GLfloat v3) const;
-    void setBool(const std::string &name, bool v1, bool v2, bool v3, bool v4) const;
-    void setInt(const std::string &name, GLint v1, GLint v2, GLint v3, GLint v4) const;
-    void setFloat(const std::string &name, GLfloat v1, GLfloat v2, GLfloat v3, GLfloat v4) const;
-    void setFloat(const std::string &name, const glm::vec2 &vec) const;
-    void setFloat(const std::string &name, const glm::vec3 &vec) const;
-    void setFloat(const std::string &name, const glm::vec4 &vec) const;
-    void setFloat(const std::string &name, const glm::mat2 &mat) const;
-    void setFloat(const std::string &name, const glm::mat3 &mat) const;
-    void setFloat(const std::string &name, const glm::mat4 &mat) const;
-    void getBool(const std::string &name, bool *result) const;
-    void getInt(const std::string &name, GLint *result) const;
-    void getFloat(const std::string &name, GLfloat *result) const;
+    /**
+     * Whether the build is done, so that using the program doesn't wait for the driver.
+     * Without parallel shader compilation there's no way to tell, so it's always true then.
+     */
+    bool isReady() const;
+
+    // uniform functions, names are plain strings so they can be built without allocating (see FrameString)
+    void setBool(const GLchar *name, bool v1) const;
+    void setInt(const GLchar *name, GLint v1) const;
+    void setFloat(const GLchar *name, GLfloat v1) const;
+    void setBool(const GLchar *name, bool v1, bool v2) const;
+    void setInt(const GLchar *name, GLint v1, GLint v2) const;
+    void setFloat(const GLchar *name, GLfloat v1, GLfloat v2) const;
+    void setBool(const GLchar *name, bool v1, bool v2, bool v3) const;
+    void setInt(const GLchar *name, GLint v1, GLint v2, GLint v3) const;
+    void setFloat(const GLchar *name, GLfloat v1, GLfloat v2, GLfloat v3) const;
+    void setBool(const GLchar *name, bool v1, bool v2, bool v3, bool v4) const;
+    void setInt(const GLchar *name, GLint v1, GLint v2, GLint v3, GLint v4) const;
+    void setFloat(const GLchar *name, GLfloat v1, GLfloat v2, GLfloat v3, GLfloat v4) const;
+    void setFloat(const GLchar *name, const glm::vec2 &vec) const;
+    void setFloat(const GLchar *name, const glm::vec3 &vec) const;
+    void setFloat(const GLchar *name, const glm::vec4 &vec) const;
+    void setFloat(const GLchar *name, const glm::mat2 &mat) const;
+    void setFloat(const GLchar *name, const glm::mat3 &mat) const;
+    void setFloat(const GLchar *name, const glm::mat4 &mat) const;
+    void getBool(const GLchar *name, bool *result) const;
+    void getInt(const GLchar *name, GLint *result) const;
+    void getFloat(const GLchar *name, GLfloat *result) const;
+
+    // uniform blocks, blocks the program doesn't have are ignored
+    void setUniformBlockBinding(const GLchar *name, GLuint binding) const;
+
+    /**
+     * Build the program again from its files, in the background if the driver supports it.
+     * The current program stays in use until the new one is linked, then it's swapped with the uniform values
+     * carried over. A build that fails keeps the current program.
+     */
+    void reload();
+
+    /**
+     * Canonical paths of the files the program is built from, including the includes.
+     */
+    const std::vector<std::string> &getFiles() const;
+
+    /**
+     * Reload every shader that was built from the file.
+     * @param path Canonical path of the changed file.
+     */
+    static void reloadChanged(const std::string &path);
 
 private:
-    // shader program ID
-    GLuint id;
+    // shader program ID, replaced by use() once a reload is done
+    mutable GLuint id;
+
+    // compiles and link that were issued but not checked yet
+    struct PendingBuild
+    {
+        GLuint program;
+        std::vector<GLuint> shaders;
+        std::vector<std::vector<std::string>> files; // files of every stage, for compile errors
+        std::string cacheKey;                        // empty if the program cache isn't used
+    };
+
+    mutable std::unique_ptr<PendingBuild> pending;
+
+    // build of a reload, the current program stays in use until it's done
+    mutable std::unique_ptr<PendingBuild> reloading;
+
+    // what the program is built from, kept for reloads
+    std::vector<std::pair<GLenum, std::string>> stages;
+    std::vector<std::string> defines;
+
+    // canonical paths of all files of all stages, including the includes
+    std::vector<std::string> files;
+
+    // nested includes deeper than this are most likely a cycle
+    static constexpr int MAX_INCLUDE_DEPTH{16};
+
+    /**
+     * Read a shader file, replace every #include "file" line with the content of the file (relative to the
+     * including file, each file is included once) and add the defines after the #version line.
+     * Includes are expanded before the GLSL preprocessor runs, so an include inside #ifdef still counts as included.
+     * @param files Receives the paths of the file and its includes, compile errors refer to them by index.
+     */
+    static std::string loadSource(const std::string &path, const std::vector<std::string> &defines,
+                                  std::vector<std::string> &files);
+    static bool appendSource(const std::string &path, std::string &code, std::vector<std::string> &files, int depth);
+
+    /**
+     * Create the program from its stages and register it for reloads.
+     * @param stages Type and path of every stage.
+     */
+    void buildProgram(const std::vector<std::pair<GLenum, std::string>> &stages,
+                      const std::vector<std::string> &defines);
+
+    /**
+     * Load the sources of the stages into a program, the linked binary is taken from the program cache if it has one
+     * for the same sources and driver (see ProgramCache). Otherwise the compiles and the link are only issued.
+     * @return The build to finish, or nullptr if the program was taken from the cache.
+     */
+    std::unique_ptr<PendingBuild> startBuild(GLuint program);
+
+    /**
+     * Wait for a build, report its errors and store the program in the cache.
+     * @return Whether the program was linked.
+     */
+    bool finishBuild(PendingBuild &build) const;
+
+    /**
+     * Finish the initial build, and swap in the reloaded program if it's done.
+     */
+    void updateProgram() const;
+
+    /**
+     * Whether the compiles and the link of a program are done, always true without parallel shader compilation.
+     */
+    static bool isBuildDone(GLuint program);
+
+    /**
+     * Set the uniforms and uniform block bindings of a new program to the values of the old one.
+     */
+    static void copyUniforms(GLuint from, GLuint to);
 
-    void checkProgramLinkSuccess(GLuint program) const;
-    void checkShaderCompileSuccess(GLuint shader) const;
+    bool checkProgramLinkSuccess(GLuint program) const;
+    bool checkShaderCompileSuccess(GLuint shader) const;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,191 @@
+#include "ShaderVariants.h"
+
+ShaderVariants::ShaderVariants(const std::string &vertexShaderPath, const std::string &fragmentShaderPath,
+                               const std::vector<std::string> &features, const std::vector<std::string> &defines)
+    : vertexShaderPath(vertexShaderPath), fragmentShaderPath(fragmentShaderPath), features(features),
+      defines(defines)
+{
+}
+
+Shader &ShaderVariants::get(GLuint mask)
+{
+    return configure(getVariant(mask));
+}
+
+Shader &ShaderVariants::getReady(GLuint mask)
+{
+    Variant &variant = getVariant(mask);
+    if (variant.configured || variant.shader->isReady())
+    {
+        return configure(variant);
+    }
+
+    return get(0);
+}
+
+void ShaderVariants::prepare(GLuint mask)
+{
+    getVariant(mask);
+}
+
+std::size_t ShaderVariants::getVariantCount() const
+{
+    return variants.size();
+}
+
+std::size_t ShaderVariants::getPendingCount() const
+{
+    std::size_t count = 0;
+    for (const auto &variant : variants)
+    {
+        if (!variant.second.configured)
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+void ShaderVariants::setBool(const GLchar *name, bool v1)
+{
+    setInt(name, v1 ? 1 : 0);
+}
+
+void ShaderVariants::setInt(const GLchar *name, GLint v1)
+{
+    UniformValue value;
+    value.type = UniformValue::Type::integer;
+    value.integer = v1;
+    setUniform(name, value);
+}
+
+void ShaderVariants::setFloat(const GLchar *name, GLfloat v1)
+{
+    UniformValue value;
+    value.type = UniformValue::Type::float1;
+    value.floats[0][0] = v1;
+    setUniform(name, value);
+}
+
+void ShaderVariants::setFloat(const GLchar *name, GLfloat v1, GLfloat v2)
+{
+    UniformValue value;
+    value.type = UniformValue::Type::float2;
+    value.floats[0] = glm::vec4(v1, v2, 0.0f, 0.0f);
+    setUniform(name, value);
+}
+
+void ShaderVariants::setFloat(const GLchar *name, const glm::vec3 &vec)
+{
+    UniformValue value;
+    value.type = UniformValue::Type::float3;
+    value.floats[0] = glm::vec4(vec, 0.0f);
+    setUniform(name, value);
+}
+
+void ShaderVariants::setFloat(const GLchar *name, const glm::mat4 &mat)
+{
+    UniformValue value;
+    value.type = UniformValue::Type::matrix4;
+    value.floats = mat;
+    setUniform(name, value);
+}
+
+void ShaderVariants::setUniformBlockBinding(const GLchar *name, GLuint binding)
+{
+    uniformBlockBindings[name] = binding;
+    for (const auto &variant : variants)
+    {
+        if (variant.second.configured)
+        {
+            variant.second.shader->setUniformBlockBinding(name, binding);
+        }
+    }
+}
+
+ShaderVariants::Variant &ShaderVariants::getVariant(GLuint mask)
+{
+    auto existing = variants.find(mask);
+    if (existing != variants.end())
+    {
+        return existing->second;
+    }
+
+    std::vector<std::string> variantDefines = defines;
+    for (std::size_t bit = 0; bit < features.size(); bit++)
+    {
+        if (mask & (1u << bit))
+        {
+            variantDefines.push_back(features[bit]);
+        }
+    }
+
+    // only issues the compile, the uniforms are set once the variant is used
+    Variant &variant = variants[mask];
+    variant.shader = std::unique_ptr<Shader>(new Shader(vertexShaderPath, fragmentShaderPath, variantDefines));
+    return variant;
+}
+
+Shader &ShaderVariants::configure(Variant &variant)
+{
+    if (variant.configured)
+    {
+        return *variant.shader;
+    }
+
+    // setting the first uniform waits for the compile
+    for (const auto &binding : uniformBlockBindings)
+    {
+        variant.shader->setUniformBlockBinding(binding.first.c_str(), binding.second);
+    }
+    for (const auto &uniform : uniforms)
+    {
+        applyUniform(*variant.shader, uniform.first.c_str(), uniform.second);
+    }
+
+    variant.configured = true;
+    return *variant.shader;
+}
+
+void ShaderVariants::setUniform(const GLchar *name, const UniformValue &value)
+{
+    auto uniform = uniforms.find(name);
+    if (uniform != uniforms.end())
+    {
+        uniform->second = value;
+    }
+    else
+    {
+        uniforms.emplace(name, value);
+    }
+
+    for (const auto &variant : variants)
+    {
+        if (variant.second.configured)
+        {
+            applyUniform(*variant.second.shader, name, value);
+        }
+    }
+}
+
+void ShaderVariants::applyUniform(const Shader &shader, const GLchar *name, const UniformValue &value)
+{
+    switch (value.type)
+    {
+    case UniformValue::Type::integer:
+        shader.setInt(name, value.integer);
+        break;
+    case UniformValue::Type::float1:
+        shader.setFloat(name, value.floats[0][0]);
+        break;
+    case UniformValue::Type::float2:
+        shader.setFloat(name, value.floats[0][0], value.floats[0][1]);
+        break;
+    case UniformValue::Type::float3:
+        shader.setFloat(name, glm::vec3(value.floats[0]));
+        break;
+    case UniformValue::Type::matrix4:
+        shader.setFloat(name, value.floats);
+        break;
+    }
+}
\ No newline at end of file
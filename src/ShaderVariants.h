@@ -0,0 +1,115 @@
+#ifndef SHADERVARIANTS_H
+#define SHADERVARIANTS_H
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "lib/glad/include/glad/glad.h"
+
+#include "Shader.h"
+
+/**
+ * Permutations of one shader that differ in their preprocessor defines.
+ * Every bit of a variant mask stands for one feature define, a variant is compiled with exactly the defines of
+ * its bits the first time it's needed and cached by its mask afterwards.
+ * Uniforms are set on all variants at once, variants compiled later get the current values as well, so the
+ * variants can be used like a single shader.
+ * Variants can be compiled in the background (see Shader), getReady hands out the variant without features
+ * instead of waiting for one that isn't done yet.
+ */
+class ShaderVariants
+{
+public:
+    /**
+     * @param features Define of every bit of a mask, the first one is bit 0.
+     * @param defines Defines that all variants have, like the number of lights.
+     */
+    ShaderVariants(const std::string &vertexShaderPath, const std::string &fragmentShaderPath,
+                   const std::vector<std::string> &features, const std::vector<std::string> &defines = {});
+
+    /**
+     * The variant with the features of the mask, compiled on first use.
+     * Waits for the variant if it's still being compiled.
+     */
+    Shader &get(GLuint mask);
+
+    /**
+     * The variant with the features of the mask if it's done compiling, otherwise the fallback variant
+     * (mask 0, which only uses the material colors) and the variant keeps compiling in the background.
+     */
+    Shader &getReady(GLuint mask);
+
+    /**
+     * Start compiling a variant without waiting for it, so that it's ready by the time it's needed.
+     */
+    void prepare(GLuint mask);
+
+    std::size_t getVariantCount() const;
+
+    /**
+     * Number of variants that were started but not used yet, some of them may be done already.
+     */
+    std::size_t getPendingCount() const;
+
+    // uniform functions, the values are set on every variant
+    void setBool(const GLchar *name, bool v1);
+    void setInt(const GLchar *name, GLint v1);
+    void setFloat(const GLchar *name, GLfloat v1);
+    void setFloat(const GLchar *name, GLfloat v1, GLfloat v2);
+    void setFloat(const GLchar *name, const glm::vec3 &vec);
+    void setFloat(const GLchar *name, const glm::mat4 &mat);
+    void setUniformBlockBinding(const GLchar *name, GLuint binding);
+
+    // remove copy functions, the variants own OpenGL programs
+    ShaderVariants(ShaderVariants const &) = delete;
+    void operator=(ShaderVariants const &) = delete;
+
+private:
+    // last value of a uniform, kept to set it on variants that are compiled later
+    struct UniformValue
+    {
+        enum class Type
+        {
+            integer,
+            float1,
+            float2,
+            float3,
+            matrix4
+        };
+
+        Type type;
+        GLint integer{0};
+        glm::mat4 floats{0.0f}; // vectors use the first column
+    };
+
+    std::string vertexShaderPath;
+    std::string fragmentShaderPath;
+    std::vector<std::string> features;
+    std::vector<std::string> defines;
+
+    struct Variant
+    {
+        std::unique_ptr<Shader> shader;
+
+        // whether the uniforms were set, which waits for the compile
+        bool configured{false};
+    };
+
+    std::unordered_map<GLuint, Variant> variants;
+    // ordered with a transparent comparison, so updating a uniform looks it up without creating a string
+    std::map<std::string, UniformValue, std::less<>> uniforms;
+    std::unordered_map<std::string, GLuint> uniformBlockBindings;
+
+    Variant &getVariant(GLuint mask);
+    Shader &configure(Variant &variant);
+    void setUniform(const GLchar *name, const UniformValue &value);
+    static void applyUniform(const Shader &shader, const GLchar *name, const UniformValue &value);
+};
+
+#endif
\ No newline at end of file
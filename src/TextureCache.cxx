@@ -0,0 +1,243 @@
+#include "TextureCache.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <boost/filesystem.hpp>
+
+#include "DirectoryHelper.h"
+#include "GlExtensions.h"
+#include "MappedFile.h"
+
+namespace
+{
+    const char CACHE_MAGIC[4]{'O', 'G', 'T', 'X'};
+
+    // needs to be increased whenever the processing or the file layout changes, older entries are ignored then
+    const std::uint32_t CACHE_VERSION{2};
+
+    // guard against reading garbage sizes from broken files
+    const std::uint32_t MAX_LEVEL_COUNT{32};
+    const std::uint32_t MAX_SIZE{65536};
+
+    struct CacheHeader
+    {
+        char magic[4];
+        std::uint32_t version;
+        std::uint32_t internalFormat;
+        std::uint32_t format;
+        std::uint32_t width;
+        std::uint32_t height;
+        std::uint32_t levelCount;
+    };
+
+    std::uint64_t hashBytes(const unsigned char *data, std::size_t size, std::uint64_t hash)
+    {
+        // FNV-1a
+        for (std::size_t i = 0; i < size; i++)
+        {
+            hash ^= data[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    /**
+     * Size in bytes a level needs to have, so uploading it never reads past its end.
+     * @return False if the formats aren't ones the texture manager creates.
+     */
+    bool getLevelSize(const CacheHeader &header, std::uint32_t level, std::uint64_t &size)
+    {
+        std::uint64_t width = std::max(header.width >> level, 1u);
+        std::uint64_t height = std::max(header.height >> level, 1u);
+
+        // compressed levels consist of 4x4 blocks
+        if (header.format == 0)
+        {
+            std::uint64_t blockSize;
+            switch (header.internalFormat)
+            {
+            case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+            case GL_COMPRESSED_RED_RGTC1:
+                blockSize = 8;
+                break;
+            case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+            case GL_COMPRESSED_RG_RGTC2:
+            case GL_COMPRESSED_RGBA_BPTC_UNORM:
+                blockSize = 16;
+                break;
+            default:
+                return false;
+            }
+            size = (width + 3) / 4 * ((height + 3) / 4) * blockSize;
+            return true;
+        }
+
+        // uncompressed rows are tightly packed 8 bit channels
+        std::uint64_t channels;
+        switch (header.format)
+        {
+        case GL_RED:
+            channels = 1;
+            break;
+        case GL_RG:
+            channels = 2;
+            break;
+        case GL_RGB:
+            channels = 3;
+            break;
+        case GL_RGBA:
+            channels = 4;
+            break;
+        default:
+            return false;
+        }
+        size = width * height * channels;
+        return true;
+    }
+
+    std::string getPath(const std::string &key)
+    {
+        return DirectoryHelper::getInstance().locateCache(key + ".tex");
+    }
+} // namespace
+
+std::string TextureCache::makeKey(const unsigned char *data, std::size_t size, const std::string &variant)
+{
+    std::uint64_t hash = hashBytes(data, size, 14695981039346656037ull);
+    hash = hashBytes(reinterpret_cast<const unsigned char *>(variant.data()), variant.size(), hash);
+
+    std::ostringstream key;
+    key << std::hex << std::setw(16) << std::setfill('0') << hash;
+    return key.str();
+}
+
+bool TextureCache::read(const std::string &key, TextureImage &image)
+{
+    std::string path = getPath(key);
+    if (path.empty() || !boost::filesystem::exists(path))
+    {
+        return false;
+    }
+
+    MappedFile file;
+    if (!file.open(path))
+    {
+        return false;
+    }
+
+    // entries of older versions are ignored, they're replaced on the next write
+    return deserialize(file.getData(), file.getSize(), image);
+}
+
+void TextureCache::write(const std::string &key, const TextureImage &image)
+{
+    std::string path = getPath(key);
+    if (path.empty())
+    {
+        return;
+    }
+
+    // write to a temporary file first, so that a crash never leaves a half written entry behind
+    std::string temporaryPath = path + ".tmp";
+    {
+        std::vector<unsigned char> data = serialize(image);
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(data.data()), data.size());
+
+        if (!file)
+        {
+            std::cerr << "Failed writing texture cache entry '" << temporaryPath << "'" << std::endl;
+            return;
+        }
+    }
+
+    boost::system::error_code error;
+    boost::filesystem::rename(temporaryPath, path, error);
+    if (error)
+    {
+        std::cerr << "Failed moving texture cache entry to '" << path << "': " << error.message() << std::endl;
+    }
+}
+
+std::vector<unsigned char> TextureCache::serialize(const TextureImage &image)
+{
+    CacheHeader header;
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.internalFormat = image.internalFormat;
+    header.format = image.format;
+    header.width = image.width;
+    header.height = image.height;
+    header.levelCount = image.levels.size();
+
+    std::size_t size = sizeof(header);
+    for (const std::vector<unsigned char> &level : image.levels)
+    {
+        size += sizeof(std::uint32_t) + level.size();
+    }
+
+    std::vector<unsigned char> data(size);
+    unsigned char *position = data.data();
+    std::memcpy(position, &header, sizeof(header));
+    position += sizeof(header);
+    for (const std::vector<unsigned char> &level : image.levels)
+    {
+        std::uint32_t levelSize = level.size();
+        std::memcpy(position, &levelSize, sizeof(levelSize));
+        std::memcpy(position + sizeof(levelSize), level.data(), level.size());
+        position += sizeof(levelSize) + level.size();
+    }
+
+    return data;
+}
+
+bool TextureCache::deserialize(const unsigned char *data, std::size_t size, TextureImage &image)
+{
+    CacheHeader header;
+    if (size < sizeof(header))
+    {
+        return false;
+    }
+
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.version != CACHE_VERSION ||
+        header.levelCount == 0 || header.levelCount > MAX_LEVEL_COUNT || header.width == 0 ||
+        header.height == 0 || header.width > MAX_SIZE || header.height > MAX_SIZE)
+    {
+        return false;
+    }
+
+    image.internalFormat = header.internalFormat;
+    image.format = header.format;
+    image.width = header.width;
+    image.height = header.height;
+    image.levels.resize(header.levelCount);
+
+    std::size_t offset = sizeof(header);
+    for (std::uint32_t level = 0; level < header.levelCount; level++)
+    {
+        std::uint64_t expectedSize;
+        std::uint32_t levelSize = 0;
+        if (size - offset < sizeof(levelSize))
+        {
+            return false;
+        }
+        std::memcpy(&levelSize, data + offset, sizeof(levelSize));
+        offset += sizeof(levelSize);
+
+        // the level is uploaded with the size the header declares
+        if (size - offset < levelSize || !getLevelSize(header, level, expectedSize) || levelSize != expectedSize)
+        {
+            return false;
+        }
+        image.levels[level].assign(data + offset, data + offset + levelSize);
+        offset += levelSize;
+    }
+
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,44 @@
+#ifndef TEXTURECACHE_H
+#define TEXTURECACHE_H
+
+#include <string>
+#include <vector>
+
+#include "TextureImage.h"
+
+/**
+ * Stores processed textures (all mip levels, usually block compressed) in the user cache directory,
+ * so that they only have to be decoded and compressed on the first load.
+ * Entries are looked up by a key derived from the content of the source image, so changed images get new entries.
+ */
+namespace TextureCache
+{
+    /**
+     * Build the key of a source image.
+     * @param data Content of the image file, as it's stored on disk.
+     * @param variant Everything else that changes the processed result (e.g. whether the image is flipped).
+     */
+    std::string makeKey(const unsigned char *data, std::size_t size, const std::string &variant);
+
+    /**
+     * @return True if a valid entry was found and read into image.
+     */
+    bool read(const std::string &key, TextureImage &image);
+
+    /**
+     * Store an entry, failures are only logged since the cache is optional.
+     */
+    void write(const std::string &key, const TextureImage &image);
+
+    /**
+     * The content of an entry, also used for the textures baked into the AssetArchive.
+     */
+    std::vector<unsigned char> serialize(const TextureImage &image);
+
+    /**
+     * @return True if the data is a valid entry, which was read into image.
+     */
+    bool deserialize(const unsigned char *data, std::size_t size, TextureImage &image);
+} // namespace TextureCache
+
+#endif
\ No newline at end of file
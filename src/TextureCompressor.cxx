@@ -0,0 +1,500 @@
+#include "TextureCompressor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "GlExtensions.h"
+
+namespace
+{
+    const int BLOCK_PIXELS{16};
+
+    // iterations of the power method that finds the principal axis of a block
+    const int AXIS_ITERATIONS{8};
+
+    // pixels of one block, stored per channel so that four pixels can be processed at once
+    struct Block
+    {
+        alignas(16) float channels[4][BLOCK_PIXELS];
+    };
+
+    // writes a block bit by bit, starting at the least significant bit of the first byte
+    class BitWriter
+    {
+    public:
+        explicit BitWriter(unsigned char *output)
+            : output(output)
+        {
+            std::fill(output, output + 16, 0);
+        }
+
+        void write(unsigned int value, int bitCount)
+        {
+            for (int bit = 0; bit < bitCount; bit++, position++)
+            {
+                if ((value >> bit) & 1)
+                {
+                    output[position / 8] |= 1 << (position % 8);
+                }
+            }
+        }
+
+    private:
+        unsigned char *output;
+        std::size_t position{0};
+    };
+
+    Block fetchBlock(const unsigned char *pixels, GLuint width, GLuint height, int nrChannels,
+                     GLuint blockX, GLuint blockY)
+    {
+        Block block;
+        for (GLuint y = 0; y < 4; y++)
+        {
+            GLuint sourceY = std::min<GLuint>(blockY * 4 + y, height - 1);
+            for (GLuint x = 0; x < 4; x++)
+            {
+                GLuint sourceX = std::min<GLuint>(blockX * 4 + x, width - 1);
+                const unsigned char *pixel =
+                    pixels + (static_cast<std::size_t>(sourceY) * width + sourceX) * nrChannels;
+
+                for (int c = 0; c < 4; c++)
+                {
+                    // missing color channels are black, missing alpha is opaque
+                    block.channels[c][y * 4 + x] = c < nrChannels ? pixel[c] : (c == 3 ? 255.0f : 0.0f);
+                }
+            }
+        }
+        return block;
+    }
+
+    /**
+     * Fit a line through the pixels of a block and return the two outermost points of the pixels on it.
+     * Only the channels firstChannel to firstChannel + channelCount - 1 are looked at.
+     */
+    void fitLine(const Block &block, int firstChannel, int channelCount, float *from, float *to)
+    {
+        float mean[4]{};
+        for (int c = 0; c < channelCount; c++)
+        {
+            for (int i = 0; i < BLOCK_PIXELS; i++)
+            {
+                mean[c] += block.channels[firstChannel + c][i];
+            }
+            mean[c] /= BLOCK_PIXELS;
+        }
+
+        float covariance[4][4]{};
+        for (int i = 0; i < BLOCK_PIXELS; i++)
+        {
+            for (int a = 0; a < channelCount; a++)
+            {
+                for (int b = 0; b < channelCount; b++)
+                {
+                    covariance[a][b] += (block.channels[firstChannel + a][i] - mean[a]) *
+                                        (block.channels[firstChannel + b][i] - mean[b]);
+                }
+            }
+        }
+
+        // start at the row of the channel with the largest variance, which can't be orthogonal to the result
+        int largest = 0;
+        for (int c = 1; c < channelCount; c++)
+        {
+            if (covariance[c][c] > covariance[largest][largest])
+            {
+                largest = c;
+            }
+        }
+
+        float axis[4]{};
+        std::copy(covariance[largest], covariance[largest] + channelCount, axis);
+
+        for (int iteration = 0; iteration < AXIS_ITERATIONS; iteration++)
+        {
+            float next[4]{};
+            float length = 0.0f;
+            for (int a = 0; a < channelCount; a++)
+            {
+                for (int b = 0; b < channelCount; b++)
+                {
+                    next[a] += covariance[a][b] * axis[b];
+                }
+                length += next[a] * next[a];
+            }
+
+            if (length == 0.0f)
+            {
+                break;
+            }
+
+            length = std::sqrt(length);
+            for (int c = 0; c < channelCount; c++)
+            {
+                axis[c] = next[c] / length;
+            }
+        }
+
+        float minimum = 0.0f;
+        float maximum = 0.0f;
+        for (int i = 0; i < BLOCK_PIXELS; i++)
+        {
+            float t = 0.0f;
+            for (int c = 0; c < channelCount; c++)
+            {
+                t += (block.channels[firstChannel + c][i] - mean[c]) * axis[c];
+            }
+            minimum = std::min(minimum, t);
+            maximum = std::max(maximum, t);
+        }
+
+        for (int c = 0; c < channelCount; c++)
+        {
+            from[c] = std::min(std::max(mean[c] + axis[c] * minimum, 0.0f), 255.0f);
+            to[c] = std::min(std::max(mean[c] + axis[c] * maximum, 0.0f), 255.0f);
+        }
+    }
+
+    /**
+     * Project every pixel onto the line between two endpoints and round it to one of levels evenly spaced steps.
+     */
+    void quantizeToLine(const Block &block, int firstChannel, int channelCount, const float *from, const float *to,
+                        int levels, int *steps)
+    {
+        float direction[4]{};
+        float lengthSquared = 0.0f;
+        for (int c = 0; c < channelCount; c++)
+        {
+            direction[c] = to[c] - from[c];
+            lengthSquared += direction[c] * direction[c];
+        }
+
+        if (lengthSquared < 1e-6f)
+        {
+            std::fill(steps, steps + BLOCK_PIXELS, 0);
+            return;
+        }
+
+        float scale = (levels - 1) / lengthSquared;
+        float maxStep = static_cast<float>(levels - 1);
+
+#if defined(__SSE2__)
+        for (int i = 0; i < BLOCK_PIXELS; i += 4)
+        {
+            __m128 dot = _mm_setzero_ps();
+            for (int c = 0; c < channelCount; c++)
+            {
+                __m128 offset = _mm_sub_ps(_mm_load_ps(&block.channels[firstChannel + c][i]), _mm_set1_ps(from[c]));
+                dot = _mm_add_ps(dot, _mm_mul_ps(offset, _mm_set1_ps(direction[c])));
+            }
+
+            __m128 step = _mm_add_ps(_mm_mul_ps(dot, _mm_set1_ps(scale)), _mm_set1_ps(0.5f));
+            step = _mm_min_ps(_mm_max_ps(step, _mm_setzero_ps()), _mm_set1_ps(maxStep));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(&steps[i]), _mm_cvttps_epi32(step));
+        }
+#else
+        for (int i = 0; i < BLOCK_PIXELS; i++)
+        {
+            float dot = 0.0f;
+            for (int c = 0; c < channelCount; c++)
+            {
+                dot += (block.channels[firstChannel + c][i] - from[c]) * direction[c];
+            }
+
+            float step = std::min(std::max(dot * scale + 0.5f, 0.0f), maxStep);
+            steps[i] = static_cast<int>(step);
+        }
+#endif
+    }
+
+    std::uint16_t packRgb565(const float *color)
+    {
+        unsigned int r = static_cast<unsigned int>(color[0] * 31.0f / 255.0f + 0.5f);
+        unsigned int g = static_cast<unsigned int>(color[1] * 63.0f / 255.0f + 0.5f);
+        unsigned int b = static_cast<unsigned int>(color[2] * 31.0f / 255.0f + 0.5f);
+        return static_cast<std::uint16_t>((r << 11) | (g << 5) | b);
+    }
+
+    void unpackRgb565(std::uint16_t packed, float *color)
+    {
+        unsigned int r = packed >> 11;
+        unsigned int g = (packed >> 5) & 0x3f;
+        unsigned int b = packed & 0x1f;
+        color[0] = static_cast<float>((r << 3) | (r >> 2));
+        color[1] = static_cast<float>((g << 2) | (g >> 4));
+        color[2] = static_cast<float>((b << 3) | (b >> 2));
+    }
+
+    void encodeBc1(const Block &block, unsigned char *output)
+    {
+        float from[3];
+        float to[3];
+        fitLine(block, 0, 3, from, to);
+
+        // the four color mode is used if the first color is the larger one
+        std::uint16_t color0 = packRgb565(to);
+        std::uint16_t color1 = packRgb565(from);
+        if (color0 < color1)
+        {
+            std::swap(color0, color1);
+        }
+
+        // the palette is color0, color1, 2/3 color0 + 1/3 color1 and 1/3 color0 + 2/3 color1
+        std::uint32_t indices = 0;
+        if (color0 != color1)
+        {
+            float endpoint0[3];
+            float endpoint1[3];
+            unpackRgb565(color0, endpoint0);
+            unpackRgb565(color1, endpoint1);
+
+            int steps[BLOCK_PIXELS];
+            quantizeToLine(block, 0, 3, endpoint0, endpoint1, 4, steps);
+
+            static const std::uint32_t stepToIndex[4]{0, 2, 3, 1};
+            for (int i = 0; i < BLOCK_PIXELS; i++)
+            {
+                indices |= stepToIndex[steps[i]] << (2 * i);
+            }
+        }
+
+        output[0] = color0 & 0xff;
+        output[1] = color0 >> 8;
+        output[2] = color1 & 0xff;
+        output[3] = color1 >> 8;
+        for (int i = 0; i < 4; i++)
+        {
+            output[4 + i] = (indices >> (8 * i)) & 0xff;
+        }
+    }
+
+    void encodeBc4(const Block &block, int channel, unsigned char *output)
+    {
+        const float *values = block.channels[channel];
+        float minimum = *std::min_element(values, values + BLOCK_PIXELS);
+        float maximum = *std::max_element(values, values + BLOCK_PIXELS);
+
+        // the eight value mode is used if the first value is the larger one
+        unsigned int value0 = static_cast<unsigned int>(maximum + 0.5f);
+        unsigned int value1 = static_cast<unsigned int>(minimum + 0.5f);
+
+        std::uint64_t bits = value0 | (value1 << 8);
+        if (value0 > value1)
+        {
+            float endpoint0 = static_cast<float>(value0);
+            float endpoint1 = static_cast<float>(value1);
+
+            int steps[BLOCK_PIXELS];
+            quantizeToLine(block, channel, 1, &endpoint0, &endpoint1, 8, steps);
+
+            // the palette is value0, value1 and then the six values in between, starting next to value0
+            static const std::uint64_t stepToIndex[8]{0, 2, 3, 4, 5, 6, 7, 1};
+            for (int i = 0; i < BLOCK_PIXELS; i++)
+            {
+                bits |= stepToIndex[steps[i]] << (16 + 3 * i);
+            }
+        }
+
+        for (int i = 0; i < 8; i++)
+        {
+            output[i] = (bits >> (8 * i)) & 0xff;
+        }
+    }
+
+    /**
+     * Round an RGBA endpoint to 7 bits per channel plus a shared lowest bit (p-bit), whichever p-bit fits better.
+     */
+    void quantizeBc7Endpoint(const float *endpoint, unsigned int *quantized, unsigned int &pBit, float *reconstructed)
+    {
+        float bestError = std::numeric_limits<float>::max();
+        for (unsigned int p = 0; p < 2; p++)
+        {
+            unsigned int candidate[4];
+            float error = 0.0f;
+            for (int c = 0; c < 4; c++)
+            {
+                float value = std::round((endpoint[c] - p) / 2.0f);
+                candidate[c] = static_cast<unsigned int>(std::min(std::max(value, 0.0f), 127.0f));
+                float difference = endpoint[c] - (candidate[c] * 2 + p);
+                error += difference * difference;
+            }
+
+            if (error < bestError)
+            {
+                bestError = error;
+                pBit = p;
+                for (int c = 0; c < 4; c++)
+                {
+                    quantized[c] = candidate[c];
+                    reconstructed[c] = static_cast<float>(candidate[c] * 2 + p);
+                }
+            }
+        }
+    }
+
+    void encodeBc7Mode6(const Block &block, unsigned char *output)
+    {
+        float from[4];
+        float to[4];
+        fitLine(block, 0, 4, from, to);
+
+        unsigned int endpoint0[4];
+        unsigned int endpoint1[4];
+        unsigned int pBit0 = 0;
+        unsigned int pBit1 = 0;
+        float reconstructed0[4];
+        float reconstructed1[4];
+        quantizeBc7Endpoint(from, endpoint0, pBit0, reconstructed0);
+        quantizeBc7Endpoint(to, endpoint1, pBit1, reconstructed1);
+
+        int steps[BLOCK_PIXELS];
+        quantizeToLine(block, 0, 4, reconstructed0, reconstructed1, 16, steps);
+
+        // the highest index bit of the first pixel isn't stored and always zero, swap the endpoints if needed
+        if (steps[0] >= 8)
+        {
+            std::swap(endpoint0, endpoint1);
+            std::swap(pBit0, pBit1);
+            for (int i = 0; i < BLOCK_PIXELS; i++)
+            {
+                steps[i] = 15 - steps[i];
+            }
+        }
+
+        BitWriter writer(output);
+        writer.write(1 << 6, 7); // mode 6
+        for (int c = 0; c < 4; c++)
+        {
+            writer.write(endpoint0[c], 7);
+            writer.write(endpoint1[c], 7);
+        }
+        writer.write(pBit0, 1);
+        writer.write(pBit1, 1);
+        writer.write(steps[0], 3);
+        for (int i = 1; i < BLOCK_PIXELS; i++)
+        {
+            writer.write(steps[i], 4);
+        }
+    }
+} // namespace
+
+bool TextureCompressor::chooseFormat(int nrChannels, bool hasAlpha, BlockFormat &format)
+{
+    if (nrChannels == 1)
+    {
+        // RGTC is part of OpenGL 3.0
+        format = BlockFormat::bc4;
+        return true;
+    }
+
+    if (nrChannels != 3 && nrChannels != 4)
+    {
+        return false;
+    }
+
+    if ((nrChannels == 3 || !hasAlpha) && GlExtensions::hasS3tcCompression())
+    {
+        format = BlockFormat::bc1;
+    }
+    else if (GlExtensions::hasBptcCompression())
+    {
+        format = BlockFormat::bc7;
+    }
+    else if (GlExtensions::hasS3tcCompression())
+    {
+        format = BlockFormat::bc3;
+    }
+    else
+    {
+        return false;
+    }
+
+    return true;
+}
+
+GLenum TextureCompressor::getInternalFormat(BlockFormat format)
+{
+    switch (format)
+    {
+    case BlockFormat::bc1:
+        return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case BlockFormat::bc3:
+        return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case BlockFormat::bc4:
+        return GL_COMPRESSED_RED_RGTC1;
+    case BlockFormat::bc5:
+        return GL_COMPRESSED_RG_RGTC2;
+    case BlockFormat::bc7:
+        return GL_COMPRESSED_RGBA_BPTC_UNORM;
+    }
+    return 0;
+}
+
+std::size_t TextureCompressor::getBlockSize(BlockFormat format)
+{
+    return format == BlockFormat::bc1 || format == BlockFormat::bc4 ? 8 : 16;
+}
+
+std::vector<unsigned char> TextureCompressor::compress(const unsigned char *pixels, GLuint width, GLuint height,
+                                                       int nrChannels, BlockFormat format)
+{
+    std::size_t blockSize = getBlockSize(format);
+    GLuint blocksX = (width + 3) / 4;
+    GLuint blocksY = (height + 3) / 4;
+
+    std::vector<unsigned char> output(static_cast<std::size_t>(blocksX) * blocksY * blockSize);
+    for (GLuint blockY = 0; blockY < blocksY; blockY++)
+    {
+        for (GLuint blockX = 0; blockX < blocksX; blockX++)
+        {
+            Block block = fetchBlock(pixels, width, height, nrChannels, blockX, blockY);
+            unsigned char *blockOutput = &output[(static_cast<std::size_t>(blockY) * blocksX + blockX) * blockSize];
+
+            switch (format)
+            {
+            case BlockFormat::bc1:
+                encodeBc1(block, blockOutput);
+                break;
+            case BlockFormat::bc3:
+                encodeBc4(block, 3, blockOutput);
+                encodeBc1(block, blockOutput + 8);
+                break;
+            case BlockFormat::bc4:
+                encodeBc4(block, 0, blockOutput);
+                break;
+            case BlockFormat::bc5:
+                encodeBc4(block, 0, blockOutput);
+                encodeBc4(block, 1, blockOutput + 8);
+                break;
+            case BlockFormat::bc7:
+                encodeBc7Mode6(block, blockOutput);
+                break;
+            }
+        }
+    }
+
+    return output;
+}
+
+TextureImage TextureCompressor::compressMipmaps(const std::vector<std::vector<unsigned char>> &levels,
+                                                GLuint width, GLuint height, int nrChannels, BlockFormat format)
+{
+    TextureImage image;
+    image.internalFormat = getInternalFormat(format);
+    image.width = width;
+    image.height = height;
+
+    for (std::size_t level = 0; level < levels.size(); level++)
+    {
+        GLuint levelWidth = std::max<GLuint>(width >> level, 1);
+        GLuint levelHeight = std::max<GLuint>(height >> level, 1);
+        image.levels.push_back(compress(levels[level].data(), levelWidth, levelHeight, nrChannels, format));
+    }
+
+    return image;
+}
\ No newline at end of file
@@ -0,0 +1,57 @@
+#ifndef TEXTURECOMPRESSOR_H
+#define TEXTURECOMPRESSOR_H
+
+#include <vector>
+
+#include "lib/glad/include/glad/glad.h"
+
+#include "TextureImage.h"
+
+/**
+ * Block compression formats, every block covers 4x4 pixels.
+ */
+enum class BlockFormat
+{
+    bc1, // RGB, 8 bytes per block
+    bc3, // RGBA, BC1 color and BC4 alpha, 16 bytes per block
+    bc4, // single channel, 8 bytes per block
+    bc5, // two channels (normal maps), two BC4 blocks
+    bc7  // RGBA, only mode 6 (one subset, 4 bit indices), 16 bytes per block
+};
+
+/**
+ * CPU encoder for BCn compressed textures.
+ * Endpoints are fitted along the principal axis of every block, which is fast enough to compress at load time
+ * and way better than a bounding box. The per pixel index search uses SSE2 if available.
+ */
+namespace TextureCompressor
+{
+    /**
+     * Pick the block format for an image, depending on what the context supports.
+     * @param hasAlpha Whether a 4 channel image has any pixel that isn't fully opaque.
+     * @return False if the image should stay uncompressed.
+     */
+    bool chooseFormat(int nrChannels, bool hasAlpha, BlockFormat &format);
+
+    GLenum getInternalFormat(BlockFormat format);
+
+    /**
+     * Size of one 4x4 block in bytes.
+     */
+    std::size_t getBlockSize(BlockFormat format);
+
+    /**
+     * Compress one image, sizes that aren't a multiple of 4 are padded by repeating the last row or column.
+     * @param pixels Tightly packed 8 bit pixels with nrChannels channels.
+     */
+    std::vector<unsigned char> compress(const unsigned char *pixels, GLuint width, GLuint height, int nrChannels,
+                                        BlockFormat format);
+
+    /**
+     * Compress all levels of a mip chain (see MipmapGenerator).
+     */
+    TextureImage compressMipmaps(const std::vector<std::vector<unsigned char>> &levels, GLuint width, GLuint height,
+                                 int nrChannels, BlockFormat format);
+} // namespace TextureCompressor
+
+#endif
\ No newline at end of file
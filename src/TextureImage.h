@@ -0,0 +1,27 @@
+#ifndef TEXTUREIMAGE_H
+#define TEXTUREIMAGE_H
+
+#include <vector>
+
+#include "lib/glad/include/glad/glad.h"
+
+/**
+ * A texture with all of its mip levels, ready to be uploaded.
+ */
+struct TextureImage
+{
+    GLenum internalFormat{0};
+    GLenum format{0}; // pixel format of the levels, 0 if they are block compressed
+    GLuint width{0};
+    GLuint height{0};
+
+    // level 0 is the full size image, every further level halves the size down to 1x1
+    std::vector<std::vector<unsigned char>> levels;
+
+    bool isCompressed() const
+    {
+        return format == 0;
+    }
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,615 @@
+#define STB_IMAGE_IMPLEMENTATION // stb_image.h one time initialization
+
+#include "TextureManager.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+#include <boost/filesystem.hpp>
+
+#include "lib/stb_image.h"
+
+#include "AssetArchive.h"
+#include "GlExtensions.h"
+#include "MappedFile.h"
+#include "MipmapGenerator.h"
+#include "TextureCache.h"
+#include "TextureCompressor.h"
+
+namespace
+{
+    bool hasTransparentPixels(const unsigned char *pixels, GLuint width, GLuint height, int nrChannels)
+    {
+        if (nrChannels != 4)
+        {
+            return false;
+        }
+
+        std::size_t pixelCount = static_cast<std::size_t>(width) * height;
+        for (std::size_t i = 0; i < pixelCount; i++)
+        {
+            if (pixels[i * 4 + 3] != 255)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+} // namespace
+
+SharedTexture::SharedTexture(TextureHandle texture)
+    : texture(texture)
+{
+    if (isValid())
+    {
+        TextureManager::getInstance().retain(texture);
+    }
+}
+
+SharedTexture::SharedTexture(const SharedTexture &other)
+    : SharedTexture(other.texture)
+{
+}
+
+SharedTexture::SharedTexture(SharedTexture &&other) noexcept
+    : texture(other.texture)
+{
+    other.texture = TextureHandle();
+}
+
+SharedTexture &SharedTexture::operator=(SharedTexture other) noexcept
+{
+    std::swap(texture, other.texture);
+    return *this;
+}
+
+SharedTexture::~SharedTexture()
+{
+    if (isValid())
+    {
+        TextureManager::getInstance().release(texture);
+    }
+}
+
+bool SharedTexture::isValid() const
+{
+    return texture != TextureHandle();
+}
+
+GLuint SharedTexture::getId() const
+{
+    return isValid() ? TextureManager::getInstance().pool.getHot(texture).id : 0;
+}
+
+TextureManager &TextureManager::getInstance()
+{
+    static TextureManager instance;
+    return instance;
+}
+
+SharedTexture TextureManager::load(const std::string &path, TextureType type)
+{
+    // textures baked into the asset archive only need to be uploaded, files without a baked texture
+    // for this context are decoded from the archive like any other file
+    bool archived = AssetArchive::isArchivePath(path);
+    if (archived)
+    {
+        SharedTexture baked = loadBaked(path, type);
+        if (baked.isValid())
+        {
+            return baked;
+        }
+    }
+
+    boost::system::error_code error;
+    std::string canonicalPath = archived ? AssetArchive::makePath(AssetArchive::getName(path))
+                                         : boost::filesystem::canonical(path, error).string();
+
+    MappedFile file;
+    if (error || !file.open(path))
+    {
+        // TODO: Add some error handling or fallback behavior
+        std::cerr << "Could not read texture from '" << path << "'" << std::endl;
+        return SharedTexture();
+    }
+
+    // make sure the image is loaded in a way that represents OpenGL texture coordinates
+    std::string cacheKey = TextureCache::makeKey(file.getData(), file.getSize(), getCacheVariant(true, type));
+    std::string key = canonicalPath + '|' + cacheKey;
+
+    SharedTexture texture = find(key);
+    if (texture.isValid())
+    {
+        return texture;
+    }
+
+    std::size_t bytes = 0;
+    GLuint id = createFromMemory(file.getData(), file.getSize(), true, type, cacheKey, bytes);
+    if (id == 0)
+    {
+        std::cerr << "Could not decode texture '" << path << "'" << std::endl;
+        return SharedTexture();
+    }
+
+    // remember where the texture came from, for reloads
+    SharedTexture reference = add(key, id, bytes);
+    ManagedTextureInfo &info = pool.getCold(reference.texture);
+    info.path = canonicalPath;
+    info.type = type;
+    return reference;
+}
+
+SharedTexture TextureManager::loadBaked(const std::string &path, TextureType type)
+{
+    std::string name = AssetArchive::getName(path) + '|' + getCacheVariant(true, type);
+    std::string key = AssetArchive::makePath(name);
+    SharedTexture texture = find(key);
+    if (texture.isValid())
+    {
+        return texture;
+    }
+
+    const unsigned char *data;
+    std::size_t size;
+    TextureImage image;
+    if (!AssetArchive::getInstance().find(name, data, size) || !TextureCache::deserialize(data, size, image))
+    {
+        return SharedTexture();
+    }
+
+    std::size_t bytes = 0;
+    GLuint id = createGlTexture(image, bytes);
+    return add(key, id, bytes);
+}
+
+SharedTexture TextureManager::loadFromMemory(const std::string &name, const unsigned char *data, std::size_t size,
+                                             TextureType type)
+{
+    std::string cacheKey = TextureCache::makeKey(data, size, getCacheVariant(false, type));
+    std::string key = name + '|' + cacheKey;
+
+    SharedTexture texture = find(key);
+    if (texture.isValid())
+    {
+        return texture;
+    }
+
+    std::size_t bytes = 0;
+    GLuint id = createFromMemory(data, size, false, type, cacheKey, bytes);
+    if (id == 0)
+    {
+        // TODO: Add some error handling or fallback behavior
+        std::cerr << "Could not read embedded texture '" << name << "'" << std::endl;
+        return SharedTexture();
+    }
+
+    return add(key, id, bytes);
+}
+
+SharedTexture TextureManager::loadFromPixels(const std::string &name, const unsigned char *pixels, GLuint width,
+                                             GLuint height, TextureType type)
+{
+    std::string cacheKey = TextureCache::makeKey(pixels, static_cast<std::size_t>(width) * height * 4,
+                                                 getCacheVariant(false, type) + ",raw");
+    std::string key = name + '|' + cacheKey;
+
+    SharedTexture texture = find(key);
+    if (texture.isValid())
+    {
+        return texture;
+    }
+
+    std::size_t bytes = 0;
+    GLuint id = createFromPixels(pixels, width, height, 4, type, cacheKey, bytes);
+    return id == 0 ? SharedTexture() : add(key, id, bytes);
+}
+
+TextureManager::PreparedTexture TextureManager::prepareFromMemory(const std::string &name, const unsigned char *data,
+                                                                 std::size_t size, bool flipVertically,
+                                                                 TextureType type)
+{
+    PreparedTexture prepared;
+    std::string cacheKey = TextureCache::makeKey(data, size, getCacheVariant(flipVertically, type));
+    prepared.key = name + '|' + cacheKey;
+    if (TextureCache::read(cacheKey, prepared.image))
+    {
+        return prepared;
+    }
+
+    // only changes the flip setting of the calling thread
+    stbi_set_flip_vertically_on_load_thread(flipVertically);
+    int width, height, nrChannels;
+    unsigned char *textureData = stbi_load_from_memory(data, size, &width, &height, &nrChannels, 0);
+    stbi_set_flip_vertically_on_load_thread(false);
+
+    if (!textureData)
+    {
+        std::cerr << "Could not decode embedded texture '" << name << "'" << std::endl;
+        return prepared;
+    }
+
+    if (!processPixels(textureData, width, height, nrChannels, type, cacheKey, prepared.image))
+    {
+        prepared.image.levels.clear();
+    }
+    stbi_image_free(textureData);
+
+    return prepared;
+}
+
+SharedTexture TextureManager::addPrepared(const PreparedTexture &prepared)
+{
+    SharedTexture texture = find(prepared.key);
+    if (texture.isValid() || prepared.image.levels.empty())
+    {
+        return texture;
+    }
+
+    std::size_t bytes = 0;
+    GLuint id = createGlTexture(prepared.image, bytes);
+    return add(prepared.key, id, bytes);
+}
+
+void TextureManager::setBudget(std::size_t bytes)
+{
+    budget = bytes;
+    evict(budget);
+}
+
+std::size_t TextureManager::getBudget() const
+{
+    return budget;
+}
+
+std::size_t TextureManager::getUsedBytes() const
+{
+    return usedBytes;
+}
+
+std::size_t TextureManager::getUnusedBytes() const
+{
+    return unusedBytes;
+}
+
+std::size_t TextureManager::getTextureCount() const
+{
+    return textures.size();
+}
+
+void TextureManager::reloadChanged(const std::string &path)
+{
+    for (const auto &texture : textures)
+    {
+        const ManagedTextureInfo &info = pool.getCold(texture.second);
+        if (info.path == path)
+        {
+            Reload reload;
+            reload.key = texture.first;
+            reload.result = std::async(std::launch::async, processFile, path, info.type);
+            reloads.push_back(std::move(reload));
+        }
+    }
+}
+
+std::vector<std::pair<GLuint, GLuint>> TextureManager::finishReloads()
+{
+    glDeleteTextures(retired.size(), retired.data());
+    retired.clear();
+
+    std::vector<std::pair<GLuint, GLuint>> replaced;
+    for (auto reload = reloads.begin(); reload != reloads.end();)
+    {
+        if (reload->result.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            reload++;
+            continue;
+        }
+
+        ReloadResult result = reload->result.get();
+        std::string key = reload->key;
+        reload = reloads.erase(reload);
+
+        // the texture may have been evicted in the meantime, and files that were only touched keep their key
+        auto entry = textures.find(key);
+        if (entry == textures.end() || result.image.levels.empty() ||
+            key == pool.getCold(entry->second).path + '|' + result.cacheKey)
+        {
+            continue;
+        }
+
+        TextureHandle texture = entry->second;
+        GLuint oldId = pool.getHot(texture).id;
+        replace(texture, result);
+        replaced.emplace_back(oldId, pool.getHot(texture).id);
+    }
+
+    return replaced;
+}
+
+void TextureManager::releaseUnused()
+{
+    // destroying the futures waits for the worker threads
+    reloads.clear();
+    glDeleteTextures(retired.size(), retired.data());
+    retired.clear();
+
+    evict(0);
+}
+
+void TextureManager::retain(TextureHandle texture)
+{
+    ManagedTexture &managed = pool.getHot(texture);
+    if (managed.references == 0)
+    {
+        // it's in use again, so it can't be evicted anymore
+        unused.erase(pool.getCold(texture).unusedPosition);
+        unusedBytes -= managed.bytes;
+    }
+    managed.references++;
+}
+
+void TextureManager::release(TextureHandle texture)
+{
+    ManagedTexture &managed = pool.getHot(texture);
+    managed.references--;
+    if (managed.references == 0)
+    {
+        pool.getCold(texture).unusedPosition = unused.insert(unused.end(), texture);
+        unusedBytes += managed.bytes;
+        evict(budget);
+    }
+}
+
+void TextureManager::evict(std::size_t maxUsedBytes)
+{
+    while (usedBytes > maxUsedBytes && !unused.empty())
+    {
+        TextureHandle texture = unused.front();
+        unused.pop_front();
+
+        const ManagedTexture &managed = pool.getHot(texture);
+        glDeleteTextures(1, &managed.id);
+        unusedBytes -= managed.bytes;
+        usedBytes -= managed.bytes;
+
+        textures.erase(pool.getCold(texture).key);
+        pool.destroy(texture);
+    }
+}
+
+void TextureManager::replace(TextureHandle texture, const ReloadResult &result)
+{
+    ManagedTexture &managed = pool.getHot(texture);
+    ManagedTextureInfo &info = pool.getCold(texture);
+
+    std::size_t bytes = 0;
+    GLuint id = createGlTexture(result.image, bytes);
+    retired.push_back(managed.id);
+    managed.id = id;
+
+    usedBytes = usedBytes - managed.bytes + bytes;
+    if (managed.references == 0)
+    {
+        unusedBytes = unusedBytes - managed.bytes + bytes;
+    }
+    managed.bytes = bytes;
+
+    // the key follows the content, so loading the changed file again shares the texture
+    std::string key = info.path + '|' + result.cacheKey;
+    if (textures.count(key) > 0)
+    {
+        // the changed file was loaded already, keep this one under a key that's never looked up
+        key += '|' + std::to_string(id);
+    }
+
+    textures.erase(info.key);
+    info.key = key;
+    textures.insert({key, texture});
+}
+
+SharedTexture TextureManager::find(const std::string &key)
+{
+    auto texture = textures.find(key);
+    return texture == textures.end() ? SharedTexture() : SharedTexture(texture->second);
+}
+
+SharedTexture TextureManager::add(const std::string &key, GLuint id, std::size_t bytes)
+{
+    ManagedTexture managed;
+    managed.id = id;
+    managed.bytes = bytes;
+    ManagedTextureInfo info;
+    info.key = key;
+    TextureHandle texture = pool.create(managed, std::move(info));
+
+    // textures start without references, the returned reference is the first one
+    pool.getCold(texture).unusedPosition = unused.insert(unused.end(), texture);
+    unusedBytes += bytes;
+    usedBytes += bytes;
+    textures.insert({key, texture});
+
+    SharedTexture reference(texture);
+
+    // make room for the new texture
+    evict(budget);
+
+    return reference;
+}
+
+std::string TextureManager::getCacheVariant(bool flipVertically, TextureType type)
+{
+    std::string variant = flipVertically ? "flipped" : "upright";
+
+    // specular maps hold intensities, everything else is color and needs to be filtered in linear space
+    variant += type == TextureType::specular ? ",linear" : ",srgb";
+
+    // the chosen block format depends on the context, so that's part of the key as well
+    variant += GlExtensions::hasS3tcCompression() ? ",s3tc" : "";
+    variant += GlExtensions::hasBptcCompression() ? ",bptc" : "";
+    return variant;
+}
+
+GLuint TextureManager::createFromMemory(const unsigned char *data, std::size_t size, bool flipVertically,
+                                        TextureType type, const std::string &cacheKey, std::size_t &bytes)
+{
+    TextureImage image;
+    if (TextureCache::read(cacheKey, image))
+    {
+        return createGlTexture(image, bytes);
+    }
+
+    // read image into byte array, the flip setting is per thread since images are also decoded by jobs
+    // (see prepareFromMemory), which can run on this thread as well
+    stbi_set_flip_vertically_on_load_thread(flipVertically);
+    int width, height, nrChannels;
+    unsigned char *textureData = stbi_load_from_memory(data, size, &width, &height, &nrChannels, 0);
+
+    // disable vertical flipping again, for future loads that might not need it
+    stbi_set_flip_vertically_on_load_thread(false);
+
+    if (!textureData)
+    {
+        return 0;
+    }
+
+    GLuint texture = createFromPixels(textureData, width, height, nrChannels, type, cacheKey, bytes);
+
+    // free the texture data again
+    stbi_image_free(textureData);
+
+    return texture;
+}
+
+TextureManager::ReloadResult TextureManager::processFile(const std::string &path, TextureType type)
+{
+    ReloadResult result;
+
+    std::ifstream file(path, std::ios::binary);
+    std::vector<unsigned char> fileData((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (!file)
+    {
+        std::cerr << "Could not read texture from '" << path << "'" << std::endl;
+        return result;
+    }
+
+    // the same key as load uses, see there
+    result.cacheKey = TextureCache::makeKey(fileData.data(), fileData.size(), getCacheVariant(true, type));
+    if (TextureCache::read(result.cacheKey, result.image))
+    {
+        return result;
+    }
+
+    // the flip setting of the main thread is left alone
+    stbi_set_flip_vertically_on_load_thread(true);
+    int width, height, nrChannels;
+    unsigned char *textureData = stbi_load_from_memory(fileData.data(), fileData.size(), &width, &height,
+                                                       &nrChannels, 0);
+    if (!textureData)
+    {
+        std::cerr << "Could not decode texture '" << path << "'" << std::endl;
+        return result;
+    }
+
+    if (!processPixels(textureData, width, height, nrChannels, type, result.cacheKey, result.image))
+    {
+        result.image.levels.clear();
+    }
+    stbi_image_free(textureData);
+
+    return result;
+}
+
+bool TextureManager::processPixels(const unsigned char *pixels, GLuint width, GLuint height, int nrChannels,
+                                   TextureType type, const std::string &cacheKey, TextureImage &image)
+{
+    bool hasAlpha = hasTransparentPixels(pixels, width, height, nrChannels);
+
+    MipmapOptions mipmapOptions;
+    mipmapOptions.srgb = type != TextureType::specular;
+    mipmapOptions.preserveAlphaCoverage = hasAlpha;
+    std::vector<std::vector<unsigned char>> levels =
+        MipmapGenerator::generate(pixels, width, height, nrChannels, mipmapOptions);
+
+    BlockFormat blockFormat;
+    if (TextureCompressor::chooseFormat(nrChannels, hasAlpha, blockFormat))
+    {
+        image = TextureCompressor::compressMipmaps(levels, width, height, nrChannels, blockFormat);
+    }
+    else if (nrChannels == 1 || nrChannels == 3 || nrChannels == 4)
+    {
+        static const GLenum formats[]{0, GL_RED, 0, GL_RGB, GL_RGBA};
+        image.internalFormat = formats[nrChannels];
+        image.format = formats[nrChannels];
+        image.width = width;
+        image.height = height;
+        image.levels = std::move(levels);
+    }
+    else
+    {
+        std::cerr << "Unexpected number of channels: " << nrChannels << std::endl;
+        return false;
+    }
+
+    TextureCache::write(cacheKey, image);
+    return true;
+}
+
+GLuint TextureManager::createFromPixels(const unsigned char *pixels, GLuint width, GLuint height, int nrChannels,
+                                        TextureType type, const std::string &cacheKey, std::size_t &bytes)
+{
+    TextureImage image;
+    if (!TextureCache::read(cacheKey, image) &&
+        !processPixels(pixels, width, height, nrChannels, type, cacheKey, image))
+    {
+        return 0;
+    }
+
+    return createGlTexture(image, bytes);
+}
+
+GLuint TextureManager::createGlTexture(const TextureImage &image, std::size_t &bytes, GLint wrappingMode)
+{
+    // create texture
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+
+    // set texture attributes (repeat and use linear filtering)
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrappingMode);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrappingMode);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, image.levels.size() - 1);
+
+    // rows of uncompressed levels are tightly packed
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    // copy all ready made mip levels
+    bytes = 0;
+    for (std::size_t level = 0; level < image.levels.size(); level++)
+    {
+        GLsizei levelWidth = std::max<GLsizei>(image.width >> level, 1);
+        GLsizei levelHeight = std::max<GLsizei>(image.height >> level, 1);
+
+        if (image.isCompressed())
+        {
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, image.internalFormat, levelWidth, levelHeight, 0,
+                                   image.levels[level].size(), image.levels[level].data());
+        }
+        else
+        {
+            glTexImage2D(GL_TEXTURE_2D, level, image.internalFormat, levelWidth, levelHeight, 0, image.format,
+                         GL_UNSIGNED_BYTE, image.levels[level].data());
+        }
+
+        // the driver may pad uncompressed RGB to four bytes, but the level size is close enough for accounting
+        bytes += image.levels[level].size();
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    return texture;
+}
\ No newline at end of file
@@ -0,0 +1,267 @@
+#ifndef TEXTUREMANAGER_H
+#define TEXTUREMANAGER_H
+
+#include <future>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "lib/glad/include/glad/glad.h"
+
+#include "ObjectPool.h"
+#include "TextureImage.h"
+
+enum class TextureType
+{
+    diffuse,
+    specular,
+    emissive
+};
+
+struct TextureTag;
+using TextureHandle = Handle<TextureTag>;
+
+/**
+ * Bookkeeping of one texture of the TextureManager, the part that's read whenever the texture is used.
+ */
+struct ManagedTexture
+{
+    GLuint id{0};
+    std::size_t bytes{0};
+    std::size_t references{0};
+};
+
+/**
+ * Rest of the bookkeeping of a texture, only needed to load, reload and evict it.
+ */
+struct ManagedTextureInfo
+{
+    std::string key;
+
+    // canonical path and type of textures loaded from a file, empty for embedded textures
+    std::string path;
+    TextureType type{TextureType::diffuse};
+
+    // position in the least recently used list, only valid while there are no references
+    std::list<TextureHandle>::iterator unusedPosition;
+};
+
+/**
+ * Reference counted handle to a texture of the TextureManager.
+ * The texture stays loaded as long as a reference to it exists, afterwards it's kept around
+ * until the memory budget of the manager is exceeded.
+ */
+class SharedTexture
+{
+public:
+    SharedTexture() = default;
+    SharedTexture(const SharedTexture &other);
+    SharedTexture(SharedTexture &&other) noexcept;
+    SharedTexture &operator=(SharedTexture other) noexcept;
+    virtual ~SharedTexture();
+
+    bool isValid() const;
+
+    /**
+     * @return The OpenGL texture, or 0 for an invalid reference.
+     */
+    GLuint getId() const;
+
+private:
+    friend class TextureManager;
+
+    TextureHandle texture;
+
+    explicit SharedTexture(TextureHandle texture);
+};
+
+/**
+ * Loads textures once for the whole process, no matter how many models use them.
+ * Textures are identified by the canonical path of their file plus a hash of its content, so a changed file
+ * gets a new texture. Textures without references are kept for later loads, until the used memory exceeds
+ * the budget and they are deleted least recently released first.
+ * Only meant to be used from the thread that owns the OpenGL context.
+ */
+class TextureManager
+{
+public:
+    static TextureManager &getInstance();
+
+    /**
+     * Load an image file, or share the texture if the same file with the same content is loaded already.
+     * @return An invalid reference if the file can't be read or decoded.
+     */
+    SharedTexture load(const std::string &path, TextureType type);
+
+    /**
+     * Load an image file that's embedded in another file (e.g. a model).
+     * @param name Unique name of the image, like the path of the model plus the index of the image.
+     */
+    SharedTexture loadFromMemory(const std::string &name, const unsigned char *data, std::size_t size,
+                                 TextureType type);
+
+    /**
+     * Load raw RGBA pixels, as some model formats embed them.
+     * @param name Unique name of the image, like the path of the model plus the index of the image.
+     */
+    SharedTexture loadFromPixels(const std::string &name, const unsigned char *pixels, GLuint width, GLuint height,
+                                 TextureType type);
+
+    /**
+     * Embedded image that was decoded and processed, but not uploaded yet (see prepareFromMemory).
+     */
+    struct PreparedTexture
+    {
+        std::string key;
+        TextureImage image; // no levels if the image couldn't be decoded
+    };
+
+    /**
+     * Decode and process an embedded image like loadFromMemory does, without touching OpenGL or the manager,
+     * so several images can be prepared in parallel. Upload them with addPrepared afterwards.
+     * @param flipVertically Whether the first row of the image is the bottom one in texture coordinates.
+     */
+    static PreparedTexture prepareFromMemory(const std::string &name, const unsigned char *data, std::size_t size,
+                                             bool flipVertically, TextureType type);
+
+    /**
+     * Upload a prepared image, or share the texture if the same image is loaded already.
+     * @return An invalid reference if the image couldn't be decoded.
+     */
+    SharedTexture addPrepared(const PreparedTexture &prepared);
+
+    /**
+     * Everything besides the image that changes how it's processed, part of the keys of processed images.
+     * Images baked into the AssetArchive are stored under their path plus the variant, since the formats depend
+     * on the context (see GlExtensions::setCompressionSupport).
+     */
+    static std::string getCacheVariant(bool flipVertically, TextureType type);
+
+    /**
+     * Memory all textures may use before unreferenced ones are deleted.
+     * Referenced textures are never deleted, so the used memory can still exceed the budget.
+     */
+    void setBudget(std::size_t bytes);
+    std::size_t getBudget() const;
+
+    /**
+     * Estimated video memory of all loaded textures (including mip levels).
+     */
+    std::size_t getUsedBytes() const;
+
+    /**
+     * Part of the used memory that belongs to textures without references.
+     */
+    std::size_t getUnusedBytes() const;
+
+    std::size_t getTextureCount() const;
+
+    /**
+     * Start reloading the textures that were loaded from a file, on a worker thread.
+     * @param path Canonical path of the changed file.
+     */
+    void reloadChanged(const std::string &path);
+
+    /**
+     * Upload the reloaded textures that are done and swap them in, the references stay valid and return the new ids.
+     * Everything that copied the ids of the textures needs to replace them. The old textures are deleted on the
+     * next call, after the users had a chance to let go of them.
+     * @return Old and new id of every replaced texture.
+     */
+    std::vector<std::pair<GLuint, GLuint>> finishReloads();
+
+    /**
+     * Delete all textures without references, needs to be called while the OpenGL context still exists.
+     * Reloads that are still running are waited for and dropped.
+     */
+    void releaseUnused();
+
+    // remove some functions for the singleton
+    TextureManager(TextureManager const &) = delete;
+    void operator=(TextureManager const &) = delete;
+
+private:
+    static constexpr std::size_t DEFAULT_BUDGET{512 * 1024 * 1024};
+
+    ObjectPool<TextureTag, ManagedTexture, ManagedTextureInfo> pool;
+    std::unordered_map<std::string, TextureHandle> textures;
+
+    // unreferenced textures, least recently used first
+    std::list<TextureHandle> unused;
+
+    // processed image of a reload, or an empty image if the file couldn't be read
+    struct ReloadResult
+    {
+        TextureImage image;
+        std::string cacheKey;
+    };
+
+    struct Reload
+    {
+        std::string key; // of the texture when the reload started
+        std::future<ReloadResult> result;
+    };
+
+    std::vector<Reload> reloads;
+
+    // textures that were replaced by reloads, deleted by the next finishReloads
+    std::vector<GLuint> retired;
+
+    std::size_t budget{DEFAULT_BUDGET};
+    std::size_t usedBytes{0};
+    std::size_t unusedBytes{0};
+
+    friend class SharedTexture;
+
+    TextureManager() = default;
+
+    void retain(TextureHandle texture);
+    void release(TextureHandle texture);
+    void evict(std::size_t maxUsedBytes);
+    void replace(TextureHandle texture, const ReloadResult &result);
+
+    SharedTexture find(const std::string &key);
+    SharedTexture add(const std::string &key, GLuint id, std::size_t bytes);
+
+    /**
+     * Load a texture that was processed when the asset archive was baked.
+     * @return An invalid reference if the archive has no entry for the current context.
+     */
+    SharedTexture loadBaked(const std::string &path, TextureType type);
+
+    /**
+     * Decode an image file that's already in memory, or take the processed texture from the cache if available.
+     * @return The texture, or 0 if the image can't be decoded.
+     */
+    static GLuint createFromMemory(const unsigned char *data, std::size_t size, bool flipVertically,
+                                   TextureType type, const std::string &cacheKey, std::size_t &bytes);
+
+    /**
+     * Read, decode and process an image file without touching OpenGL, so it can be done on any thread.
+     */
+    static ReloadResult processFile(const std::string &path, TextureType type);
+
+    /**
+     * Build the mip chain of decoded pixels, block compress it if the context supports it and store it in the cache.
+     * Doesn't touch OpenGL.
+     * @return False if the number of channels isn't supported.
+     */
+    static bool processPixels(const unsigned char *pixels, GLuint width, GLuint height, int nrChannels,
+                              TextureType type, const std::string &cacheKey, TextureImage &image);
+
+    /**
+     * Process decoded pixels (see processPixels), or take them from the cache if available, and upload them.
+     */
+    static GLuint createFromPixels(const unsigned char *pixels, GLuint width, GLuint height, int nrChannels,
+                                   TextureType type, const std::string &cacheKey, std::size_t &bytes);
+
+    /**
+     * Upload a texture with all of its mip levels.
+     */
+    static GLuint createGlTexture(const TextureImage &image, std::size_t &bytes, GLint wrappingMode = GL_REPEAT);
+};
+
+#endif
\ No newline at end of file
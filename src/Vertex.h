@@ -0,0 +1,15 @@
+#ifndef VERTEX_H
+#define VERTEX_H
+
+#include <glm/glm.hpp>
+
+// note: this could be optimized for meshes that don't have textures (or even normals)
+// separate vertex types could be introduced for that as an optimization
+struct Vertex
+{
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec2 textureCoordinates;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,263 @@
+#include "VirtualTextureFile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <boost/filesystem.hpp>
+
+#include "lib/stb_image.h"
+
+#include "MappedFile.h"
+#include "MipmapGenerator.h"
+
+namespace
+{
+    const char FILE_MAGIC[4]{'O', 'G', 'V', 'T'};
+    const std::uint32_t FILE_VERSION{1};
+
+    // the feedback pass stores page coordinates in 8 bits, which also guards against garbage sizes
+    const std::uint32_t MAX_PAGE_COUNT{256};
+
+    GLuint nextPowerOfTwo(GLuint value)
+    {
+        GLuint result = 1;
+        while (result < value)
+        {
+            result *= 2;
+        }
+        return result;
+    }
+
+    /**
+     * Bilinear RGBA lookup with wrapping, u and v are in texels of the image.
+     */
+    void sampleWrapped(const std::vector<unsigned char> &image, GLuint width, GLuint height, float u, float v,
+                       unsigned char *result)
+    {
+        float x = u - 0.5f;
+        float y = v - 0.5f;
+        float x0 = std::floor(x);
+        float y0 = std::floor(y);
+        float fractionX = x - x0;
+        float fractionY = y - y0;
+
+        auto wrap = [](long coordinate, GLuint size) {
+            long wrapped = coordinate % static_cast<long>(size);
+            return static_cast<std::size_t>(wrapped < 0 ? wrapped + size : wrapped);
+        };
+        std::size_t left = wrap(static_cast<long>(x0), width);
+        std::size_t right = wrap(static_cast<long>(x0) + 1, width);
+        std::size_t top = wrap(static_cast<long>(y0), height);
+        std::size_t bottom = wrap(static_cast<long>(y0) + 1, height);
+
+        for (int channel = 0; channel < 4; channel++)
+        {
+            float topValue = image[(top * width + left) * 4 + channel] * (1.0f - fractionX) +
+                             image[(top * width + right) * 4 + channel] * fractionX;
+            float bottomValue = image[(bottom * width + left) * 4 + channel] * (1.0f - fractionX) +
+                                image[(bottom * width + right) * 4 + channel] * fractionX;
+            result[channel] =
+                static_cast<unsigned char>(topValue * (1.0f - fractionY) + bottomValue * fractionY + 0.5f);
+        }
+    }
+} // namespace
+
+bool VirtualTextureFile::build(const std::string &imagePath, const std::string &outputPath)
+{
+    // mapped, so images in the asset archive are read the same way
+    MappedFile source;
+    if (!source.open(imagePath))
+    {
+        return false;
+    }
+
+    // pages are flipped like every other texture, to match OpenGL texture coordinates
+    stbi_set_flip_vertically_on_load_thread(true);
+    int width, height, nrChannels;
+    unsigned char *pixels =
+        stbi_load_from_memory(source.getData(), source.getSize(), &width, &height, &nrChannels, 4);
+    stbi_set_flip_vertically_on_load_thread(false);
+
+    if (!pixels)
+    {
+        std::cerr << "Could not read virtual texture source '" << imagePath << "'" << std::endl;
+        return false;
+    }
+
+    MipmapOptions mipmapOptions;
+    mipmapOptions.srgb = true;
+    std::vector<std::vector<unsigned char>> sourceLevels =
+        MipmapGenerator::generate(pixels, width, height, 4, mipmapOptions);
+    stbi_image_free(pixels);
+
+    // the page grid is rounded up to powers of two, so every level has exactly half the pages of the one above
+    VirtualTextureFile layout;
+    layout.pageCountX = nextPowerOfTwo((width + TILE_SIZE - 1) / TILE_SIZE);
+    layout.pageCountY = nextPowerOfTwo((height + TILE_SIZE - 1) / TILE_SIZE);
+    layout.levelCount =
+        static_cast<GLuint>(std::log2(std::max(layout.pageCountX, layout.pageCountY))) + 1;
+
+    if (layout.pageCountX > MAX_PAGE_COUNT || layout.pageCountY > MAX_PAGE_COUNT)
+    {
+        std::cerr << "Virtual texture source '" << imagePath << "' is too large" << std::endl;
+        return false;
+    }
+
+    Header header;
+    std::memcpy(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+    header.version = FILE_VERSION;
+    header.tileSize = TILE_SIZE;
+    header.borderSize = BORDER_SIZE;
+    header.pageCountX = layout.pageCountX;
+    header.pageCountY = layout.pageCountY;
+    header.levelCount = layout.levelCount;
+
+    // write to a temporary file first, so that a crash never leaves a half written file behind
+    std::string temporaryPath = outputPath + ".tmp";
+    {
+        std::ofstream output(temporaryPath, std::ios::binary | std::ios::trunc);
+        output.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+        std::vector<unsigned char> page(PAGE_BYTES);
+        for (GLuint level = 0; level < layout.levelCount; level++)
+        {
+            // pages are resampled from the source level that's closest in size,
+            // which only stretches images that don't fill the page grid
+            std::size_t sourceLevel = std::min<std::size_t>(level, sourceLevels.size() - 1);
+            GLuint sourceWidth = std::max(static_cast<GLuint>(width) >> sourceLevel, 1u);
+            GLuint sourceHeight = std::max(static_cast<GLuint>(height) >> sourceLevel, 1u);
+
+            GLuint pagesX = layout.getPageCountX(level);
+            GLuint pagesY = layout.getPageCountY(level);
+            float scaleX = static_cast<float>(sourceWidth) / (pagesX * TILE_SIZE);
+            float scaleY = static_cast<float>(sourceHeight) / (pagesY * TILE_SIZE);
+
+            for (GLuint pageY = 0; pageY < pagesY; pageY++)
+            {
+                for (GLuint pageX = 0; pageX < pagesX; pageX++)
+                {
+                    // the border repeats the neighbouring pages, wrapping around like GL_REPEAT
+                    for (GLuint y = 0; y < PAGE_SIZE; y++)
+                    {
+                        float virtualY = static_cast<float>(pageY * TILE_SIZE) + y - BORDER_SIZE + 0.5f;
+                        for (GLuint x = 0; x < PAGE_SIZE; x++)
+                        {
+                            float virtualX = static_cast<float>(pageX * TILE_SIZE) + x - BORDER_SIZE + 0.5f;
+                            sampleWrapped(sourceLevels[sourceLevel], sourceWidth, sourceHeight, virtualX * scaleX,
+                                          virtualY * scaleY, &page[(y * PAGE_SIZE + x) * 4]);
+                        }
+                    }
+
+                    output.write(reinterpret_cast<const char *>(page.data()), page.size());
+                }
+            }
+        }
+
+        if (!output)
+        {
+            std::cerr << "Failed writing virtual texture '" << temporaryPath << "'" << std::endl;
+            return false;
+        }
+    }
+
+    boost::system::error_code error;
+    boost::filesystem::rename(temporaryPath, outputPath, error);
+    if (error)
+    {
+        std::cerr << "Failed moving virtual texture to '" << outputPath << "': " << error.message() << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool VirtualTextureFile::open(const std::string &path)
+{
+    std::lock_guard<std::mutex> lock(fileMutex);
+
+    file.close();
+    file.clear();
+    levelCount = 0;
+
+    file.open(path, std::ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+
+    Header header;
+    if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0 || header.version != FILE_VERSION ||
+        header.tileSize != TILE_SIZE || header.borderSize != BORDER_SIZE || header.pageCountX == 0 ||
+        header.pageCountY == 0 || header.pageCountX > MAX_PAGE_COUNT || header.pageCountY > MAX_PAGE_COUNT ||
+        header.levelCount != static_cast<GLuint>(std::log2(std::max(header.pageCountX, header.pageCountY))) + 1)
+    {
+        file.close();
+        return false;
+    }
+
+    pageCountX = header.pageCountX;
+    pageCountY = header.pageCountY;
+    levelCount = header.levelCount;
+    computeLevelOffsets();
+
+    // a file that was cut off would only fail on some pages, so reject it right away
+    file.seekg(0, std::ios::end);
+    std::size_t expectedSize = sizeof(Header) + levelOffsets.back() * PAGE_BYTES;
+    if (static_cast<std::size_t>(file.tellg()) != expectedSize)
+    {
+        std::cerr << "Virtual texture '" << path << "' is truncated" << std::endl;
+        file.close();
+        levelCount = 0;
+        return false;
+    }
+
+    return true;
+}
+
+bool VirtualTextureFile::isOpen() const
+{
+    return levelCount > 0;
+}
+
+GLuint VirtualTextureFile::getLevelCount() const
+{
+    return levelCount;
+}
+
+GLuint VirtualTextureFile::getPageCountX(GLuint level) const
+{
+    return std::max(pageCountX >> level, 1u);
+}
+
+GLuint VirtualTextureFile::getPageCountY(GLuint level) const
+{
+    return std::max(pageCountY >> level, 1u);
+}
+
+bool VirtualTextureFile::readPage(GLuint level, GLuint x, GLuint y, std::vector<unsigned char> &pixels)
+{
+    if (level >= levelCount || x >= getPageCountX(level) || y >= getPageCountY(level))
+    {
+        return false;
+    }
+
+    std::size_t index = levelOffsets[level] + y * getPageCountX(level) + x;
+    pixels.resize(PAGE_BYTES);
+
+    std::lock_guard<std::mutex> lock(fileMutex);
+    file.clear();
+    file.seekg(sizeof(Header) + index * PAGE_BYTES);
+    return static_cast<bool>(file.read(reinterpret_cast<char *>(pixels.data()), PAGE_BYTES));
+}
+
+void VirtualTextureFile::computeLevelOffsets()
+{
+    // one more entry than levels, the last one is the total page count
+    levelOffsets.assign(levelCount + 1, 0);
+    for (GLuint level = 0; level < levelCount; level++)
+    {
+        levelOffsets[level + 1] = levelOffsets[level] + getPageCountX(level) * getPageCountY(level);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,76 @@
+#ifndef VIRTUALTEXTUREFILE_H
+#define VIRTUALTEXTUREFILE_H
+
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "lib/glad/include/glad/glad.h"
+
+/**
+ * Tiled on-disk format of a virtual texture.
+ * The virtual texture is a grid of pages on level 0 (a power of two in each direction), every level halves the
+ * page count until a single page covers the whole texture. Each page is stored as RGBA8 with a border of
+ * neighbouring texels, so it can be filtered bilinearly in the page cache without seams.
+ * Pages have a fixed size and are stored level by level and row by row, so their offset is computed, not looked up.
+ * Reading pages is thread-safe.
+ */
+class VirtualTextureFile
+{
+public:
+    // texels of a page without its border
+    static constexpr GLuint TILE_SIZE{128};
+    static constexpr GLuint BORDER_SIZE{4};
+    static constexpr GLuint PAGE_SIZE{TILE_SIZE + 2 * BORDER_SIZE};
+    static constexpr std::size_t PAGE_BYTES{PAGE_SIZE * PAGE_SIZE * 4};
+
+    /**
+     * Cut an image file into pages, including all levels.
+     * @return False if the image can't be read or the file can't be written.
+     */
+    static bool build(const std::string &imagePath, const std::string &outputPath);
+
+    /**
+     * @return False if the file doesn't exist or isn't a valid virtual texture.
+     */
+    bool open(const std::string &path);
+
+    bool isOpen() const;
+
+    GLuint getLevelCount() const;
+    GLuint getPageCountX(GLuint level) const;
+    GLuint getPageCountY(GLuint level) const;
+
+    /**
+     * Read the pixels of a page (PAGE_BYTES, including the border).
+     */
+    bool readPage(GLuint level, GLuint x, GLuint y, std::vector<unsigned char> &pixels);
+
+private:
+    struct Header
+    {
+        char magic[4];
+        std::uint32_t version;
+        std::uint32_t tileSize;
+        std::uint32_t borderSize;
+        std::uint32_t pageCountX;
+        std::uint32_t pageCountY;
+        std::uint32_t levelCount;
+    };
+
+    std::ifstream file;
+    std::mutex fileMutex;
+
+    GLuint pageCountX{0};
+    GLuint pageCountY{0};
+    GLuint levelCount{0};
+
+    // index of the first page of every level
+    std::vector<std::size_t> levelOffsets;
+
+    void computeLevelOffsets();
+};
+
+#endif
\ No newline at end of file
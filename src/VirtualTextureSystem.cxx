@@ -0,0 +1,570 @@
+#include "VirtualTextureSystem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#include "DirectoryHelper.h"
+#include "MappedFile.h"
+#include "TextureCache.h"
+
+VirtualTextureSystem::VirtualTextureSystem(GLuint width, GLuint height)
+{
+    // page cache, pages keep their border so bilinear filtering never reads from a neighbouring page
+    GLuint cacheSize = CACHE_PAGES_PER_ROW * VirtualTextureFile::PAGE_SIZE;
+    glGenTextures(1, &cacheTexture);
+    glBindTexture(GL_TEXTURE_2D, cacheTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, cacheSize, cacheSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+
+    cacheSlots.resize(CACHE_PAGES_PER_ROW * CACHE_PAGES_PER_ROW);
+    statistics.cachePages = cacheSlots.size();
+
+    for (Readback &readback : readbacks)
+    {
+        glGenBuffers(1, &readback.pixelBuffer);
+    }
+
+    resize(width, height);
+
+    for (std::size_t i = 0; i < STREAMING_THREAD_COUNT; i++)
+    {
+        streamingThreads.emplace_back(&VirtualTextureSystem::stream, this);
+    }
+}
+
+VirtualTextureSystem::~VirtualTextureSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueCondition.notify_all();
+    for (std::thread &thread : streamingThreads)
+    {
+        thread.join();
+    }
+
+    deleteFeedbackTargets();
+
+    for (Readback &readback : readbacks)
+    {
+        glDeleteBuffers(1, &readback.pixelBuffer);
+    }
+
+    for (std::unique_ptr<Texture> &texture : textures)
+    {
+        glDeleteTextures(1, &texture->pageTable);
+    }
+
+    glDeleteTextures(1, &cacheTexture);
+}
+
+int VirtualTextureSystem::addTexture(const std::string &imagePath)
+{
+    MappedFile source;
+    if (!source.open(imagePath))
+    {
+        std::cerr << "Could not read virtual texture '" << imagePath << "'" << std::endl;
+        return -1;
+    }
+
+    // the pages only depend on the content of the image, a changed image gets new pages
+    std::string key = TextureCache::makeKey(source.getData(), source.getSize(), "virtual");
+    std::string path = DirectoryHelper::getInstance().locateCache(key + ".vt");
+    if (path.empty())
+    {
+        std::cerr << "Virtual textures need a cache directory to store their pages" << std::endl;
+        return -1;
+    }
+
+    std::unique_ptr<Texture> texture(new Texture());
+    if (!texture->file.open(path))
+    {
+        if (!VirtualTextureFile::build(imagePath, path) || !texture->file.open(path))
+        {
+            return -1;
+        }
+    }
+
+    GLuint levelCount = texture->file.getLevelCount();
+    texture->pageSlots.resize(levelCount);
+
+    // one texel per page, the mip levels of the page table match the levels of the virtual texture
+    glGenTextures(1, &texture->pageTable);
+    glBindTexture(GL_TEXTURE_2D, texture->pageTable);
+    for (GLuint level = 0; level < levelCount; level++)
+    {
+        GLuint pagesX = texture->file.getPageCountX(level);
+        GLuint pagesY = texture->file.getPageCountY(level);
+        texture->pageSlots[level].assign(pagesX * pagesY, -1);
+        glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, pagesX, pagesY, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+
+    int index = textures.size();
+    textures.push_back(std::move(texture));
+    Texture &added = *textures.back();
+
+    // the single page of the coarsest level is loaded right away, so there's always something to show
+    LoadedPage root;
+    root.request.texture = index;
+    root.request.file = &added.file;
+    root.request.level = levelCount - 1;
+    root.valid = added.file.readPage(root.request.level, 0, 0, root.pixels);
+
+    int slot = root.valid ? uploadPage(root) : -1;
+    if (slot < 0)
+    {
+        std::cerr << "Could not load the coarsest page of virtual texture '" << imagePath << "'" << std::endl;
+    }
+    else
+    {
+        cacheSlots[slot].pinned = true;
+    }
+
+    updatePageTable(added);
+    return index;
+}
+
+void VirtualTextureSystem::resize(GLuint width, GLuint height)
+{
+    if (width == this->width && height == this->height)
+    {
+        return;
+    }
+
+    this->width = width;
+    this->height = height;
+
+    deleteFeedbackTargets();
+    createFeedbackTargets();
+
+    // old readbacks don't match the new size anymore
+    for (Readback &readback : readbacks)
+    {
+        readback.pending = false;
+    }
+    feedback.clear();
+}
+
+void VirtualTextureSystem::beginFeedback()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, feedbackFramebuffer);
+    glViewport(0, 0, std::max(width / FEEDBACK_SCALE, 1u), std::max(height / FEEDBACK_SCALE, 1u));
+
+    // zero means that no page is needed, so the background must not be read as a request
+    GLfloat clearColor[4];
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+}
+
+void VirtualTextureSystem::endFeedback()
+{
+    // the buffer that's about to be reused holds the oldest readback, which is done by now
+    finishReadback();
+
+    Readback &readback = readbacks[nextReadback];
+    readback.width = std::max(width / FEEDBACK_SCALE, 1u);
+    readback.height = std::max(height / FEEDBACK_SCALE, 1u);
+    readback.pending = true;
+
+    // copy into the pixel buffer asynchronously, it's mapped once it comes around again
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, feedbackFramebuffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pixelBuffer);
+    glBufferData(GL_PIXEL_PACK_BUFFER, readback.width * readback.height * 4, NULL, GL_STREAM_READ);
+    glReadPixels(0, 0, readback.width, readback.height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    nextReadback = (nextReadback + 1) % READBACK_BUFFER_COUNT;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, width, height);
+}
+
+void VirtualTextureSystem::update()
+{
+    statistics.uploadedPages = 0;
+    statistics.evictedPages = 0;
+
+    requestPages();
+    uploadPages();
+
+    for (std::unique_ptr<Texture> &texture : textures)
+    {
+        if (texture->pageTableChanged)
+        {
+            updatePageTable(*texture);
+        }
+    }
+
+    statistics.pendingPages = pendingPages.size();
+    frame++;
+}
+
+template <class ShaderType>
+void VirtualTextureSystem::bind(ShaderType &shader, int texture, GLuint firstTextureUnit) const
+{
+    const Texture &virtualTexture = *textures[texture];
+
+    glActiveTexture(GL_TEXTURE0 + firstTextureUnit);
+    glBindTexture(GL_TEXTURE_2D, virtualTexture.pageTable);
+    glActiveTexture(GL_TEXTURE0 + firstTextureUnit + 1);
+    glBindTexture(GL_TEXTURE_2D, cacheTexture);
+    glActiveTexture(GL_TEXTURE0);
+
+    shader.setInt("virtualTexture.pageTable", firstTextureUnit);
+    shader.setInt("virtualTexture.cache", firstTextureUnit + 1);
+    shader.setFloat("virtualTexture.pageCount", virtualTexture.file.getPageCountX(0),
+                    virtualTexture.file.getPageCountY(0));
+    shader.setFloat("virtualTexture.levelCount", virtualTexture.file.getLevelCount());
+    shader.setFloat("virtualTexture.tileSize", VirtualTextureFile::TILE_SIZE);
+    shader.setFloat("virtualTexture.borderSize", VirtualTextureFile::BORDER_SIZE);
+    shader.setFloat("virtualTexture.cachePagesPerRow", CACHE_PAGES_PER_ROW);
+    shader.setInt("virtualTexture.index", texture);
+
+    // one feedback pixel covers FEEDBACK_SCALE² pixels of the screen, so its derivatives are that much larger
+    shader.setFloat("feedbackLodBias", -std::log2(static_cast<float>(FEEDBACK_SCALE)));
+}
+
+template void VirtualTextureSystem::bind<Shader>(Shader &shader, int texture, GLuint firstTextureUnit) const;
+template void VirtualTextureSystem::bind<ShaderVariants>(ShaderVariants &shader, int texture,
+                                                         GLuint firstTextureUnit) const;
+
+const VirtualTextureStatistics &VirtualTextureSystem::getStatistics() const
+{
+    return statistics;
+}
+
+std::uint64_t VirtualTextureSystem::makePageKey(int texture, GLuint level, GLuint x, GLuint y)
+{
+    return (static_cast<std::uint64_t>(texture) << 40) | (static_cast<std::uint64_t>(level) << 32) |
+           (static_cast<std::uint64_t>(x) << 16) | y;
+}
+
+void VirtualTextureSystem::createFeedbackTargets()
+{
+    GLuint feedbackWidth = std::max(width / FEEDBACK_SCALE, 1u);
+    GLuint feedbackHeight = std::max(height / FEEDBACK_SCALE, 1u);
+
+    glGenTextures(1, &feedbackTexture);
+    glBindTexture(GL_TEXTURE_2D, feedbackTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, feedbackWidth, feedbackHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    glGenRenderbuffers(1, &feedbackDepth);
+    glBindRenderbuffer(GL_RENDERBUFFER, feedbackDepth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, feedbackWidth, feedbackHeight);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &feedbackFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, feedbackFramebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, feedbackTexture, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, feedbackDepth);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cerr << "Virtual texture feedback framebuffer is incomplete" << std::endl;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void VirtualTextureSystem::deleteFeedbackTargets()
+{
+    if (!feedbackFramebuffer)
+    {
+        return;
+    }
+
+    glDeleteFramebuffers(1, &feedbackFramebuffer);
+    glDeleteTextures(1, &feedbackTexture);
+    glDeleteRenderbuffers(1, &feedbackDepth);
+
+    feedbackFramebuffer = 0;
+}
+
+void VirtualTextureSystem::finishReadback()
+{
+    Readback &readback = readbacks[nextReadback];
+
+    if (!readback.pending)
+    {
+        return;
+    }
+
+    std::size_t size = readback.width * readback.height * 4;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pixelBuffer);
+    const unsigned char *data =
+        static_cast<const unsigned char *>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT));
+
+    if (data)
+    {
+        feedback.assign(data, data + size);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    readback.pending = false;
+}
+
+void VirtualTextureSystem::requestPages()
+{
+    if (feedback.empty())
+    {
+        return;
+    }
+
+    // many pixels need the same page, so every page is only looked at once
+    std::unordered_set<std::uint64_t> visitedPages;
+    std::unordered_set<std::uint64_t> missingKeys;
+    std::vector<PageRequest> missingPages;
+
+    for (std::size_t i = 0; i + 3 < feedback.size(); i += 4)
+    {
+        // alpha holds the texture index plus one, zero means nothing with a virtual texture was drawn there
+        int textureIndex = static_cast<int>(feedback[i + 3]) - 1;
+        if (textureIndex < 0 || textureIndex >= static_cast<int>(textures.size()))
+        {
+            continue;
+        }
+
+        Texture &texture = *textures[textureIndex];
+        GLuint levelCount = texture.file.getLevelCount();
+        GLuint level = std::min<GLuint>(feedback[i + 2], levelCount - 1);
+        GLuint x = feedback[i];
+        GLuint y = feedback[i + 1];
+        if (x >= texture.file.getPageCountX(level) || y >= texture.file.getPageCountY(level) ||
+            !visitedPages.insert(makePageKey(textureIndex, level, x, y)).second)
+        {
+            continue;
+        }
+
+        // walk up to the first resident page, which is what's shown in the meantime,
+        // every missing page on the way is requested so the image gets sharper step by step
+        for (; level < levelCount; level++, x /= 2, y /= 2)
+        {
+            int slot = texture.pageSlots[level][y * texture.file.getPageCountX(level) + x];
+            if (slot >= 0)
+            {
+                cacheSlots[slot].lastUsedFrame = frame;
+                break;
+            }
+
+            std::uint64_t key = makePageKey(textureIndex, level, x, y);
+            if (pendingPages.count(key) == 0 && missingKeys.insert(key).second)
+            {
+                PageRequest request;
+                request.texture = textureIndex;
+                request.file = &texture.file;
+                request.level = level;
+                request.x = x;
+                request.y = y;
+                missingPages.push_back(request);
+            }
+        }
+    }
+    feedback.clear();
+
+    // coarse pages first, they cover more of the screen and are the fallback of the finer ones
+    std::stable_sort(missingPages.begin(), missingPages.end(),
+                     [](const PageRequest &a, const PageRequest &b) { return a.level > b.level; });
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        for (const PageRequest &request : missingPages)
+        {
+            if (pendingPages.size() >= MAX_PENDING_PAGES)
+            {
+                break;
+            }
+
+            pendingPages.insert(makePageKey(request.texture, request.level, request.x, request.y));
+            requests.push_back(request);
+        }
+    }
+    queueCondition.notify_all();
+}
+
+void VirtualTextureSystem::uploadPages()
+{
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        for (LoadedPage &page : loadedPages)
+        {
+            readyPages.push_back(std::move(page));
+        }
+        loadedPages.clear();
+    }
+
+    std::size_t uploads = 0;
+    while (!readyPages.empty() && uploads < MAX_UPLOADS_PER_FRAME)
+    {
+        LoadedPage page = std::move(readyPages.front());
+        readyPages.pop_front();
+
+        const PageRequest &request = page.request;
+        pendingPages.erase(makePageKey(request.texture, request.level, request.x, request.y));
+
+        if (!page.valid)
+        {
+            std::cerr << "Could not read page " << request.x << ", " << request.y << " of level " << request.level
+                      << " of virtual texture " << request.texture << std::endl;
+            continue;
+        }
+
+        // every cached page is needed for the current frame, the page is requested again later
+        if (uploadPage(page) < 0)
+        {
+            break;
+        }
+        uploads++;
+    }
+}
+
+int VirtualTextureSystem::uploadPage(const LoadedPage &page)
+{
+    int slot = allocateSlot();
+    if (slot < 0)
+    {
+        return -1;
+    }
+
+    GLuint slotX = slot % CACHE_PAGES_PER_ROW;
+    GLuint slotY = slot / CACHE_PAGES_PER_ROW;
+    glBindTexture(GL_TEXTURE_2D, cacheTexture);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, slotX * VirtualTextureFile::PAGE_SIZE, slotY * VirtualTextureFile::PAGE_SIZE,
+                    VirtualTextureFile::PAGE_SIZE, VirtualTextureFile::PAGE_SIZE, GL_RGBA, GL_UNSIGNED_BYTE,
+                    page.pixels.data());
+
+    const PageRequest &request = page.request;
+    CacheSlot &cacheSlot = cacheSlots[slot];
+    cacheSlot.texture = request.texture;
+    cacheSlot.level = request.level;
+    cacheSlot.x = request.x;
+    cacheSlot.y = request.y;
+    cacheSlot.lastUsedFrame = frame;
+
+    Texture &texture = *textures[request.texture];
+    texture.pageSlots[request.level][request.y * texture.file.getPageCountX(request.level) + request.x] = slot;
+    texture.pageTableChanged = true;
+
+    statistics.uploadedPages++;
+    statistics.residentPages++;
+    return slot;
+}
+
+int VirtualTextureSystem::allocateSlot()
+{
+    // take a free slot, otherwise replace the least recently used page that isn't needed for the current frame
+    int leastRecentlyUsed = -1;
+    for (std::size_t i = 0; i < cacheSlots.size(); i++)
+    {
+        const CacheSlot &slot = cacheSlots[i];
+        if (slot.texture < 0)
+        {
+            return i;
+        }
+
+        if (!slot.pinned && slot.lastUsedFrame < frame &&
+            (leastRecentlyUsed < 0 || slot.lastUsedFrame < cacheSlots[leastRecentlyUsed].lastUsedFrame))
+        {
+            leastRecentlyUsed = i;
+        }
+    }
+
+    if (leastRecentlyUsed >= 0)
+    {
+        CacheSlot &slot = cacheSlots[leastRecentlyUsed];
+        Texture &owner = *textures[slot.texture];
+        owner.pageSlots[slot.level][slot.y * owner.file.getPageCountX(slot.level) + slot.x] = -1;
+        owner.pageTableChanged = true;
+        slot = CacheSlot();
+
+        statistics.evictedPages++;
+        statistics.residentPages--;
+    }
+
+    return leastRecentlyUsed;
+}
+
+void VirtualTextureSystem::updatePageTable(Texture &texture)
+{
+    glBindTexture(GL_TEXTURE_2D, texture.pageTable);
+
+    // from coarse to fine, so missing pages can copy the entry of the page that covers them on the level above
+    GLuint levelCount = texture.file.getLevelCount();
+    std::vector<unsigned char> coarserEntries;
+    for (GLuint level = levelCount; level-- > 0;)
+    {
+        GLuint pagesX = texture.file.getPageCountX(level);
+        GLuint pagesY = texture.file.getPageCountY(level);
+        GLuint coarserPagesX = level + 1 < levelCount ? texture.file.getPageCountX(level + 1) : 0;
+
+        // cache slot in red and green, level of the page in blue, alpha marks valid entries
+        std::vector<unsigned char> entries(pagesX * pagesY * 4, 0);
+        for (GLuint y = 0; y < pagesY; y++)
+        {
+            for (GLuint x = 0; x < pagesX; x++)
+            {
+                unsigned char *entry = &entries[(y * pagesX + x) * 4];
+                int slot = texture.pageSlots[level][y * pagesX + x];
+                if (slot >= 0)
+                {
+                    entry[0] = slot % CACHE_PAGES_PER_ROW;
+                    entry[1] = slot / CACHE_PAGES_PER_ROW;
+                    entry[2] = level;
+                    entry[3] = 255;
+                }
+                else if (!coarserEntries.empty())
+                {
+                    std::memcpy(entry, &coarserEntries[((y / 2) * coarserPagesX + x / 2) * 4], 4);
+                }
+            }
+        }
+
+        glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, pagesX, pagesY, GL_RGBA, GL_UNSIGNED_BYTE, entries.data());
+        coarserEntries = std::move(entries);
+    }
+
+    texture.pageTableChanged = false;
+}
+
+void VirtualTextureSystem::stream()
+{
+    while (true)
+    {
+        PageRequest request;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueCondition.wait(lock, [this] { return stopping || !requests.empty(); });
+            if (stopping)
+            {
+                return;
+            }
+
+            request = requests.front();
+            requests.pop_front();
+        }
+
+        // the file is read outside of the lock, so the OpenGL thread never waits for the disk
+        LoadedPage page;
+        page.request = request;
+        page.valid = request.file->readPage(request.level, request.x, request.y, page.pixels);
+
+        std::lock_guard<std::mutex> lock(queueMutex);
+        loadedPages.push_back(std::move(page));
+    }
+}
\ No newline at end of file
@@ -0,0 +1,201 @@
+#ifndef VIRTUALTEXTURESYSTEM_H
+#define VIRTUALTEXTURESYSTEM_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "lib/glad/include/glad/glad.h"
+
+#include "Shader.h"
+#include "ShaderVariants.h"
+#include "VirtualTextureFile.h"
+
+struct VirtualTextureStatistics
+{
+    std::size_t residentPages{0};
+    std::size_t cachePages{0};
+    std::size_t pendingPages{0};
+    std::size_t uploadedPages{0};
+    std::size_t evictedPages{0};
+};
+
+/**
+ * Virtual texturing on plain OpenGL 3.3, so the texture memory depends on the screen resolution instead of the
+ * size of the textures.
+ * Textures are split into pages (see VirtualTextureFile), only the pages that are visible are kept in a fixed size
+ * page cache texture. Every virtual texture has a page table texture with one texel per page and level,
+ * which points to the cached page, or to the closest coarser page that is cached if it's missing.
+ * Objects are drawn into a small feedback framebuffer first, which records the pages they need. The feedback is
+ * read back asynchronously, missing pages are read from disk by streaming threads and uploaded a few per frame,
+ * the least recently used pages are replaced when the cache is full.
+ */
+class VirtualTextureSystem
+{
+public:
+    VirtualTextureSystem(GLuint width, GLuint height);
+    virtual ~VirtualTextureSystem();
+
+    /**
+     * Add an image as virtual texture, its pages are built into the cache directory on the first use.
+     * @return Index of the texture, or -1 if the image can't be read.
+     */
+    int addTexture(const std::string &imagePath);
+
+    void resize(GLuint width, GLuint height);
+
+    /**
+     * Bind and clear the feedback framebuffer, objects with virtual textures need to be drawn into it
+     * with a shader based on 07_virtualTextureFeedback.frag afterwards.
+     */
+    void beginFeedback();
+
+    /**
+     * Start reading back the feedback and bind the default framebuffer again.
+     */
+    void endFeedback();
+
+    /**
+     * Request the pages the most recent feedback readback is missing and upload the pages the streaming threads
+     * finished loading. Needs to be called once per frame.
+     */
+    void update();
+
+    /**
+     * Set the uniforms (struct virtualTexture) and textures a shader needs to sample a virtual texture.
+     * Works with a Shader as well as with ShaderVariants.
+     * @param firstTextureUnit The page table and the page cache use this and the following texture unit.
+     */
+    template <class ShaderType>
+    void bind(ShaderType &shader, int texture, GLuint firstTextureUnit) const;
+
+    const VirtualTextureStatistics &getStatistics() const;
+
+    // remove copy functions, the system owns OpenGL objects and threads
+    VirtualTextureSystem(VirtualTextureSystem const &) = delete;
+    void operator=(VirtualTextureSystem const &) = delete;
+
+private:
+    // the feedback framebuffer is this many times smaller than the screen
+    static constexpr GLuint FEEDBACK_SCALE{8};
+
+    // the page cache holds CACHE_PAGES_PER_ROW² pages
+    static constexpr GLuint CACHE_PAGES_PER_ROW{16};
+
+    // limits the time spent in glTexSubImage2D, the rest is uploaded in later frames
+    static constexpr std::size_t MAX_UPLOADS_PER_FRAME{16};
+
+    // requests beyond this are dropped, the feedback asks for them again once the queue got shorter
+    static constexpr std::size_t MAX_PENDING_PAGES{64};
+
+    static constexpr std::size_t STREAMING_THREAD_COUNT{2};
+
+    // number of pixel buffers the readback cycles through, so mapping never waits for the GPU
+    static constexpr std::size_t READBACK_BUFFER_COUNT{2};
+
+    struct Texture
+    {
+        VirtualTextureFile file;
+        GLuint pageTable{0};
+
+        // cache slot of every page on every level, -1 if it isn't resident
+        std::vector<std::vector<int>> pageSlots;
+        bool pageTableChanged{false};
+    };
+
+    struct CacheSlot
+    {
+        int texture{-1};
+        GLuint level{0};
+        GLuint x{0};
+        GLuint y{0};
+        std::uint64_t lastUsedFrame{0};
+
+        // the coarsest level is the fallback for everything else, so it's never replaced
+        bool pinned{false};
+    };
+
+    struct PageRequest
+    {
+        int texture{-1};
+        VirtualTextureFile *file{nullptr};
+        GLuint level{0};
+        GLuint x{0};
+        GLuint y{0};
+    };
+
+    struct LoadedPage
+    {
+        PageRequest request;
+        std::vector<unsigned char> pixels;
+        bool valid{false};
+    };
+
+    struct Readback
+    {
+        GLuint pixelBuffer{0};
+        GLuint width{0};
+        GLuint height{0};
+        bool pending{false};
+    };
+
+    GLuint width{0};
+    GLuint height{0};
+
+    std::vector<std::unique_ptr<Texture>> textures;
+
+    GLuint cacheTexture{0};
+    std::vector<CacheSlot> cacheSlots;
+    std::uint64_t frame{1};
+
+    GLuint feedbackFramebuffer{0};
+    GLuint feedbackTexture{0};
+    GLuint feedbackDepth{0};
+    Readback readbacks[READBACK_BUFFER_COUNT];
+    std::size_t nextReadback{0};
+
+    // pixels of the most recent readback, consumed by the next update
+    std::vector<unsigned char> feedback;
+
+    // pages that were requested from the streaming threads, only used by the OpenGL thread
+    std::unordered_set<std::uint64_t> pendingPages;
+
+    // loaded pages that didn't fit into the upload limit of their frame
+    std::deque<LoadedPage> readyPages;
+
+    // shared with the streaming threads
+    std::mutex queueMutex;
+    std::condition_variable queueCondition;
+    std::deque<PageRequest> requests;
+    std::vector<LoadedPage> loadedPages;
+    bool stopping{false};
+    std::vector<std::thread> streamingThreads;
+
+    VirtualTextureStatistics statistics;
+
+    static std::uint64_t makePageKey(int texture, GLuint level, GLuint x, GLuint y);
+
+    void createFeedbackTargets();
+    void deleteFeedbackTargets();
+    void finishReadback();
+
+    void requestPages();
+    void uploadPages();
+
+    /**
+     * @return The cache slot the page was copied to, or -1 if the cache has no slot to spare.
+     */
+    int uploadPage(const LoadedPage &page);
+    int allocateSlot();
+    void updatePageTable(Texture &texture);
+
+    void stream();
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,251 @@
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include <boost/filesystem.hpp>
+
+#include <assimp/Importer.hpp>
+
+#include "AssetArchive.h"
+#include "GlExtensions.h"
+#include "JobSystem.h"
+#include "MappedFile.h"
+#include "Model.h"
+#include "PackedModel.h"
+#include "TextureCache.h"
+#include "TextureManager.h"
+
+namespace
+{
+    // prototypes
+    bool readFile(const std::string &path, std::vector<unsigned char> &data);
+    bool isModel(const boost::filesystem::path &path);
+    std::string escapeDependency(const std::string &path);
+    bool writeDepfile(const std::string &path, const std::string &target, const std::vector<std::string> &inputs);
+
+    bool readFile(const std::string &path, std::vector<unsigned char> &data)
+    {
+        MappedFile file;
+        if (!file.open(path))
+        {
+            return false;
+        }
+        data.assign(file.getData(), file.getData() + file.getSize());
+        return true;
+    }
+
+    bool isModel(const boost::filesystem::path &path)
+    {
+        std::string extension = path.extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+        if (extension.empty() || extension == ".mtl" || extension == ".bin")
+        {
+            return false;
+        }
+        return Assimp::Importer().IsExtensionSupported(extension);
+    }
+
+    std::string escapeDependency(const std::string &path)
+    {
+        // depfiles use the make syntax, which ninja reads as well
+        std::string escaped;
+        for (char c : path)
+        {
+            if (c == ' ' || c == '#')
+            {
+                escaped += '\\';
+            }
+            else if (c == '$')
+            {
+                escaped += '$';
+            }
+            escaped += c;
+        }
+        return escaped;
+    }
+
+    bool writeDepfile(const std::string &path, const std::string &target, const std::vector<std::string> &inputs)
+    {
+        std::ofstream file(path);
+        file << escapeDependency(target) << ':';
+        for (const std::string &input : inputs)
+        {
+            file << " \\\n " << escapeDependency(input);
+        }
+        file << '\n';
+
+        if (!file)
+        {
+            std::cerr << "Failed writing '" << path << "'" << std::endl;
+            return false;
+        }
+        return true;
+    }
+} // namespace
+
+/**
+ * Bakes a data directory into an AssetArchive.
+ * Every file is archived as it is, models are imported and stored in the layout of the geometry pool as well,
+ * the textures they use are processed and compressed for the given profile.
+ */
+int main(int argc, char *argv[])
+{
+    bool s3tc = true;
+    bool bptc = true;
+    std::string depfile;
+    std::vector<std::string> arguments;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--depfile") == 0 && i + 1 < argc)
+        {
+            depfile = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--no-s3tc") == 0)
+        {
+            s3tc = false;
+        }
+        else if (std::strcmp(argv[i], "--no-bptc") == 0)
+        {
+            bptc = false;
+        }
+        else
+        {
+            arguments.push_back(argv[i]);
+        }
+    }
+
+    if (arguments.size() != 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " <data directory> <archive> [--no-s3tc] [--no-bptc] [--depfile <path>]"
+                  << std::endl;
+        return 1;
+    }
+
+    // the textures are compressed like on a context with these extensions, others decode the archived images
+    GlExtensions::setCompressionSupport(s3tc, bptc);
+
+    boost::filesystem::path dataDir(arguments[0]);
+    boost::system::error_code error;
+    if (!boost::filesystem::is_directory(dataDir, error))
+    {
+        std::cerr << "'" << dataDir.string() << "' isn't a directory" << std::endl;
+        return 1;
+    }
+
+    AssetArchiveWriter writer;
+    std::vector<std::pair<std::string, TextureType>> textures;
+    std::size_t modelCount = 0;
+
+    // the directories are dependencies too, so added or removed files rebuild the archive
+    std::vector<std::string> inputs{dataDir.string()};
+    for (boost::filesystem::recursive_directory_iterator it(dataDir, error), end; !error && it != end;
+         it.increment(error))
+    {
+        if (boost::filesystem::is_directory(it->status()))
+        {
+            inputs.push_back(it->path().string());
+            continue;
+        }
+        if (!boost::filesystem::is_regular_file(it->status()))
+        {
+            continue;
+        }
+
+        std::string path = it->path().string();
+        std::string name = AssetArchive::getName(it->path().lexically_relative(dataDir).generic_string());
+        if (name == AssetArchive::getFileName())
+        {
+            continue;
+        }
+
+        std::vector<unsigned char> data;
+        if (!readFile(path, data))
+        {
+            return 1;
+        }
+        writer.add(name, std::move(data));
+        inputs.push_back(path);
+
+        if (!isModel(it->path()))
+        {
+            continue;
+        }
+
+        std::unique_ptr<aiScene> scene = ModelPool::importScene(path);
+        std::vector<unsigned char> model;
+        std::vector<std::pair<std::string, TextureType>> modelTextures;
+        if (!scene || !PackedModel::bake(*scene, model, modelTextures))
+        {
+            std::cerr << "Skipped baking the model '" << name << "', it's imported at runtime" << std::endl;
+            continue;
+        }
+        writer.add(PackedModel::getEntryName(name), std::move(model));
+        modelCount++;
+
+        // the texture paths are relative to the model
+        std::string modelDir = boost::filesystem::path(name).parent_path().generic_string();
+        for (const std::pair<std::string, TextureType> &texture : modelTextures)
+        {
+            std::pair<std::string, TextureType> entry{
+                AssetArchive::getName(modelDir.empty() ? texture.first : modelDir + '/' + texture.first),
+                texture.second};
+            if (std::find(textures.begin(), textures.end(), entry) == textures.end())
+            {
+                textures.push_back(entry);
+            }
+        }
+    }
+
+    if (error)
+    {
+        std::cerr << "Failed reading '" << dataDir.string() << "': " << error.message() << std::endl;
+        return 1;
+    }
+
+    // processing the textures dominates, they're independent of each other
+    std::vector<std::vector<unsigned char>> bakedTextures(textures.size());
+    JobSystem::getInstance().parallelFor(textures.size(), [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; i++)
+        {
+            std::vector<unsigned char> data;
+            if (!readFile((dataDir / textures[i].first).string(), data))
+            {
+                continue;
+            }
+
+            TextureManager::PreparedTexture prepared = TextureManager::prepareFromMemory(
+                textures[i].first, data.data(), data.size(), true, textures[i].second);
+            if (!prepared.image.levels.empty())
+            {
+                bakedTextures[i] = TextureCache::serialize(prepared.image);
+            }
+        }
+    });
+
+    std::size_t textureCount = 0;
+    for (std::size_t i = 0; i < textures.size(); i++)
+    {
+        if (bakedTextures[i].empty())
+        {
+            std::cerr << "Skipped baking the texture '" << textures[i].first << "'" << std::endl;
+            continue;
+        }
+        writer.add(textures[i].first + '|' + TextureManager::getCacheVariant(true, textures[i].second),
+                   std::move(bakedTextures[i]));
+        textureCount++;
+    }
+
+    if (!writer.write(arguments[1]) || (!depfile.empty() && !writeDepfile(depfile, arguments[1], inputs)))
+    {
+        return 1;
+    }
+
+    std::cout << "Wrote " << writer.getEntryCount() << " entries (" << modelCount << " baked models, " << textureCount
+              << " baked textures) to '" << arguments[1] << "'" << std::endl;
+    return 0;
+}
\ No newline at end of file